@@ -126,7 +126,7 @@ public class AutoMixEngine {
     // MARK: - Library Scanning
     
     /// Scans a directory for music files and analyzes them. This is a blocking operation.
-    /// Wraps `automix_scan` and `automix_scan_with_callback`.
+    /// Wraps `automix_scan_with_callback_mode`.
     ///
     /// - Parameters:
     ///   - musicDir: Path to the directory containing music files.
@@ -134,11 +134,15 @@ public class AutoMixEngine {
     ///   - progress: Optional callback closure with parameters (current file path, files processed, total files).
     ///               If omitted, the no-callback variant is called.
     ///   - metadataOnly: When true, only collect path/duration/mtime without BPM/key analysis.
+    ///   - fast: When true, analyze only short excerpts of each track (ignored if metadataOnly).
+    ///           A later full scan re-analyzes tracks whose excerpt analysis had low confidence.
     /// - Returns: The number of tracks successfully processed.
     /// - Throws: An `AutoMixError` if scanning fails or a database error occurs.
-    public func scan(musicDir: String, recursive: Bool, progress: ((String, Int, Int) -> Void)? = nil, metadataOnly: Bool = false) throws -> Int {
+    public func scan(musicDir: String, recursive: Bool, progress: ((String, Int, Int) -> Void)? = nil, metadataOnly: Bool = false, fast: Bool = false) throws -> Int {
         guard let engine = enginePtr else { throw AutoMixError.notInitialized }
         
+        let mode: AutoMixScanMode = metadataOnly ? AUTOMIX_SCAN_METADATA_ONLY : (fast ? AUTOMIX_SCAN_FAST : AUTOMIX_SCAN_FULL)
+        
         if let progress = progress {
             let context = ScanContext(callback: progress)
             let contextPtr = Unmanaged.passRetained(context).toOpaque()
@@ -154,13 +158,13 @@ public class AutoMixEngine {
                 context.callback(filePath, Int(filesProcessed), Int(filesTotal))
             }
             
-            let result = automix_scan_with_callback_ex(
+            let result = automix_scan_with_callback_mode(
                 engine,
                 musicDir,
                 recursive ? 1 : 0,
                 callback,
                 contextPtr,
-                metadataOnly ? 1 : 0
+                mode
             )
             
             if result < 0 {
@@ -168,7 +172,7 @@ public class AutoMixEngine {
             }
             return Int(result)
         } else {
-            let result = automix_scan_ex(engine, musicDir, recursive ? 1 : 0, metadataOnly ? 1 : 0)
+            let result = automix_scan_with_callback_mode(engine, musicDir, recursive ? 1 : 0, nil, nil, mode)
             if result < 0 {
                 throw AutoMixError.from(code: Int32(result))
             }
@@ -177,9 +181,9 @@ public class AutoMixEngine {
     }
     
     /// Async version of scan without progress reporting.
-    public func scan(musicDir: String, recursive: Bool, metadataOnly: Bool = false) async throws -> Int {
+    public func scan(musicDir: String, recursive: Bool, metadataOnly: Bool = false, fast: Bool = false) async throws -> Int {
         return try await Task.detached(priority: .userInitiated) {
-            try self.scan(musicDir: musicDir, recursive: recursive, progress: nil, metadataOnly: metadataOnly)
+            try self.scan(musicDir: musicDir, recursive: recursive, progress: nil, metadataOnly: metadataOnly, fast: fast)
         }.value
     }
     
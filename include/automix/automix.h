@@ -42,6 +42,31 @@ typedef enum {
     AUTOMIX_STATE_TRANSITIONING = 3,
 } AutoMixPlaybackState;
 
+/* Library scan modes */
+typedef enum {
+    AUTOMIX_SCAN_FULL = 0,          /* Decode and analyze whole tracks */
+    AUTOMIX_SCAN_METADATA_ONLY = 1, /* Path/duration/mtime only */
+    AUTOMIX_SCAN_FAST = 2,          /* Analyze a few excerpts per track */
+} AutoMixScanMode;
+
+/* Throughput of one scan pipeline stage */
+typedef struct {
+    int workers;                    /* 0 if the stage was not used */
+    int completed;
+    int failed;
+    double files_per_second;
+    double utilization;             /* Busy share of worker time (0-1); near 1 marks the bottleneck */
+} AutoMixScanStageStats;
+
+/* Scan pipeline statistics */
+typedef struct {
+    AutoMixScanStageStats read;     /* File I/O */
+    AutoMixScanStageStats decode;
+    AutoMixScanStageStats analyze;
+    AutoMixScanStageStats write;    /* Database writer (single thread) */
+    double elapsed_seconds;
+} AutoMixScanStats;
+
 /* Track information */
 typedef struct {
     int64_t id;
@@ -185,6 +210,95 @@ int automix_scan_with_callback_ex(
     int metadata_only
 );
 
+/**
+ * Scan with progress callback and an explicit scan mode.
+ * AUTOMIX_SCAN_FAST decodes only short excerpts (intro, middle, outro) of
+ * each track for a much quicker first import. Its BPM/key are estimated
+ * from the excerpts with a confidence score; a later AUTOMIX_SCAN_FULL
+ * scan re-analyzes the tracks whose confidence is low.
+ * AUTOMIX_SCAN_METADATA_ONLY behaves like metadata_only in automix_scan_ex().
+ */
+int automix_scan_with_callback_mode(
+    AutoMixEngine* engine,
+    const char* music_dir,
+    int recursive,
+    AutoMixScanCallback callback,
+    void* user_data,
+    AutoMixScanMode mode
+);
+
+/**
+ * Get per-stage scan statistics. Called from a scan callback it reports
+ * the scan in progress; otherwise the last finished scan.
+ */
+AutoMixError automix_get_scan_stats(AutoMixEngine* engine, AutoMixScanStats* stats);
+
+/**
+ * Set worker threads per scan stage for later scans.
+ * Files are read, decoded and analyzed by separate thread pools joined by
+ * bounded queues; a single thread writes to the database. Pass 0 to size a
+ * stage automatically from the CPU count. More readers help with network
+ * storage; readers are unused by fast and metadata-only scans.
+ */
+AutoMixError automix_set_scan_concurrency(AutoMixEngine* engine, int readers, int decoders, int analyzers);
+
+/**
+ * Enable or disable the directory cache for later recursive scans
+ * (enabled by default). Directories unchanged since the last scan are not
+ * listed again; the files the library has there are still checked for
+ * in-place edits.
+ */
+AutoMixError automix_set_scan_directory_cache(AutoMixEngine* engine, int enabled);
+
+/* ============================================================================
+ * Watch Mode
+ * ============================================================================ */
+
+/* Library change applied while watching */
+typedef enum {
+    AUTOMIX_WATCH_ANALYZED = 0,     /* New or modified file analyzed */
+    AUTOMIX_WATCH_FAILED = 1,       /* New or modified file could not be analyzed */
+    AUTOMIX_WATCH_RENAMED = 2,      /* File or directory moved; analysis kept */
+    AUTOMIX_WATCH_REMOVED = 3,      /* File or directory deleted from the library */
+    AUTOMIX_WATCH_RESCANNED = 4     /* Events were lost; the folder was rescanned */
+} AutoMixWatchEvent;
+
+/**
+ * Watch callback type. old_path is set for AUTOMIX_WATCH_RENAMED, else NULL.
+ */
+typedef void (*AutoMixWatchCallback)(
+    AutoMixWatchEvent event,
+    const char* path,
+    const char* old_path,
+    void* user_data
+);
+
+/**
+ * Start watching a music directory for changes (Linux only).
+ * Changes are queued from this call on: run a scan next to catch up, then
+ * automix_watch_run() to apply them.
+ */
+AutoMixError automix_watch_start(AutoMixEngine* engine, const char* music_dir, int recursive);
+
+/**
+ * Apply library changes as they happen until automix_watch_stop().
+ * Blocks; the callback runs on the calling thread or a scan worker.
+ *
+ * @return Number of library changes applied, or negative error code
+ */
+int automix_watch_run(
+    AutoMixEngine* engine,
+    AutoMixWatchCallback callback,
+    void* user_data,
+    AutoMixScanMode mode
+);
+
+/**
+ * Make automix_watch_run() return. Safe from other threads and signal handlers,
+ * also while or after automix_watch_run() returns.
+ */
+AutoMixError automix_watch_stop(AutoMixEngine* engine);
+
 /**
  * Get the number of tracks in the library.
  */
@@ -356,6 +470,39 @@ AutoMixError automix_previous(AutoMixEngine* engine);
  */
 AutoMixError automix_seek(AutoMixEngine* engine, float position_seconds);
 
+/* Queue editing: change upcoming tracks without interrupting playback.
+ * Positions count from the current track (0); the next track is position 1.
+ * Only the transitions next to an edit are re-planned. Return
+ * AUTOMIX_ERROR_TRANSITIONING when editing the next track while it is being
+ * mixed in, AUTOMIX_ERROR_INVALID_ARGUMENT for other positions out of range
+ * or unknown tracks. */
+
+/**
+ * Insert a track at a queue position (up to the queue length to append).
+ */
+AutoMixError automix_queue_insert(AutoMixEngine* engine, int position, int64_t track_id);
+
+/**
+ * Remove the track at a queue position.
+ */
+AutoMixError automix_queue_remove(AutoMixEngine* engine, int position);
+
+/**
+ * Move the track at queue position `from` so that it ends up at `to`.
+ */
+AutoMixError automix_queue_move(AutoMixEngine* engine, int from, int to);
+
+/**
+ * Replace the track at a queue position.
+ */
+AutoMixError automix_queue_replace(AutoMixEngine* engine, int position, int64_t track_id);
+
+/**
+ * Get the queue: track IDs from the current track on (index = position).
+ * Free *out_ids with automix_free_track_ids(); it is null for an empty queue.
+ */
+AutoMixError automix_get_queue(AutoMixEngine* engine, int64_t** out_ids, int* out_count);
+
 /**
  * Get current playback state.
  */
@@ -86,14 +86,54 @@ struct AudioBuffer {
     }
 };
 
+/**
+ * A slice of a track decoded for excerpt-based analysis.
+ */
+struct AudioExcerpt {
+    float start = 0.0f;                 // Offset in the track in seconds
+    AudioBuffer audio;
+};
+
+/**
+ * Excerpts of one track, in track order.
+ */
+struct TrackExcerpts {
+    float duration = 0.0f;              // Whole-track duration in seconds
+    std::vector<AudioExcerpt> excerpts;
+};
+
 /* ============================================================================
  * Track Features
  * ============================================================================ */
 
+/**
+ * Per-feature confidence in [0, 1]. Full-track analysis reports 1;
+ * excerpt analysis reports how well the excerpts agree.
+ */
+struct FeatureConfidence {
+    float bpm = 1.0f;                   // Share of excerpts agreeing on the tempo
+    float key = 1.0f;                   // Share of excerpts agreeing on the key
+    float beats = 1.0f;                 // Share of the beat grid detected rather than interpolated
+    
+    /**
+     * Confidence of the features used for matching (BPM and key).
+     */
+    float overall() const { return bpm < key ? bpm : key; }
+};
+
+/**
+ * Musical key as a position on the Camelot wheel:
+ * (number - 1) * 2 + (B ? 1 : 0), so "1A" = 0 ... "12B" = 23.
+ * Text ("8A") only appears in the database and the C API; see
+ * utils::key_from_camelot and utils::key_to_camelot.
+ */
+using KeyCode = int8_t;
+constexpr KeyCode kUnknownKey = -1;
+
 struct TrackFeatures {
     float bpm = 0.0f;
     std::vector<float> beats;           // Beat positions in seconds
-    std::string key;                    // Camelot notation (e.g., "8A")
+    KeyCode key = kUnknownKey;
     std::vector<float> mfcc;            // 13-dimensional MFCC mean
     std::vector<float> chroma;          // 12-dimensional chroma
     std::vector<float> energy_curve;    // Energy over time (normalized)
@@ -102,6 +142,8 @@ struct TrackFeatures {
     // Optional extended features
     std::optional<float> loudness_lufs;
     std::optional<std::string> genre;
+    
+    FeatureConfidence confidence;
 };
 
 /* ============================================================================
@@ -113,13 +155,15 @@ struct TrackInfo {
     std::string path;
     float bpm = 0.0f;
     std::vector<float> beats;
-    std::string key;
+    KeyCode key = kUnknownKey;
     std::vector<float> mfcc;
     std::vector<float> chroma;
     std::vector<float> energy_curve;
     float duration = 0.0f;
     int64_t analyzed_at = 0;            // Unix timestamp
     int64_t file_modified_at = 0;       // File modification time
+    float confidence = 1.0f;            // FeatureConfidence::overall() of the stored analysis
+    uint64_t content_hash = 0;          // file_fingerprint() of the analyzed file; 0 = unknown
 };
 
 /* ============================================================================
@@ -244,6 +288,13 @@ struct PlaylistRules {
     float bpm_step_limit = 0.0f;        // 0 = no limit on BPM jump between tracks
     bool prefer_bpm_progression = false; // Prefer gradual BPM changes
     
+    // Sequence optimizer: beam search over whole playlists instead of
+    // picking one track at a time. It orders the 1023 tracks nearest to
+    // the seed; longer playlists continue with greedy selection
+    int beam_width = 0;                 // Partial playlists kept per step (0 = greedy selection)
+    int beam_depth = 0;                 // Tracks looked ahead per chosen track (0 = plan the whole playlist)
+    float beam_time_limit = 1.0f;       // Seconds (0 = none); then the remaining tracks are chosen greedily
+    
     // Random seed (0 = non-deterministic)
     uint32_t random_seed = 0;
 };
@@ -0,0 +1,61 @@
+/**
+ * AutoMix Engine - Shared Analysis Front-end Implementation
+ */
+
+#include "analysis_context.h"
+#include <cmath>
+#include <numeric>
+
+namespace automix {
+
+std::vector<float> hann_window(size_t n) {
+    std::vector<float> window(n);
+    for (size_t i = 0; i < n; ++i) {
+        window[i] = 0.5f * (1.0f - std::cos(2.0f * M_PI * i / (n - 1)));
+    }
+    return window;
+}
+
+SpectrumFrames::SpectrumFrames(const std::vector<float>& mono, int frame_size, int hop_size)
+    : mono_(mono)
+    , frame_size_(frame_size)
+    , hop_size_(hop_size)
+    , bins_(static_cast<size_t>(std::max(frame_size, 0)) / 2 + 1) {
+    if (frame_size <= 0 || hop_size <= 0 || mono.size() < static_cast<size_t>(frame_size)) {
+        return;
+    }
+    
+    frames_ = (mono.size() - frame_size) / hop_size + 1;
+    
+    window_ = hann_window(frame_size);
+    window_sum_ = std::accumulate(window_.begin(), window_.end(), 0.0f);
+    
+    fft_ = std::make_unique<RealFFT>(frame_size);
+    windowed_.resize(frame_size);
+    magnitude_.resize(bins_);
+}
+
+SpectrumFrames::~SpectrumFrames() = default;
+
+const float* SpectrumFrames::frame(size_t index) {
+    const float* src = mono_.data() + index * hop_size_;
+    for (int i = 0; i < frame_size_; ++i) {
+        windowed_[i] = src[i] * window_[i];
+    }
+    fft_->magnitude_spectrum(windowed_.data(), magnitude_.data());
+    return magnitude_.data();
+}
+
+AnalysisContext::AnalysisContext(const AudioBuffer& audio)
+    : sample_rate_(audio.sample_rate)
+    , channels_(std::max(audio.channels, 1))
+    , duration_(audio.duration_seconds()) {
+    if (audio.channels == 1) {
+        mono_ = &audio.samples;
+    } else {
+        mono_storage_ = audio.to_mono();
+        mono_ = &mono_storage_;
+    }
+}
+
+} // namespace automix
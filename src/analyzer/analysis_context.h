@@ -0,0 +1,147 @@
+/**
+ * AutoMix Engine - Shared Analysis Front-end
+ */
+
+#ifndef AUTOMIX_ANALYSIS_CONTEXT_H
+#define AUTOMIX_ANALYSIS_CONTEXT_H
+
+#include "automix/types.h"
+#include "fft.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace automix {
+
+/**
+ * Symmetric Hann window of `n` samples, shared by every STFT front-end.
+ */
+std::vector<float> hann_window(size_t n);
+
+/**
+ * STFT magnitude frames of a mono signal (Hann window, full frames only).
+ *
+ * Frames are transformed on demand into one reusable buffer, so memory is a
+ * single frame whatever the signal length. Each framing is read by a single
+ * extractor, so nothing is kept between calls. The signal must outlive
+ * the frames.
+ */
+class SpectrumFrames {
+public:
+    SpectrumFrames(const std::vector<float>& mono, int frame_size, int hop_size);
+    ~SpectrumFrames();
+
+    int frame_size() const { return frame_size_; }
+    int hop_size() const { return hop_size_; }
+    size_t bins() const { return bins_; }                // frame_size / 2 + 1
+    size_t frames() const { return frames_; }
+    float window_sum() const { return window_sum_; }     // Sum of the analysis window (for normalization)
+
+    /**
+     * Magnitude spectrum of frame `index` (bins() values), valid until the
+     * next call.
+     */
+    const float* frame(size_t index);
+
+private:
+    const std::vector<float>& mono_;
+    int frame_size_;
+    int hop_size_;
+    size_t bins_;
+    size_t frames_ = 0;
+    float window_sum_ = 0.0f;
+    std::vector<float> window_;
+    std::vector<float> windowed_;
+    std::vector<float> magnitude_;
+    std::unique_ptr<RealFFT> fft_;
+};
+
+/**
+ * Per-track analysis front-end shared by all feature extractors.
+ *
+ * Downmixes the input to mono once (mono input is borrowed, not copied) and
+ * hands out STFT frames over it. The AudioBuffer must outlive the context.
+ * Not thread-safe: use one context per track per thread.
+ */
+class AnalysisContext {
+public:
+    explicit AnalysisContext(const AudioBuffer& audio);
+
+    // Non-copyable (may borrow the source buffer)
+    AnalysisContext(const AnalysisContext&) = delete;
+    AnalysisContext& operator=(const AnalysisContext&) = delete;
+
+    /**
+     * Mono samples of the whole track.
+     */
+    const std::vector<float>& mono() const { return *mono_; }
+
+    int sample_rate() const { return sample_rate_; }
+    int channels() const { return channels_; }
+    float duration() const { return duration_; }
+    bool empty() const { return mono_->empty(); }
+
+    /**
+     * STFT magnitude frames of the mono signal for the given framing.
+     */
+    SpectrumFrames spectrum(int frame_size, int hop_size) const {
+        return SpectrumFrames(*mono_, frame_size, hop_size);
+    }
+
+private:
+    const std::vector<float>* mono_ = nullptr;
+    std::vector<float> mono_storage_;   // Only used when the input is multi-channel
+    int sample_rate_ = 44100;
+    int channels_ = 1;                  // Of the source buffer
+    float duration_ = 0.0f;
+};
+
+/**
+ * Splits a sample stream into overlapping frames for streaming analysis.
+ *
+ * Emits exactly the frames the whole-buffer extractors see
+ * (start = 0, hop, 2 * hop, ...; full frames only), whatever the chunk
+ * sizes pushed. Only one frame of samples is kept.
+ */
+class Framer {
+public:
+    Framer(int frame_size, int hop_size)
+        : frame_size_(static_cast<size_t>(frame_size))
+        , hop_size_(static_cast<size_t>(std::min(hop_size, frame_size)))
+        , buffer_(frame_size_) {}
+    
+    /**
+     * Append samples, calling on_frame(const float* frame) for each
+     * completed frame.
+     */
+    template <typename OnFrame>
+    void push(const float* samples, size_t count, OnFrame&& on_frame) {
+        while (count > 0) {
+            size_t take = std::min(count, frame_size_ - fill_);
+            std::memcpy(buffer_.data() + fill_, samples, take * sizeof(float));
+            fill_ += take;
+            samples += take;
+            count -= take;
+            
+            if (fill_ == frame_size_) {
+                on_frame(static_cast<const float*>(buffer_.data()));
+                std::memmove(buffer_.data(), buffer_.data() + hop_size_,
+                             (frame_size_ - hop_size_) * sizeof(float));
+                fill_ = frame_size_ - hop_size_;
+            }
+        }
+    }
+    
+    size_t frame_size() const { return frame_size_; }
+    
+private:
+    size_t frame_size_;
+    size_t hop_size_;
+    size_t fill_ = 0;
+    std::vector<float> buffer_;
+};
+
+} // namespace automix
+
+#endif // AUTOMIX_ANALYSIS_CONTEXT_H
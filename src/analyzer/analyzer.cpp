@@ -8,6 +8,8 @@
 #include "bpm_detector.h"
 #include "key_detector.h"
 #include "energy_analyzer.h"
+#include "analysis_context.h"
+#include "fft.h"
 #include "../core/utils.h"
 
 #ifdef AUTOMIX_HAS_ESSENTIA
@@ -54,7 +56,7 @@ namespace automix {
 
 class Analyzer::Impl {
 public:
-    Impl() {
+    explicit Impl(const AnalyzerConfig& config) : config_(config) {
 #ifdef AUTOMIX_HAS_ESSENTIA
         EssentiaManager::instance().ensure_initialized();
 #endif
@@ -66,36 +68,32 @@ public:
         TrackFeatures features;
         features.duration = audio.duration_seconds();
         
-        // BPM detection
-        auto bpm_result = detect_bpm(audio);
-        if (bpm_result.ok()) {
-            features.bpm = bpm_result.value();
-        }
+        // Mono downmix is computed once and shared
+        AnalysisContext context(audio);
         
-        // Beat detection
-        auto beats_result = detect_beats(audio);
-        if (beats_result.ok()) {
-            features.beats = beats_result.value();
+        // BPM and beat detection (single rhythm pass)
+        auto rhythm_result = analyze_rhythm(context);
+        if (rhythm_result.ok()) {
+            features.bpm = rhythm_result.value().bpm;
+            features.beats = std::move(rhythm_result.value().beats);
         }
         
-        // Key detection
-        auto key_result = detect_key(audio);
-        if (key_result.ok()) {
-            features.key = key_result.value();
+        // Chroma, then key from the same chroma
+        auto chroma_result = key_detector_.compute_chroma(context);
+        if (chroma_result.ok()) {
+            features.chroma = chroma_result.value();
+            auto key_result = key_detector_.detect_from_chroma(features.chroma);
+            if (key_result.ok()) {
+                features.key = key_result.value();
+            }
         }
         
         // MFCC
-        auto mfcc_result = compute_mfcc(audio);
+        auto mfcc_result = compute_mfcc(context);
         if (mfcc_result.ok()) {
             features.mfcc = mfcc_result.value();
         }
         
-        // Chroma
-        auto chroma_result = compute_chroma(audio);
-        if (chroma_result.ok()) {
-            features.chroma = chroma_result.value();
-        }
-        
         // Energy curve
         auto energy_result = compute_energy_curve(audio);
         if (energy_result.ok()) {
@@ -105,34 +103,331 @@ public:
         return features;
     }
     
+    Result<TrackFeatures> analyze_excerpts(const TrackExcerpts& track) {
+        if (track.excerpts.empty()) {
+            return "No excerpts to analyze";
+        }
+        
+        // One excerpt: plain analysis, trusted in proportion to the share of
+        // the track it covers (1 when the decoder returned the whole track)
+        if (track.excerpts.size() == 1) {
+            const AudioExcerpt& only = track.excerpts.front();
+            auto result = analyze(only.audio);
+            if (result.ok() && track.duration > 0.0f) {
+                TrackFeatures& features = result.value();
+                float coverage = std::min(1.0f, features.duration / track.duration);
+                features.confidence = {coverage, coverage, coverage};
+                for (float& beat : features.beats) {
+                    beat += only.start;
+                }
+                features.duration = std::max(features.duration, track.duration);
+            }
+            return result;
+        }
+        
+        const size_t count = track.excerpts.size();
+        std::vector<float> bpms;
+        std::vector<std::vector<float>> beats(count);
+        std::vector<KeyCode> keys;
+        std::vector<float> chroma(12, 0.0f);
+        std::vector<double> mfcc_sum;
+        double mfcc_weight = 0.0;
+        
+        // Raw RMS windows on the track timeline; gaps are filled below
+        const float resolution = kEnergyResolution;
+        const float track_end = std::max(track.duration,
+            track.excerpts.back().start + track.excerpts.back().audio.duration_seconds());
+        std::vector<float> energy(static_cast<size_t>(std::ceil(track_end / resolution)), -1.0f);
+        
+        for (size_t i = 0; i < count; ++i) {
+            const AudioExcerpt& excerpt = track.excerpts[i];
+            AnalysisContext context(excerpt.audio);
+            if (context.empty()) continue;
+            const float weight = context.duration();
+            
+            auto rhythm_result = analyze_rhythm(context);
+            if (rhythm_result.ok() && rhythm_result.value().bpm > 0.0f) {
+                bpms.push_back(rhythm_result.value().bpm);
+                for (float beat : rhythm_result.value().beats) {
+                    beats[i].push_back(beat + excerpt.start);
+                }
+            }
+            
+            auto chroma_result = key_detector_.compute_chroma(context);
+            if (chroma_result.ok()) {
+                auto key_result = key_detector_.detect_from_chroma(chroma_result.value());
+                if (key_result.ok()) {
+                    keys.push_back(key_result.value());
+                }
+                for (int pc = 0; pc < 12; ++pc) {
+                    chroma[pc] += chroma_result.value()[pc] * weight;
+                }
+            }
+            
+            auto mfcc_result = compute_mfcc(context);
+            if (mfcc_result.ok()) {
+                const auto& mfcc = mfcc_result.value();
+                mfcc_sum.resize(std::max(mfcc_sum.size(), mfcc.size()), 0.0);
+                for (size_t c = 0; c < mfcc.size(); ++c) {
+                    mfcc_sum[c] += static_cast<double>(mfcc[c]) * weight;
+                }
+                mfcc_weight += weight;
+            }
+            
+            const auto& mono = context.mono();
+            const size_t window = static_cast<size_t>(resolution * context.sample_rate());
+            size_t slot = static_cast<size_t>(std::lround(excerpt.start / resolution));
+            for (size_t begin = 0; begin < mono.size() && slot < energy.size() && window > 0; begin += window, ++slot) {
+                energy[slot] = EnergyAnalyzer::compute_rms(&mono[begin], std::min(window, mono.size() - begin));
+            }
+        }
+        
+        TrackFeatures features;
+        features.duration = track_end;
+        
+        // Tempo: median over excerpts; confidence is the share within 3% of it
+        if (!bpms.empty()) {
+            std::vector<float> sorted = bpms;
+            std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+            features.bpm = sorted[sorted.size() / 2];
+            size_t agreeing = std::count_if(bpms.begin(), bpms.end(), [&](float bpm) {
+                return std::abs(bpm - features.bpm) <= features.bpm * 0.03f;
+            });
+            features.confidence.bpm = static_cast<float>(agreeing) / count;
+            features.beats = merge_excerpt_beats(beats, 60.0f / features.bpm, track_end, features.confidence.beats);
+        } else {
+            features.confidence.bpm = 0.0f;
+            features.confidence.beats = 0.0f;
+        }
+        
+        // Key from the pooled chroma; confidence is the share of excerpts agreeing
+        KeyDetector::normalize_chroma(chroma);
+        features.chroma = chroma;
+        auto key_result = key_detector_.detect_from_chroma(chroma);
+        if (key_result.ok()) {
+            features.key = key_result.value();
+            features.confidence.key = static_cast<float>(std::count(keys.begin(), keys.end(), features.key)) / count;
+        } else {
+            features.confidence.key = 0.0f;
+        }
+        
+        if (mfcc_weight > 0.0) {
+            features.mfcc.resize(mfcc_sum.size());
+            for (size_t c = 0; c < mfcc_sum.size(); ++c) {
+                features.mfcc[c] = static_cast<float>(mfcc_sum[c] / mfcc_weight);
+            }
+        }
+        
+        // Energy between excerpts is interpolated linearly
+        fill_energy_gaps(energy);
+        auto energy_result = EnergyAnalyzer::finalize_curve(std::move(energy));
+        if (energy_result.ok()) {
+            features.energy_curve = std::move(energy_result.value());
+        }
+        
+        return features;
+    }
+    
+    // Energy curve resolution in seconds (EnergyAnalyzer::compute_curve default)
+    static constexpr float kEnergyResolution = 0.5f;
+    
+    /**
+     * Join per-excerpt beats (already on the track timeline) into one
+     * sorted grid. Gaps between excerpts are bridged with evenly spaced
+     * beats snapped to both neighbours, and the grid is extended at the
+     * period to the track start and end. detected_share receives the
+     * fraction of returned beats that were actually detected.
+     */
+    static std::vector<float> merge_excerpt_beats(const std::vector<std::vector<float>>& excerpt_beats,
+                                                  float period, float track_end, float& detected_share) {
+        std::vector<float> grid;
+        size_t detected = 0;
+        
+        for (const auto& beats : excerpt_beats) {
+            if (beats.empty()) continue;
+            if (!grid.empty() && beats.front() > grid.back()) {
+                float gap = beats.front() - grid.back();
+                int steps = static_cast<int>(std::lround(gap / period));
+                float step = steps > 0 ? gap / steps : gap;
+                float from = grid.back();
+                for (int k = 1; k < steps; ++k) {
+                    grid.push_back(from + step * k);
+                }
+            }
+            for (float beat : beats) {
+                if (grid.empty() || beat > grid.back()) {
+                    grid.push_back(beat);
+                    detected++;
+                }
+            }
+        }
+        
+        if (grid.empty()) {
+            detected_share = 0.0f;
+            return grid;
+        }
+        
+        std::vector<float> lead;
+        for (float t = grid.front() - period; t >= 0.0f; t -= period) {
+            lead.push_back(t);
+        }
+        grid.insert(grid.begin(), lead.rbegin(), lead.rend());
+        for (float t = grid.back() + period; t < track_end; t += period) {
+            grid.push_back(t);
+        }
+        
+        detected_share = static_cast<float>(detected) / grid.size();
+        return grid;
+    }
+    
+    /**
+     * Replace unknown (negative) energy windows by linear interpolation
+     * between their known neighbours.
+     */
+    static void fill_energy_gaps(std::vector<float>& energy) {
+        size_t i = 0;
+        while (i < energy.size()) {
+            if (energy[i] >= 0.0f) {
+                ++i;
+                continue;
+            }
+            size_t end = i;
+            while (end < energy.size() && energy[end] < 0.0f) ++end;
+            float left = i > 0 ? energy[i - 1] : (end < energy.size() ? energy[end] : 0.0f);
+            float right = end < energy.size() ? energy[end] : left;
+            for (size_t j = i; j < end; ++j) {
+                float t = static_cast<float>(j - i + 1) / static_cast<float>(end - i + 1);
+                energy[j] = left + (right - left) * t;
+            }
+            i = end;
+        }
+    }
+    
+    void begin_stream(int sample_rate) {
+        stream_ = std::make_unique<StreamState>(sample_rate);
+    }
+    
+    void push_stream(const float* samples, size_t frames) {
+        if (!stream_ || frames == 0) return;
+        StreamState& st = *stream_;
+        st.frames += frames;
+        st.onset.push(samples, frames);
+        st.chroma.push(samples, frames);
+        st.energy.push(samples, frames);
+#ifdef AUTOMIX_HAS_ESSENTIA
+        try {
+            essentia::standard::Algorithm& mfcc = mfcc_algorithm(st.sample_rate);
+            const essentia::Real scale = st.mfcc_window_sum > 0 ? 2.0f / st.mfcc_window_sum : 1.0f;
+            st.mfcc_framer.push(samples, frames, [&](const float* frame) {
+                for (int i = 0; i < kMfccFrameSize; ++i) {
+                    st.mfcc_windowed[i] = frame[i] * st.mfcc_window[i];
+                }
+                st.mfcc_fft.magnitude_spectrum(st.mfcc_windowed.data(), st.mfcc_magnitude.data());
+                accumulate_mfcc_frame(mfcc, st.mfcc_magnitude.data(), st.mfcc_magnitude.size(),
+                                      scale, st.mfcc_sum, st.mfcc_frames);
+            });
+        } catch (const std::exception&) {
+            // MFCC falls back to the simple statistics at finish
+        }
+#endif
+        st.mfcc_stats.push(samples, frames);
+    }
+    
+    Result<TrackFeatures> finish_stream() {
+        if (!stream_) {
+            return "No analysis stream in progress";
+        }
+        std::unique_ptr<StreamState> st = std::move(stream_);
+        if (st->frames == 0) {
+            return "Empty audio stream";
+        }
+        
+        TrackFeatures features;
+        features.duration = static_cast<float>(st->frames) / st->sample_rate;
+        
+        // Rhythm from the internal onset envelope (Essentia's
+        // RhythmExtractor2013 needs the whole signal)
+        auto rhythm = bpm_detector_.analyze_envelope(st->onset.take_envelope(), st->sample_rate);
+        if (rhythm.ok()) {
+            features.bpm = rhythm.value().bpm;
+            features.beats = std::move(rhythm.value().beats);
+        }
+        
+        features.chroma = st->chroma.finish();
+        auto key_result = key_detector_.detect_from_chroma(features.chroma);
+        if (key_result.ok()) {
+            features.key = key_result.value();
+        }
+        
+#ifdef AUTOMIX_HAS_ESSENTIA
+        if (st->mfcc_frames > 0) {
+            features.mfcc.assign(13, 0.0f);
+            for (size_t i = 0; i < 13; ++i) {
+                features.mfcc[i] = static_cast<float>(st->mfcc_sum[i] / st->mfcc_frames);
+            }
+        } else {
+            features.mfcc = st->mfcc_stats.finish();
+        }
+#else
+        features.mfcc = st->mfcc_stats.finish();
+#endif
+        
+        auto energy_result = st->energy.finish();
+        if (energy_result.ok()) {
+            features.energy_curve = std::move(energy_result.value());
+        }
+        
+        return features;
+    }
+    
     Result<float> detect_bpm(const AudioBuffer& audio) {
+        AnalysisContext context(audio);
+        auto rhythm = analyze_rhythm(context);
+        if (rhythm.failed()) {
+            return ResultError{rhythm.error()};
+        }
+        return rhythm.value().bpm;
+    }
+    
+    Result<std::vector<float>> detect_beats(const AudioBuffer& audio) {
+        AnalysisContext context(audio);
+        auto rhythm = analyze_rhythm(context);
+        if (rhythm.failed()) {
+            return ResultError{rhythm.error()};
+        }
+        return std::move(rhythm.value().beats);
+    }
+    
+    /**
+     * BPM and beats from a single rhythm pass.
+     * With Essentia, RhythmExtractor2013 supplies both; the internal onset
+     * detector is only used as a fallback.
+     */
+    Result<RhythmAnalysis> analyze_rhythm(const AnalysisContext& context) {
 #ifdef AUTOMIX_HAS_ESSENTIA
+        auto essentia_rhythm = analyze_rhythm_essentia(context);
+        if (essentia_rhythm.ok()) {
+            return essentia_rhythm;
+        }
+#endif
+        return bpm_detector_.analyze(context);
+    }
+    
+#ifdef AUTOMIX_HAS_ESSENTIA
+    Result<RhythmAnalysis> analyze_rhythm_essentia(const AnalysisContext& context) {
         try {
             using namespace essentia;
             using namespace essentia::standard;
             
-            // Convert to mono
-            std::vector<Real> mono = to_mono(audio);
-            
-            AlgorithmFactory& factory = AlgorithmFactory::instance();
-            
-            // Use RhythmExtractor2013 for robust BPM detection
-            Algorithm* rhythm = factory.create("RhythmExtractor2013",
-                "method", "multifeature");
-                
-            std::vector<Real> ticks, estimates, bpmIntervals;
-            Real bpm, confidence;
-            
-            rhythm->input("signal").set(mono);
-            rhythm->output("bpm").set(bpm);
-            rhythm->output("ticks").set(ticks);
-            rhythm->output("confidence").set(confidence);
-            rhythm->output("estimates").set(estimates);
-            rhythm->output("bpmIntervals").set(bpmIntervals);
+            Algorithm& rhythm = rhythm_extractor();
             
-            rhythm->compute();
+            rhythm.reset();
+            rhythm.input("signal").set(context.mono());
+            rhythm.compute();
             
-            delete rhythm;
+            const Real bpm = essentia_.bpm;
+            const Real confidence = essentia_.confidence;
+            const std::vector<Real>& estimates = essentia_.estimates;
             
             if (bpm > 0) {
                 auto octave_distance = [](float a, float b) -> float {
@@ -183,29 +478,58 @@ public:
                     }
                 }
                 
-                return best_bpm;
+                RhythmAnalysis result;
+                result.bpm = best_bpm;
+                result.beats = align_ticks(essentia_.ticks, best_bpm / raw_bpm);
+                return result;
             }
             
         } catch (const std::exception& e) {
-            // Fallback to internal detector if Essentia fails
+            return std::string("Essentia rhythm extraction failed: ") + e.what();
         }
-#endif
-        return bpm_detector_.detect(audio);
+        return "Essentia returned no BPM";
     }
     
-    Result<std::vector<float>> detect_beats(const AudioBuffer& audio) {
-        return bpm_detector_.detect_beats(audio);
+    /**
+     * Match the tick grid to an octave-corrected BPM: keep every other tick
+     * when the tempo was halved, add midpoints when it was doubled.
+     */
+    static std::vector<float> align_ticks(const std::vector<essentia::Real>& ticks, float ratio) {
+        std::vector<float> beats;
+        if (ratio < 0.75f) {
+            beats.reserve(ticks.size() / 2 + 1);
+            for (size_t i = 0; i < ticks.size(); i += 2) {
+                beats.push_back(static_cast<float>(ticks[i]));
+            }
+        } else if (ratio > 1.5f) {
+            beats.reserve(ticks.size() * 2);
+            for (size_t i = 0; i < ticks.size(); ++i) {
+                beats.push_back(static_cast<float>(ticks[i]));
+                if (i + 1 < ticks.size()) {
+                    beats.push_back(0.5f * static_cast<float>(ticks[i] + ticks[i + 1]));
+                }
+            }
+        } else {
+            beats.assign(ticks.begin(), ticks.end());
+        }
+        return beats;
     }
+#endif
     
-    Result<std::string> detect_key(const AudioBuffer& audio) {
+    Result<KeyCode> detect_key(const AudioBuffer& audio) {
         return key_detector_.detect(audio);
     }
     
     Result<std::vector<float>> compute_mfcc(const AudioBuffer& audio) {
+        AnalysisContext context(audio);
+        return compute_mfcc(context);
+    }
+    
+    Result<std::vector<float>> compute_mfcc(AnalysisContext& context) {
 #ifdef AUTOMIX_HAS_ESSENTIA
-        return compute_mfcc_essentia(audio);
+        return compute_mfcc_essentia(context);
 #else
-        return compute_mfcc_simple(audio);
+        return compute_mfcc_simple(context);
 #endif
     }
     
@@ -217,89 +541,121 @@ public:
         return energy_analyzer_.compute_curve(audio);
     }
     
+    const AnalyzerConfig& config() const { return config_; }
+    
 private:
+    // MFCC framing (Essentia path)
+    static constexpr int kMfccFrameSize = 2048;
+    static constexpr int kMfccHopSize = 1024;
+    
+    AnalyzerConfig config_;
     BPMDetector bpm_detector_;
     KeyDetector key_detector_;
     EnergyAnalyzer energy_analyzer_;
     
 #ifdef AUTOMIX_HAS_ESSENTIA
-    Result<std::vector<float>> compute_mfcc_essentia(const AudioBuffer& audio) {
-        try {
-            using namespace essentia;
-            using namespace essentia::standard;
-            
-            // Convert to mono
-            std::vector<Real> mono = to_mono(audio);
-            
-            AlgorithmFactory& factory = AlgorithmFactory::instance();
-            
-            // Frame cutting
-            Algorithm* fc = factory.create("FrameCutter",
-                "frameSize", 2048,
-                "hopSize", 1024,
-                "startFromZero", true);
-            
-            // Windowing
-            Algorithm* w = factory.create("Windowing",
-                "type", "hann",
-                "zeroPadding", 0);
-            
-            // Spectrum
-            Algorithm* spec = factory.create("Spectrum",
-                "size", 2048);
-            
-            // MFCC
-            Algorithm* mfcc = factory.create("MFCC",
+    /**
+     * Essentia algorithms and their bound I/O buffers, created on first use
+     * and reused for every track this Analyzer processes. Each scan worker
+     * owns its own Analyzer, so this is a per-thread pool.
+     */
+    struct EssentiaAlgorithms {
+        std::unique_ptr<essentia::standard::Algorithm> rhythm;
+        std::unique_ptr<essentia::standard::Algorithm> mfcc;
+        int mfcc_sample_rate = 0;
+        
+        essentia::Real bpm = 0;
+        essentia::Real confidence = 0;
+        std::vector<essentia::Real> ticks, estimates, bpm_intervals;
+        std::vector<essentia::Real> spectrum, bands, coefficients;
+    };
+    EssentiaAlgorithms essentia_;
+    
+    essentia::standard::Algorithm& rhythm_extractor() {
+        using namespace essentia::standard;
+        if (!essentia_.rhythm) {
+            // Use RhythmExtractor2013 for robust BPM and beat detection
+            const char* method = config_.rhythm_method == RhythmMethod::Degara ? "degara" : "multifeature";
+            essentia_.rhythm.reset(AlgorithmFactory::instance().create("RhythmExtractor2013",
+                "method", method));
+            essentia_.rhythm->output("bpm").set(essentia_.bpm);
+            essentia_.rhythm->output("ticks").set(essentia_.ticks);
+            essentia_.rhythm->output("confidence").set(essentia_.confidence);
+            essentia_.rhythm->output("estimates").set(essentia_.estimates);
+            essentia_.rhythm->output("bpmIntervals").set(essentia_.bpm_intervals);
+        }
+        return *essentia_.rhythm;
+    }
+    
+    essentia::standard::Algorithm& mfcc_algorithm(int sample_rate) {
+        using namespace essentia::standard;
+        if (!essentia_.mfcc || essentia_.mfcc_sample_rate != sample_rate) {
+            essentia_.mfcc.reset(AlgorithmFactory::instance().create("MFCC",
                 "inputSize", 1025,
                 "numberCoefficients", 13,
                 "numberBands", 40,
                 "lowFrequencyBound", 0,
-                "highFrequencyBound", audio.sample_rate / 2.0f);
-            
-            std::vector<Real> frame, windowed, spectrum, mfcc_bands, mfcc_coeffs;
-            std::vector<std::vector<Real>> all_mfcc;
+                "highFrequencyBound", sample_rate / 2.0f));
+            essentia_.mfcc_sample_rate = sample_rate;
+            essentia_.spectrum.assign(1025, 0.0f);
+            essentia_.mfcc->input("spectrum").set(essentia_.spectrum);
+            essentia_.mfcc->output("bands").set(essentia_.bands);
+            essentia_.mfcc->output("mfcc").set(essentia_.coefficients);
+        }
+        return *essentia_.mfcc;
+    }
+    
+    /**
+     * Run MFCC on one magnitude spectrum and add it to the running sum.
+     * All-zero (silent) frames are skipped.
+     */
+    void accumulate_mfcc_frame(essentia::standard::Algorithm& mfcc, const float* magnitude, size_t bins,
+                               essentia::Real scale, double* sum, size_t& frame_count) {
+        std::vector<essentia::Real>& spectrum = essentia_.spectrum;
+        bool silent = true;
+        for (size_t k = 0; k < bins; ++k) {
+            spectrum[k] = magnitude[k] * scale;
+            if (magnitude[k] != 0.0f) silent = false;
+        }
+        if (silent) return;
+        
+        mfcc.compute();
+        
+        const std::vector<essentia::Real>& coefficients = essentia_.coefficients;
+        for (size_t i = 0; i < 13 && i < coefficients.size(); ++i) {
+            sum[i] += coefficients[i];
+        }
+        frame_count++;
+    }
+    
+    Result<std::vector<float>> compute_mfcc_essentia(AnalysisContext& context) {
+        try {
+            using namespace essentia;
+            using namespace essentia::standard;
             
-            fc->input("signal").set(mono);
-            fc->output("frame").set(frame);
+            // MFCC over 2048/1024 Hann STFT frames of the shared mono signal
+            Algorithm& mfcc = mfcc_algorithm(context.sample_rate());
+            mfcc.reset();
             
-            w->input("frame").set(frame);
-            w->output("frame").set(windowed);
+            SpectrumFrames spec = context.spectrum(kMfccFrameSize, kMfccHopSize);
             
-            spec->input("frame").set(windowed);
-            spec->output("spectrum").set(spectrum);
+            // Essentia's Windowing normalizes the window to sum 2
+            const Real scale = spec.window_sum() > 0 ? 2.0f / spec.window_sum() : 1.0f;
             
-            mfcc->input("spectrum").set(spectrum);
-            mfcc->output("bands").set(mfcc_bands);
-            mfcc->output("mfcc").set(mfcc_coeffs);
+            // Running sum; no per-frame coefficient vectors are kept
+            double sum[13] = {0.0};
+            size_t frame_count = 0;
             
-            while (true) {
-                fc->compute();
-                if (frame.empty() || std::all_of(frame.begin(), frame.end(), 
-                    [](Real v) { return v == 0; })) break;
-                
-                w->compute();
-                spec->compute();
-                mfcc->compute();
-                
-                all_mfcc.push_back(mfcc_coeffs);
+            for (size_t f = 0; f < spec.frames(); ++f) {
+                accumulate_mfcc_frame(mfcc, spec.frame(f), spec.bins(), scale, sum, frame_count);
             }
             
-            delete fc;
-            delete w;
-            delete spec;
-            delete mfcc;
-            
             // Average MFCC
-            if (all_mfcc.empty()) return std::vector<float>(13, 0.0f);
-            
             std::vector<float> mean_mfcc(13, 0.0f);
-            for (const auto& m : all_mfcc) {
-                for (size_t i = 0; i < 13 && i < m.size(); ++i) {
-                    mean_mfcc[i] += m[i];
-                }
-            }
-            for (auto& v : mean_mfcc) {
-                v /= all_mfcc.size();
+            if (frame_count == 0) return mean_mfcc;
+            
+            for (size_t i = 0; i < 13; ++i) {
+                mean_mfcc[i] = static_cast<float>(sum[i] / frame_count);
             }
             
             return mean_mfcc;
@@ -307,65 +663,115 @@ private:
             return std::string("MFCC computation failed: ") + e.what();
         }
     }
-    
-    std::vector<essentia::Real> to_mono(const AudioBuffer& audio) {
-        auto mono_float = audio.to_mono();
-        return std::vector<essentia::Real>(mono_float.begin(), mono_float.end());
-    }
 #endif
     
-    Result<std::vector<float>> compute_mfcc_simple(const AudioBuffer& audio) {
-        // Simplified MFCC - just compute basic spectral features
-        // This is a placeholder; real MFCC requires mel filterbanks
-        
-        const size_t frame_size = 2048;
-        const size_t hop_size = 1024;
-        
-        if (audio.samples.size() < frame_size * 2) {
-            return std::vector<float>(13, 0.0f);
-        }
-        
-        // Convert to mono (no-op if already mono)
-        auto mono = audio.to_mono();
-        
-        // Simple spectral centroid as proxy for MFCC[0]
-        std::vector<float> mfcc(13, 0.0f);
-        
-        float total_energy = 0.0f;
-        float weighted_freq = 0.0f;
+    /**
+     * Running statistics behind the simplified MFCC.
+     */
+    struct SimpleMfccStats {
+        float energy = 0.0f;    // Sum of squares
+        float sum = 0.0f;
+        size_t count = 0;       // Mono samples
+        size_t channels = 1;    // Of the source buffer
         
-        for (size_t i = 0; i < mono.size(); ++i) {
-            float energy = mono[i] * mono[i];
-            total_energy += energy;
+        void push(const float* samples, size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                energy += samples[i] * samples[i];
+                sum += samples[i];
+            }
+            count += n;
         }
         
-        if (total_energy > 0) {
-            mfcc[0] = std::log(total_energy / mono.size() + 1e-10f);
+        std::vector<float> finish() const {
+            // Simple spectral centroid as proxy for MFCC[0]
+            std::vector<float> mfcc(13, 0.0f);
+            if (count * channels < 4096) {      // Two 2048-sample frames of interleaved input
+                return mfcc;
+            }
+            
+            if (energy > 0) {
+                mfcc[0] = std::log(energy / count + 1e-10f);
+            }
+            
+            // Fill remaining coefficients with simple statistics
+            float mean = sum / count;
+            float variance = energy / count - mean * mean;
+            
+            mfcc[1] = mean;
+            mfcc[2] = std::sqrt(std::max(0.0f, variance));
+            
+            return mfcc;
         }
-        
-        // Fill remaining coefficients with simple statistics
-        float sum = 0.0f, sum_sq = 0.0f;
-        for (float v : mono) {
-            sum += v;
-            sum_sq += v * v;
+    };
+    
+    Result<std::vector<float>> compute_mfcc_simple(const AnalysisContext& context) {
+        // Simplified MFCC - just compute basic spectral features
+        // This is a placeholder; real MFCC requires mel filterbanks
+        SimpleMfccStats stats;
+        stats.channels = static_cast<size_t>(context.channels());
+        stats.push(context.mono().data(), context.mono().size());
+        return stats.finish();
+    }
+    
+    /* ------------------------------------------------------------------------
+     * Streaming analysis
+     * ------------------------------------------------------------------------ */
+    
+    /**
+     * Incremental accumulators for one streamed track. Memory is a few
+     * analysis frames plus the onset envelope and energy curve.
+     */
+    struct StreamState {
+        explicit StreamState(int rate)
+            : sample_rate(rate)
+            , onset(rate)
+            , chroma(rate)
+            , energy(rate)
+#ifdef AUTOMIX_HAS_ESSENTIA
+            , mfcc_framer(kMfccFrameSize, kMfccHopSize)
+            , mfcc_fft(kMfccFrameSize)
+            , mfcc_window(hann_window(kMfccFrameSize))
+            , mfcc_windowed(kMfccFrameSize)
+            , mfcc_magnitude(mfcc_fft.bins())
+#endif
+        {
+#ifdef AUTOMIX_HAS_ESSENTIA
+            mfcc_window_sum = std::accumulate(mfcc_window.begin(), mfcc_window.end(), 0.0f);
+#endif
         }
-        float mean = sum / mono.size();
-        float variance = sum_sq / mono.size() - mean * mean;
         
-        mfcc[1] = mean;
-        mfcc[2] = std::sqrt(std::max(0.0f, variance));
-        
-        return mfcc;
-    }
+        int sample_rate;
+        size_t frames = 0;
+        OnsetAccumulator onset;
+        ChromaAccumulator chroma;
+        EnergyAccumulator energy;
+        SimpleMfccStats mfcc_stats;
+#ifdef AUTOMIX_HAS_ESSENTIA
+        Framer mfcc_framer;
+        RealFFT mfcc_fft;
+        std::vector<float> mfcc_window;
+        std::vector<float> mfcc_windowed;
+        std::vector<float> mfcc_magnitude;
+        float mfcc_window_sum = 0.0f;
+        double mfcc_sum[13] = {0.0};
+        size_t mfcc_frames = 0;
+#endif
+    };
+    
+    std::unique_ptr<StreamState> stream_;
 };
 
-Analyzer::Analyzer() : impl_(std::make_unique<Impl>()) {}
+Analyzer::Analyzer(const AnalyzerConfig& config) : impl_(std::make_unique<Impl>(config)) {}
 Analyzer::~Analyzer() = default;
 
 Result<TrackFeatures> Analyzer::analyze(const AudioBuffer& audio) {
     return impl_->analyze(audio);
 }
 
+Result<TrackFeatures> Analyzer::analyze_excerpts(const TrackExcerpts& track) {
+    return impl_->analyze_excerpts(track);
+}
+
 Result<float> Analyzer::detect_bpm(const AudioBuffer& audio) {
     return impl_->detect_bpm(audio);
 }
@@ -374,7 +780,7 @@ Result<std::vector<float>> Analyzer::detect_beats(const AudioBuffer& audio) {
     return impl_->detect_beats(audio);
 }
 
-Result<std::string> Analyzer::detect_key(const AudioBuffer& audio) {
+Result<KeyCode> Analyzer::detect_key(const AudioBuffer& audio) {
     return impl_->detect_key(audio);
 }
 
@@ -390,4 +796,20 @@ Result<std::vector<float>> Analyzer::compute_energy_curve(const AudioBuffer& aud
     return impl_->compute_energy_curve(audio);
 }
 
+void Analyzer::begin_stream(int sample_rate) {
+    impl_->begin_stream(sample_rate);
+}
+
+void Analyzer::push_stream(const float* samples, size_t frames) {
+    impl_->push_stream(samples, frames);
+}
+
+Result<TrackFeatures> Analyzer::finish_stream() {
+    return impl_->finish_stream();
+}
+
+const AnalyzerConfig& Analyzer::config() const {
+    return impl_->config();
+}
+
 } // namespace automix
@@ -11,13 +11,30 @@
 
 namespace automix {
 
+/**
+ * Essentia RhythmExtractor2013 beat tracking method.
+ * Ignored when built without Essentia.
+ */
+enum class RhythmMethod {
+    MultiFeature,   // Most accurate, slowest
+    Degara          // Much cheaper; suited to bulk library scans
+};
+
+struct AnalyzerConfig {
+    RhythmMethod rhythm_method = RhythmMethod::MultiFeature;
+    
+    // Decode and analyze in fixed-size chunks (bounded memory per track).
+    // Rhythm then always uses the internal onset detector.
+    bool streaming = false;
+};
+
 /**
  * Audio feature analyzer.
  * Extracts BPM, beat positions, key, MFCC, chroma, and energy curve.
  */
 class Analyzer {
 public:
-    Analyzer();
+    explicit Analyzer(const AnalyzerConfig& config = AnalyzerConfig());
     ~Analyzer();
     
     // Non-copyable
@@ -29,16 +46,38 @@ public:
      */
     Result<TrackFeatures> analyze(const AudioBuffer& audio);
     
+    /**
+     * Analyze a track from a few excerpts (Decoder::decode_excerpts) for a
+     * fast first pass. BPM is the median over excerpts, key comes from the
+     * pooled chroma, beats are joined into one grid across the gaps and the
+     * energy curve is interpolated between excerpts. features.confidence
+     * reports how far the excerpts agree.
+     */
+    Result<TrackFeatures> analyze_excerpts(const TrackExcerpts& track);
+    
     /**
      * Analyze specific features only.
      */
     Result<float> detect_bpm(const AudioBuffer& audio);
     Result<std::vector<float>> detect_beats(const AudioBuffer& audio);
-    Result<std::string> detect_key(const AudioBuffer& audio);
+    Result<KeyCode> detect_key(const AudioBuffer& audio);
     Result<std::vector<float>> compute_mfcc(const AudioBuffer& audio);
     Result<std::vector<float>> compute_chroma(const AudioBuffer& audio);
     Result<std::vector<float>> compute_energy_curve(const AudioBuffer& audio);
     
+    /**
+     * Streaming analysis with bounded memory.
+     * Call begin_stream(), push mono PCM chunks of any size with
+     * push_stream(), then finish_stream(). Produces the same features as
+     * analyze() on the whole mono buffer, except that rhythm always uses
+     * the internal onset detector. One stream per Analyzer at a time.
+     */
+    void begin_stream(int sample_rate);
+    void push_stream(const float* samples, size_t frames);
+    Result<TrackFeatures> finish_stream();
+    
+    const AnalyzerConfig& config() const;
+    
 private:
     class Impl;
     std::unique_ptr<Impl> impl_;
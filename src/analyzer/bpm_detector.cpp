@@ -3,48 +3,55 @@
  */
 
 #include "bpm_detector.h"
+#include "analysis_context.h"
+#include "fft.h"
 #include <cmath>
 #include <algorithm>
 #include <numeric>
 
 namespace automix {
 
-Result<float> BPMDetector::detect(const AudioBuffer& audio) {
-    if (audio.samples.empty()) {
+Result<RhythmAnalysis> BPMDetector::analyze(const AudioBuffer& audio) {
+    AnalysisContext context(audio);
+    return analyze(context);
+}
+
+Result<RhythmAnalysis> BPMDetector::analyze(const AnalysisContext& context) {
+    if (context.empty()) {
         return "Empty audio buffer";
     }
     
-    auto onset_envelope = compute_onset_envelope(audio);
-    if (onset_envelope.empty()) {
+    return analyze_envelope(compute_onset_envelope(context.mono()), context.sample_rate());
+}
+
+Result<RhythmAnalysis> BPMDetector::analyze_envelope(std::vector<float> onset_envelope_raw, int sample_rate) {
+    if (onset_envelope_raw.empty()) {
         return "Failed to compute onset envelope";
     }
     
-    // Onset envelope is at a reduced sample rate
-    int onset_sr = audio.sample_rate / 512;  // hop size
-    float bpm = estimate_bpm_autocorr(onset_envelope, onset_sr);
-    
-    // Validate BPM range
-    if (bpm < 40.0f) bpm *= 2.0f;
-    if (bpm > 220.0f) bpm /= 2.0f;
+    RhythmAnalysis rhythm;
+    rhythm.onset_envelope = std::move(onset_envelope_raw);
+    auto& onset_envelope = rhythm.onset_envelope;
     
-    return bpm;
-}
-
-Result<std::vector<float>> BPMDetector::detect_beats(const AudioBuffer& audio) {
-    if (audio.samples.empty()) {
-        return "Empty audio buffer";
+    // Normalize
+    float max_val = *std::max_element(onset_envelope.begin(), onset_envelope.end());
+    if (max_val > 0) {
+        for (float& v : onset_envelope) {
+            v /= max_val;
+        }
     }
     
-    auto onset_envelope = compute_onset_envelope(audio);
-    if (onset_envelope.empty()) {
-        return "Failed to compute onset envelope";
-    }
+    // Onset envelope is at a reduced sample rate
+    int onset_sr = sample_rate / kHopSize;
+    rhythm.onset_rate = static_cast<float>(sample_rate) / kHopSize;
+    
+    rhythm.tempo_curve = compute_tempo_curve(onset_envelope, onset_sr);
+    float bpm = estimate_bpm_autocorr(rhythm.tempo_curve, onset_sr);
     
-    // Get BPM first
-    int onset_sr = audio.sample_rate / 512;
-    float bpm = estimate_bpm_autocorr(onset_envelope, onset_sr);
+    // Validate BPM range
     if (bpm < 40.0f) bpm *= 2.0f;
     if (bpm > 220.0f) bpm /= 2.0f;
+    rhythm.bpm = bpm;
     
     // Expected samples between beats
     float beat_period_samples = (60.0f / bpm) * onset_sr;
@@ -63,121 +70,126 @@ Result<std::vector<float>> BPMDetector::detect_beats(const AudioBuffer& audio) {
     auto peak_indices = pick_peaks(onset_envelope, threshold, min_distance);
     
     // Convert to seconds
-    float hop_duration = 512.0f / audio.sample_rate;
-    std::vector<float> beat_times;
-    beat_times.reserve(peak_indices.size());
+    float hop_duration = static_cast<float>(kHopSize) / sample_rate;
+    rhythm.beats.reserve(peak_indices.size());
     
     for (float idx : peak_indices) {
-        beat_times.push_back(idx * hop_duration);
+        rhythm.beats.push_back(idx * hop_duration);
     }
     
-    return beat_times;
+    return rhythm;
+}
+
+Result<float> BPMDetector::detect(const AudioBuffer& audio) {
+    AnalysisContext context(audio);
+    return detect(context);
+}
+
+Result<float> BPMDetector::detect(const AnalysisContext& context) {
+    auto result = analyze(context);
+    if (result.failed()) {
+        return ResultError{result.error()};
+    }
+    return result.value().bpm;
 }
 
-std::vector<float> BPMDetector::compute_onset_envelope(const AudioBuffer& audio) {
-    const int frame_size = 1024;
-    const int hop_size = 512;
+Result<std::vector<float>> BPMDetector::detect_beats(const AudioBuffer& audio) {
+    AnalysisContext context(audio);
+    return detect_beats(context);
+}
+
+Result<std::vector<float>> BPMDetector::detect_beats(const AnalysisContext& context) {
+    auto result = analyze(context);
+    if (result.failed()) {
+        return ResultError{result.error()};
+    }
+    return std::move(result.value().beats);
+}
+
+float BPMDetector::onset_flux(const float* frame, const float* window, float* prev_bands) {
+    // Simplified: just compute energy in frequency bands
+    float bands[3] = {0.0f, 0.0f, 0.0f};
     
-    // Convert to mono (no-op if already mono)
-    auto mono = audio.to_mono();
+    for (int i = 0; i < kFrameSize; ++i) {
+        float sample = frame[i] * window[i];
+        float energy = sample * sample;
+        
+        // Rough frequency band assignment
+        if (i < kFrameSize / 8) {
+            bands[0] += energy;
+        } else if (i < kFrameSize / 2) {
+            bands[1] += energy;
+        } else {
+            bands[2] += energy;
+        }
+    }
+    
+    // Spectral flux (half-wave rectified difference)
+    float flux = 0.0f;
+    for (int i = 0; i < 3; ++i) {
+        float diff = bands[i] - prev_bands[i];
+        if (diff > 0) flux += diff;
+        prev_bands[i] = bands[i];
+    }
     
-    if (mono.size() < static_cast<size_t>(frame_size)) {
+    return flux;
+}
+
+std::vector<float> BPMDetector::compute_onset_envelope(const std::vector<float>& mono) {
+    if (mono.size() < static_cast<size_t>(kFrameSize)) {
         return {};
     }
     
-    // Compute spectral flux
     std::vector<float> envelope;
-    envelope.reserve(mono.size() / hop_size);
+    envelope.reserve(mono.size() / kHopSize);
     
-    std::vector<float> prev_spectrum(frame_size / 2 + 1, 0.0f);
-    std::vector<float> window(frame_size);
+    auto window = hann_window(kFrameSize);
+    float prev_bands[3] = {0.0f, 0.0f, 0.0f};
     
-    // Hann window
-    for (int i = 0; i < frame_size; ++i) {
-        window[i] = 0.5f * (1.0f - std::cos(2.0f * M_PI * i / (frame_size - 1)));
+    for (size_t start = 0; start + kFrameSize <= mono.size(); start += kHopSize) {
+        envelope.push_back(onset_flux(&mono[start], window.data(), prev_bands));
     }
     
-    for (size_t start = 0; start + frame_size <= mono.size(); start += hop_size) {
-        // Apply window and compute energy in bands
-        std::vector<float> spectrum(frame_size / 2 + 1, 0.0f);
-        
-        // Simplified: just compute energy in frequency bands
-        float low_energy = 0.0f;
-        float mid_energy = 0.0f;
-        float high_energy = 0.0f;
-        
-        for (int i = 0; i < frame_size; ++i) {
-            float sample = mono[start + i] * window[i];
-            float energy = sample * sample;
-            
-            // Rough frequency band assignment
-            if (i < frame_size / 8) {
-                low_energy += energy;
-            } else if (i < frame_size / 2) {
-                mid_energy += energy;
-            } else {
-                high_energy += energy;
-            }
-        }
-        
-        spectrum[0] = low_energy;
-        spectrum[1] = mid_energy;
-        spectrum[2] = high_energy;
-        
-        // Spectral flux (half-wave rectified difference)
-        float flux = 0.0f;
-        for (size_t i = 0; i < 3; ++i) {
-            float diff = spectrum[i] - prev_spectrum[i];
-            if (diff > 0) flux += diff;
-        }
-        
-        envelope.push_back(flux);
-        prev_spectrum = spectrum;
+    return envelope;
+}
+
+std::vector<float> BPMDetector::compute_tempo_curve(const std::vector<float>& onset_envelope, int sample_rate) {
+    if (onset_envelope.size() < 100) {
+        return {};
     }
     
-    // Normalize
-    float max_val = *std::max_element(envelope.begin(), envelope.end());
-    if (max_val > 0) {
-        for (float& v : envelope) {
-            v /= max_val;
-        }
+    // Longest lag of interest is one beat at 60 BPM
+    size_t max_lag = std::min(static_cast<size_t>(std::max(sample_rate, 1)), onset_envelope.size() / 2);
+    
+    // One FFT-based pass for every lag instead of a direct sum per lag
+    auto curve = autocorrelation(onset_envelope.data(), onset_envelope.size(), max_lag);
+    
+    // Mean over the overlapping samples
+    for (size_t lag = 0; lag < curve.size(); ++lag) {
+        curve[lag] /= static_cast<float>(onset_envelope.size() - lag);
     }
     
-    return envelope;
+    return curve;
 }
 
-float BPMDetector::estimate_bpm_autocorr(const std::vector<float>& onset_envelope, int sample_rate) {
-    if (onset_envelope.size() < 100) {
+float BPMDetector::estimate_bpm_autocorr(const std::vector<float>& tempo_curve, int sample_rate) {
+    if (tempo_curve.empty()) {
         return 120.0f;  // Default
     }
     
     // BPM range: 60-200 -> period in samples
     int min_lag = static_cast<int>(sample_rate * 60.0f / 200.0f);
-    int max_lag = static_cast<int>(sample_rate * 60.0f / 60.0f);
-    
-    max_lag = std::min(max_lag, static_cast<int>(onset_envelope.size() / 2));
+    int max_lag = static_cast<int>(tempo_curve.size()) - 1;
     min_lag = std::max(min_lag, 1);
     
-    // Compute autocorrelation
+    // Strongest lag in range
     float best_corr = -1.0f;
     int best_lag = min_lag;
     
     for (int lag = min_lag; lag <= max_lag; ++lag) {
-        float corr = 0.0f;
-        int count = 0;
-        
-        for (size_t i = 0; i < onset_envelope.size() - lag; ++i) {
-            corr += onset_envelope[i] * onset_envelope[i + lag];
-            count++;
-        }
-        
-        if (count > 0) {
-            corr /= count;
-            
-            if (corr > best_corr) {
-                best_corr = corr;
-                best_lag = lag;
-            }
+        if (tempo_curve[lag] > best_corr) {
+            best_corr = tempo_curve[lag];
+            best_lag = lag;
         }
     }
     
@@ -189,13 +201,7 @@ float BPMDetector::estimate_bpm_autocorr(const std::vector<float>& onset_envelop
     if (bpm > 140.0f) {
         int half_tempo_lag = best_lag * 2;
         if (half_tempo_lag <= max_lag) {
-            float half_corr = 0.0f;
-            int count = 0;
-            for (size_t i = 0; i < onset_envelope.size() - half_tempo_lag; ++i) {
-                half_corr += onset_envelope[i] * onset_envelope[i + half_tempo_lag];
-                count++;
-            }
-            if (count > 0) half_corr /= count;
+            float half_corr = tempo_curve[half_tempo_lag];
             
             // Require stronger evidence than before to avoid over-collapsing true fast tracks.
             if (half_corr > best_corr * 0.55f) {
@@ -231,4 +237,19 @@ std::vector<float> BPMDetector::pick_peaks(const std::vector<float>& envelope, f
     return peaks;
 }
 
+/* ============================================================================
+ * OnsetAccumulator
+ * ============================================================================ */
+
+OnsetAccumulator::OnsetAccumulator(int sample_rate)
+    : sample_rate_(sample_rate)
+    , framer_(BPMDetector::kFrameSize, BPMDetector::kHopSize)
+    , window_(hann_window(BPMDetector::kFrameSize)) {}
+
+void OnsetAccumulator::push(const float* samples, size_t count) {
+    framer_.push(samples, count, [this](const float* frame) {
+        envelope_.push_back(BPMDetector::onset_flux(frame, window_.data(), prev_bands_));
+    });
+}
+
 } // namespace automix
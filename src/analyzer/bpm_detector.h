@@ -6,9 +6,21 @@
 #define AUTOMIX_BPM_DETECTOR_H
 
 #include "automix/types.h"
+#include "analysis_context.h"
 
 namespace automix {
 
+/**
+ * Result of one rhythm analysis pass.
+ */
+struct RhythmAnalysis {
+    float bpm = 0.0f;
+    std::vector<float> beats;           // Beat times in seconds
+    std::vector<float> onset_envelope;  // Normalized spectral flux, one value per hop
+    float onset_rate = 0.0f;            // Onset envelope frames per second
+    std::vector<float> tempo_curve;     // Mean onset autocorrelation by lag (in onset frames)
+};
+
 /**
  * BPM and beat detection.
  */
@@ -16,29 +28,84 @@ class BPMDetector {
 public:
     BPMDetector() = default;
     
+    /**
+     * Estimate BPM and beat positions from a single onset envelope.
+     */
+    Result<RhythmAnalysis> analyze(const AudioBuffer& audio);
+    Result<RhythmAnalysis> analyze(const AnalysisContext& context);
+    
+    /**
+     * Estimate BPM and beats from a raw (unnormalized) onset envelope,
+     * e.g. one built incrementally by OnsetAccumulator.
+     */
+    Result<RhythmAnalysis> analyze_envelope(std::vector<float> onset_envelope, int sample_rate);
+    
     /**
      * Detect BPM from audio buffer.
      * @return BPM value (typically 60-200)
      */
     Result<float> detect(const AudioBuffer& audio);
+    Result<float> detect(const AnalysisContext& context);
     
     /**
      * Detect beat positions.
      * @return Vector of beat times in seconds
      */
     Result<std::vector<float>> detect_beats(const AudioBuffer& audio);
+    Result<std::vector<float>> detect_beats(const AnalysisContext& context);
+    
+    // Onset envelope framing
+    static constexpr int kFrameSize = 1024;
+    static constexpr int kHopSize = 512;
+    
+    /**
+     * Onset strength of one frame (half-wave rectified band energy flux).
+     * @param frame      kFrameSize samples
+     * @param window     kFrameSize Hann window
+     * @param prev_bands Band energies of the previous frame (updated)
+     */
+    static float onset_flux(const float* frame, const float* window, float* prev_bands);
     
 private:
-    // Energy-based onset detection
-    std::vector<float> compute_onset_envelope(const AudioBuffer& audio);
+    // Energy-based onset detection (raw spectral flux, one value per hop)
+    std::vector<float> compute_onset_envelope(const std::vector<float>& mono);
     
-    // Auto-correlation based BPM estimation
-    float estimate_bpm_autocorr(const std::vector<float>& onset_envelope, int sample_rate);
+    // Onset autocorrelation for every lag up to one beat at 60 BPM
+    std::vector<float> compute_tempo_curve(const std::vector<float>& onset_envelope, int sample_rate);
+    
+    // Auto-correlation based BPM estimation (lookups into the tempo curve)
+    float estimate_bpm_autocorr(const std::vector<float>& tempo_curve, int sample_rate);
     
     // Peak picking for beat positions
     std::vector<float> pick_peaks(const std::vector<float>& envelope, float threshold, int min_distance);
 };
 
+/**
+ * Incremental onset envelope for streaming analysis.
+ * Yields the same envelope as the whole-buffer path; memory is one frame
+ * plus the envelope itself (~43 values per second at 22050 Hz).
+ */
+class OnsetAccumulator {
+public:
+    explicit OnsetAccumulator(int sample_rate);
+    
+    void push(const float* samples, size_t count);
+    
+    int sample_rate() const { return sample_rate_; }
+    
+    /**
+     * Raw envelope collected so far (moved out).
+     */
+    std::vector<float> take_envelope() { return std::move(envelope_); }
+    
+private:
+    int sample_rate_;
+    Framer framer_;
+    std::vector<float> window_;
+    float prev_bands_[3] = {0.0f, 0.0f, 0.0f};
+    std::vector<float> envelope_;
+};
+
 } // namespace automix
 
 #endif // AUTOMIX_BPM_DETECTOR_H
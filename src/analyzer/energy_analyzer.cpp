@@ -29,6 +29,10 @@ Result<std::vector<float>> EnergyAnalyzer::compute_curve(const AudioBuffer& audi
         energy_curve.push_back(rms);
     }
     
+    return finalize_curve(std::move(energy_curve));
+}
+
+Result<std::vector<float>> EnergyAnalyzer::finalize_curve(std::vector<float> energy_curve) {
     if (energy_curve.empty()) {
         return "No energy data computed";
     }
@@ -114,4 +118,31 @@ float EnergyAnalyzer::compute_rms(const float* samples, size_t count) {
     return std::sqrt(sum_sq / count);
 }
 
+/* ============================================================================
+ * EnergyAccumulator
+ * ============================================================================ */
+
+EnergyAccumulator::EnergyAccumulator(int sample_rate, float resolution)
+    : window_samples_(static_cast<size_t>(std::max(1, static_cast<int>(resolution * sample_rate)))) {}
+
+void EnergyAccumulator::push(const float* samples, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        sum_sq_ += samples[i] * samples[i];
+        if (++fill_ == window_samples_) {
+            rms_.push_back(std::sqrt(sum_sq_ / fill_));
+            sum_sq_ = 0.0f;
+            fill_ = 0;
+        }
+    }
+}
+
+Result<std::vector<float>> EnergyAccumulator::finish() {
+    if (fill_ > 0) {
+        rms_.push_back(std::sqrt(sum_sq_ / fill_));
+        sum_sq_ = 0.0f;
+        fill_ = 0;
+    }
+    return EnergyAnalyzer::finalize_curve(std::move(rms_));
+}
+
 } // namespace automix
@@ -39,6 +39,30 @@ public:
      * Compute RMS energy of a segment.
      */
     static float compute_rms(const float* samples, size_t count);
+    
+    /**
+     * Normalize raw RMS windows to 0-1 and smooth them.
+     */
+    static Result<std::vector<float>> finalize_curve(std::vector<float> rms_windows);
+};
+
+/**
+ * Incremental energy curve for streaming analysis (mono input).
+ * Yields the same curve as EnergyAnalyzer::compute_curve.
+ */
+class EnergyAccumulator {
+public:
+    explicit EnergyAccumulator(int sample_rate, float resolution = 0.5f);
+    
+    void push(const float* samples, size_t count);
+    
+    Result<std::vector<float>> finish();
+    
+private:
+    size_t window_samples_;
+    size_t fill_ = 0;
+    float sum_sq_ = 0.0f;
+    std::vector<float> rms_;
 };
 
 } // namespace automix
@@ -0,0 +1,243 @@
+/**
+ * AutoMix Engine - Real-input FFT Implementation
+ */
+
+#include "fft.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace automix {
+
+struct RealFFT::Plan {
+    size_t half = 0;                                // Complex transform size (N/2)
+    std::vector<uint32_t> bitrev;                   // Bit-reversal permutation for `half`
+    std::vector<std::complex<float>> twiddles;      // Per stage of span s: exp(-2*pi*i*k/(2s)), k < s, at offset s-1
+    std::vector<std::complex<float>> split;         // exp(-2*pi*i*k/N),    k <= half
+};
+
+namespace {
+
+std::shared_ptr<const RealFFT::Plan> build_plan(size_t size) {
+    auto plan = std::make_shared<RealFFT::Plan>();
+    const size_t half = size / 2;
+    plan->half = half;
+
+    // Bit-reversal table
+    int bits = 0;
+    while ((size_t(1) << bits) < half) ++bits;
+    plan->bitrev.assign(half, 0);
+    for (size_t i = 1; i < half; ++i) {
+        plan->bitrev[i] = (plan->bitrev[i >> 1] >> 1) | (static_cast<uint32_t>(i & 1) << (bits - 1));
+    }
+
+    // Twiddles computed in double to keep large transforms accurate. Each
+    // butterfly stage gets its own contiguous run so the inner loop never
+    // strides through the table.
+    plan->twiddles.resize(half > 1 ? half - 1 : 0);
+    for (size_t span = 1; span < half; span <<= 1) {
+        for (size_t k = 0; k < span; ++k) {
+            double angle = -M_PI * static_cast<double>(k) / static_cast<double>(span);
+            plan->twiddles[span - 1 + k] = {static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle))};
+        }
+    }
+
+    plan->split.resize(half + 1);
+    for (size_t k = 0; k <= half; ++k) {
+        double angle = -2.0 * M_PI * static_cast<double>(k) / static_cast<double>(size);
+        plan->split[k] = {static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle))};
+    }
+
+    return plan;
+}
+
+std::shared_ptr<const RealFFT::Plan> get_plan(size_t size) {
+    static std::mutex mutex;
+    static std::unordered_map<size_t, std::shared_ptr<const RealFFT::Plan>> cache;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = cache.find(size);
+    if (it != cache.end()) {
+        return it->second;
+    }
+    auto plan = build_plan(size);
+    cache.emplace(size, plan);
+    return plan;
+}
+
+} // namespace
+
+RealFFT::RealFFT(size_t size) : size_(size) {
+    if (!is_power_of_two(size)) {
+        throw std::invalid_argument("RealFFT size must be a power of two");
+    }
+    plan_ = get_plan(size);
+    scratch_.resize(size / 2);
+    spectrum_.resize(size / 2 + 1);
+}
+
+RealFFT::~RealFFT() = default;
+
+size_t RealFFT::next_power_of_two(size_t n) {
+    size_t p = 2;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+void RealFFT::transform() {
+    const Plan& plan = *plan_;
+    const size_t half = plan.half;
+    std::complex<float>* a = scratch_.data();
+
+    // Iterative radix-2 decimation-in-time butterflies
+    for (size_t len = 2; len <= half; len <<= 1) {
+        const size_t span = len / 2;
+        const std::complex<float>* stage = plan.twiddles.data() + (span - 1);
+        for (size_t i = 0; i < half; i += len) {
+            for (size_t j = 0; j < span; ++j) {
+                const std::complex<float> w = stage[j];
+                const std::complex<float> u = a[i + j];
+                const std::complex<float> t = a[i + j + span];
+                const float vr = t.real() * w.real() - t.imag() * w.imag();
+                const float vi = t.real() * w.imag() + t.imag() * w.real();
+                a[i + j] = {u.real() + vr, u.imag() + vi};
+                a[i + j + span] = {u.real() - vr, u.imag() - vi};
+            }
+        }
+    }
+}
+
+void RealFFT::forward(const float* input, std::complex<float>* output) {
+    const Plan& plan = *plan_;
+    const size_t half = plan.half;
+    std::complex<float>* a = scratch_.data();
+
+    // Pack even/odd samples as real/imag parts, in bit-reversed order
+    for (size_t i = 0; i < half; ++i) {
+        a[plan.bitrev[i]] = {input[2 * i], input[2 * i + 1]};
+    }
+
+    transform();
+
+    // Split step: recover the N-point real spectrum from the N/2-point complex one
+    for (size_t k = 0; k <= half; ++k) {
+        const std::complex<float> z = a[k == half ? 0 : k];
+        const std::complex<float> zc = std::conj(a[k == 0 ? 0 : half - k]);
+        const float er = 0.5f * (z.real() + zc.real());
+        const float ei = 0.5f * (z.imag() + zc.imag());
+        // (z - zc) / 2i
+        const float or_ = 0.5f * (z.imag() - zc.imag());
+        const float oi = -0.5f * (z.real() - zc.real());
+        const std::complex<float> w = plan.split[k];
+        output[k] = {er + or_ * w.real() - oi * w.imag(),
+                     ei + or_ * w.imag() + oi * w.real()};
+    }
+}
+
+void RealFFT::inverse(const std::complex<float>* input, float* output) {
+    const Plan& plan = *plan_;
+    const size_t half = plan.half;
+    std::complex<float>* a = scratch_.data();
+
+    // Undo the split step: Z[k] = E[k] + i * O[k], where
+    // E[k] = (X[k] + conj(X[half-k])) / 2 and O[k] = (X[k] - conj(X[half-k])) / 2 * conj(w[k]).
+    // Z is conjugated on load so the forward butterflies compute the inverse transform.
+    for (size_t k = 0; k < half; ++k) {
+        const std::complex<float> x = input[k];
+        const std::complex<float> xc = std::conj(input[half - k]);
+        const std::complex<float> e = 0.5f * (x + xc);
+        const std::complex<float> o = 0.5f * (x - xc) * std::conj(plan.split[k]);
+        const std::complex<float> z = {e.real() - o.imag(), e.imag() + o.real()};
+        a[plan.bitrev[k]] = std::conj(z);
+    }
+
+    transform();
+
+    const float scale = 1.0f / static_cast<float>(half);
+    for (size_t n = 0; n < half; ++n) {
+        output[2 * n] = a[n].real() * scale;
+        output[2 * n + 1] = -a[n].imag() * scale;
+    }
+}
+
+void RealFFT::power_spectrum(const float* input, float* power) {
+    forward(input, spectrum_.data());
+    for (size_t k = 0; k < spectrum_.size(); ++k) {
+        power[k] = spectrum_[k].real() * spectrum_[k].real() + spectrum_[k].imag() * spectrum_[k].imag();
+    }
+}
+
+void RealFFT::magnitude_spectrum(const float* input, float* magnitude) {
+    power_spectrum(input, magnitude);
+    for (size_t k = 0; k < spectrum_.size(); ++k) {
+        magnitude[k] = std::sqrt(magnitude[k]);
+    }
+}
+
+std::vector<float> autocorrelation(const float* input, size_t count, size_t max_lag) {
+    if (count == 0) {
+        return {};
+    }
+    max_lag = std::min(max_lag, count - 1);
+
+    // Block-wise Wiener-Khinchin. Each block of B samples, zero-padded to 2B,
+    // is correlated with the 2B samples starting at the same offset; the
+    // spectrum of that span is H[b] + (-1)^k * H[b+1], so one FFT per block
+    // suffices. Cross-spectra are summed over all blocks and inverted once:
+    // O(count * log B) time and O(B) memory regardless of track length.
+    const size_t block = RealFFT::next_power_of_two(std::max<size_t>(max_lag + 1, 64));
+    const size_t size = block * 2;
+    const size_t block_count = (count + block - 1) / block;
+
+    RealFFT fft(size);
+    const size_t bins = fft.bins();
+    std::vector<float> frame(size, 0.0f);
+    std::vector<std::complex<float>> current(bins), next(bins);
+    std::vector<double> accum_re(bins, 0.0), accum_im(bins, 0.0);
+
+    auto block_spectrum = [&](size_t index, std::vector<std::complex<float>>& out) {
+        const size_t start = index * block;
+        const size_t len = std::min(block, count - start);
+        std::copy(input + start, input + start + len, frame.begin());
+        std::fill(frame.begin() + len, frame.begin() + block, 0.0f);
+        fft.forward(frame.data(), out.data());
+    };
+
+    block_spectrum(0, current);
+    for (size_t b = 0; b < block_count; ++b) {
+        const bool has_next = b + 1 < block_count;
+        if (has_next) {
+            block_spectrum(b + 1, next);
+        }
+        for (size_t k = 0; k < bins; ++k) {
+            const float hr = current[k].real();
+            const float hi = current[k].imag();
+            double re = hr * hr + hi * hi;
+            double im = 0.0;
+            if (has_next) {
+                // conj(H[b]) * H[b+1] * (-1)^k
+                const float nr = next[k].real();
+                const float ni = next[k].imag();
+                const float sign = (k & 1) ? -1.0f : 1.0f;
+                re += sign * (hr * nr + hi * ni);
+                im += sign * (hr * ni - hi * nr);
+            }
+            accum_re[k] += re;
+            accum_im[k] += im;
+        }
+        std::swap(current, next);
+    }
+
+    for (size_t k = 0; k < bins; ++k) {
+        current[k] = {static_cast<float>(accum_re[k]), static_cast<float>(accum_im[k])};
+    }
+    fft.inverse(current.data(), frame.data());
+
+    frame.resize(max_lag + 1);
+    return frame;
+}
+
+} // namespace automix
@@ -0,0 +1,98 @@
+/**
+ * AutoMix Engine - Real-input FFT
+ */
+
+#ifndef AUTOMIX_FFT_H
+#define AUTOMIX_FFT_H
+
+#include <complex>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace automix {
+
+/**
+ * Radix-2 FFT for real-valued input.
+ *
+ * A size-N real transform is computed as a size-N/2 complex transform
+ * followed by a split step. Twiddle factors and the bit-reversal table are
+ * computed once per size and shared by every RealFFT of that size (the plan
+ * cache is thread-safe). Each RealFFT instance owns its scratch buffer, so
+ * use one instance per thread.
+ */
+class RealFFT {
+public:
+    /**
+     * @param size Transform size (power of two, >= 2)
+     */
+    explicit RealFFT(size_t size);
+    ~RealFFT();
+
+    size_t size() const { return size_; }
+
+    /**
+     * Number of output bins (size / 2 + 1).
+     */
+    size_t bins() const { return size_ / 2 + 1; }
+
+    /**
+     * Forward transform.
+     * @param input  size() real samples
+     * @param output bins() complex values (DC .. Nyquist)
+     */
+    void forward(const float* input, std::complex<float>* output);
+
+    /**
+     * Forward transform returning the power spectrum |X[k]|^2.
+     * @param input  size() real samples
+     * @param power  bins() values
+     */
+    void power_spectrum(const float* input, float* power);
+
+    /**
+     * Forward transform returning the magnitude spectrum |X[k]|.
+     * @param input     size() real samples
+     * @param magnitude bins() values
+     */
+    void magnitude_spectrum(const float* input, float* magnitude);
+
+    /**
+     * Inverse transform (normalized, so inverse(forward(x)) == x).
+     * @param input  bins() complex values (DC .. Nyquist)
+     * @param output size() real samples
+     */
+    void inverse(const std::complex<float>* input, float* output);
+
+    static bool is_power_of_two(size_t n) { return n >= 2 && (n & (n - 1)) == 0; }
+
+    /**
+     * Smallest power of two >= n.
+     */
+    static size_t next_power_of_two(size_t n);
+
+    struct Plan;
+
+private:
+    // In-place complex radix-2 butterflies on bit-reversed scratch_
+    void transform();
+    
+    size_t size_;
+    std::shared_ptr<const Plan> plan_;
+    std::vector<std::complex<float>> scratch_;
+    std::vector<std::complex<float>> spectrum_;
+};
+
+/**
+ * Linear (non-circular) autocorrelation via the Wiener-Khinchin theorem,
+ * computed block-wise so cost and memory scale with max_lag, not count.
+ * @param input   Signal samples
+ * @param count   Number of samples
+ * @param max_lag Largest lag to return (clamped to count - 1)
+ * @return r[lag] = sum_i input[i] * input[i + lag], for lag = 0 .. max_lag
+ */
+std::vector<float> autocorrelation(const float* input, size_t count, size_t max_lag);
+
+} // namespace automix
+
+#endif // AUTOMIX_FFT_H
@@ -3,6 +3,7 @@
  */
 
 #include "key_detector.h"
+#include "analysis_context.h"
 #include <cmath>
 #include <algorithm>
 #include <numeric>
@@ -20,13 +21,20 @@ const float KeyDetector::minor_profile_[12] = {
     2.54f, 4.75f, 3.98f, 2.69f, 3.34f, 3.17f
 };
 
-Result<std::string> KeyDetector::detect(const AudioBuffer& audio) {
-    auto chroma_result = compute_chroma(audio);
+Result<KeyCode> KeyDetector::detect(const AudioBuffer& audio) {
+    AnalysisContext context(audio);
+    return detect(context);
+}
+
+Result<KeyCode> KeyDetector::detect(AnalysisContext& context) {
+    auto chroma_result = compute_chroma(context);
     if (chroma_result.failed()) {
         return ResultError{chroma_result.error()};
     }
-    
-    const auto& chroma = chroma_result.value();
+    return detect_from_chroma(chroma_result.value());
+}
+
+Result<KeyCode> KeyDetector::detect_from_chroma(const std::vector<float>& chroma) {
     if (chroma.size() != 12) {
         return ResultError{"Invalid chroma vector"};
     }
@@ -58,38 +66,50 @@ Result<std::string> KeyDetector::detect(const AudioBuffer& audio) {
 }
 
 Result<std::vector<float>> KeyDetector::compute_chroma(const AudioBuffer& audio) {
-    if (audio.samples.empty()) {
+    AnalysisContext context(audio);
+    return compute_chroma(context);
+}
+
+Result<std::vector<float>> KeyDetector::compute_chroma(AnalysisContext& context) {
+    if (context.empty()) {
         return "Empty audio buffer";
     }
     
-    // Convert to mono (no-op if already mono)
-    auto mono = audio.to_mono();
-    
-    const int frame_size = 4096;
-    const int hop_size = 2048;
-    
-    if (mono.size() < static_cast<size_t>(frame_size)) {
+    if (context.mono().size() < static_cast<size_t>(kFrameSize)) {
         return std::vector<float>(12, 1.0f / 12.0f);  // Uniform if too short
     }
     
     // Accumulate chroma
     std::vector<float> chroma(12, 0.0f);
-    int frame_count = 0;
+    auto bin_to_pitch = pitch_class_map(context.sample_rate());
     
-    // Hann window
-    std::vector<float> window(frame_size);
-    for (int i = 0; i < frame_size; ++i) {
-        window[i] = 0.5f * (1.0f - std::cos(2.0f * M_PI * i / (frame_size - 1)));
+    SpectrumFrames spec = context.spectrum(kFrameSize, kHopSize);
+    
+    for (size_t f = 0; f < spec.frames(); ++f) {
+        const float* magnitude = spec.frame(f);
+        
+        // Accumulate power |X[k]|^2 into chroma bins
+        for (size_t bin = 0; bin < spec.bins(); ++bin) {
+            int pitch_class = bin_to_pitch[bin];
+            if (pitch_class >= 0 && pitch_class < 12) {
+                chroma[pitch_class] += magnitude[bin] * magnitude[bin];
+            }
+        }
     }
     
+    normalize_chroma(chroma);
+    return chroma;
+}
+
+std::vector<int> KeyDetector::pitch_class_map(int sample_rate) {
     // Reference frequency for A4 (440 Hz)
     const float a4_freq = 440.0f;
     const int a4_midi = 69;
     
     // Frequency bins to pitch class mapping
-    std::vector<int> bin_to_pitch(frame_size / 2 + 1, -1);
-    for (int bin = 1; bin < frame_size / 2 + 1; ++bin) {
-        float freq = static_cast<float>(bin) * audio.sample_rate / frame_size;
+    std::vector<int> bin_to_pitch(kFrameSize / 2 + 1, -1);
+    for (int bin = 1; bin < kFrameSize / 2 + 1; ++bin) {
+        float freq = static_cast<float>(bin) * sample_rate / kFrameSize;
         if (freq > 20.0f && freq < 5000.0f) {
             // Convert frequency to MIDI note number
             float midi_note = 12.0f * std::log2(freq / a4_freq) + a4_midi;
@@ -98,50 +118,16 @@ Result<std::vector<float>> KeyDetector::compute_chroma(const AudioBuffer& audio)
             bin_to_pitch[bin] = pitch_class;
         }
     }
-    
-    for (size_t start = 0; start + frame_size <= mono.size(); start += hop_size) {
-        // Apply window
-        std::vector<float> windowed(frame_size);
-        for (int i = 0; i < frame_size; ++i) {
-            windowed[i] = mono[start + i] * window[i];
-        }
-        
-        // Simple DFT for magnitude spectrum (simplified - production would use FFT)
-        std::vector<float> magnitude(frame_size / 2 + 1, 0.0f);
-        
-        for (int k = 0; k < frame_size / 2 + 1; ++k) {
-            float real = 0.0f, imag = 0.0f;
-            for (int n = 0; n < frame_size; ++n) {
-                float angle = -2.0f * M_PI * k * n / frame_size;
-                real += windowed[n] * std::cos(angle);
-                imag += windowed[n] * std::sin(angle);
-            }
-            magnitude[k] = std::sqrt(real * real + imag * imag);
-        }
-        
-        // Accumulate into chroma bins
-        for (int bin = 0; bin < frame_size / 2 + 1; ++bin) {
-            int pitch_class = bin_to_pitch[bin];
-            if (pitch_class >= 0 && pitch_class < 12) {
-                chroma[pitch_class] += magnitude[bin] * magnitude[bin];
-            }
-        }
-        
-        frame_count++;
-        
-        // Limit processing for long files
-        if (frame_count > 1000) break;
-    }
-    
-    // Normalize
+    return bin_to_pitch;
+}
+
+void KeyDetector::normalize_chroma(std::vector<float>& chroma) {
     float sum = std::accumulate(chroma.begin(), chroma.end(), 0.0f);
     if (sum > 0) {
         for (float& v : chroma) {
             v /= sum;
         }
     }
-    
-    return chroma;
 }
 
 float KeyDetector::correlate_with_profile(const std::vector<float>& chroma, const float* profile, int shift) {
@@ -172,7 +158,7 @@ float KeyDetector::correlate_with_profile(const std::vector<float>& chroma, cons
     return numerator / denominator;
 }
 
-std::string KeyDetector::pitch_class_to_camelot(int pitch_class, bool is_major) {
+KeyCode KeyDetector::pitch_class_to_camelot(int pitch_class, bool is_major) {
     // Camelot wheel mapping
     // Major keys (B): C=8B, C#=3B, D=10B, D#=5B, E=12B, F=7B, F#=2B, G=9B, G#=4B, A=11B, A#=6B, B=1B
     // Minor keys (A): C=5A, C#=12A, D=7A, D#=2A, E=9A, F=4A, F#=11A, G=6A, G#=1A, A=8A, A#=3A, B=10A
@@ -180,18 +166,47 @@ std::string KeyDetector::pitch_class_to_camelot(int pitch_class, bool is_major)
     static const int major_camelot[] = {8, 3, 10, 5, 12, 7, 2, 9, 4, 11, 6, 1};
     static const int minor_camelot[] = {5, 12, 7, 2, 9, 4, 11, 6, 1, 8, 3, 10};
     
-    int camelot_num;
-    char mode_char;
-    
-    if (is_major) {
-        camelot_num = major_camelot[pitch_class];
-        mode_char = 'B';
-    } else {
-        camelot_num = minor_camelot[pitch_class];
-        mode_char = 'A';
+    int camelot_num = is_major ? major_camelot[pitch_class] : minor_camelot[pitch_class];
+    return static_cast<KeyCode>((camelot_num - 1) * 2 + (is_major ? 1 : 0));
+}
+
+/* ============================================================================
+ * ChromaAccumulator
+ * ============================================================================ */
+
+ChromaAccumulator::ChromaAccumulator(int sample_rate)
+    : framer_(KeyDetector::kFrameSize, KeyDetector::kHopSize)
+    , fft_(KeyDetector::kFrameSize)
+    , window_(hann_window(KeyDetector::kFrameSize))
+    , windowed_(KeyDetector::kFrameSize)
+    , magnitude_(fft_.bins())
+    , bin_to_pitch_(KeyDetector::pitch_class_map(sample_rate))
+    , chroma_(12, 0.0f) {}
+
+void ChromaAccumulator::push(const float* samples, size_t count) {
+    framer_.push(samples, count, [this](const float* frame) {
+        for (size_t i = 0; i < windowed_.size(); ++i) {
+            windowed_[i] = frame[i] * window_[i];
+        }
+        fft_.magnitude_spectrum(windowed_.data(), magnitude_.data());
+        
+        for (size_t bin = 0; bin < magnitude_.size(); ++bin) {
+            int pitch_class = bin_to_pitch_[bin];
+            if (pitch_class >= 0 && pitch_class < 12) {
+                chroma_[pitch_class] += magnitude_[bin] * magnitude_[bin];
+            }
+        }
+        frames_++;
+    });
+}
+
+std::vector<float> ChromaAccumulator::finish() const {
+    if (frames_ == 0) {
+        return std::vector<float>(12, 1.0f / 12.0f);  // Uniform if too short
     }
-    
-    return std::to_string(camelot_num) + mode_char;
+    std::vector<float> chroma = chroma_;
+    KeyDetector::normalize_chroma(chroma);
+    return chroma;
 }
 
 } // namespace automix
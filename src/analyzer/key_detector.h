@@ -6,40 +6,94 @@
 #define AUTOMIX_KEY_DETECTOR_H
 
 #include "automix/types.h"
+#include "analysis_context.h"
+#include "fft.h"
 
 namespace automix {
 
 /**
  * Musical key detection.
- * Returns key in Camelot notation (e.g., "8A", "11B").
+ * Returns the key as a Camelot wheel code (see KeyCode).
  */
 class KeyDetector {
 public:
     KeyDetector() = default;
     
+    // STFT framing used for chroma
+    static constexpr int kFrameSize = 4096;
+    static constexpr int kHopSize = 2048;
+    
     /**
      * Detect musical key from audio buffer.
-     * @return Key in Camelot notation (e.g., "8A", "11B")
+     * @return Key code ("8A" = 14)
+     */
+    Result<KeyCode> detect(const AudioBuffer& audio);
+    Result<KeyCode> detect(AnalysisContext& context);
+    
+    /**
+     * Detect musical key from a precomputed chroma vector.
      */
-    Result<std::string> detect(const AudioBuffer& audio);
+    Result<KeyCode> detect_from_chroma(const std::vector<float>& chroma);
     
     /**
      * Compute chroma features (12-dimensional pitch class profile).
      */
     Result<std::vector<float>> compute_chroma(const AudioBuffer& audio);
     
+    /**
+     * Compute chroma from the context's kFrameSize/kHopSize STFT frames.
+     */
+    Result<std::vector<float>> compute_chroma(AnalysisContext& context);
+    
+    /**
+     * Pitch class (0-11, C = 0) of each kFrameSize spectrum bin, -1 outside 20-5000 Hz.
+     */
+    static std::vector<int> pitch_class_map(int sample_rate);
+    
+    /**
+     * Normalize accumulated chroma energy to sum 1.
+     */
+    static void normalize_chroma(std::vector<float>& chroma);
+    
 private:
     // Key profiles for major and minor keys
     static const float major_profile_[12];
     static const float minor_profile_[12];
     
-    // Convert pitch class to Camelot notation
-    static std::string pitch_class_to_camelot(int pitch_class, bool is_major);
+    // Convert pitch class to a Camelot key code
+    static KeyCode pitch_class_to_camelot(int pitch_class, bool is_major);
     
     // Correlate chroma with key profiles
     float correlate_with_profile(const std::vector<float>& chroma, const float* profile, int shift);
 };
 
+/**
+ * Incremental chroma for streaming analysis.
+ * Yields the same chroma as KeyDetector::compute_chroma; memory is one
+ * kFrameSize frame plus FFT scratch.
+ */
+class ChromaAccumulator {
+public:
+    explicit ChromaAccumulator(int sample_rate);
+    
+    void push(const float* samples, size_t count);
+    
+    /**
+     * Normalized chroma (uniform if no full frame was seen).
+     */
+    std::vector<float> finish() const;
+    
+private:
+    Framer framer_;
+    RealFFT fft_;
+    std::vector<float> window_;
+    std::vector<float> windowed_;
+    std::vector<float> magnitude_;
+    std::vector<int> bin_to_pitch_;
+    std::vector<float> chroma_;
+    size_t frames_ = 0;
+};
+
 } // namespace automix
 
 #endif // AUTOMIX_KEY_DETECTOR_H
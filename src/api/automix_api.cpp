@@ -4,6 +4,8 @@
 
 #include "automix/automix.h"
 #include "../mixer/engine.h"
+#include "../core/utils.h"
+#include <algorithm>
 #include <climits>
 #include <cstring>
 #include <unordered_map>
@@ -21,6 +23,7 @@ struct AutoMixEngine {
     TransitionConfig transition_config;
     AutoMixStatusCallback status_callback = nullptr;
     void* status_callback_user_data = nullptr;
+    ScanStats scan_stats;               // Scan in progress, or the last one
 };
 
 struct PlaylistHandleImpl {
@@ -127,23 +130,148 @@ int automix_scan_with_callback_ex(
     AutoMixScanCallback callback,
     void* user_data,
     int metadata_only
+) {
+    return automix_scan_with_callback_mode(engine, music_dir, recursive, callback, user_data,
+        metadata_only ? AUTOMIX_SCAN_METADATA_ONLY : AUTOMIX_SCAN_FULL);
+}
+
+int automix_scan_with_callback_mode(
+    AutoMixEngine* engine,
+    const char* music_dir,
+    int recursive,
+    AutoMixScanCallback callback,
+    void* user_data,
+    AutoMixScanMode mode
 ) {
     if (!engine || !engine->engine || !music_dir) return AUTOMIX_ERROR_INVALID_ARGUMENT;
     
-    ScanCallback cpp_callback = nullptr;
+    ScanMode scan_mode;
+    switch (mode) {
+        case AUTOMIX_SCAN_FULL: scan_mode = ScanMode::Full; break;
+        case AUTOMIX_SCAN_METADATA_ONLY: scan_mode = ScanMode::MetadataOnly; break;
+        case AUTOMIX_SCAN_FAST: scan_mode = ScanMode::Fast; break;
+        default: return AUTOMIX_ERROR_INVALID_ARGUMENT;
+    }
+    
+    // Progress runs on the scan's writer thread while this call blocks, so
+    // automix_get_scan_stats() from inside the callback sees current stats
+    ScanProgressCallback progress = [engine, callback, user_data](const ScanProgress& p) {
+        engine->scan_stats = p.stats;
+        if (callback) {
+            callback(p.file.c_str(), p.processed, p.total, user_data);
+        }
+    };
+    
+    int result = engine->engine->scan(music_dir, recursive != 0, progress, scan_mode);
+    engine->scan_stats = engine->engine->last_scan_stats();
+    if (result < 0) {
+        engine->last_error = engine->engine->error();
+    }
+    return result;
+}
+
+static AutoMixScanStageStats to_c_stage_stats(const ScanStageStats& stage, double elapsed) {
+    AutoMixScanStageStats out;
+    out.workers = stage.workers;
+    out.completed = stage.completed;
+    out.failed = stage.failed;
+    out.files_per_second = stage.throughput(elapsed);
+    out.utilization = stage.utilization(elapsed);
+    return out;
+}
+
+AutoMixError automix_get_scan_stats(AutoMixEngine* engine, AutoMixScanStats* stats) {
+    if (!engine || !engine->engine || !stats) return AUTOMIX_ERROR_INVALID_ARGUMENT;
+    
+    const ScanStats& s = engine->scan_stats;
+    stats->read = to_c_stage_stats(s.read, s.elapsed_seconds);
+    stats->decode = to_c_stage_stats(s.decode, s.elapsed_seconds);
+    stats->analyze = to_c_stage_stats(s.analyze, s.elapsed_seconds);
+    stats->write = to_c_stage_stats(s.write, s.elapsed_seconds);
+    stats->elapsed_seconds = s.elapsed_seconds;
+    return AUTOMIX_OK;
+}
+
+AutoMixError automix_set_scan_concurrency(AutoMixEngine* engine, int readers, int decoders, int analyzers) {
+    if (!engine || !engine->engine) return AUTOMIX_ERROR_INVALID_ARGUMENT;
+    if (readers < 0 || decoders < 0 || analyzers < 0) return AUTOMIX_ERROR_INVALID_ARGUMENT;
+    
+    ScanConcurrency concurrency = engine->engine->scan_concurrency();
+    concurrency.readers = readers;
+    concurrency.decoders = decoders;
+    concurrency.analyzers = analyzers;
+    engine->engine->set_scan_concurrency(concurrency);
+    return AUTOMIX_OK;
+}
+
+AutoMixError automix_set_scan_directory_cache(AutoMixEngine* engine, int enabled) {
+    if (!engine || !engine->engine) return AUTOMIX_ERROR_INVALID_ARGUMENT;
+    
+    engine->engine->set_directory_cache(enabled != 0);
+    return AUTOMIX_OK;
+}
+
+/* ============================================================================
+ * Watch Mode
+ * ============================================================================ */
+
+AutoMixError automix_watch_start(AutoMixEngine* engine, const char* music_dir, int recursive) {
+    if (!engine || !engine->engine || !music_dir) return AUTOMIX_ERROR_INVALID_ARGUMENT;
+    
+    if (!engine->engine->start_watch(music_dir, recursive != 0)) {
+        engine->last_error = engine->engine->error();
+        return AUTOMIX_ERROR_FILE_NOT_FOUND;
+    }
+    return AUTOMIX_OK;
+}
+
+int automix_watch_run(
+    AutoMixEngine* engine,
+    AutoMixWatchCallback callback,
+    void* user_data,
+    AutoMixScanMode mode
+) {
+    if (!engine || !engine->engine) return AUTOMIX_ERROR_INVALID_ARGUMENT;
+    
+    ScanMode scan_mode;
+    switch (mode) {
+        case AUTOMIX_SCAN_FULL: scan_mode = ScanMode::Full; break;
+        case AUTOMIX_SCAN_METADATA_ONLY: scan_mode = ScanMode::MetadataOnly; break;
+        case AUTOMIX_SCAN_FAST: scan_mode = ScanMode::Fast; break;
+        default: return AUTOMIX_ERROR_INVALID_ARGUMENT;
+    }
+    
+    WatchCallback on_update = nullptr;
     if (callback) {
-        cpp_callback = [callback, user_data](const std::string& file, int processed, int total) {
-            callback(file.c_str(), processed, total, user_data);
+        on_update = [callback, user_data](const WatchUpdate& update) {
+            AutoMixWatchEvent event = AUTOMIX_WATCH_ANALYZED;
+            switch (update.kind) {
+                case WatchUpdate::Kind::Analyzed: event = AUTOMIX_WATCH_ANALYZED; break;
+                case WatchUpdate::Kind::Failed: event = AUTOMIX_WATCH_FAILED; break;
+                case WatchUpdate::Kind::Renamed: event = AUTOMIX_WATCH_RENAMED; break;
+                case WatchUpdate::Kind::Removed: event = AUTOMIX_WATCH_REMOVED; break;
+                case WatchUpdate::Kind::Rescanned: event = AUTOMIX_WATCH_RESCANNED; break;
+            }
+            callback(event, update.path.c_str(),
+                     update.old_path.empty() ? nullptr : update.old_path.c_str(), user_data);
         };
     }
     
-    int result = engine->engine->scan(music_dir, recursive != 0, cpp_callback, metadata_only != 0);
+    int result = engine->engine->run_watch(on_update, scan_mode);
     if (result < 0) {
         engine->last_error = engine->engine->error();
+        return AUTOMIX_ERROR_NOT_INITIALIZED;
     }
     return result;
 }
 
+AutoMixError automix_watch_stop(AutoMixEngine* engine) {
+    if (!engine || !engine->engine) return AUTOMIX_ERROR_INVALID_ARGUMENT;
+    
+    engine->engine->stop_watch();
+    return AUTOMIX_OK;
+}
+
 int automix_get_track_count(AutoMixEngine* engine) {
     if (!engine || !engine->engine) return 0;
     return engine->engine->track_count();
@@ -164,7 +292,7 @@ AutoMixError automix_get_track_info(
     info->id = track->id;
     info->path = strdup(track->path.c_str());
     info->bpm = track->bpm;
-    info->key = strdup(track->key.c_str());
+    info->key = strdup(utils::key_to_camelot(track->key).c_str());
     info->duration = track->duration;
     info->analyzed_at = track->analyzed_at;
     
@@ -423,6 +551,65 @@ AutoMixError automix_seek(AutoMixEngine* engine, float position_seconds) {
     return AUTOMIX_OK;
 }
 
+// Map a failed queue edit that touched `position`
+static AutoMixError queue_edit_error(AutoMixEngine* engine, int position) {
+    if (position <= 1 && engine->engine->playback_state() == PlaybackState::Transitioning) {
+        return AUTOMIX_ERROR_TRANSITIONING;
+    }
+    return AUTOMIX_ERROR_INVALID_ARGUMENT;
+}
+
+AutoMixError automix_queue_insert(AutoMixEngine* engine, int position, int64_t track_id) {
+    if (!engine || !engine->engine || position < 0) return AUTOMIX_ERROR_INVALID_ARGUMENT;
+    if (!engine->engine->queue_insert(static_cast<size_t>(position), track_id)) {
+        return queue_edit_error(engine, position);
+    }
+    return AUTOMIX_OK;
+}
+
+AutoMixError automix_queue_remove(AutoMixEngine* engine, int position) {
+    if (!engine || !engine->engine || position < 0) return AUTOMIX_ERROR_INVALID_ARGUMENT;
+    if (!engine->engine->queue_remove(static_cast<size_t>(position))) {
+        return queue_edit_error(engine, position);
+    }
+    return AUTOMIX_OK;
+}
+
+AutoMixError automix_queue_move(AutoMixEngine* engine, int from, int to) {
+    if (!engine || !engine->engine || from < 0 || to < 0) return AUTOMIX_ERROR_INVALID_ARGUMENT;
+    if (!engine->engine->queue_move(static_cast<size_t>(from), static_cast<size_t>(to))) {
+        return queue_edit_error(engine, std::min(from, to));
+    }
+    return AUTOMIX_OK;
+}
+
+AutoMixError automix_queue_replace(AutoMixEngine* engine, int position, int64_t track_id) {
+    if (!engine || !engine->engine || position < 0) return AUTOMIX_ERROR_INVALID_ARGUMENT;
+    if (!engine->engine->queue_replace(static_cast<size_t>(position), track_id)) {
+        return queue_edit_error(engine, position);
+    }
+    return AUTOMIX_OK;
+}
+
+AutoMixError automix_get_queue(AutoMixEngine* engine, int64_t** out_ids, int* out_count) {
+    if (!engine || !engine->engine || !out_ids || !out_count) return AUTOMIX_ERROR_INVALID_ARGUMENT;
+    
+    std::vector<int64_t> queue = engine->engine->queue();
+    if (queue.size() > static_cast<size_t>(INT_MAX)) {
+        engine->last_error = "Queue exceeds maximum size";
+        return AUTOMIX_ERROR_INVALID_ARGUMENT;
+    }
+    
+    *out_count = static_cast<int>(queue.size());
+    if (queue.empty()) {
+        *out_ids = nullptr;
+        return AUTOMIX_OK;
+    }
+    *out_ids = new int64_t[queue.size()];
+    std::copy(queue.begin(), queue.end(), *out_ids);
+    return AUTOMIX_OK;
+}
+
 AutoMixPlaybackState automix_get_state(AutoMixEngine* engine) {
     if (!engine || !engine->engine) return AUTOMIX_STATE_STOPPED;
     return static_cast<AutoMixPlaybackState>(engine->engine->playback_state());
@@ -10,8 +10,18 @@
 #include "db_path.h"
 #include <iostream>
 #include <string>
+#include <csignal>
+#include <cstdlib>
 #include <cstring>
 
+static AutoMixEngine* g_watch_engine = nullptr;
+
+static void handle_stop_signal(int) {
+    if (g_watch_engine) {
+        automix_watch_stop(g_watch_engine);
+    }
+}
+
 void print_usage(const char* program) {
     std::string default_hint = "AUTOMIX_DB or ~/Library/Application Support/Automix/automix.db";
 #ifdef __linux__
@@ -23,9 +33,38 @@ void print_usage(const char* program) {
               << "  -r, --recursive        Scan subdirectories (default: true)\n"
               << "  -n, --no-recursive     Don't scan subdirectories\n"
               << "  -m, --metadata-only    Only collect path/duration, skip BPM/key analysis\n"
+              << "  -f, --fast             Analyze short excerpts only (quick first import;\n"
+              << "                         a later full scan redoes low-confidence tracks)\n"
+              << "  --readers <n>          File reader threads (default: auto)\n"
+              << "  --decoders <n>         Decoder threads (default: auto)\n"
+              << "  --analyzers <n>        Analyzer threads (default: auto)\n"
+              << "  --full-walk            List every directory, even unchanged ones\n"
+              << "                         (finds files edited in place)\n"
+              << "  -w, --watch            After scanning, keep running and apply changes\n"
+              << "                         as files are added, moved or deleted (Linux)\n"
               << "  -h, --help             Show this help\n";
 }
 
+void print_stage(const char* name, const AutoMixScanStageStats& stage) {
+    if (stage.workers == 0) return;
+    std::cout << "  " << name << ": " << stage.workers << " thread(s), "
+              << stage.completed << " ok, " << stage.failed << " failed, "
+              << stage.files_per_second << " files/s, "
+              << static_cast<int>(stage.utilization * 100.0 + 0.5) << "% busy\n";
+}
+
+void watch_callback(AutoMixWatchEvent event, const char* path, const char* old_path, void* user_data) {
+    (void)user_data;
+    switch (event) {
+        case AUTOMIX_WATCH_ANALYZED: std::cout << "analyzed " << path << "\n"; break;
+        case AUTOMIX_WATCH_FAILED: std::cout << "failed   " << path << "\n"; break;
+        case AUTOMIX_WATCH_RENAMED: std::cout << "renamed  " << old_path << " -> " << path << "\n"; break;
+        case AUTOMIX_WATCH_REMOVED: std::cout << "removed  " << path << "\n"; break;
+        case AUTOMIX_WATCH_RESCANNED: std::cout << "rescanned " << path << " (events were dropped)\n"; break;
+    }
+    std::cout << std::flush;
+}
+
 void scan_callback(const char* file, int processed, int total, void* user_data) {
     (void)user_data;
     std::cout << "\r[" << processed << "/" << total << "] " << file << std::flush;
@@ -38,7 +77,10 @@ int main(int argc, char* argv[]) {
     std::string db_path_arg;  // From -d, empty if not specified
     std::string music_dir;
     bool recursive = true;
-    int metadata_only = 0;
+    AutoMixScanMode mode = AUTOMIX_SCAN_FULL;
+    int readers = 0, decoders = 0, analyzers = 0;
+    bool full_walk = false;
+    bool watch = false;
     
     // Parse arguments
     for (int i = 1; i < argc; ++i) {
@@ -57,7 +99,23 @@ int main(int argc, char* argv[]) {
         } else if (strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--no-recursive") == 0) {
             recursive = false;
         } else if (strcmp(argv[i], "-m") == 0 || strcmp(argv[i], "--metadata-only") == 0) {
-            metadata_only = 1;
+            mode = AUTOMIX_SCAN_METADATA_ONLY;
+        } else if (strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--fast") == 0) {
+            mode = AUTOMIX_SCAN_FAST;
+        } else if (strcmp(argv[i], "-w") == 0 || strcmp(argv[i], "--watch") == 0) {
+            watch = true;
+        } else if (strcmp(argv[i], "--full-walk") == 0) {
+            full_walk = true;
+        } else if (strcmp(argv[i], "--readers") == 0 || strcmp(argv[i], "--decoders") == 0 ||
+                   strcmp(argv[i], "--analyzers") == 0) {
+            if (i + 1 >= argc || std::atoi(argv[i + 1]) <= 0) {
+                std::cerr << "Error: " << argv[i] << " requires a positive number\n";
+                return 1;
+            }
+            int count = std::atoi(argv[++i]);
+            if (strcmp(argv[i - 1], "--readers") == 0) readers = count;
+            else if (strcmp(argv[i - 1], "--decoders") == 0) decoders = count;
+            else analyzers = count;
         } else if (argv[i][0] != '-') {
             music_dir = argv[i];
         } else {
@@ -82,11 +140,23 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
-    std::cout << "Scanning " << music_dir << (metadata_only ? " (metadata only)" : "") << "...\n";
+    automix_set_scan_concurrency(engine, readers, decoders, analyzers);
+    automix_set_scan_directory_cache(engine, full_walk ? 0 : 1);
+    
+    // Watch before scanning so changes made during the scan are not missed
+    if (watch && automix_watch_start(engine, music_dir.c_str(), recursive ? 1 : 0) != AUTOMIX_OK) {
+        std::cerr << "Error: " << automix_get_error(engine) << "\n";
+        automix_destroy(engine);
+        return 1;
+    }
+    
+    const bool metadata_only = mode == AUTOMIX_SCAN_METADATA_ONLY;
+    std::cout << "Scanning " << music_dir
+              << (metadata_only ? " (metadata only)" : mode == AUTOMIX_SCAN_FAST ? " (fast)" : "") << "...\n";
     
     // Scan
-    int result = automix_scan_with_callback_ex(
-        engine, music_dir.c_str(), recursive ? 1 : 0, scan_callback, nullptr, metadata_only);
+    int result = automix_scan_with_callback_mode(
+        engine, music_dir.c_str(), recursive ? 1 : 0, scan_callback, nullptr, mode);
     
     if (result < 0) {
         std::cerr << "Error: " << automix_get_error(engine) << "\n";
@@ -98,6 +168,30 @@ int main(int argc, char* argv[]) {
     std::cout << "\nDone! " << result << " tracks " << (metadata_only ? "processed" : "analyzed") << ".\n";
     std::cout << "Total tracks in library: " << total << "\n";
     
+    AutoMixScanStats stats;
+    if (automix_get_scan_stats(engine, &stats) == AUTOMIX_OK && stats.elapsed_seconds > 0.0) {
+        std::cout << "Pipeline (" << stats.elapsed_seconds << " s):\n";
+        print_stage("read", stats.read);
+        print_stage("decode", stats.decode);
+        print_stage("analyze", stats.analyze);
+        print_stage("write", stats.write);
+    }
+    
+    if (watch) {
+        g_watch_engine = engine;
+        std::signal(SIGINT, handle_stop_signal);
+        std::signal(SIGTERM, handle_stop_signal);
+        
+        std::cout << "\nWatching " << music_dir << " for changes (Ctrl-C to stop)...\n";
+        int changes = automix_watch_run(engine, watch_callback, nullptr, mode);
+        g_watch_engine = nullptr;
+        if (changes < 0) {
+            std::cerr << "Error: " << automix_get_error(engine) << "\n";
+        } else {
+            std::cout << changes << " library changes applied.\n";
+        }
+    }
+    
     automix_destroy(engine);
     return 0;
 }
@@ -0,0 +1,132 @@
+/**
+ * AutoMix Engine - Content Fingerprints Implementation
+ */
+
+#include "content_hash.h"
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace automix {
+
+namespace {
+
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+// Little-endian reads, as the reference implementation defines the hash
+inline uint64_t read64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+
+inline uint32_t read32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline uint64_t xxh_round(uint64_t acc, uint64_t input) {
+    acc += input * kPrime2;
+    acc = rotl(acc, 31);
+    return acc * kPrime1;
+}
+
+inline uint64_t merge_round(uint64_t acc, uint64_t value) {
+    acc ^= xxh_round(0, value);
+    return acc * kPrime1 + kPrime4;
+}
+
+} // namespace
+
+uint64_t xxhash64(const void* data, size_t length, uint64_t seed) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const uint8_t* end = p + length;
+    uint64_t h;
+    
+    if (length >= 32) {
+        uint64_t v1 = seed + kPrime1 + kPrime2;
+        uint64_t v2 = seed + kPrime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - kPrime1;
+        
+        const uint8_t* limit = end - 32;
+        do {
+            v1 = xxh_round(v1, read64(p));
+            v2 = xxh_round(v2, read64(p + 8));
+            v3 = xxh_round(v3, read64(p + 16));
+            v4 = xxh_round(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge_round(h, v1);
+        h = merge_round(h, v2);
+        h = merge_round(h, v3);
+        h = merge_round(h, v4);
+    } else {
+        h = seed + kPrime5;
+    }
+    
+    h += static_cast<uint64_t>(length);
+    
+    while (p + 8 <= end) {
+        h ^= xxh_round(0, read64(p));
+        h = rotl(h, 27) * kPrime1 + kPrime4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= static_cast<uint64_t>(read32(p)) * kPrime1;
+        h = rotl(h, 23) * kPrime2 + kPrime3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= static_cast<uint64_t>(*p) * kPrime5;
+        h = rotl(h, 11) * kPrime1;
+        ++p;
+    }
+    
+    // Avalanche
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t file_fingerprint(const std::string& path, size_t edge_bytes) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) return 0;
+    
+    std::streamoff size = in.tellg();
+    if (size < 0) return 0;
+    const uint64_t file_size = static_cast<uint64_t>(size);
+    
+    // Head and tail: tags usually sit at the ends, audio frames in between
+    std::vector<char> buffer;
+    if (file_size <= 2 * static_cast<uint64_t>(edge_bytes)) {
+        buffer.resize(static_cast<size_t>(file_size));
+        in.seekg(0);
+        in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    } else {
+        buffer.resize(2 * edge_bytes);
+        in.seekg(0);
+        in.read(buffer.data(), static_cast<std::streamsize>(edge_bytes));
+        in.seekg(static_cast<std::streamoff>(file_size - edge_bytes));
+        in.read(buffer.data() + edge_bytes, static_cast<std::streamsize>(edge_bytes));
+    }
+    if (!in) return 0;
+    
+    uint64_t hash = xxhash64(buffer.data(), buffer.size(), file_size);
+    return hash != 0 ? hash : 1;  // 0 means "no fingerprint"
+}
+
+} // namespace automix
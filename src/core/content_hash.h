@@ -0,0 +1,33 @@
+/**
+ * AutoMix Engine - Content Fingerprints
+ */
+
+#ifndef AUTOMIX_CONTENT_HASH_H
+#define AUTOMIX_CONTENT_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace automix {
+
+// Bytes hashed at each end of a file by file_fingerprint()
+constexpr size_t kFingerprintEdgeBytes = 1024 * 1024;
+
+/**
+ * XXH64 (xxHash, 64-bit) of a buffer.
+ */
+uint64_t xxhash64(const void* data, size_t length, uint64_t seed = 0);
+
+/**
+ * Fingerprint of a file's contents: XXH64 over the first and last
+ * edge_bytes (the whole file if it is smaller than both), seeded with the
+ * file size. Cheap enough to run on every new file of a scan, and stable
+ * when a file is moved, renamed or copied.
+ * @return 0 if the file cannot be read
+ */
+uint64_t file_fingerprint(const std::string& path, size_t edge_bytes = kFingerprintEdgeBytes);
+
+} // namespace automix
+
+#endif // AUTOMIX_CONTENT_HASH_H
@@ -0,0 +1,166 @@
+/**
+ * AutoMix Engine - Parallel Library Directory Walker Implementation
+ */
+
+#include "directory_walker.h"
+#include "utils.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+namespace automix {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+int64_t directory_mtime(const fs::path& dir) {
+    std::error_code ec;
+    auto time = fs::last_write_time(dir, ec);
+    return ec ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+int64_t file_mtime_seconds(const fs::directory_entry& entry) {
+    std::error_code ec;
+    auto time = entry.last_write_time(ec);
+    if (ec) return 0;
+    return std::chrono::duration_cast<std::chrono::seconds>(time.time_since_epoch()).count();
+}
+
+} // namespace
+
+DirectoryWalker::DirectoryWalker(int threads) {
+    // Directory listing is latency bound on network storage; a few
+    // requests in flight help even on small machines
+    threads_ = threads > 0 ? threads : std::max(4, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+WalkResult DirectoryWalker::walk(const std::string& root, bool recursive, const DirectorySnapshot* previous) const {
+    WalkResult result;
+    const fs::path root_path(utils::path_to_absolute(root));
+    
+    std::error_code ec;
+    if (fs::is_regular_file(root_path, ec)) {
+        if (utils::is_audio_file(root_path)) {
+            result.files.push_back({root_path.string(), utils::file_modified_time(root_path)});
+        }
+        return result;
+    }
+    if (!fs::is_directory(root_path, ec)) {
+        return result;
+    }
+    
+    // Subdirectories by parent, for descending into unchanged directories
+    std::unordered_map<std::string, std::vector<std::string>> children;
+    if (previous) {
+        for (const auto& [path, state] : *previous) {
+            if (!state.parent.empty()) {
+                children[state.parent].push_back(path);
+            }
+        }
+    }
+    
+    std::mutex mutex;
+    std::condition_variable has_work;
+    std::deque<std::pair<std::string, std::string>> pending;  // (directory, parent)
+    int active = 0;
+    pending.emplace_back(root_path.string(), std::string());
+    
+    auto visit = [&](const std::string& dir, const std::string& parent,
+                     std::vector<WalkedFile>& files, std::vector<std::pair<std::string, std::string>>& subdirs) {
+        // Read the mtime before listing: a change made while listing shows
+        // up as a different mtime next time
+        DirectoryState state;
+        state.mtime = directory_mtime(dir);
+        state.parent = parent;
+        
+        bool unchanged = false;
+        if (previous && state.mtime != 0) {
+            auto it = previous->find(dir);
+            unchanged = it != previous->end() && it->second.mtime == state.mtime;
+        }
+        
+        if (unchanged) {
+            auto it = children.find(dir);
+            if (recursive && it != children.end()) {
+                for (const auto& child : it->second) {
+                    subdirs.emplace_back(child, dir);
+                }
+            }
+        } else {
+            std::error_code list_ec;
+            for (fs::directory_iterator entries(dir, list_ec), end; !list_ec && entries != end; entries.increment(list_ec)) {
+                const auto& entry = *entries;
+                std::error_code type_ec;
+                if (entry.is_directory(type_ec) && !entry.is_symlink(type_ec)) {
+                    if (recursive) {
+                        subdirs.emplace_back(entry.path().string(), dir);
+                    }
+                } else if (entry.is_regular_file(type_ec) && utils::is_audio_file(entry.path())) {
+                    files.push_back({entry.path().string(), file_mtime_seconds(entry)});
+                }
+            }
+            if (list_ec) {
+                state.mtime = 0;  // Unreadable (permissions, I/O): try again next time
+            }
+        }
+        
+        std::lock_guard<std::mutex> lock(mutex);
+        if (unchanged) {
+            result.unchanged_dirs.push_back(dir);
+        } else {
+            result.listed_dirs++;
+        }
+        result.directories[dir] = std::move(state);
+        result.files.insert(result.files.end(), std::make_move_iterator(files.begin()),
+                            std::make_move_iterator(files.end()));
+    };
+    
+    auto worker = [&]() {
+        std::vector<WalkedFile> files;
+        std::vector<std::pair<std::string, std::string>> subdirs;
+        
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            has_work.wait(lock, [&]() { return !pending.empty() || active == 0; });
+            if (pending.empty()) {
+                break;  // Nothing queued and nobody listing: the walk is done
+            }
+            auto [dir, parent] = std::move(pending.front());
+            pending.pop_front();
+            active++;
+            lock.unlock();
+            
+            files.clear();
+            subdirs.clear();
+            visit(dir, parent, files, subdirs);
+            
+            lock.lock();
+            active--;
+            for (auto& subdir : subdirs) {
+                pending.push_back(std::move(subdir));
+            }
+            has_work.notify_all();
+        }
+    };
+    
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads_; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+    
+    std::sort(result.files.begin(), result.files.end(),
+              [](const WalkedFile& a, const WalkedFile& b) { return a.path < b.path; });
+    std::sort(result.unchanged_dirs.begin(), result.unchanged_dirs.end());
+    return result;
+}
+
+} // namespace automix
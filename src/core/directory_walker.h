@@ -0,0 +1,68 @@
+/**
+ * AutoMix Engine - Parallel Library Directory Walker
+ */
+
+#ifndef AUTOMIX_DIRECTORY_WALKER_H
+#define AUTOMIX_DIRECTORY_WALKER_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace automix {
+
+/**
+ * A directory as seen by the last walk. mtime is the raw file-clock tick
+ * count (sub-second on most filesystems); 0 forces a relisting.
+ */
+struct DirectoryState {
+    int64_t mtime = 0;
+    std::string parent;                 // Empty for the walk root
+};
+
+using DirectorySnapshot = std::unordered_map<std::string, DirectoryState>;
+
+struct WalkedFile {
+    std::string path;                   // Absolute
+    int64_t mtime = 0;                  // Seconds, as utils::file_modified_time
+};
+
+struct WalkResult {
+    std::vector<WalkedFile> files;      // Audio files in listed directories, sorted by path
+    std::vector<std::string> unchanged_dirs;  // Not listed: same mtime as in the previous walk
+    DirectorySnapshot directories;      // Every directory reached, to persist for the next walk
+    int listed_dirs = 0;
+};
+
+/**
+ * Walks a library tree with several threads sharing a queue of
+ * directories, collecting file modification times in the same pass.
+ *
+ * Given the snapshot of a previous walk, a directory whose mtime has not
+ * changed is not listed again: its set of entries is the same, so its
+ * audio files are the ones already known, and its subdirectories (from the
+ * snapshot) are still visited, since changes deeper down do not touch the
+ * parent's mtime. Edits to a file in place do not change the directory
+ * mtime either, so callers stat the known files of unchanged directories.
+ */
+class DirectoryWalker {
+public:
+    /**
+     * @param threads Walker threads; 0 picks a default suited to network storage
+     */
+    explicit DirectoryWalker(int threads = 0);
+    
+    /**
+     * Walk `root` (a directory, or a single audio file).
+     * @param previous Snapshot from the last walk of this root, or null to list everything
+     */
+    WalkResult walk(const std::string& root, bool recursive, const DirectorySnapshot* previous = nullptr) const;
+
+private:
+    int threads_;
+};
+
+} // namespace automix
+
+#endif // AUTOMIX_DIRECTORY_WALKER_H
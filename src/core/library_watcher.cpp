@@ -0,0 +1,267 @@
+/**
+ * AutoMix Engine - Library Folder Watcher Implementation
+ */
+
+#include "library_watcher.h"
+#include <atomic>
+#include <filesystem>
+#include <system_error>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace automix {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+bool is_under(const std::string& path, const std::string& dir) {
+    return path.size() > dir.size() && path.compare(0, dir.size(), dir) == 0 && path[dir.size()] == '/';
+}
+
+} // namespace
+
+#ifdef __linux__
+
+class LibraryWatcher::Impl {
+public:
+    Impl() {
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (fd < 0 || wake_fd < 0) {
+            error = "Failed to initialize inotify";
+        }
+    }
+    
+    ~Impl() {
+        if (fd >= 0) close(fd);
+        if (wake_fd >= 0) close(wake_fd);
+    }
+    
+    bool add_watch(const std::string& dir) {
+        static constexpr uint32_t kMask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                          IN_DELETE_SELF | IN_ONLYDIR | IN_EXCL_UNLINK;
+        int wd = inotify_add_watch(fd, dir.c_str(), kMask);
+        if (wd < 0) {
+            // Typically ENOSPC: fs.inotify.max_user_watches is too low for the library
+            error = "Failed to watch " + dir + ": " + std::generic_category().message(errno);
+            return false;
+        }
+        dirs[wd] = dir;
+        return true;
+    }
+    
+    bool add_tree(const std::string& root) {
+        bool ok = add_watch(root);
+        if (!recursive) return ok;
+        
+        std::error_code ec;
+        for (fs::recursive_directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec)) {
+            std::error_code type_ec;
+            if (it->is_directory(type_ec) && !it->is_symlink(type_ec)) {
+                ok = add_watch(it->path().string()) && ok;
+            }
+        }
+        return ok;
+    }
+    
+    void remove_tree(const std::string& root) {
+        for (auto it = dirs.begin(); it != dirs.end();) {
+            if (it->second == root || is_under(it->second, root)) {
+                inotify_rm_watch(fd, it->first);
+                it = dirs.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    
+    // Watches follow the directory inode; only our path names need updating
+    void rename_tree(const std::string& from, const std::string& to) {
+        for (auto& entry : dirs) {
+            if (entry.second == from) {
+                entry.second = to;
+            } else if (is_under(entry.second, from)) {
+                entry.second = to + entry.second.substr(from.size());
+            }
+        }
+    }
+    
+    void read_events(std::vector<WatchEvent>& events) {
+        // MOVED_FROM waiting for the MOVED_TO with the same cookie
+        struct PendingMove {
+            std::string path;
+            bool is_directory;
+        };
+        std::unordered_map<uint32_t, PendingMove> moves;
+        std::vector<uint32_t> move_order;
+        
+        alignas(struct inotify_event) char buffer[64 * 1024];
+        while (true) {
+            ssize_t length = read(fd, buffer, sizeof(buffer));
+            if (length <= 0) break;  // EAGAIN: drained
+            
+            for (char* ptr = buffer; ptr < buffer + length;) {
+                const auto* event = reinterpret_cast<const struct inotify_event*>(ptr);
+                ptr += sizeof(struct inotify_event) + event->len;
+                
+                if (event->mask & IN_Q_OVERFLOW) {
+                    WatchEvent overflow;
+                    overflow.type = WatchEvent::Type::Overflow;
+                    events.push_back(overflow);
+                    continue;
+                }
+                
+                auto dir = dirs.find(event->wd);
+                if (dir == dirs.end()) continue;
+                if (event->mask & (IN_DELETE_SELF | IN_IGNORED)) {
+                    if (event->mask & IN_IGNORED) dirs.erase(dir);
+                    continue;
+                }
+                if (event->len == 0) continue;
+                
+                WatchEvent change;
+                change.path = dir->second + "/" + event->name;
+                change.is_directory = (event->mask & IN_ISDIR) != 0;
+                
+                if (event->mask & IN_CREATE) {
+                    // Files are reported on IN_CLOSE_WRITE, once complete
+                    if (!change.is_directory || !recursive) continue;
+                    add_tree(change.path);
+                    events.push_back(change);
+                } else if (event->mask & IN_CLOSE_WRITE) {
+                    events.push_back(change);
+                } else if (event->mask & IN_DELETE) {
+                    change.type = WatchEvent::Type::Removed;
+                    events.push_back(change);
+                } else if (event->mask & IN_MOVED_FROM) {
+                    moves[event->cookie] = {change.path, change.is_directory};
+                    move_order.push_back(event->cookie);
+                } else if (event->mask & IN_MOVED_TO) {
+                    auto move = moves.find(event->cookie);
+                    if (move != moves.end()) {
+                        change.type = WatchEvent::Type::Moved;
+                        change.old_path = move->second.path;
+                        if (change.is_directory) rename_tree(change.old_path, change.path);
+                        moves.erase(move);
+                    } else if (change.is_directory && recursive) {
+                        add_tree(change.path);  // Moved in from outside
+                    }
+                    events.push_back(change);
+                }
+            }
+        }
+        
+        // A MOVED_FROM without its MOVED_TO left the watched tree
+        for (uint32_t cookie : move_order) {
+            auto move = moves.find(cookie);
+            if (move == moves.end()) continue;
+            
+            WatchEvent removed;
+            removed.type = WatchEvent::Type::Removed;
+            removed.path = move->second.path;
+            removed.is_directory = move->second.is_directory;
+            if (removed.is_directory) remove_tree(removed.path);
+            events.push_back(removed);
+        }
+    }
+    
+    int fd = -1;
+    int wake_fd = -1;
+    bool recursive = true;
+    std::atomic<bool> stopped{false};
+    std::unordered_map<int, std::string> dirs;  // Watch descriptor -> directory
+    std::string error;
+};
+
+LibraryWatcher::LibraryWatcher() : impl_(std::make_unique<Impl>()) {}
+LibraryWatcher::~LibraryWatcher() = default;
+
+bool LibraryWatcher::is_supported() {
+    return true;
+}
+
+bool LibraryWatcher::add_tree(const std::string& root, bool recursive) {
+    if (impl_->fd < 0) return false;
+    
+    impl_->recursive = recursive;
+    std::string path = root;
+    if (path.size() > 1 && path.back() == '/') path.pop_back();
+    return impl_->add_tree(path);
+}
+
+bool LibraryWatcher::wait(std::vector<WatchEvent>& events, int timeout_ms) {
+    if (impl_->stopped || impl_->fd < 0) return false;
+    
+    struct pollfd fds[2] = {{impl_->fd, POLLIN, 0}, {impl_->wake_fd, POLLIN, 0}};
+    int ready = poll(fds, 2, timeout_ms);
+    if (impl_->stopped) return false;
+    
+    if (ready > 0 && (fds[0].revents & POLLIN)) {
+        impl_->read_events(events);
+    }
+    return true;
+}
+
+void LibraryWatcher::stop() {
+    // Only an atomic store and write(2): async-signal-safe
+    impl_->stopped = true;
+    if (impl_->wake_fd >= 0) {
+        uint64_t one = 1;
+        ssize_t written = write(impl_->wake_fd, &one, sizeof(one));
+        (void)written;
+    }
+}
+
+size_t LibraryWatcher::watch_count() const {
+    return impl_->dirs.size();
+}
+
+const std::string& LibraryWatcher::error() const {
+    return impl_->error;
+}
+
+#else // !__linux__
+
+class LibraryWatcher::Impl {
+public:
+    std::atomic<bool> stopped{false};
+    std::string error = "Watching folders requires inotify (Linux)";
+};
+
+LibraryWatcher::LibraryWatcher() : impl_(std::make_unique<Impl>()) {}
+LibraryWatcher::~LibraryWatcher() = default;
+
+bool LibraryWatcher::is_supported() {
+    return false;
+}
+
+bool LibraryWatcher::add_tree(const std::string&, bool) {
+    return false;
+}
+
+bool LibraryWatcher::wait(std::vector<WatchEvent>&, int) {
+    return false;
+}
+
+void LibraryWatcher::stop() {
+    impl_->stopped = true;
+}
+
+size_t LibraryWatcher::watch_count() const {
+    return 0;
+}
+
+const std::string& LibraryWatcher::error() const {
+    return impl_->error;
+}
+
+#endif
+
+} // namespace automix
@@ -0,0 +1,77 @@
+/**
+ * AutoMix Engine - Library Folder Watcher
+ */
+
+#ifndef AUTOMIX_LIBRARY_WATCHER_H
+#define AUTOMIX_LIBRARY_WATCHER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace automix {
+
+/**
+ * A change below a watched library folder.
+ */
+struct WatchEvent {
+    enum class Type {
+        Changed,                        // File written or moved in; directory created or moved in
+        Removed,                        // Deleted or moved out of the watched tree
+        Moved,                          // Renamed within the watched tree (old_path -> path)
+        Overflow                        // Events were dropped; rescan to resynchronize
+    };
+    
+    Type type = Type::Changed;
+    std::string path;
+    std::string old_path;               // Moved only
+    bool is_directory = false;
+};
+
+/**
+ * Watches a directory tree for file changes (inotify on Linux). Files are
+ * reported once they are closed after writing, so partially copied files
+ * are not picked up. New subdirectories are watched as they appear.
+ *
+ * Not supported on other platforms: add_tree() fails there.
+ */
+class LibraryWatcher {
+public:
+    LibraryWatcher();
+    ~LibraryWatcher();
+    
+    // Non-copyable
+    LibraryWatcher(const LibraryWatcher&) = delete;
+    LibraryWatcher& operator=(const LibraryWatcher&) = delete;
+    
+    static bool is_supported();
+    
+    /**
+     * Watch `root` and, if recursive, every directory below it.
+     * @return false on error (see error())
+     */
+    bool add_tree(const std::string& root, bool recursive);
+    
+    /**
+     * Wait up to timeout_ms (-1 = forever) and append pending events.
+     * @return false once stop() has been called
+     */
+    bool wait(std::vector<WatchEvent>& events, int timeout_ms);
+    
+    /**
+     * Wake wait() and make it return false. Safe to call from another
+     * thread or a signal handler.
+     */
+    void stop();
+    
+    size_t watch_count() const;
+    const std::string& error() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace automix
+
+#endif // AUTOMIX_LIBRARY_WATCHER_H
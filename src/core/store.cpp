@@ -7,6 +7,16 @@
 #include <cstring>
 #include <filesystem>
 
+// RETURNING (SQLite 3.35+) hands back the row id of an upsert in the same
+// statement; older libraries fall back to an id lookup by path
+#if SQLITE_VERSION_NUMBER >= 3035000
+#define AUTOMIX_SQLITE_HAS_RETURNING 1
+#define UPSERT_RETURNING_ID " RETURNING id"
+#else
+#define AUTOMIX_SQLITE_HAS_RETURNING 0
+#define UPSERT_RETURNING_ID ""
+#endif
+
 namespace automix {
 
 Store::Store(const std::string& db_path) {
@@ -31,26 +41,85 @@ Store::Store(const std::string& db_path) {
 }
 
 Store::~Store() {
-    if (db_) {
-        sqlite3_close(db_);
-    }
+    close();
 }
 
 Store::Store(Store&& other) noexcept
-    : db_(other.db_), last_error_(std::move(other.last_error_)) {
+    : db_(other.db_), last_error_(std::move(other.last_error_))
+    , statements_(std::move(other.statements_)) {
     other.db_ = nullptr;
 }
 
 Store& Store::operator=(Store&& other) noexcept {
     if (this != &other) {
-        if (db_) sqlite3_close(db_);
+        close();
         db_ = other.db_;
         last_error_ = std::move(other.last_error_);
+        statements_ = std::move(other.statements_);
         other.db_ = nullptr;
     }
     return *this;
 }
 
+void Store::close() {
+    // Cached statements must be finalized before the connection can close
+    for (auto& entry : statements_) {
+        sqlite3_finalize(entry.second->stmt);
+    }
+    statements_.clear();
+    
+    if (db_) {
+        sqlite3_close(db_);
+        db_ = nullptr;
+    }
+}
+
+Store::Statement::Statement(CachedStatement* cached)
+    : cached_(cached) {
+    if (cached) {
+        lock_ = std::unique_lock<std::mutex>(cached->mutex);
+        cached->owner = std::this_thread::get_id();
+    }
+}
+
+Store::Statement::~Statement() {
+    if (cached_) {
+        // Ends the read or write and frees bound values for the next user
+        sqlite3_reset(cached_->stmt);
+        sqlite3_clear_bindings(cached_->stmt);
+        cached_->owner = std::thread::id();
+    }
+}
+
+Store::Statement Store::prepare(const char* sql) {
+    if (!db_) return Statement(nullptr);
+    
+    CachedStatement* cached = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(statements_mutex_);
+        auto it = statements_.find(sql);
+        if (it == statements_.end()) {
+            auto entry = std::make_unique<CachedStatement>();
+            entry->sql = sql;
+            if (sqlite3_prepare_v3(db_, sql, -1, SQLITE_PREPARE_PERSISTENT, &entry->stmt, nullptr) != SQLITE_OK) {
+                sqlite3_finalize(entry->stmt);
+                return Statement(nullptr);
+            }
+            std::string_view key = entry->sql;
+            it = statements_.emplace(key, std::move(entry)).first;
+        }
+        cached = it->second.get();
+    }
+    
+    // Re-entrant use would wait on our own lease forever
+    if (cached->owner == std::this_thread::get_id()) {
+        return Statement(nullptr);
+    }
+    
+    // Waits if another thread is using the same statement
+    return Statement(cached);
+}
+
 void Store::init_schema() {
     const char* schema = R"(
         CREATE TABLE IF NOT EXISTS tracks (
@@ -64,7 +133,9 @@ void Store::init_schema() {
             energy_curve BLOB,
             duration REAL DEFAULT 0,
             analyzed_at INTEGER DEFAULT 0,
-            file_modified_at INTEGER DEFAULT 0
+            file_modified_at INTEGER DEFAULT 0,
+            confidence REAL DEFAULT 1,
+            content_hash INTEGER DEFAULT 0
         );
         
         CREATE INDEX IF NOT EXISTS idx_tracks_path ON tracks(path);
@@ -81,6 +152,12 @@ void Store::init_schema() {
             source TEXT,
             fetched_at INTEGER DEFAULT 0
         );
+        
+        CREATE TABLE IF NOT EXISTS directories (
+            path TEXT PRIMARY KEY,
+            parent TEXT NOT NULL,
+            mtime INTEGER DEFAULT 0
+        );
     )";
     
     char* err_msg = nullptr;
@@ -88,7 +165,15 @@ void Store::init_schema() {
     if (rc != SQLITE_OK) {
         last_error_ = err_msg ? err_msg : "Failed to create schema";
         sqlite3_free(err_msg);
+        return;
     }
+    
+    // Databases created before excerpt analysis / content hashes lack these
+    // columns; the error for an existing column is expected and ignored
+    sqlite3_exec(db_, "ALTER TABLE tracks ADD COLUMN confidence REAL DEFAULT 1;", nullptr, nullptr, nullptr);
+    sqlite3_exec(db_, "ALTER TABLE tracks ADD COLUMN content_hash INTEGER DEFAULT 0;", nullptr, nullptr, nullptr);
+    sqlite3_exec(db_, "CREATE INDEX IF NOT EXISTS idx_tracks_content_hash ON tracks(content_hash);",
+                 nullptr, nullptr, nullptr);
 }
 
 std::vector<uint8_t> Store::serialize_floats(const std::vector<float>& data) {
@@ -110,8 +195,8 @@ Result<int64_t> Store::upsert_track(const TrackInfo& track) {
     if (!db_) return "Database not open";
     
     const char* sql = R"(
-        INSERT INTO tracks (path, bpm, beats, key, mfcc, chroma, energy_curve, duration, analyzed_at, file_modified_at)
-        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+        INSERT INTO tracks (path, bpm, beats, key, mfcc, chroma, energy_curve, duration, analyzed_at, file_modified_at, confidence, content_hash)
+        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
         ON CONFLICT(path) DO UPDATE SET
             bpm = excluded.bpm,
             beats = excluded.beats,
@@ -121,12 +206,13 @@ Result<int64_t> Store::upsert_track(const TrackInfo& track) {
             energy_curve = excluded.energy_curve,
             duration = excluded.duration,
             analyzed_at = excluded.analyzed_at,
-            file_modified_at = excluded.file_modified_at
-    )";
+            file_modified_at = excluded.file_modified_at,
+            confidence = excluded.confidence,
+            content_hash = excluded.content_hash
+    )" UPSERT_RETURNING_ID;
     
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    auto stmt = prepare(sql);
+    if (!stmt) {
         return std::string("Prepare failed: ") + sqlite3_errmsg(db_);
     }
     
@@ -139,24 +225,17 @@ Result<int64_t> Store::upsert_track(const TrackInfo& track) {
     sqlite3_bind_text(stmt, 1, track.path.c_str(), -1, SQLITE_TRANSIENT);
     sqlite3_bind_double(stmt, 2, track.bpm);
     sqlite3_bind_blob(stmt, 3, beats_data.data(), beats_data.size(), SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 4, track.key.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 4, utils::key_to_camelot(track.key).c_str(), -1, SQLITE_TRANSIENT);
     sqlite3_bind_blob(stmt, 5, mfcc_data.data(), mfcc_data.size(), SQLITE_TRANSIENT);
     sqlite3_bind_blob(stmt, 6, chroma_data.data(), chroma_data.size(), SQLITE_TRANSIENT);
     sqlite3_bind_blob(stmt, 7, energy_data.data(), energy_data.size(), SQLITE_TRANSIENT);
     sqlite3_bind_double(stmt, 8, track.duration);
     sqlite3_bind_int64(stmt, 9, track.analyzed_at);
     sqlite3_bind_int64(stmt, 10, track.file_modified_at);
+    sqlite3_bind_double(stmt, 11, track.confidence);
+    sqlite3_bind_int64(stmt, 12, static_cast<int64_t>(track.content_hash));
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
-    
-    if (rc != SQLITE_DONE) {
-        return std::string("Insert failed: ") + sqlite3_errmsg(db_);
-    }
-    
-    // Get the ID (either new or existing)
-    auto existing = get_track_by_path(track.path);
-    return existing ? existing->id : sqlite3_last_insert_rowid(db_);
+    return step_upsert(stmt, track.path);
 }
 
 Result<int64_t> Store::upsert_track_path_duration(const std::string& path, float duration, int64_t file_modified_at) {
@@ -171,11 +250,10 @@ Result<int64_t> Store::upsert_track_path_duration(const std::string& path, float
         ON CONFLICT(path) DO UPDATE SET
             duration = excluded.duration,
             file_modified_at = excluded.file_modified_at
-    )";
+    )" UPSERT_RETURNING_ID;
     
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    auto stmt = prepare(sql);
+    if (!stmt) {
         return std::string("Prepare failed: ") + sqlite3_errmsg(db_);
     }
     
@@ -193,24 +271,89 @@ Result<int64_t> Store::upsert_track_path_duration(const std::string& path, float
     sqlite3_bind_int64 (stmt, 9, 0);                                   // analyzed_at = 0
     sqlite3_bind_int64 (stmt, 10, file_modified_at);                   // file_modified_at
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    return step_upsert(stmt, path);
+}
+
+Result<int64_t> Store::step_upsert(sqlite3_stmt* stmt, const std::string& path) {
+    int rc = sqlite3_step(stmt);
+
+#if AUTOMIX_SQLITE_HAS_RETURNING
+    (void)path;
+    
+    // The id of the inserted or updated row, without reading it back
+    int64_t id = rc == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : 0;
+    if (rc == SQLITE_ROW) {
+        rc = sqlite3_step(stmt);
+    }
     
+    if (rc != SQLITE_DONE || id == 0) {
+        return std::string("Insert failed: ") + sqlite3_errmsg(db_);
+    }
+    return id;
+#else
     if (rc != SQLITE_DONE) {
         return std::string("Insert failed: ") + sqlite3_errmsg(db_);
     }
     
-    auto existing = get_track_by_path(path);
-    return existing ? existing->id : sqlite3_last_insert_rowid(db_);
+    // last_insert_rowid is stale when the upsert took the UPDATE branch, so
+    // look the id up (without loading the feature blobs)
+    return find_track_id(path);
+#endif
+}
+
+Result<int64_t> Store::find_track_id(const std::string& path) {
+    auto stmt = prepare("SELECT id FROM tracks WHERE path = ?");
+    if (!stmt) {
+        return std::string("Prepare failed: ") + sqlite3_errmsg(db_);
+    }
+    
+    sqlite3_bind_text(stmt, 1, path.c_str(), -1, SQLITE_TRANSIENT);
+    
+    int64_t id = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        id = sqlite3_column_int64(stmt, 0);
+    }
+    
+    if (id == 0) return "Track not found: " + path;
+    return id;
+}
+
+bool Store::begin_transaction() {
+    if (!db_) return false;
+    
+    char* err_msg = nullptr;
+    if (sqlite3_exec(db_, "BEGIN IMMEDIATE;", nullptr, nullptr, &err_msg) != SQLITE_OK) {
+        last_error_ = err_msg ? err_msg : "Failed to begin transaction";
+        sqlite3_free(err_msg);
+        return false;
+    }
+    return true;
+}
+
+bool Store::commit_transaction() {
+    if (!db_) return false;
+    
+    char* err_msg = nullptr;
+    if (sqlite3_exec(db_, "COMMIT;", nullptr, nullptr, &err_msg) != SQLITE_OK) {
+        last_error_ = err_msg ? err_msg : "Failed to commit transaction";
+        sqlite3_free(err_msg);
+        return false;
+    }
+    return true;
+}
+
+void Store::rollback_transaction() {
+    if (db_) {
+        sqlite3_exec(db_, "ROLLBACK;", nullptr, nullptr, nullptr);
+    }
 }
 
 std::optional<TrackInfo> Store::get_track(int64_t id) {
     if (!db_) return std::nullopt;
     
     const char* sql = "SELECT * FROM tracks WHERE id = ?";
-    sqlite3_stmt* stmt;
-    
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    auto stmt = prepare(sql);
+    if (!stmt) {
         return std::nullopt;
     }
     
@@ -225,7 +368,7 @@ std::optional<TrackInfo> Store::get_track(int64_t id) {
         track.beats = deserialize_floats(sqlite3_column_blob(stmt, 3), sqlite3_column_bytes(stmt, 3));
         
         const char* key_text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
-        track.key = key_text ? key_text : "";
+        track.key = utils::key_from_camelot(key_text ? key_text : "");
         
         track.mfcc = deserialize_floats(sqlite3_column_blob(stmt, 5), sqlite3_column_bytes(stmt, 5));
         track.chroma = deserialize_floats(sqlite3_column_blob(stmt, 6), sqlite3_column_bytes(stmt, 6));
@@ -233,11 +376,12 @@ std::optional<TrackInfo> Store::get_track(int64_t id) {
         track.duration = static_cast<float>(sqlite3_column_double(stmt, 8));
         track.analyzed_at = sqlite3_column_int64(stmt, 9);
         track.file_modified_at = sqlite3_column_int64(stmt, 10);
+        track.confidence = static_cast<float>(sqlite3_column_double(stmt, 11));
+        track.content_hash = static_cast<uint64_t>(sqlite3_column_int64(stmt, 12));
         
         result = track;
     }
     
-    sqlite3_finalize(stmt);
     return result;
 }
 
@@ -245,9 +389,8 @@ std::optional<TrackInfo> Store::get_track_by_path(const std::string& path) {
     if (!db_) return std::nullopt;
     
     const char* sql = "SELECT * FROM tracks WHERE path = ?";
-    sqlite3_stmt* stmt;
-    
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    auto stmt = prepare(sql);
+    if (!stmt) {
         return std::nullopt;
     }
     
@@ -262,7 +405,7 @@ std::optional<TrackInfo> Store::get_track_by_path(const std::string& path) {
         track.beats = deserialize_floats(sqlite3_column_blob(stmt, 3), sqlite3_column_bytes(stmt, 3));
         
         const char* key_text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
-        track.key = key_text ? key_text : "";
+        track.key = utils::key_from_camelot(key_text ? key_text : "");
         
         track.mfcc = deserialize_floats(sqlite3_column_blob(stmt, 5), sqlite3_column_bytes(stmt, 5));
         track.chroma = deserialize_floats(sqlite3_column_blob(stmt, 6), sqlite3_column_bytes(stmt, 6));
@@ -270,11 +413,12 @@ std::optional<TrackInfo> Store::get_track_by_path(const std::string& path) {
         track.duration = static_cast<float>(sqlite3_column_double(stmt, 8));
         track.analyzed_at = sqlite3_column_int64(stmt, 9);
         track.file_modified_at = sqlite3_column_int64(stmt, 10);
+        track.confidence = static_cast<float>(sqlite3_column_double(stmt, 11));
+        track.content_hash = static_cast<uint64_t>(sqlite3_column_int64(stmt, 12));
         
         result = track;
     }
     
-    sqlite3_finalize(stmt);
     return result;
 }
 
@@ -283,9 +427,8 @@ std::vector<TrackInfo> Store::get_all_tracks() {
     if (!db_) return tracks;
     
     const char* sql = "SELECT * FROM tracks ORDER BY id";
-    sqlite3_stmt* stmt;
-    
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    auto stmt = prepare(sql);
+    if (!stmt) {
         return tracks;
     }
     
@@ -297,7 +440,7 @@ std::vector<TrackInfo> Store::get_all_tracks() {
         track.beats = deserialize_floats(sqlite3_column_blob(stmt, 3), sqlite3_column_bytes(stmt, 3));
         
         const char* key_text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
-        track.key = key_text ? key_text : "";
+        track.key = utils::key_from_camelot(key_text ? key_text : "");
         
         track.mfcc = deserialize_floats(sqlite3_column_blob(stmt, 5), sqlite3_column_bytes(stmt, 5));
         track.chroma = deserialize_floats(sqlite3_column_blob(stmt, 6), sqlite3_column_bytes(stmt, 6));
@@ -305,11 +448,12 @@ std::vector<TrackInfo> Store::get_all_tracks() {
         track.duration = static_cast<float>(sqlite3_column_double(stmt, 8));
         track.analyzed_at = sqlite3_column_int64(stmt, 9);
         track.file_modified_at = sqlite3_column_int64(stmt, 10);
+        track.confidence = static_cast<float>(sqlite3_column_double(stmt, 11));
+        track.content_hash = static_cast<uint64_t>(sqlite3_column_int64(stmt, 12));
         
         tracks.push_back(track);
     }
     
-    sqlite3_finalize(stmt);
     return tracks;
 }
 
@@ -318,9 +462,8 @@ std::vector<TrackInfo> Store::search_tracks(const std::string& pattern) {
     if (!db_) return tracks;
     
     const char* sql = "SELECT * FROM tracks WHERE path LIKE ? ORDER BY id";
-    sqlite3_stmt* stmt;
-    
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    auto stmt = prepare(sql);
+    if (!stmt) {
         return tracks;
     }
     
@@ -334,7 +477,7 @@ std::vector<TrackInfo> Store::search_tracks(const std::string& pattern) {
         track.beats = deserialize_floats(sqlite3_column_blob(stmt, 3), sqlite3_column_bytes(stmt, 3));
         
         const char* key_text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
-        track.key = key_text ? key_text : "";
+        track.key = utils::key_from_camelot(key_text ? key_text : "");
         
         track.mfcc = deserialize_floats(sqlite3_column_blob(stmt, 5), sqlite3_column_bytes(stmt, 5));
         track.chroma = deserialize_floats(sqlite3_column_blob(stmt, 6), sqlite3_column_bytes(stmt, 6));
@@ -342,21 +485,61 @@ std::vector<TrackInfo> Store::search_tracks(const std::string& pattern) {
         track.duration = static_cast<float>(sqlite3_column_double(stmt, 8));
         track.analyzed_at = sqlite3_column_int64(stmt, 9);
         track.file_modified_at = sqlite3_column_int64(stmt, 10);
+        track.confidence = static_cast<float>(sqlite3_column_double(stmt, 11));
+        track.content_hash = static_cast<uint64_t>(sqlite3_column_int64(stmt, 12));
         
         tracks.push_back(track);
     }
     
-    sqlite3_finalize(stmt);
     return tracks;
 }
 
+void Store::for_each_track_features(const std::function<void(const TrackInfo&)>& visit) {
+    if (!db_) return;
+    
+    const char* sql = "SELECT id, bpm, key, mfcc, chroma, energy_curve, duration FROM tracks ORDER BY id";
+    auto stmt = prepare(sql);
+    if (!stmt) {
+        return;
+    }
+    
+    TrackInfo track;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        track.id = sqlite3_column_int64(stmt, 0);
+        track.bpm = static_cast<float>(sqlite3_column_double(stmt, 1));
+        
+        const char* key_text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+        track.key = utils::key_from_camelot(key_text ? key_text : "");
+        
+        track.mfcc = deserialize_floats(sqlite3_column_blob(stmt, 3), sqlite3_column_bytes(stmt, 3));
+        track.chroma = deserialize_floats(sqlite3_column_blob(stmt, 4), sqlite3_column_bytes(stmt, 4));
+        track.energy_curve = deserialize_floats(sqlite3_column_blob(stmt, 5), sqlite3_column_bytes(stmt, 5));
+        track.duration = static_cast<float>(sqlite3_column_double(stmt, 6));
+        
+        visit(track);
+    }
+}
+
+int64_t Store::data_version() {
+    if (!db_) return 0;
+    
+    // data_version only moves for commits by other connections; add this
+    // connection's own changes
+    int64_t version = 0;
+    const char* sql = "PRAGMA data_version";
+    auto stmt = prepare(sql);
+    if (stmt && sqlite3_step(stmt) == SQLITE_ROW) {
+        version = sqlite3_column_int64(stmt, 0);
+    }
+    return version + sqlite3_total_changes(db_);
+}
+
 int Store::get_track_count() {
     if (!db_) return 0;
     
     const char* sql = "SELECT COUNT(*) FROM tracks";
-    sqlite3_stmt* stmt;
-    
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    auto stmt = prepare(sql);
+    if (!stmt) {
         return 0;
     }
     
@@ -365,7 +548,6 @@ int Store::get_track_count() {
         count = sqlite3_column_int(stmt, 0);
     }
     
-    sqlite3_finalize(stmt);
     return count;
 }
 
@@ -373,15 +555,13 @@ bool Store::delete_track(int64_t id) {
     if (!db_) return false;
     
     const char* sql = "DELETE FROM tracks WHERE id = ?";
-    sqlite3_stmt* stmt;
-    
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    auto stmt = prepare(sql);
+    if (!stmt) {
         return false;
     }
     
     sqlite3_bind_int64(stmt, 1, id);
     int rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
     
     return rc == SQLITE_DONE;
 }
@@ -390,26 +570,184 @@ bool Store::delete_track_by_path(const std::string& path) {
     if (!db_) return false;
     
     const char* sql = "DELETE FROM tracks WHERE path = ?";
-    sqlite3_stmt* stmt;
-    
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    auto stmt = prepare(sql);
+    if (!stmt) {
         return false;
     }
     
     sqlite3_bind_text(stmt, 1, path.c_str(), -1, SQLITE_TRANSIENT);
     int rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
     
-    return rc == SQLITE_DONE;
+    return rc == SQLITE_DONE && sqlite3_changes(db_) > 0;
 }
 
-bool Store::needs_analysis(const std::string& path, int64_t file_modified_at) {
-    auto track = get_track_by_path(path);
-    if (!track) return true;  // Not in database
+int Store::delete_tracks_under(const std::string& dir) {
+    if (!db_) return 0;
     
-    if (track->analyzed_at == 0) return true;  // Added via metadata-only scan; full analysis pending
+    const char* sql = "DELETE FROM tracks WHERE substr(path, 1, length(?1)) = ?1";
+    auto stmt = prepare(sql);
+    if (!stmt) {
+        return 0;
+    }
+    
+    std::string prefix = (std::filesystem::path(dir) / "").string();
+    sqlite3_bind_text(stmt, 1, prefix.c_str(), -1, SQLITE_TRANSIENT);
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        return 0;
+    }
+    return sqlite3_changes(db_);
+}
+
+bool Store::rename_track(const std::string& old_path, const std::string& new_path) {
+    if (!db_) return false;
+    
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    bool in_transaction = begin_transaction();
+    
+    bool renamed = false;
+    if (find_track_id(old_path).ok()) {
+        delete_track_by_path(new_path);
+        
+        const char* sql = "UPDATE tracks SET path = ? WHERE path = ?";
+        auto stmt = prepare(sql);
+        if (stmt) {
+            sqlite3_bind_text(stmt, 1, new_path.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 2, old_path.c_str(), -1, SQLITE_TRANSIENT);
+            renamed = sqlite3_step(stmt) == SQLITE_DONE && sqlite3_changes(db_) == 1;
+        }
+    }
+    
+    if (in_transaction) {
+        if (renamed) {
+            commit_transaction();
+        } else {
+            rollback_transaction();
+        }
+    }
+    return renamed;
+}
+
+int Store::rename_directory(const std::string& old_dir, const std::string& new_dir) {
+    if (!db_) return 0;
+    
+    const char* sql = "UPDATE tracks SET path = ?2 || substr(path, length(?1) + 1) WHERE substr(path, 1, length(?1)) = ?1";
+    auto stmt = prepare(sql);
+    if (!stmt) {
+        return 0;
+    }
+    
+    std::string old_prefix = (std::filesystem::path(old_dir) / "").string();
+    std::string new_prefix = (std::filesystem::path(new_dir) / "").string();
+    sqlite3_bind_text(stmt, 1, old_prefix.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, new_prefix.c_str(), -1, SQLITE_TRANSIENT);
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        last_error_ = std::string("Rename failed: ") + sqlite3_errmsg(db_);
+        return 0;
+    }
+    return sqlite3_changes(db_);
+}
+
+bool Store::touch_track(const std::string& path, int64_t file_modified_at) {
+    if (!db_) return false;
+    
+    const char* sql = "UPDATE tracks SET file_modified_at = ? WHERE path = ?";
+    auto stmt = prepare(sql);
+    if (!stmt) {
+        return false;
+    }
     
-    return track->file_modified_at < file_modified_at;
+    sqlite3_bind_int64(stmt, 1, file_modified_at);
+    sqlite3_bind_text(stmt, 2, path.c_str(), -1, SQLITE_TRANSIENT);
+    return sqlite3_step(stmt) == SQLITE_DONE && sqlite3_changes(db_) > 0;
+}
+
+Result<int64_t> Store::copy_track_analysis(const std::string& from_path, const std::string& to_path,
+                                           int64_t file_modified_at) {
+    if (!db_) return "Database not open";
+    
+    // The WHERE clause also keeps SQLite from parsing ON CONFLICT as a join
+    const char* sql = R"(
+        INSERT INTO tracks (path, bpm, beats, key, mfcc, chroma, energy_curve, duration, analyzed_at, file_modified_at, confidence, content_hash)
+        SELECT ?1, bpm, beats, key, mfcc, chroma, energy_curve, duration, analyzed_at, ?2, confidence, content_hash
+        FROM tracks WHERE path = ?3
+        ON CONFLICT(path) DO UPDATE SET
+            bpm = excluded.bpm,
+            beats = excluded.beats,
+            key = excluded.key,
+            mfcc = excluded.mfcc,
+            chroma = excluded.chroma,
+            energy_curve = excluded.energy_curve,
+            duration = excluded.duration,
+            analyzed_at = excluded.analyzed_at,
+            file_modified_at = excluded.file_modified_at,
+            confidence = excluded.confidence,
+            content_hash = excluded.content_hash
+    )";
+    
+    auto stmt = prepare(sql);
+    if (!stmt) {
+        return std::string("Prepare failed: ") + sqlite3_errmsg(db_);
+    }
+    
+    sqlite3_bind_text(stmt, 1, to_path.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 2, file_modified_at);
+    sqlite3_bind_text(stmt, 3, from_path.c_str(), -1, SQLITE_TRANSIENT);
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        return std::string("Copy failed: ") + sqlite3_errmsg(db_);
+    }
+    if (sqlite3_changes(db_) == 0) {
+        return "Track not found: " + from_path;
+    }
+    return find_track_id(to_path);
+}
+
+bool Store::needs_analysis(const std::string& path, int64_t file_modified_at, float min_confidence) {
+    // Only the columns the decision needs; the feature blobs stay on disk
+    auto stmt = prepare("SELECT analyzed_at, confidence, file_modified_at FROM tracks WHERE path = ?");
+    if (!stmt) return true;
+    
+    sqlite3_bind_text(stmt, 1, path.c_str(), -1, SQLITE_TRANSIENT);
+    if (sqlite3_step(stmt) != SQLITE_ROW) return true;  // Not in database
+    
+    TrackScanState state;
+    state.analyzed_at = sqlite3_column_int64(stmt, 0);
+    state.confidence = static_cast<float>(sqlite3_column_double(stmt, 1));
+    state.file_modified_at = sqlite3_column_int64(stmt, 2);
+    return needs_analysis(state, file_modified_at, min_confidence);
+}
+
+bool Store::needs_analysis(const TrackScanState& state, int64_t file_modified_at, float min_confidence) {
+    if (state.analyzed_at == 0) return true;  // Added via metadata-only scan; full analysis pending
+    
+    if (state.confidence < min_confidence) return true;  // Low-confidence excerpt analysis
+    
+    return state.file_modified_at < file_modified_at;
+}
+
+TrackScanSnapshot Store::get_scan_snapshot() {
+    TrackScanSnapshot snapshot;
+    if (!db_) return snapshot;
+    
+    const char* sql = "SELECT path, id, file_modified_at, analyzed_at, confidence, content_hash FROM tracks";
+    auto stmt = prepare(sql);
+    if (!stmt) {
+        return snapshot;
+    }
+    
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* path = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        if (!path) continue;
+        
+        TrackScanState state;
+        state.id = sqlite3_column_int64(stmt, 1);
+        state.file_modified_at = sqlite3_column_int64(stmt, 2);
+        state.analyzed_at = sqlite3_column_int64(stmt, 3);
+        state.confidence = static_cast<float>(sqlite3_column_double(stmt, 4));
+        state.content_hash = static_cast<uint64_t>(sqlite3_column_int64(stmt, 5));
+        snapshot.emplace(path, state);
+    }
+    
+    return snapshot;
 }
 
 std::vector<std::string> Store::get_all_paths() {
@@ -417,9 +755,8 @@ std::vector<std::string> Store::get_all_paths() {
     if (!db_) return paths;
     
     const char* sql = "SELECT path FROM tracks";
-    sqlite3_stmt* stmt;
-    
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    auto stmt = prepare(sql);
+    if (!stmt) {
         return paths;
     }
     
@@ -428,7 +765,6 @@ std::vector<std::string> Store::get_all_paths() {
         if (path) paths.push_back(path);
     }
     
-    sqlite3_finalize(stmt);
     return paths;
 }
 
@@ -447,6 +783,98 @@ int Store::cleanup_missing_files() {
     return removed;
 }
 
+int Store::cleanup_missing_files(const TrackScanSnapshot& candidates) {
+    std::vector<int64_t> missing;
+    for (const auto& [path, state] : candidates) {
+        if (!std::filesystem::exists(path)) {
+            missing.push_back(state.id);
+        }
+    }
+    if (missing.empty()) return 0;
+    
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    bool in_transaction = begin_transaction();
+    
+    int removed = 0;
+    for (int64_t id : missing) {
+        if (delete_track(id)) {
+            removed++;
+        }
+    }
+    
+    if (in_transaction) {
+        commit_transaction();
+    }
+    return removed;
+}
+
+DirectorySnapshot Store::get_directory_states(const std::string& root) {
+    DirectorySnapshot states;
+    if (!db_) return states;
+    
+    // The root itself and everything below it (prefix compare; LIKE would
+    // treat % and _ in paths as wildcards)
+    const char* sql = "SELECT path, parent, mtime FROM directories WHERE path = ?1 OR substr(path, 1, length(?2)) = ?2";
+    auto stmt = prepare(sql);
+    if (!stmt) {
+        return states;
+    }
+    
+    std::string prefix = (std::filesystem::path(root) / "").string();
+    sqlite3_bind_text(stmt, 1, root.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, prefix.c_str(), -1, SQLITE_TRANSIENT);
+    
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* path = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        const char* parent = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+        if (!path) continue;
+        
+        DirectoryState state;
+        state.parent = parent ? parent : "";
+        state.mtime = sqlite3_column_int64(stmt, 2);
+        states.emplace(path, std::move(state));
+    }
+    
+    return states;
+}
+
+bool Store::save_directory_states(const std::string& root, const DirectorySnapshot& states) {
+    if (!db_) return false;
+    
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    if (!begin_transaction()) return false;
+    
+    bool ok = true;
+    {
+        auto stmt = prepare("DELETE FROM directories WHERE path = ?1 OR substr(path, 1, length(?2)) = ?2");
+        std::string prefix = (std::filesystem::path(root) / "").string();
+        ok = stmt != nullptr;
+        if (ok) {
+            sqlite3_bind_text(stmt, 1, root.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 2, prefix.c_str(), -1, SQLITE_TRANSIENT);
+            ok = sqlite3_step(stmt) == SQLITE_DONE;
+        }
+    }
+    
+    for (auto it = states.begin(); ok && it != states.end(); ++it) {
+        auto stmt = prepare("INSERT OR REPLACE INTO directories (path, parent, mtime) VALUES (?, ?, ?)");
+        ok = stmt != nullptr;
+        if (ok) {
+            sqlite3_bind_text(stmt, 1, it->first.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 2, it->second.parent.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_int64(stmt, 3, it->second.mtime);
+            ok = sqlite3_step(stmt) == SQLITE_DONE;
+        }
+    }
+    
+    if (!ok) {
+        last_error_ = std::string("Saving directory states failed: ") + sqlite3_errmsg(db_);
+        rollback_transaction();
+        return false;
+    }
+    return commit_transaction();
+}
+
 bool Store::upsert_track_metadata(const TrackMetadata& metadata) {
     if (!db_) return false;
     
@@ -463,8 +891,8 @@ bool Store::upsert_track_metadata(const TrackMetadata& metadata) {
             fetched_at = excluded.fetched_at
     )";
     
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    auto stmt = prepare(sql);
+    if (!stmt) {
         last_error_ = std::string("Prepare failed: ") + sqlite3_errmsg(db_);
         return false;
     }
@@ -485,7 +913,6 @@ bool Store::upsert_track_metadata(const TrackMetadata& metadata) {
     sqlite3_bind_int64(stmt, 8, metadata.fetched_at);
     
     int rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
     
     if (rc != SQLITE_DONE) {
         last_error_ = std::string("Insert metadata failed: ") + sqlite3_errmsg(db_);
@@ -498,9 +925,8 @@ std::optional<TrackMetadata> Store::get_track_metadata(int64_t track_id) {
     if (!db_) return std::nullopt;
     
     const char* sql = "SELECT title, artist, album, artwork_url, artwork_data, source, fetched_at FROM track_metadata WHERE track_id = ?";
-    sqlite3_stmt* stmt;
-    
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    auto stmt = prepare(sql);
+    if (!stmt) {
         return std::nullopt;
     }
     
@@ -537,7 +963,6 @@ std::optional<TrackMetadata> Store::get_track_metadata(int64_t track_id) {
         result = md;
     }
     
-    sqlite3_finalize(stmt);
     return result;
 }
 
@@ -6,15 +6,34 @@
 #define AUTOMIX_STORE_H
 
 #include "automix/types.h"
+#include "directory_walker.h"
 #include <sqlite3.h>
 #include <string>
 #include <vector>
 #include <optional>
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 
 namespace automix {
 
+/**
+ * The columns an incremental scan compares, without the feature blobs.
+ */
+struct TrackScanState {
+    int64_t id = 0;
+    int64_t file_modified_at = 0;
+    int64_t analyzed_at = 0;
+    float confidence = 1.0f;
+    uint64_t content_hash = 0;
+};
+
+using TrackScanSnapshot = std::unordered_map<std::string, TrackScanState>;
+
 /**
  * SQLite-based storage for track features and metadata.
  */
@@ -66,6 +85,19 @@ public:
      */
     std::vector<TrackInfo> get_all_tracks();
     
+    /**
+     * Visit the similarity features of every track in id order: id, bpm,
+     * key, mfcc, chroma, energy curve and duration (no path or beats).
+     * The TrackInfo passed is reused between calls.
+     */
+    void for_each_track_features(const std::function<void(const TrackInfo&)>& visit);
+    
+    /**
+     * Changes whenever the database was written, through this connection
+     * or another one; lets callers cache derived data.
+     */
+    int64_t data_version();
+    
     /**
      * Search tracks by path pattern (SQL LIKE).
      */
@@ -83,9 +115,40 @@ public:
     
     /**
      * Delete a track by path.
+     * @return false if no track had this path
      */
     bool delete_track_by_path(const std::string& path);
     
+    /**
+     * Delete every track below a directory.
+     * @return Number of tracks removed
+     */
+    int delete_tracks_under(const std::string& dir);
+    
+    /**
+     * Change a track's path, keeping its id and analysis. A track already
+     * stored at new_path (the file was replaced) is removed first.
+     * @return false if no track had old_path
+     */
+    bool rename_track(const std::string& old_path, const std::string& new_path);
+    
+    /**
+     * Change the directory part of every track below old_dir.
+     * @return Number of tracks moved
+     */
+    int rename_directory(const std::string& old_dir, const std::string& new_dir);
+    
+    /**
+     * Record a new modification time for a file whose content is unchanged.
+     */
+    bool touch_track(const std::string& path, int64_t file_modified_at);
+    
+    /**
+     * Store the analysis of the track at from_path for a file with the same
+     * content at to_path (inserted, or replacing that row's analysis).
+     */
+    Result<int64_t> copy_track_analysis(const std::string& from_path, const std::string& to_path, int64_t file_modified_at);
+    
     /* ========================================================================
      * Track Metadata Operations
      * ======================================================================== */
@@ -106,8 +169,21 @@ public:
     
     /**
      * Check if a track needs re-analysis based on file modification time.
+     * Tracks whose stored confidence is below min_confidence (fast excerpt
+     * analysis that did not agree well) also need it.
      */
-    bool needs_analysis(const std::string& path, int64_t file_modified_at);
+    bool needs_analysis(const std::string& path, int64_t file_modified_at, float min_confidence = 0.0f);
+    
+    /**
+     * The same decision for a row from get_scan_snapshot().
+     */
+    static bool needs_analysis(const TrackScanState& state, int64_t file_modified_at, float min_confidence = 0.0f);
+    
+    /**
+     * Scan state of every track keyed by path, loaded in one query, so a
+     * scan can diff a directory walk against the library in memory.
+     */
+    TrackScanSnapshot get_scan_snapshot();
     
     /**
      * Get paths of all tracks in the database.
@@ -119,15 +195,88 @@ public:
      */
     int cleanup_missing_files();
     
+    /**
+     * Remove those of the given tracks whose files no longer exist, in one
+     * transaction. Scans pass the snapshot entries their walk did not see.
+     */
+    int cleanup_missing_files(const TrackScanSnapshot& candidates);
+    
+    /**
+     * Directory states saved by the last walk of `root` (root included).
+     */
+    DirectorySnapshot get_directory_states(const std::string& root);
+    
+    /**
+     * Replace the saved directory states under `root` with `states`.
+     */
+    bool save_directory_states(const std::string& root, const DirectorySnapshot& states);
+    
+    /* ========================================================================
+     * Transactions
+     * ======================================================================== */
+    
+    /**
+     * Group subsequent writes into one transaction (one commit / WAL sync).
+     * Callers hold write_mutex() from begin to commit or rollback.
+     */
+    bool begin_transaction();
+    bool commit_transaction();
+    void rollback_transaction();
+    
     /**
      * Get the mutex for thread-safe write operations.
-     * Used by Engine for multi-threaded scanning.
+     * Used by StoreWriter and Engine for multi-threaded scanning.
      */
     std::mutex& write_mutex() { return write_mutex_; }
     
 private:
+    /**
+     * A cached prepared statement, locked for one caller at a time.
+     */
+    struct CachedStatement {
+        std::string sql;                            // Backs the cache key
+        sqlite3_stmt* stmt = nullptr;
+        std::mutex mutex;
+        std::atomic<std::thread::id> owner{};       // Thread holding the lease, if any
+    };
+    
+    /**
+     * Exclusive use of a cached statement; resets it and clears its
+     * bindings when it goes out of scope. Converts to the raw statement
+     * (null if preparing failed).
+     */
+    class Statement {
+    public:
+        explicit Statement(CachedStatement* cached);
+        ~Statement();
+        Statement(Statement&& other) noexcept
+            : cached_(other.cached_), lock_(std::move(other.lock_)) { other.cached_ = nullptr; }
+        Statement(const Statement&) = delete;
+        Statement& operator=(const Statement&) = delete;
+        Statement& operator=(Statement&&) = delete;
+        
+        operator sqlite3_stmt*() const { return cached_ ? cached_->stmt : nullptr; }
+    
+    private:
+        CachedStatement* cached_;
+        std::unique_lock<std::mutex> lock_;
+    };
+    
+    /**
+     * Look up (or compile once) the statement for a SQL string. Statements
+     * are cached per connection by SQL text. Asking again for a statement
+     * the calling thread already holds (e.g. from a for_each_* callback)
+     * returns a null statement instead of waiting on itself.
+     */
+    Statement prepare(const char* sql);
+    
+    void close();
     void init_schema();
     
+    // Step a prepared upsert (the caller's lease resets it) and return the row id
+    Result<int64_t> step_upsert(sqlite3_stmt* stmt, const std::string& path);
+    Result<int64_t> find_track_id(const std::string& path);
+    
     // Serialization helpers for vector fields
     std::vector<uint8_t> serialize_floats(const std::vector<float>& data);
     std::vector<float> deserialize_floats(const void* data, int size);
@@ -135,6 +284,9 @@ private:
     sqlite3* db_ = nullptr;
     std::string last_error_;
     std::mutex write_mutex_;
+    
+    std::mutex statements_mutex_;
+    std::unordered_map<std::string_view, std::unique_ptr<CachedStatement>> statements_;
 };
 
 } // namespace automix
@@ -0,0 +1,190 @@
+/**
+ * AutoMix Engine - Batched Write-Behind Store Writer Implementation
+ */
+
+#include "store_writer.h"
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace automix {
+
+namespace {
+
+// Adapts a callback-based write to a future
+std::pair<std::future<Result<int64_t>>, StoreWriter::IdCallback> make_promise_callback() {
+    auto promise = std::make_shared<std::promise<Result<int64_t>>>();
+    auto future = promise->get_future();
+    return {std::move(future), [promise](const Result<int64_t>& id) { promise->set_value(id); }};
+}
+
+} // namespace
+
+StoreWriter::StoreWriter(Store& store, StoreWriterConfig config)
+    : store_(store)
+    , config_(config) {
+    config_.batch_size = std::max<size_t>(1, config_.batch_size);
+    config_.max_pending = std::max(config_.max_pending, config_.batch_size);
+    thread_ = std::thread([this]() { run(); });
+}
+
+StoreWriter::~StoreWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    has_work_.notify_all();
+    thread_.join();
+}
+
+std::future<Result<int64_t>> StoreWriter::upsert_track(TrackInfo track) {
+    auto [future, callback] = make_promise_callback();
+    upsert_track(std::move(track), std::move(callback));
+    return std::move(future);
+}
+
+void StoreWriter::upsert_track(TrackInfo track, IdCallback on_written) {
+    Write write;
+    write.track = std::move(track);
+    write.on_written = std::move(on_written);
+    enqueue(std::move(write));
+}
+
+std::future<Result<int64_t>> StoreWriter::upsert_track_path_duration(std::string path, float duration,
+                                                                     int64_t file_modified_at) {
+    auto [future, callback] = make_promise_callback();
+    upsert_track_path_duration(std::move(path), duration, file_modified_at, std::move(callback));
+    return std::move(future);
+}
+
+void StoreWriter::upsert_track_path_duration(std::string path, float duration, int64_t file_modified_at,
+                                             IdCallback on_written) {
+    Write write;
+    write.metadata_only = true;
+    write.track.path = std::move(path);
+    write.track.duration = duration;
+    write.track.file_modified_at = file_modified_at;
+    write.on_written = std::move(on_written);
+    enqueue(std::move(write));
+}
+
+void StoreWriter::enqueue(Write write) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    has_room_.wait(lock, [this]() { return queue_.size() < config_.max_pending; });
+    queue_.push_back(std::move(write));
+    // The first row starts the batching delay; a full batch ends it
+    if (queue_.size() == 1 || queue_.size() >= config_.batch_size) {
+        has_work_.notify_one();
+    }
+}
+
+void StoreWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    flush_waiters_++;
+    has_work_.notify_one();
+    idle_.wait(lock, [this]() { return queue_.empty() && in_flight_ == 0; });
+    flush_waiters_--;
+}
+
+StoreWriterStats StoreWriter::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+std::string StoreWriter::last_error() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_error_;
+}
+
+void StoreWriter::run() {
+    const auto max_delay = std::chrono::milliseconds(std::max(0, config_.max_delay_ms));
+    std::deque<Write> batch;
+    
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        has_work_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) {
+            break;  // Stopping and drained
+        }
+        
+        // Let a partial batch fill up unless someone is waiting on it
+        auto deadline = std::chrono::steady_clock::now() + max_delay;
+        has_work_.wait_until(lock, deadline, [this]() {
+            return stopping_ || flush_waiters_ > 0 || queue_.size() >= config_.batch_size;
+        });
+        
+        size_t count = std::min(queue_.size(), config_.batch_size);
+        for (size_t i = 0; i < count; ++i) {
+            batch.push_back(std::move(queue_.front()));
+            queue_.pop_front();
+        }
+        in_flight_ = count;
+        has_room_.notify_all();
+        
+        lock.unlock();
+        write_batch(batch);
+        batch.clear();
+        lock.lock();
+        
+        in_flight_ = 0;
+        if (queue_.empty()) {
+            idle_.notify_all();
+        }
+    }
+}
+
+void StoreWriter::write_batch(std::deque<Write>& batch) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Result<int64_t>> results;
+    results.reserve(batch.size());
+    
+    {
+        std::lock_guard<std::mutex> store_lock(store_.write_mutex());
+        
+        // Without a transaction each row still commits on its own
+        bool in_transaction = store_.begin_transaction();
+        
+        for (const auto& write : batch) {
+            const TrackInfo& track = write.track;
+            if (write.metadata_only) {
+                results.push_back(store_.upsert_track_path_duration(track.path, track.duration, track.file_modified_at));
+            } else {
+                results.push_back(store_.upsert_track(track));
+            }
+        }
+        
+        if (in_transaction && !store_.commit_transaction()) {
+            // Nothing in the batch was kept
+            std::string error = "Commit failed: " + store_.error();
+            store_.rollback_transaction();
+            for (auto& result : results) {
+                result = ResultError{error};
+            }
+        }
+    }
+    
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.transactions++;
+        stats_.busy_seconds += elapsed;
+        for (const auto& result : results) {
+            if (result.ok()) {
+                stats_.rows++;
+            } else {
+                stats_.failed++;
+                last_error_ = result.error();
+            }
+        }
+    }
+    
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (batch[i].on_written) {
+            batch[i].on_written(results[i]);
+        }
+    }
+}
+
+} // namespace automix
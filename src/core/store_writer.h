@@ -0,0 +1,112 @@
+/**
+ * AutoMix Engine - Batched Write-Behind Store Writer
+ */
+
+#ifndef AUTOMIX_STORE_WRITER_H
+#define AUTOMIX_STORE_WRITER_H
+
+#include "store.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace automix {
+
+struct StoreWriterConfig {
+    size_t batch_size = 256;            // Rows per transaction (at most)
+    int max_delay_ms = 50;              // Commit a partial batch after this long
+    size_t max_pending = 4096;          // Producers block beyond this many queued rows
+};
+
+struct StoreWriterStats {
+    int transactions = 0;
+    int rows = 0;                       // Rows written successfully
+    int failed = 0;
+    double busy_seconds = 0.0;          // Time spent inside transactions
+};
+
+/**
+ * Queues track upserts and writes them from one thread, grouped into
+ * transactions of up to batch_size rows or max_delay_ms, whichever comes
+ * first. With WAL this turns one commit (and sync) per file into one per
+ * batch, and producers never wait on the database.
+ *
+ * The row id of each write is delivered through a future or a callback
+ * once its transaction has committed. Callbacks run on the writer thread.
+ */
+class StoreWriter {
+public:
+    using IdCallback = std::function<void(const Result<int64_t>& id)>;
+    
+    explicit StoreWriter(Store& store, StoreWriterConfig config = StoreWriterConfig());
+    
+    /**
+     * Commits everything still queued, then stops the writer thread.
+     */
+    ~StoreWriter();
+    
+    // Non-copyable
+    StoreWriter(const StoreWriter&) = delete;
+    StoreWriter& operator=(const StoreWriter&) = delete;
+    
+    /**
+     * Queue Store::upsert_track.
+     */
+    std::future<Result<int64_t>> upsert_track(TrackInfo track);
+    void upsert_track(TrackInfo track, IdCallback on_written);
+    
+    /**
+     * Queue Store::upsert_track_path_duration.
+     */
+    std::future<Result<int64_t>> upsert_track_path_duration(std::string path, float duration, int64_t file_modified_at);
+    void upsert_track_path_duration(std::string path, float duration, int64_t file_modified_at, IdCallback on_written);
+    
+    /**
+     * Block until every write queued so far has committed (and its callback
+     * has run). Does not wait for the batching delay.
+     */
+    void flush();
+    
+    StoreWriterStats stats() const;
+    
+    /**
+     * Error message of the most recent failed write, empty if none failed.
+     */
+    std::string last_error() const;
+
+private:
+    struct Write {
+        bool metadata_only = false;     // upsert_track_path_duration
+        TrackInfo track;
+        IdCallback on_written;
+    };
+    
+    void enqueue(Write write);
+    void run();
+    void write_batch(std::deque<Write>& batch);
+    
+    Store& store_;
+    StoreWriterConfig config_;
+    
+    mutable std::mutex mutex_;
+    std::condition_variable has_work_;  // Writer: rows queued, flush or stop
+    std::condition_variable has_room_;  // Producers: queue below max_pending
+    std::condition_variable idle_;      // flush(): queue empty, nothing in flight
+    std::deque<Write> queue_;
+    size_t in_flight_ = 0;
+    int flush_waiters_ = 0;
+    bool stopping_ = false;
+    
+    StoreWriterStats stats_;
+    std::string last_error_;
+    
+    std::thread thread_;
+};
+
+} // namespace automix
+
+#endif // AUTOMIX_STORE_WRITER_H
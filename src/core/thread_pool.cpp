@@ -0,0 +1,84 @@
+/**
+ * AutoMix Engine - Fork/Join Thread Pool Implementation
+ */
+
+#include "thread_pool.h"
+#include <algorithm>
+
+namespace automix {
+
+ThreadPool::ThreadPool(int threads) {
+    if (threads <= 0) {
+        threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+    for (int i = 1; i < threads; ++i) {
+        workers_.emplace_back([this]() { run_worker(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t)>& task) {
+    if (count == 0) {
+        return;
+    }
+    if (workers_.empty() || count == 1) {
+        for (size_t i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = &task;
+        count_ = count;
+        next_ = 0;
+        active_ = workers_.size();
+        generation_++;
+    }
+    wake_.notify_all();
+    
+    drain();
+    
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this]() { return active_ == 0; });
+    task_ = nullptr;
+}
+
+void ThreadPool::drain() {
+    for (size_t i = next_++; i < count_; i = next_++) {
+        (*task_)(i);
+    }
+}
+
+void ThreadPool::run_worker() {
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [&]() { return stop_ || generation_ != seen; });
+        if (stop_) {
+            return;
+        }
+        seen = generation_;
+        
+        lock.unlock();
+        drain();
+        lock.lock();
+        
+        if (--active_ == 0) {
+            done_.notify_all();
+        }
+    }
+}
+
+} // namespace automix
@@ -0,0 +1,73 @@
+/**
+ * AutoMix Engine - Fork/Join Thread Pool
+ */
+
+#ifndef AUTOMIX_THREAD_POOL_H
+#define AUTOMIX_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace automix {
+
+/**
+ * Fixed set of worker threads for data-parallel loops. parallel_for()
+ * hands out task indices to the workers and the calling thread, and
+ * returns once every index has run, so callers get plain fork/join
+ * semantics without spawning threads per loop.
+ */
+class ThreadPool {
+public:
+    /**
+     * @param threads Threads taking part in a loop, the caller included;
+     *        0 = std::thread::hardware_concurrency()
+     */
+    explicit ThreadPool(int threads = 0);
+    
+    /**
+     * Stops the workers (no loop may be running).
+     */
+    ~ThreadPool();
+    
+    // Non-copyable
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    
+    /**
+     * Threads taking part in a loop, the caller included.
+     */
+    int size() const { return static_cast<int>(workers_.size()) + 1; }
+    
+    /**
+     * Call task(i) for every i in [0, count) across the pool; the order of
+     * calls is unspecified. Blocks until all have returned. One loop at a
+     * time: tasks must not call parallel_for on the same pool.
+     */
+    void parallel_for(size_t count, const std::function<void(size_t)>& task);
+
+private:
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    
+    // Current loop
+    const std::function<void(size_t)>* task_ = nullptr;
+    size_t count_ = 0;
+    std::atomic<size_t> next_{0};
+    size_t active_ = 0;                 // Workers still in the loop
+    uint64_t generation_ = 0;           // Bumped per loop to wake workers
+    bool stop_ = false;
+    
+    void run_worker();
+    void drain();
+};
+
+} // namespace automix
+
+#endif // AUTOMIX_THREAD_POOL_H
@@ -5,6 +5,7 @@
 #ifndef AUTOMIX_UTILS_H
 #define AUTOMIX_UTILS_H
 
+#include "automix/types.h"
 #include <string>
 #include <vector>
 #include <cmath>
@@ -68,61 +69,100 @@ inline float euclidean_distance(const std::vector<float>& a, const std::vector<f
 
 /**
  * Camelot wheel key representation.
- * Keys are represented as "NA" where N is 1-12 and A is 'A' (minor) or 'B' (major).
- * Adjacent keys on the wheel are harmonically compatible.
+ * Keys are written "NA" where N is 1-12 and A is 'A' (minor) or 'B' (major),
+ * and handled as a KeyCode. Adjacent keys on the wheel are harmonically
+ * compatible.
  */
 
-inline int parse_camelot_number(const std::string& key) {
-    if (key.empty()) return 0;
-    try {
-        return std::stoi(key.substr(0, key.length() - 1));
-    } catch (...) {
-        return 0;
+/**
+ * Parse Camelot notation ("8A"); kUnknownKey if empty or not parseable.
+ */
+inline KeyCode key_from_camelot(const std::string& key) {
+    if (key.size() < 2 || key.size() > 3) {
+        return kUnknownKey;
+    }
+    
+    int number = 0;
+    for (size_t i = 0; i + 1 < key.size(); ++i) {
+        if (key[i] < '0' || key[i] > '9') return kUnknownKey;
+        number = number * 10 + (key[i] - '0');
+    }
+    
+    const char mode = key.back();
+    if (number < 1 || number > 12 || (mode != 'A' && mode != 'B')) {
+        return kUnknownKey;
     }
+    return static_cast<KeyCode>((number - 1) * 2 + (mode == 'B' ? 1 : 0));
+}
+
+/**
+ * Camelot notation of a key; empty if unknown.
+ */
+inline std::string key_to_camelot(KeyCode key) {
+    if (key < 0 || key >= 24) return "";
+    return std::to_string(key / 2 + 1) + (key % 2 ? 'B' : 'A');
 }
 
-inline char parse_camelot_mode(const std::string& key) {
-    if (key.empty()) return 'A';
-    return key.back();
+namespace detail {
+
+struct KeyTables {
+    int8_t distance[24][24] = {};
+    int8_t semitone[24] = {};
+};
+
+constexpr KeyTables make_key_tables() {
+    KeyTables tables;
+    for (int a = 0; a < 24; ++a) {
+        for (int b = 0; b < 24; ++b) {
+            // Steps around the wheel (circular, 1-12)
+            const int diff = a / 2 > b / 2 ? a / 2 - b / 2 : b / 2 - a / 2;
+            const int wheel_dist = diff < 12 - diff ? diff : 12 - diff;
+            
+            int dist = wheel_dist;
+            if (a % 2 != b % 2) {
+                // Relative major/minor share a number; other mode changes cost one more step
+                dist = a / 2 == b / 2 ? 0 : wheel_dist + 1;
+            }
+            tables.distance[a][b] = static_cast<int8_t>(dist);
+        }
+        
+        // Each step on the wheel is a fifth (7 semitones), B is the relative
+        // major (+3); 5A = C minor = 0
+        int semi = ((a / 2 + 1 - 5) * 7 % 12 + 12) % 12;
+        if (a % 2) semi = (semi + 3) % 12;
+        tables.semitone[a] = static_cast<int8_t>(semi);
+    }
+    return tables;
 }
 
+inline constexpr KeyTables kKeyTables = make_key_tables();
+
+} // namespace detail
+
 /**
  * Calculate distance on Camelot wheel between two keys.
- * Returns minimum steps needed (0-6 for same mode, or considering mode change).
+ * Returns minimum steps needed (0-6 for same mode, or considering mode
+ * change); 0 if either key is unknown.
  */
-inline int camelot_distance(const std::string& key1, const std::string& key2) {
-    if (key1.empty() || key2.empty()) return 0;
-    
-    int num1 = parse_camelot_number(key1);
-    int num2 = parse_camelot_number(key2);
-    char mode1 = parse_camelot_mode(key1);
-    char mode2 = parse_camelot_mode(key2);
-    
-    if (num1 == 0 || num2 == 0) return 0;
-    
-    // Distance on the wheel (circular, 1-12)
-    int diff = std::abs(num1 - num2);
-    int wheel_dist = std::min(diff, 12 - diff);
-    
-    // Same mode: just wheel distance
-    if (mode1 == mode2) {
-        return wheel_dist;
-    }
-    
-    // Different mode: check relative major/minor (same number = 0 distance)
-    if (num1 == num2) {
-        return 0;  // Relative major/minor
-    }
-    
-    // Cross-mode: add 1 for mode change penalty
-    return wheel_dist + 1;
+constexpr int camelot_distance(KeyCode key1, KeyCode key2) {
+    if (key1 < 0 || key1 >= 24 || key2 < 0 || key2 >= 24) return 0;
+    return detail::kKeyTables.distance[key1][key2];
+}
+
+/**
+ * Tonic of a key in semitones above C (5A = C minor = 0), 0-11;
+ * 0 if unknown.
+ */
+constexpr int key_semitone(KeyCode key) {
+    if (key < 0 || key >= 24) return 0;
+    return detail::kKeyTables.semitone[key];
 }
 
 /**
  * Check if two keys are harmonically compatible.
  * Compatible means distance <= 1 on Camelot wheel.
  */
-inline bool keys_compatible(const std::string& key1, const std::string& key2) {
+constexpr bool keys_compatible(KeyCode key1, KeyCode key2) {
     return camelot_distance(key1, key2) <= 1;
 }
 
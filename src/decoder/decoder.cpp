@@ -15,7 +15,12 @@ extern "C" {
 #include <libswresample/swresample.h>
 }
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <cstring>
+#include <fstream>
+#include <functional>
 
 namespace automix {
 
@@ -28,233 +33,521 @@ public:
     ~Impl() = default;
     
     Result<AudioBuffer> decode(const std::string& path, int target_sample_rate) {
-        return decode_internal(path, target_sample_rate, 2);
+        return decode_internal(path, nullptr, target_sample_rate, 2);
     }
     
-    Result<AudioBuffer> decode_for_analysis(const std::string& path) {
-        return decode_internal(path, 22050, 1);
+    Result<AudioBuffer> decode_for_analysis(const std::string& path, const std::vector<uint8_t>* data) {
+        return decode_internal(path, data, kAnalysisSampleRate, 1);
+    }
+    
+    Result<size_t> stream_for_analysis(const std::string& path, const std::vector<uint8_t>* data,
+                                       const PCMChunkCallback& callback, size_t chunk_frames) {
+        if (chunk_frames == 0) {
+            return "Invalid chunk size";
+        }
+        
+        // Re-block decoder output into fixed-size chunks
+        std::vector<float> chunk(chunk_frames);
+        size_t fill = 0;
+        bool stopped = false;
+        
+        auto result = decode_pcm(path, data, kAnalysisSampleRate, 1,
+            [&](const float* samples, size_t frames) {
+                while (frames > 0) {
+                    size_t take = std::min(frames, chunk_frames - fill);
+                    std::memcpy(chunk.data() + fill, samples, take * sizeof(float));
+                    fill += take;
+                    samples += take;
+                    frames -= take;
+                    if (fill == chunk_frames) {
+                        fill = 0;
+                        if (!callback(chunk.data(), chunk_frames)) {
+                            stopped = true;
+                            return false;
+                        }
+                    }
+                }
+                return true;
+            });
+        
+        if (result.failed()) {
+            return result;
+        }
+        if (fill > 0 && !stopped) {
+            callback(chunk.data(), fill);
+        }
+        if (result.value() == 0) {
+            return "No audio data decoded";
+        }
+        return result;
     }
     
     /**
      * Internal decode method supporting configurable sample rate and channels.
+     * Decodes from data when given (already read file contents), else from path.
+     */
+    Result<AudioBuffer> decode_internal(const std::string& path, const std::vector<uint8_t>* data,
+                                        int target_sample_rate, int target_channels) {
+        AudioBuffer buffer;
+        buffer.sample_rate = target_sample_rate > 0 ? target_sample_rate : 44100;
+        buffer.channels = target_channels > 0 ? target_channels : 2;
+        
+        auto result = decode_pcm(path, data, buffer.sample_rate, buffer.channels,
+            [&](const float* samples, size_t frames) {
+                buffer.samples.insert(buffer.samples.end(), samples, samples + frames * buffer.channels);
+                return true;
+            },
+            [&](int64_t estimated_frames) {
+                buffer.samples.reserve(estimated_frames * buffer.channels);
+            });
+        
+        if (result.failed()) {
+            return ResultError{result.error()};
+        }
+        
+        if (buffer.samples.empty()) {
+            return "No audio data decoded";
+        }
+        
+        return buffer;
+    }
+    
+    /**
+     * Decode and resample a file, handing converted PCM (interleaved float32)
+     * to on_data as it is produced. on_data returns false to stop early.
+     * on_length, if set, receives the estimated output length in frames
+     * before decoding starts.
+     * @return Number of frames delivered
+     */
+    Result<size_t> decode_pcm(const std::string& path, const std::vector<uint8_t>* data, int sample_rate, int channels,
+                              const std::function<bool(const float*, size_t)>& on_data,
+                              const std::function<void(int64_t)>& on_length = nullptr) {
+        Session session;
+        auto open_result = open(session, path, data, sample_rate, channels);
+        if (open_result.failed()) {
+            return ResultError{open_result.error()};
+        }
+        
+        // Estimate output size
+        if (on_length && session.format_ctx->duration > 0) {
+            on_length(av_rescale_q(session.format_ctx->duration, AV_TIME_BASE_Q, {1, sample_rate}));
+        }
+        
+        return pump(session, on_data);
+    }
+    
+    Result<TrackExcerpts> decode_excerpts(const std::string& path, int count, float excerpt_seconds) {
+        if (count <= 0 || excerpt_seconds <= 0.0f) {
+            return "Invalid excerpt layout";
+        }
+        
+        Session session;
+        auto open_result = open(session, path, nullptr, kAnalysisSampleRate, 1);
+        if (open_result.failed()) {
+            return ResultError{open_result.error()};
+        }
+        
+        TrackExcerpts track;
+        track.duration = static_cast<float>(session.duration());
+        
+        auto make_excerpt = []() {
+            AudioExcerpt excerpt;
+            excerpt.audio.sample_rate = kAnalysisSampleRate;
+            excerpt.audio.channels = 1;
+            return excerpt;
+        };
+        
+        // Unknown length, or too short for skipping to pay off: the whole
+        // track becomes a single excerpt
+        if (track.duration <= 0.0f || track.duration < count * excerpt_seconds * kMinExcerptSkipRatio) {
+            AudioExcerpt whole = make_excerpt();
+            pump(session, [&](const float* samples, size_t frames) {
+                whole.audio.samples.insert(whole.audio.samples.end(), samples, samples + frames);
+                return true;
+            });
+            if (whole.audio.samples.empty()) {
+                return "No audio data decoded";
+            }
+            track.duration = whole.audio.duration_seconds();
+            track.excerpts.push_back(std::move(whole));
+            return track;
+        }
+        
+        // Evenly spaced windows from the very start to the very end, so the
+        // intro and outro (where transitions happen) are always covered
+        const size_t length = static_cast<size_t>(excerpt_seconds * kAnalysisSampleRate);
+        for (int i = 0; i < count; ++i) {
+            double start = count > 1 ? static_cast<double>(track.duration - excerpt_seconds) * i / (count - 1) : 0.0;
+            int64_t first_frame = static_cast<int64_t>(std::llround(start * kAnalysisSampleRate));
+            if (i > 0) {
+                // Unseekable input keeps reading forward; the trimming below still applies
+                seek(session, start);
+            }
+            
+            AudioExcerpt excerpt = make_excerpt();
+            excerpt.audio.samples.reserve(length);
+            pump(session, [&](const float* samples, size_t frames) {
+                // Drop decoded audio before the window (seeks land on or before it)
+                int64_t position = session.position;
+                size_t skip = static_cast<size_t>(std::clamp<int64_t>(first_frame - position, 0, static_cast<int64_t>(frames)));
+                if (skip == frames) {
+                    return true;
+                }
+                if (excerpt.audio.samples.empty()) {
+                    excerpt.start = static_cast<float>(position + static_cast<int64_t>(skip)) / kAnalysisSampleRate;
+                }
+                size_t take = std::min(frames - skip, length - excerpt.audio.samples.size());
+                excerpt.audio.samples.insert(excerpt.audio.samples.end(), samples + skip, samples + skip + take);
+                return excerpt.audio.samples.size() < length;
+            });
+            
+            if (!excerpt.audio.samples.empty()) {
+                track.excerpts.push_back(std::move(excerpt));
+            }
+        }
+        
+        if (track.excerpts.empty()) {
+            return "No audio data decoded";
+        }
+        return track;
+    }
+    
+    // Tracks shorter than count * excerpt length * this are decoded whole
+    static constexpr float kMinExcerptSkipRatio = 1.5f;
+    
+    /**
+     * Read position in file contents held in memory (custom FFmpeg I/O).
      */
-    Result<AudioBuffer> decode_internal(const std::string& path, int target_sample_rate, int target_channels) {
+    struct MemoryInput {
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+        size_t position = 0;
+    };
+    
+    static int read_memory(void* opaque, uint8_t* buffer, int buffer_size) {
+        auto* input = static_cast<MemoryInput*>(opaque);
+        size_t count = std::min(input->size - input->position, static_cast<size_t>(buffer_size));
+        if (count == 0) {
+            return AVERROR_EOF;
+        }
+        std::memcpy(buffer, input->data + input->position, count);
+        input->position += count;
+        return static_cast<int>(count);
+    }
+    
+    static int64_t seek_memory(void* opaque, int64_t offset, int whence) {
+        auto* input = static_cast<MemoryInput*>(opaque);
+        int64_t target;
+        switch (whence & ~AVSEEK_FORCE) {
+            case AVSEEK_SIZE: return static_cast<int64_t>(input->size);
+            case SEEK_SET: target = offset; break;
+            case SEEK_CUR: target = static_cast<int64_t>(input->position) + offset; break;
+            case SEEK_END: target = static_cast<int64_t>(input->size) + offset; break;
+            default: return -1;
+        }
+        if (target < 0 || target > static_cast<int64_t>(input->size)) {
+            return -1;
+        }
+        input->position = static_cast<size_t>(target);
+        return target;
+    }
+    
+    // Buffer size for in-memory input
+    static constexpr int kIOBufferSize = 64 * 1024;
+    
+    /**
+     * An opened input: demuxer, decoder and resampler for the first audio
+     * stream. Released on destruction.
+     */
+    struct Session {
         AVFormatContext* format_ctx = nullptr;
+        AVIOContext* io_ctx = nullptr;      // Only set for in-memory input
+        MemoryInput memory;
         AVCodecContext* codec_ctx = nullptr;
         SwrContext* swr_ctx = nullptr;
         AVPacket* packet = nullptr;
         AVFrame* frame = nullptr;
+        AVStream* audio_stream = nullptr;
+        int audio_stream_idx = -1;
+        int in_sample_rate = 44100;
+        int sample_rate = 0;
+        int channels = 0;
         
-        AudioBuffer buffer;
-        buffer.sample_rate = target_sample_rate > 0 ? target_sample_rate : 44100;
-        buffer.channels = target_channels > 0 ? target_channels : 2;
+        // Track position (output frames) of the next converted sample;
+        // -1 until the first decoded frame after open/seek reports it
+        int64_t position = -1;
+        int64_t expected_position = 0;      // Used when frames carry no timestamp
         
-        // Cleanup helper
-        auto cleanup = [&]() {
+        std::vector<float> out_buffer;      // Conversion buffer, reused across frames
+        
+        Session() = default;
+        Session(const Session&) = delete;
+        Session& operator=(const Session&) = delete;
+        
+        ~Session() {
             if (frame) av_frame_free(&frame);
             if (packet) av_packet_free(&packet);
             if (swr_ctx) swr_free(&swr_ctx);
             if (codec_ctx) avcodec_free_context(&codec_ctx);
             if (format_ctx) avformat_close_input(&format_ctx);
-        };
+            if (io_ctx) {
+                av_freep(&io_ctx->buffer);
+                avio_context_free(&io_ctx);
+            }
+        }
+        
+        /**
+         * Container duration in seconds, or 0 if unknown.
+         */
+        double duration() const {
+            return format_ctx->duration > 0 ? static_cast<double>(format_ctx->duration) / AV_TIME_BASE : 0.0;
+        }
+    };
+    
+    /**
+     * Open a file and set up decoding of its first audio stream to float32
+     * PCM at the given sample rate and channel count. When data is given the
+     * file contents are read from it (path then only names the input).
+     * @return Index of the audio stream
+     */
+    Result<int> open(Session& s, const std::string& path, const std::vector<uint8_t>* data,
+                     int sample_rate, int channels) {
+        s.sample_rate = sample_rate;
+        s.channels = channels;
+        
+        if (data) {
+            s.memory = {data->data(), data->size(), 0};
+            auto* io_buffer = static_cast<unsigned char*>(av_malloc(kIOBufferSize));
+            if (io_buffer) {
+                s.io_ctx = avio_alloc_context(io_buffer, kIOBufferSize, 0, &s.memory, &read_memory, nullptr, &seek_memory);
+            }
+            s.format_ctx = avformat_alloc_context();
+            if (!s.io_ctx || !s.format_ctx) {
+                if (!s.io_ctx) av_free(io_buffer);
+                return "Failed to allocate I/O context";
+            }
+            s.format_ctx->pb = s.io_ctx;
+        }
         
         // Open file
-        int ret = avformat_open_input(&format_ctx, path.c_str(), nullptr, nullptr);
+        int ret = avformat_open_input(&s.format_ctx, path.c_str(), nullptr, nullptr);
         if (ret < 0) {
-            cleanup();
             return "Failed to open file: " + path;
         }
         
         // Find stream info
-        ret = avformat_find_stream_info(format_ctx, nullptr);
+        ret = avformat_find_stream_info(s.format_ctx, nullptr);
         if (ret < 0) {
-            cleanup();
             return "Failed to find stream info";
         }
         
         // Find audio stream
-        int audio_stream_idx = -1;
-        for (unsigned int i = 0; i < format_ctx->nb_streams; i++) {
-            if (format_ctx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
-                audio_stream_idx = i;
+        for (unsigned int i = 0; i < s.format_ctx->nb_streams; i++) {
+            if (s.format_ctx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
+                s.audio_stream_idx = i;
                 break;
             }
         }
         
-        if (audio_stream_idx < 0) {
-            cleanup();
+        if (s.audio_stream_idx < 0) {
             return "No audio stream found";
         }
         
-        AVStream* audio_stream = format_ctx->streams[audio_stream_idx];
-        AVCodecParameters* codecpar = audio_stream->codecpar;
+        s.audio_stream = s.format_ctx->streams[s.audio_stream_idx];
+        AVCodecParameters* codecpar = s.audio_stream->codecpar;
         
         // Find decoder
         const AVCodec* codec = avcodec_find_decoder(codecpar->codec_id);
         if (!codec) {
-            cleanup();
             return "Unsupported codec";
         }
         
         // Allocate codec context
-        codec_ctx = avcodec_alloc_context3(codec);
-        if (!codec_ctx) {
-            cleanup();
+        s.codec_ctx = avcodec_alloc_context3(codec);
+        if (!s.codec_ctx) {
             return "Failed to allocate codec context";
         }
         
-        ret = avcodec_parameters_to_context(codec_ctx, codecpar);
+        ret = avcodec_parameters_to_context(s.codec_ctx, codecpar);
         if (ret < 0) {
-            cleanup();
             return "Failed to copy codec parameters";
         }
         
         // Open codec
-        ret = avcodec_open2(codec_ctx, codec, nullptr);
+        ret = avcodec_open2(s.codec_ctx, codec, nullptr);
         if (ret < 0) {
-            cleanup();
             return "Failed to open codec";
         }
         
-        // Setup resampler - configure output channel layout based on target_channels
+        // Setup resampler - configure output channel layout based on target channels
         AVChannelLayout out_ch_layout;
-        if (buffer.channels == 1) {
+        if (channels == 1) {
             out_ch_layout = AV_CHANNEL_LAYOUT_MONO;
         } else {
             out_ch_layout = AV_CHANNEL_LAYOUT_STEREO;
         }
         AVChannelLayout in_ch_layout;
         
-        if (codec_ctx->ch_layout.nb_channels > 0) {
-            av_channel_layout_copy(&in_ch_layout, &codec_ctx->ch_layout);
+        if (s.codec_ctx->ch_layout.nb_channels > 0) {
+            av_channel_layout_copy(&in_ch_layout, &s.codec_ctx->ch_layout);
         } else {
             av_channel_layout_default(&in_ch_layout, codecpar->ch_layout.nb_channels > 0 ? 
                 codecpar->ch_layout.nb_channels : 2);
         }
         
-        int in_sample_rate = codec_ctx->sample_rate > 0 ? codec_ctx->sample_rate : 44100;
+        s.in_sample_rate = s.codec_ctx->sample_rate > 0 ? s.codec_ctx->sample_rate : 44100;
         
-        ret = swr_alloc_set_opts2(&swr_ctx,
+        ret = swr_alloc_set_opts2(&s.swr_ctx,
             &out_ch_layout,
             AV_SAMPLE_FMT_FLT,
-            buffer.sample_rate,
+            sample_rate,
             &in_ch_layout,
-            codec_ctx->sample_fmt,
-            in_sample_rate,
+            s.codec_ctx->sample_fmt,
+            s.in_sample_rate,
             0, nullptr);
         
-        if (ret < 0 || !swr_ctx) {
-            cleanup();
+        if (ret < 0 || !s.swr_ctx) {
             return "Failed to create resampler";
         }
         
-        ret = swr_init(swr_ctx);
+        ret = swr_init(s.swr_ctx);
         if (ret < 0) {
-            cleanup();
             return "Failed to initialize resampler";
         }
         
         // Allocate packet and frame
-        packet = av_packet_alloc();
-        frame = av_frame_alloc();
-        if (!packet || !frame) {
-            cleanup();
+        s.packet = av_packet_alloc();
+        s.frame = av_frame_alloc();
+        if (!s.packet || !s.frame) {
             return "Failed to allocate packet/frame";
         }
         
-        // Estimate output size and reserve
-        int64_t duration_samples = 0;
-        if (format_ctx->duration > 0) {
-            duration_samples = av_rescale_q(format_ctx->duration, 
-                AV_TIME_BASE_Q, {1, buffer.sample_rate});
-            buffer.samples.reserve(duration_samples * buffer.channels);
+        return s.audio_stream_idx;
+    }
+    
+    /**
+     * Move the read position to at or before `seconds` and reset decoder
+     * and resampler state. Returns false if the input cannot seek, in which
+     * case reading continues where it was.
+     */
+    bool seek(Session& s, double seconds) {
+        int64_t timestamp = static_cast<int64_t>(seconds * AV_TIME_BASE);
+        if (s.format_ctx->start_time != AV_NOPTS_VALUE) {
+            timestamp += s.format_ctx->start_time;
         }
+        if (av_seek_frame(s.format_ctx, -1, timestamp, AVSEEK_FLAG_BACKWARD) < 0) {
+            return false;
+        }
+        avcodec_flush_buffers(s.codec_ctx);
+        swr_init(s.swr_ctx);  // Drops samples buffered from before the seek
+        s.position = -1;
+        s.expected_position = static_cast<int64_t>(std::llround(seconds * s.sample_rate));
+        return true;
+    }
+    
+    /**
+     * Track position (output frames) of a decoded frame, from its timestamp.
+     */
+    static int64_t frame_position(const Session& s, const AVFrame* frame) {
+        int64_t timestamp = frame->best_effort_timestamp;
+        if (timestamp == AV_NOPTS_VALUE) {
+            timestamp = frame->pts;
+        }
+        if (timestamp == AV_NOPTS_VALUE) {
+            return s.expected_position;
+        }
+        if (s.audio_stream->start_time != AV_NOPTS_VALUE) {
+            timestamp -= s.audio_stream->start_time;
+        }
+        return std::max<int64_t>(0, av_rescale_q(timestamp, s.audio_stream->time_base, {1, s.sample_rate}));
+    }
+    
+    /**
+     * Decode from the current read position, handing converted PCM to
+     * on_data until it returns false or the input ends (then decoder and
+     * resampler are flushed). While on_data runs, s.position is the track
+     * position of its first sample.
+     * @return Number of frames delivered
+     */
+    size_t pump(Session& s, const std::function<bool(const float*, size_t)>& on_data) {
+        size_t delivered = 0;
+        bool stopped = false;
+        
+        // Resample one decoded frame (or flush the resampler when frame is null)
+        auto convert = [&](AVFrame* in) {
+            if (in && s.position < 0) {
+                s.position = frame_position(s, in);
+            }
+            
+            int in_samples = in ? in->nb_samples : 0;
+            int out_samples = in
+                ? static_cast<int>(av_rescale_rnd(swr_get_delay(s.swr_ctx, s.in_sample_rate) + in_samples,
+                                                  s.sample_rate, s.in_sample_rate, AV_ROUND_UP))
+                : static_cast<int>(swr_get_delay(s.swr_ctx, s.sample_rate));
+            if (out_samples <= 0) return;
+            
+            if (s.out_buffer.size() < static_cast<size_t>(out_samples) * s.channels) {
+                s.out_buffer.resize(static_cast<size_t>(out_samples) * s.channels);
+            }
+            uint8_t* out_ptr = reinterpret_cast<uint8_t*>(s.out_buffer.data());
+            
+            int converted = swr_convert(s.swr_ctx,
+                &out_ptr, out_samples,
+                in ? (const uint8_t**)in->extended_data : nullptr, in_samples);
+            
+            if (converted > 0) {
+                delivered += converted;
+                if (s.position < 0) {
+                    s.position = s.expected_position;
+                }
+                bool keep_going = on_data(s.out_buffer.data(), static_cast<size_t>(converted));
+                s.position += converted;
+                if (!keep_going) {
+                    stopped = true;
+                }
+            }
+        };
         
         // Decode loop
-        while (av_read_frame(format_ctx, packet) >= 0) {
-            if (packet->stream_index == audio_stream_idx) {
-                ret = avcodec_send_packet(codec_ctx, packet);
+        int ret = 0;
+        while (!stopped && av_read_frame(s.format_ctx, s.packet) >= 0) {
+            if (s.packet->stream_index == s.audio_stream_idx) {
+                ret = avcodec_send_packet(s.codec_ctx, s.packet);
                 if (ret < 0) {
-                    av_packet_unref(packet);
+                    av_packet_unref(s.packet);
                     continue;
                 }
                 
-                while (ret >= 0) {
-                    ret = avcodec_receive_frame(codec_ctx, frame);
+                while (ret >= 0 && !stopped) {
+                    ret = avcodec_receive_frame(s.codec_ctx, s.frame);
                     if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
                         break;
                     } else if (ret < 0) {
                         break;
                     }
                     
-                    // Resample
-                    int out_samples = av_rescale_rnd(
-                        swr_get_delay(swr_ctx, in_sample_rate) + frame->nb_samples,
-                        buffer.sample_rate, in_sample_rate, AV_ROUND_UP);
-                    
-                    std::vector<float> out_buffer(out_samples * buffer.channels);
-                    uint8_t* out_ptr = reinterpret_cast<uint8_t*>(out_buffer.data());
-                    
-                    int converted = swr_convert(swr_ctx,
-                        &out_ptr, out_samples,
-                        (const uint8_t**)frame->extended_data, frame->nb_samples);
-                    
-                    if (converted > 0) {
-                        buffer.samples.insert(buffer.samples.end(),
-                            out_buffer.begin(),
-                            out_buffer.begin() + converted * buffer.channels);
-                    }
-                    
-                    av_frame_unref(frame);
+                    convert(s.frame);
+                    av_frame_unref(s.frame);
                 }
             }
-            av_packet_unref(packet);
+            av_packet_unref(s.packet);
         }
         
-        // Flush decoder
-        avcodec_send_packet(codec_ctx, nullptr);
-        while (avcodec_receive_frame(codec_ctx, frame) >= 0) {
-            int out_samples = av_rescale_rnd(
-                swr_get_delay(swr_ctx, in_sample_rate) + frame->nb_samples,
-                buffer.sample_rate, in_sample_rate, AV_ROUND_UP);
-            
-            std::vector<float> out_buffer(out_samples * buffer.channels);
-            uint8_t* out_ptr = reinterpret_cast<uint8_t*>(out_buffer.data());
-            
-            int converted = swr_convert(swr_ctx,
-                &out_ptr, out_samples,
-                (const uint8_t**)frame->extended_data, frame->nb_samples);
-            
-            if (converted > 0) {
-                buffer.samples.insert(buffer.samples.end(),
-                    out_buffer.begin(),
-                    out_buffer.begin() + converted * buffer.channels);
+        if (!stopped) {
+            // Flush decoder
+            avcodec_send_packet(s.codec_ctx, nullptr);
+            while (!stopped && avcodec_receive_frame(s.codec_ctx, s.frame) >= 0) {
+                convert(s.frame);
+                av_frame_unref(s.frame);
             }
             
-            av_frame_unref(frame);
-        }
-        
-        // Flush resampler
-        int out_samples = swr_get_delay(swr_ctx, buffer.sample_rate);
-        if (out_samples > 0) {
-            std::vector<float> out_buffer(out_samples * buffer.channels);
-            uint8_t* out_ptr = reinterpret_cast<uint8_t*>(out_buffer.data());
-            
-            int converted = swr_convert(swr_ctx, &out_ptr, out_samples, nullptr, 0);
-            if (converted > 0) {
-                buffer.samples.insert(buffer.samples.end(),
-                    out_buffer.begin(),
-                    out_buffer.begin() + converted * buffer.channels);
+            // Flush resampler
+            if (!stopped) {
+                convert(nullptr);
             }
         }
         
-        cleanup();
-        
-        if (buffer.samples.empty()) {
-            return "No audio data decoded";
-        }
-        
-        return buffer;
+        return delivered;
     }
     
     float get_duration(const std::string& path) {
@@ -289,13 +582,51 @@ Result<AudioBuffer> Decoder::decode(const std::string& path, int target_sample_r
 }
 
 Result<AudioBuffer> Decoder::decode_for_analysis(const std::string& path) {
-    return impl_->decode_for_analysis(path);
+    return impl_->decode_for_analysis(path, nullptr);
+}
+
+Result<AudioBuffer> Decoder::decode_for_analysis(const EncodedFile& file) {
+    return impl_->decode_for_analysis(file.path, &file.data);
+}
+
+Result<size_t> Decoder::stream_for_analysis(const std::string& path, const PCMChunkCallback& callback,
+                                            size_t chunk_frames) {
+    return impl_->stream_for_analysis(path, nullptr, callback, chunk_frames);
+}
+
+Result<size_t> Decoder::stream_for_analysis(const EncodedFile& file, const PCMChunkCallback& callback,
+                                            size_t chunk_frames) {
+    return impl_->stream_for_analysis(file.path, &file.data, callback, chunk_frames);
+}
+
+Result<TrackExcerpts> Decoder::decode_excerpts(const std::string& path, int count, float excerpt_seconds) {
+    return impl_->decode_excerpts(path, count, excerpt_seconds);
 }
 
 float Decoder::get_duration(const std::string& path) {
     return impl_->get_duration(path);
 }
 
+Result<EncodedFile> Decoder::read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        return "Failed to open file: " + path;
+    }
+    
+    EncodedFile file;
+    file.path = path;
+    std::streamsize size = in.tellg();
+    if (size < 0) {
+        return "Failed to read file: " + path;
+    }
+    file.data.resize(static_cast<size_t>(size));
+    in.seekg(0);
+    if (!in.read(reinterpret_cast<char*>(file.data.data()), size)) {
+        return "Failed to read file: " + path;
+    }
+    return file;
+}
+
 bool Decoder::is_supported(const std::string& path) {
     return utils::is_audio_file(path);
 }
@@ -6,10 +6,28 @@
 #define AUTOMIX_DECODER_H
 
 #include "automix/types.h"
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <vector>
 
 namespace automix {
 
+/**
+ * Receives a chunk of decoded PCM (interleaved float32).
+ * Return false to stop decoding.
+ */
+using PCMChunkCallback = std::function<bool(const float* samples, size_t frames)>;
+
+/**
+ * Encoded file contents, read ahead of decoding so that file I/O and
+ * decoding can run on different threads.
+ */
+struct EncodedFile {
+    std::string path;                   // Names the input (errors, format probing)
+    std::vector<uint8_t> data;
+};
+
 /**
  * Audio decoder that converts various formats to uniform PCM.
  * Supported formats: MP3, FLAC, AAC, M4A, OGG, WAV, AIFF, DSD (DSF/DFF)
@@ -44,6 +62,47 @@ public:
      */
     Result<AudioBuffer> decode_for_analysis(const std::string& path);
     
+    /**
+     * Same as decode_for_analysis(path), from contents already read by
+     * read_file(). The decoder does no file I/O.
+     */
+    Result<AudioBuffer> decode_for_analysis(const EncodedFile& file);
+    
+    /**
+     * Stream a file for analysis (mono, kAnalysisSampleRate) in fixed-size
+     * chunks instead of materializing the whole track. Every chunk has
+     * chunk_frames frames except possibly the last. Memory stays bounded
+     * regardless of file length.
+     * 
+     * @param path Path to audio file
+     * @param callback Receives each chunk; return false to stop early
+     * @param chunk_frames Frames per chunk
+     * @return Total frames decoded, or error
+     */
+    Result<size_t> stream_for_analysis(const std::string& path, const PCMChunkCallback& callback,
+                                       size_t chunk_frames = 16384);
+    
+    /**
+     * Same as stream_for_analysis(path, ...), from contents already read by
+     * read_file().
+     */
+    Result<size_t> stream_for_analysis(const EncodedFile& file, const PCMChunkCallback& callback,
+                                       size_t chunk_frames = 16384);
+    
+    /**
+     * Decode only a few evenly spaced excerpts of a file for fast analysis
+     * (mono, kAnalysisSampleRate), seeking between them in a single open.
+     * The first excerpt starts at 0 and the last ends at the end of the
+     * track. Tracks too short for skipping to pay off, or of unknown length,
+     * come back as one excerpt holding the whole track.
+     * 
+     * @param path Path to audio file
+     * @param count Number of excerpts
+     * @param excerpt_seconds Length of each excerpt
+     * @return Excerpts and whole-track duration, or error
+     */
+    Result<TrackExcerpts> decode_excerpts(const std::string& path, int count = 3, float excerpt_seconds = 20.0f);
+    
     /**
      * Get audio duration without full decode.
      * 
@@ -52,11 +111,19 @@ public:
      */
     float get_duration(const std::string& path);
     
+    /**
+     * Read a whole file into memory for one of the EncodedFile overloads.
+     */
+    static Result<EncodedFile> read_file(const std::string& path);
+    
     /**
      * Check if a file format is supported.
      */
     static bool is_supported(const std::string& path);
     
+    // Sample rate of decode_for_analysis() / stream_for_analysis() output
+    static constexpr int kAnalysisSampleRate = 22050;
+    
 private:
     class Impl;
     std::unique_ptr<Impl> impl_;
@@ -0,0 +1,400 @@
+/**
+ * AutoMix Engine - Approximate Nearest-Neighbour Index Implementation
+ */
+
+#include "ann_index.h"
+#include "simd_kernels.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+
+namespace automix {
+
+namespace {
+
+// Visit marks reused across searches on the same thread
+struct VisitedSet {
+    std::vector<uint32_t> marks;
+    uint32_t epoch = 0;
+    
+    void reset(size_t size) {
+        if (marks.size() < size) {
+            marks.resize(size, 0);
+        }
+        if (++epoch == 0) {
+            std::fill(marks.begin(), marks.end(), 0);
+            epoch = 1;
+        }
+    }
+    
+    // True the first time a node is seen since reset()
+    bool insert(uint32_t node) {
+        if (marks[node] == epoch) return false;
+        marks[node] = epoch;
+        return true;
+    }
+};
+
+VisitedSet& visited_set() {
+    thread_local VisitedSet visited;
+    return visited;
+}
+
+} // namespace
+
+AnnIndex::AnnIndex() : AnnIndex(Config()) {}
+
+AnnIndex::AnnIndex(const Config& config)
+    : config_(config)
+    , rng_(config.seed) {
+    config_.max_links = std::max(2, config_.max_links);
+    config_.ef_construction = std::max(config_.max_links, config_.ef_construction);
+}
+
+void AnnIndex::embed(const FeatureMatrix& m, size_t row, float* out) {
+    std::fill(out, out + kDims, 0.0f);
+    
+    // Unit halves weighted equally: squared distance is 2 - (cos_mfcc + cos_chroma)
+    const float half = std::sqrt(0.5f);
+    const float* mfcc = m.mfcc(row);
+    if (mfcc && m.mfcc_norm(row) > 0.0f) {
+        const float scale = half / m.mfcc_norm(row);
+        for (size_t i = 0; i < FeatureMatrix::kMfccDims; ++i) {
+            out[i] = mfcc[i] * scale;
+        }
+    }
+    const float* chroma = m.chroma(row);
+    if (chroma && m.chroma_norm(row) > 0.0f) {
+        const float scale = half / m.chroma_norm(row);
+        for (size_t i = 0; i < FeatureMatrix::kChromaDims; ++i) {
+            out[FeatureMatrix::kMfccStride + i] = chroma[i] * scale;
+        }
+    }
+}
+
+bool AnnIndex::is_complete(const FeatureMatrix& m, size_t row) {
+    return m.mfcc(row) && m.mfcc_norm(row) > 0.0f && m.chroma(row) && m.chroma_norm(row) > 0.0f;
+}
+
+const float* AnnIndex::stored_vector(int64_t id) const {
+    auto it = by_id_.find(id);
+    if (it != by_id_.end()) {
+        return vector(it->second);
+    }
+    auto partial = partial_by_id_.find(id);
+    if (partial != partial_by_id_.end()) {
+        return &partial_vectors_[partial->second * kDims];
+    }
+    return nullptr;
+}
+
+bool AnnIndex::add(const FeatureMatrix& m, size_t row) {
+    float vec[kDims];
+    embed(m, row, vec);
+    
+    const int64_t id = m.id(row);
+    const float* existing = stored_vector(id);
+    if (existing && std::equal(vec, vec + kDims, existing)) {
+        return false;  // Unchanged
+    }
+    remove(id);
+    
+    if (is_complete(m, row)) {
+        by_id_[id] = insert(id, vec);
+        live_++;
+    } else {
+        partial_by_id_[id] = partial_ids_.size();
+        partial_ids_.push_back(id);
+        partial_vectors_.insert(partial_vectors_.end(), vec, vec + kDims);
+    }
+    return true;
+}
+
+void AnnIndex::remove(int64_t track_id) {
+    auto it = by_id_.find(track_id);
+    if (it != by_id_.end()) {
+        nodes_[it->second].removed = true;
+        by_id_.erase(it);
+        live_--;
+        return;
+    }
+    
+    auto partial = partial_by_id_.find(track_id);
+    if (partial == partial_by_id_.end()) {
+        return;
+    }
+    
+    // Swap with the last entry
+    const size_t i = partial->second;
+    const size_t last = partial_ids_.size() - 1;
+    if (i != last) {
+        partial_ids_[i] = partial_ids_[last];
+        std::copy_n(&partial_vectors_[last * kDims], kDims, &partial_vectors_[i * kDims]);
+        partial_by_id_[partial_ids_[i]] = i;
+    }
+    partial_ids_.pop_back();
+    partial_vectors_.resize(last * kDims);
+    partial_by_id_.erase(partial);
+}
+
+size_t AnnIndex::sync(const FeatureMatrix& m) {
+    std::vector<int64_t> gone;
+    for (const auto& [id, node] : by_id_) {
+        if (!m.index_of(id)) gone.push_back(id);
+    }
+    for (int64_t id : partial_ids_) {
+        if (!m.index_of(id)) gone.push_back(id);
+    }
+    for (int64_t id : gone) {
+        remove(id);
+    }
+    
+    size_t added = 0;
+    for (size_t row = 0; row < m.size(); ++row) {
+        if (add(m, row)) added++;
+    }
+    return added;
+}
+
+float AnnIndex::distance(const float* query, float query_norm, uint32_t node) const {
+    float d = query_norm + norms_[node] - 2.0f * simd::dot(query, vector(node), kDims);
+    return std::max(0.0f, d);
+}
+
+float AnnIndex::partial_distance(const float* query, float query_norm, size_t i) const {
+    const float* vec = &partial_vectors_[i * kDims];
+    float d = query_norm + simd::dot(vec, vec, kDims) - 2.0f * simd::dot(query, vec, kDims);
+    return std::max(0.0f, d);
+}
+
+int AnnIndex::random_level() {
+    std::uniform_real_distribution<double> unit(std::numeric_limits<double>::min(), 1.0);
+    const double level_mult = 1.0 / std::log(static_cast<double>(config_.max_links));
+    return static_cast<int>(-std::log(unit(rng_)) * level_mult);
+}
+
+size_t AnnIndex::max_links(int level) const {
+    return static_cast<size_t>(level == 0 ? 2 * config_.max_links : config_.max_links);
+}
+
+uint32_t AnnIndex::insert(int64_t id, const float* vec) {
+    const uint32_t node = static_cast<uint32_t>(nodes_.size());
+    const int level = random_level();
+    
+    nodes_.emplace_back();
+    nodes_.back().id = id;
+    nodes_.back().links.resize(static_cast<size_t>(level) + 1);
+    vectors_.insert(vectors_.end(), vec, vec + kDims);
+    const float norm = simd::dot(vec, vec, kDims);
+    norms_.push_back(norm);
+    
+    if (max_level_ < 0) {
+        entry_ = node;
+        max_level_ = level;
+        return node;
+    }
+    
+    uint32_t entry = entry_;
+    for (int l = max_level_; l > level; --l) {
+        entry = closest_on_level(vec, norm, entry, l);
+    }
+    
+    for (int l = std::min(level, max_level_); l >= 0; --l) {
+        auto candidates = search_level(vec, norm, entry, static_cast<size_t>(config_.ef_construction), l, nullptr);
+        if (candidates.empty()) {
+            continue;
+        }
+        
+        nodes_[node].links[l] = select_neighbors(candidates, static_cast<size_t>(config_.max_links));
+        
+        // Link back, pruning neighbours that now have too many links
+        for (uint32_t neighbor : nodes_[node].links[l]) {
+            auto& links = nodes_[neighbor].links[l];
+            links.push_back(node);
+            if (links.size() > max_links(l)) {
+                std::vector<Candidate> ranked;
+                ranked.reserve(links.size());
+                for (uint32_t link : links) {
+                    ranked.push_back({distance(vector(neighbor), norms_[neighbor], link), link});
+                }
+                std::sort(ranked.begin(), ranked.end());
+                links = select_neighbors(ranked, max_links(l));
+            }
+        }
+        entry = candidates.front().second;
+    }
+    
+    if (level > max_level_) {
+        entry_ = node;
+        max_level_ = level;
+    }
+    return node;
+}
+
+std::vector<uint32_t> AnnIndex::select_neighbors(const std::vector<Candidate>& sorted, size_t count) const {
+    std::vector<uint32_t> selected;
+    std::vector<uint32_t> skipped;
+    selected.reserve(count);
+    
+    for (const auto& [dist, candidate] : sorted) {
+        if (selected.size() >= count) break;
+        
+        bool diverse = true;
+        for (uint32_t kept : selected) {
+            if (distance(vector(candidate), norms_[candidate], kept) < dist) {
+                diverse = false;
+                break;
+            }
+        }
+        (diverse ? selected : skipped).push_back(candidate);
+    }
+    
+    // Fill up with the closest skipped ones to keep the graph connected
+    for (size_t i = 0; i < skipped.size() && selected.size() < count; ++i) {
+        selected.push_back(skipped[i]);
+    }
+    return selected;
+}
+
+uint32_t AnnIndex::closest_on_level(const float* query, float query_norm, uint32_t entry, int level) const {
+    uint32_t current = entry;
+    float current_dist = distance(query, query_norm, current);
+    
+    bool improved = true;
+    while (improved) {
+        improved = false;
+        for (uint32_t neighbor : nodes_[current].links[level]) {
+            float d = distance(query, query_norm, neighbor);
+            if (d < current_dist) {
+                current_dist = d;
+                current = neighbor;
+                improved = true;
+            }
+        }
+    }
+    return current;
+}
+
+std::vector<AnnIndex::Candidate> AnnIndex::search_level(
+    const float* query, float query_norm, uint32_t entry, size_t ef, int level, const Filter* filter
+) const {
+    auto accepted = [&](uint32_t node) {
+        return !nodes_[node].removed && (!filter || !*filter || (*filter)(nodes_[node].id));
+    };
+    
+    VisitedSet& visited = visited_set();
+    visited.reset(nodes_.size());
+    
+    // Nodes to expand (nearest first) and the best accepted ones (worst on top)
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> to_visit;
+    std::priority_queue<Candidate> best;
+    
+    const float entry_dist = distance(query, query_norm, entry);
+    visited.insert(entry);
+    to_visit.push({entry_dist, entry});
+    if (accepted(entry)) {
+        best.push({entry_dist, entry});
+    }
+    
+    while (!to_visit.empty()) {
+        const Candidate current = to_visit.top();
+        if (best.size() >= ef && current.first > best.top().first) {
+            break;
+        }
+        to_visit.pop();
+        
+        for (uint32_t neighbor : nodes_[current.second].links[level]) {
+            if (!visited.insert(neighbor)) continue;
+            
+            const float d = distance(query, query_norm, neighbor);
+            if (best.size() < ef || d < best.top().first) {
+                // Rejected nodes are still walked through to reach accepted ones
+                to_visit.push({d, neighbor});
+                if (accepted(neighbor)) {
+                    best.push({d, neighbor});
+                    if (best.size() > ef) best.pop();
+                }
+            }
+        }
+    }
+    
+    std::vector<Candidate> results(best.size());
+    for (size_t i = results.size(); i-- > 0;) {
+        results[i] = best.top();
+        best.pop();
+    }
+    return results;
+}
+
+AnnIndex::Results AnnIndex::search(const FeatureMatrix& m, size_t row, size_t k, int ef, const Filter& filter) const {
+    float query[kDims];
+    embed(m, row, query);
+    auto it = by_id_.find(m.id(row));
+    return search_from(query, it != by_id_.end() ? &it->second : nullptr, k, ef, filter);
+}
+
+AnnIndex::Results AnnIndex::search(const float* query, size_t k, int ef, const Filter& filter) const {
+    return search_from(query, nullptr, k, ef, filter);
+}
+
+AnnIndex::Results AnnIndex::search_from(
+    const float* query, const uint32_t* start, size_t k, int ef, const Filter& filter
+) const {
+    Results results;
+    if (k == 0) {
+        return results;
+    }
+    
+    const float query_norm = simd::dot(query, query, kDims);
+    if (max_level_ >= 0) {
+        uint32_t entry = start ? *start : entry_;
+        for (int l = start ? 0 : max_level_; l > 0; --l) {
+            entry = closest_on_level(query, query_norm, entry, l);
+        }
+        
+        const size_t width = std::max(k, static_cast<size_t>(ef > 0 ? ef : config_.ef_search));
+        auto found = search_level(query, query_norm, entry, width, 0, &filter);
+        
+        results.reserve(std::min(k, found.size()) + partial_ids_.size());
+        for (size_t i = 0; i < found.size() && results.size() < k; ++i) {
+            results.push_back({nodes_[found[i].second].id, found[i].first});
+        }
+    }
+    
+    if (partial_ids_.empty()) {
+        return results;
+    }
+    for (size_t i = 0; i < partial_ids_.size(); ++i) {
+        if (filter && !filter(partial_ids_[i])) continue;
+        results.push_back({partial_ids_[i], partial_distance(query, query_norm, i)});
+    }
+    
+    const size_t n = std::min(k, results.size());
+    std::partial_sort(results.begin(), results.begin() + n, results.end(),
+        [](const auto& a, const auto& b) { return a.second < b.second || (a.second == b.second && a.first < b.first); });
+    results.resize(n);
+    return results;
+}
+
+AnnIndex::Results AnnIndex::search_exact(const float* query, size_t k, const Filter& filter) const {
+    const float query_norm = simd::dot(query, query, kDims);
+    Results results;
+    results.reserve(size());
+    for (const auto& [id, node] : by_id_) {
+        if (filter && !filter(id)) continue;
+        results.push_back({id, distance(query, query_norm, node)});
+    }
+    for (size_t i = 0; i < partial_ids_.size(); ++i) {
+        if (filter && !filter(partial_ids_[i])) continue;
+        results.push_back({partial_ids_[i], partial_distance(query, query_norm, i)});
+    }
+    
+    const size_t n = std::min(k, results.size());
+    std::partial_sort(results.begin(), results.begin() + n, results.end(),
+        [](const auto& a, const auto& b) { return a.second < b.second || (a.second == b.second && a.first < b.first); });
+    results.resize(n);
+    return results;
+}
+
+} // namespace automix
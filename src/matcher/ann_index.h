@@ -0,0 +1,155 @@
+/**
+ * AutoMix Engine - Approximate Nearest-Neighbour Index
+ */
+
+#ifndef AUTOMIX_ANN_INDEX_H
+#define AUTOMIX_ANN_INDEX_H
+
+#include "feature_matrix.h"
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace automix {
+
+/**
+ * HNSW graph (Malkov & Yashunin) over each track's timbre and harmony:
+ * its MFCC and chroma vectors, each scaled to unit length and weighted
+ * equally. Nearby tracks in the index are candidates for the full
+ * similarity distance, which still decides their order.
+ *
+ * Tracks missing MFCC or chroma would form clusters the graph cannot route
+ * into, so they are kept out of it in a flat list every search scans (these
+ * are few: tracks whose analysis failed part way).
+ *
+ * Tracks are added incrementally (sync() after a scan) and looked up by
+ * track id. A search may take a filter for exact constraints (BPM, key):
+ * rejected tracks are still walked through but never returned.
+ *
+ * Searches may run concurrently with each other, not with add/remove/sync.
+ */
+class AnnIndex {
+public:
+    struct Config {
+        int max_links = 16;             // M: links per node above layer 0 (2M on layer 0)
+        int ef_construction = 100;      // Candidate list size while inserting
+        int ef_search = 64;             // Default candidate list size while searching
+        uint32_t seed = 42;             // Level assignment (deterministic builds)
+    };
+    
+    // Timbre + chroma embedding, zero padded for the SIMD kernels
+    static constexpr size_t kDims = FeatureMatrix::kMfccStride + FeatureMatrix::kChromaStride;
+    
+    // Return false to leave a track out of the results
+    using Filter = std::function<bool(int64_t track_id)>;
+    
+    // (track id, squared embedding distance), nearest first
+    using Results = std::vector<std::pair<int64_t, float>>;
+    
+    AnnIndex();
+    explicit AnnIndex(const Config& config);
+    
+    /**
+     * Insert the track of matrix row `row`, or replace it if its features
+     * changed.
+     * @return true if a node was inserted
+     */
+    bool add(const FeatureMatrix& m, size_t row);
+    
+    /**
+     * Remove a track; its node stays in the graph for routing (removed and
+     * replaced tracks are never returned).
+     */
+    void remove(int64_t track_id);
+    
+    /**
+     * Bring the index in line with a new snapshot of the library: add new
+     * tracks, re-add tracks whose features changed, remove missing ones.
+     * @return Number of tracks added or re-added
+     */
+    size_t sync(const FeatureMatrix& m);
+    
+    /**
+     * The k tracks nearest to row `row` of a matrix (the track itself
+     * included if indexed), with at least `ef` candidates examined
+     * (0 = Config::ef_search). Higher ef raises recall and latency.
+     * An indexed track is its own entry point (no descent from the top).
+     */
+    Results search(const FeatureMatrix& m, size_t row, size_t k, int ef = 0, const Filter& filter = Filter()) const;
+    
+    /**
+     * Search with an embedding from embed().
+     */
+    Results search(const float* query, size_t k, int ef = 0, const Filter& filter = Filter()) const;
+    
+    /**
+     * Exact k nearest tracks by embedding distance (for measuring recall).
+     */
+    Results search_exact(const float* query, size_t k, const Filter& filter = Filter()) const;
+    
+    /**
+     * Embedding of a matrix row: kDims floats.
+     */
+    static void embed(const FeatureMatrix& m, size_t row, float* out);
+    
+    size_t size() const { return live_ + partial_ids_.size(); }
+    bool contains(int64_t track_id) const { return by_id_.count(track_id) > 0 || partial_by_id_.count(track_id) > 0; }
+    
+    void set_ef_search(int ef) { config_.ef_search = ef; }
+    const Config& config() const { return config_; }
+
+private:
+    using Candidate = std::pair<float, uint32_t>;  // (distance, node)
+    
+    struct Node {
+        int64_t id = 0;
+        bool removed = false;
+        std::vector<std::vector<uint32_t>> links;  // Per level, 0 = densest
+    };
+    
+    Config config_;
+    std::vector<Node> nodes_;
+    std::vector<float> vectors_;        // nodes_.size() * kDims
+    std::vector<float> norms_;          // Squared length of each vector
+    std::unordered_map<int64_t, uint32_t> by_id_;
+    uint32_t entry_ = 0;
+    int max_level_ = -1;
+    size_t live_ = 0;
+    std::mt19937 rng_;
+    
+    // Tracks kept out of the graph
+    std::vector<int64_t> partial_ids_;
+    std::vector<float> partial_vectors_;   // partial_ids_.size() * kDims
+    std::unordered_map<int64_t, size_t> partial_by_id_;
+    
+    static bool is_complete(const FeatureMatrix& m, size_t row);
+    const float* stored_vector(int64_t id) const;
+    
+    const float* vector(uint32_t node) const { return &vectors_[static_cast<size_t>(node) * kDims]; }
+    float distance(const float* query, float query_norm, uint32_t node) const;
+    float partial_distance(const float* query, float query_norm, size_t i) const;
+    
+    uint32_t insert(int64_t id, const float* vec);
+    int random_level();
+    size_t max_links(int level) const;
+    
+    Results search_from(const float* query, const uint32_t* start, size_t k, int ef, const Filter& filter) const;
+    
+    // Greedy descent on one upper layer
+    uint32_t closest_on_level(const float* query, float query_norm, uint32_t entry, int level) const;
+    
+    // Best-first search of one layer; results sorted nearest first
+    std::vector<Candidate> search_level(const float* query, float query_norm, uint32_t entry, size_t ef,
+                                        int level, const Filter* filter) const;
+    
+    // Keep up to `count` candidates that are not closer to an already kept
+    // one than to the base (HNSW neighbour heuristic)
+    std::vector<uint32_t> select_neighbors(const std::vector<Candidate>& sorted, size_t count) const;
+};
+
+} // namespace automix
+
+#endif // AUTOMIX_ANN_INDEX_H
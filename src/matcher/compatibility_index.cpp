@@ -0,0 +1,138 @@
+/**
+ * AutoMix Engine - BPM/Key Compatibility Index Implementation
+ */
+
+#include "compatibility_index.h"
+#include "../core/utils.h"
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <limits>
+
+namespace automix {
+
+namespace {
+
+// Widening of the BPM bounds (log2 units) so float rounding never drops a
+// track the exact check would accept
+constexpr float kBpmSlack = 1e-4f;
+
+struct BpmRange {
+    float lo;
+    float hi;
+};
+
+} // namespace
+
+CompatibilityIndex::CompatibilityIndex(const FeatureMatrix& m) {
+    build(m);
+}
+
+void CompatibilityIndex::build(const FeatureMatrix& m) {
+    for (auto& bucket : buckets_) {
+        bucket.by_bpm.clear();
+        bucket.unknown_bpm.clear();
+    }
+    
+    for (size_t row = 0; row < m.size(); ++row) {
+        Bucket& bucket = buckets_[bucket_of(m.key(row))];
+        const float bpm = m.bpm(row);
+        if (bpm > 0) {
+            bucket.by_bpm.push_back({std::log2(bpm), static_cast<uint32_t>(row)});
+        } else {
+            bucket.unknown_bpm.push_back(static_cast<uint32_t>(row));
+        }
+    }
+    
+    for (auto& bucket : buckets_) {
+        std::sort(bucket.by_bpm.begin(), bucket.by_bpm.end(), [](const Entry& a, const Entry& b) {
+            return a.log_bpm < b.log_bpm || (a.log_bpm == b.log_bpm && a.row < b.row);
+        });
+    }
+    size_ = m.size();
+}
+
+float CompatibilityIndex::bpm_tolerance(const PlaylistRules& rules) {
+    float tolerance = rules.bpm_tolerance > 0 ? rules.bpm_tolerance : 0.0f;
+    if (rules.bpm_step_limit > 0) {
+        const float step = rules.bpm_step_limit / 100.0f;
+        tolerance = tolerance > 0 ? std::min(tolerance, step) : step;
+    }
+    return tolerance;
+}
+
+bool CompatibilityIndex::key_rule_active(const PlaylistRules& rules) {
+    // Camelot distances never exceed 7, so larger limits allow any key
+    return !rules.allow_key_change || (rules.max_key_distance > 0 && rules.max_key_distance < 7);
+}
+
+bool CompatibilityIndex::key_allowed(KeyCode current, KeyCode key, const PlaylistRules& rules) {
+    const int dist = utils::camelot_distance(current, key);
+    if (!rules.allow_key_change) {
+        return dist == 0;
+    }
+    return rules.max_key_distance <= 0 || dist <= rules.max_key_distance;
+}
+
+bool CompatibilityIndex::narrows(const PlaylistRules& rules) {
+    return bpm_tolerance(rules) > 0 || key_rule_active(rules);
+}
+
+void CompatibilityIndex::candidates(
+    const FeatureMatrix& m,
+    size_t current,
+    const PlaylistRules& rules,
+    std::vector<size_t>& out
+) const {
+    const float bpm = m.bpm(current);
+    const KeyCode key = m.key(current);
+    const float tolerance = bpm > 0 ? bpm_tolerance(rules) : 0.0f;
+    const bool by_key = key != kUnknownKey && key_rule_active(rules);
+    
+    // BPM windows around the current tempo and its half/double-time aliases:
+    // |c - bpm / other| <= t  <=>  bpm / (c + t) <= other <= bpm / (c - t)
+    BpmRange ranges[3];
+    int range_count = 0;
+    if (tolerance > 0) {
+        const float log_bpm = std::log2(bpm);
+        for (float c : {2.0f, 1.0f, 0.5f}) {
+            BpmRange range;
+            range.lo = log_bpm - std::log2(c + tolerance) - kBpmSlack;
+            range.hi = c > tolerance ? log_bpm - std::log2(c - tolerance) + kBpmSlack
+                                     : std::numeric_limits<float>::infinity();
+            
+            // Ascending by lo; merge overlaps so no row is listed twice
+            if (range_count > 0 && range.lo <= ranges[range_count - 1].hi) {
+                ranges[range_count - 1].hi = std::max(ranges[range_count - 1].hi, range.hi);
+            } else {
+                ranges[range_count++] = range;
+            }
+        }
+    }
+    
+    for (int b = 0; b < kKeyBuckets; ++b) {
+        if (by_key && b != kKeyBuckets - 1 && !key_allowed(key, static_cast<KeyCode>(b), rules)) {
+            continue;
+        }
+        
+        const Bucket& bucket = buckets_[b];
+        out.insert(out.end(), bucket.unknown_bpm.begin(), bucket.unknown_bpm.end());
+        
+        if (range_count == 0) {
+            for (const Entry& entry : bucket.by_bpm) {
+                out.push_back(entry.row);
+            }
+            continue;
+        }
+        
+        for (int r = 0; r < range_count; ++r) {
+            auto it = std::lower_bound(bucket.by_bpm.begin(), bucket.by_bpm.end(), ranges[r].lo,
+                [](const Entry& entry, float value) { return entry.log_bpm < value; });
+            for (; it != bucket.by_bpm.end() && it->log_bpm <= ranges[r].hi; ++it) {
+                out.push_back(it->row);
+            }
+        }
+    }
+}
+
+} // namespace automix
@@ -0,0 +1,82 @@
+/**
+ * AutoMix Engine - BPM/Key Compatibility Index
+ */
+
+#ifndef AUTOMIX_COMPATIBILITY_INDEX_H
+#define AUTOMIX_COMPATIBILITY_INDEX_H
+
+#include "automix/types.h"
+#include "feature_matrix.h"
+#include <cstdint>
+#include <vector>
+
+namespace automix {
+
+/**
+ * Buckets the rows of a feature matrix by key code and, within each key,
+ * sorts them by log-BPM, so the tracks a PlaylistRules BPM tolerance and key
+ * rule can accept are listed from a few binary searches instead of a scan.
+ *
+ * BPM tolerance follows utils::bpm_distance: half- and double-time tracks
+ * are found by searching the same bucket one octave (log2 = 1) down and up.
+ * Tracks with an unknown BPM or key pass those rules and are always listed.
+ *
+ * The listing is a superset: energy rules are not applied and bounds are
+ * widened slightly, so callers still check each track exactly.
+ */
+class CompatibilityIndex {
+public:
+    CompatibilityIndex() = default;
+    explicit CompatibilityIndex(const FeatureMatrix& m);
+    
+    /**
+     * Index every row of a matrix, replacing the previous contents.
+     */
+    void build(const FeatureMatrix& m);
+    
+    size_t size() const { return size_; }
+    
+    /**
+     * Whether the rules restrict BPM or key at all; if not, listing
+     * returns every track and a plain scan is as good.
+     */
+    static bool narrows(const PlaylistRules& rules);
+    
+    /**
+     * Append to `out` the rows whose BPM and key may pass `rules` (including
+     * bpm_step_limit) against row `current` of the indexed matrix.
+     * Rows are grouped by key, not sorted.
+     */
+    void candidates(const FeatureMatrix& m, size_t current, const PlaylistRules& rules,
+                    std::vector<size_t>& out) const;
+
+private:
+    static constexpr int kKeyBuckets = 25;          // 24 key codes, then unknown
+    
+    struct Entry {
+        float log_bpm;                              // log2(bpm)
+        uint32_t row;
+    };
+    
+    struct Bucket {
+        std::vector<Entry> by_bpm;                  // Sorted by log_bpm
+        std::vector<uint32_t> unknown_bpm;
+    };
+    
+    Bucket buckets_[kKeyBuckets];
+    size_t size_ = 0;
+    
+    static int bucket_of(KeyCode key) { return key == kUnknownKey ? kKeyBuckets - 1 : key; }
+    
+    // Largest bpm_distance the rules allow; 0 = any
+    static float bpm_tolerance(const PlaylistRules& rules);
+    
+    // Whether the key rule lets `key` follow `current` (both known)
+    static bool key_allowed(KeyCode current, KeyCode key, const PlaylistRules& rules);
+    
+    static bool key_rule_active(const PlaylistRules& rules);
+};
+
+} // namespace automix
+
+#endif // AUTOMIX_COMPATIBILITY_INDEX_H
@@ -0,0 +1,142 @@
+/**
+ * AutoMix Engine - Columnar Track Feature Matrix Implementation
+ */
+
+#include "feature_matrix.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <numeric>
+
+namespace automix {
+
+FeatureMatrix::FeatureMatrix(const std::vector<TrackInfo>& tracks) {
+    reserve(tracks.size());
+    for (const auto& track : tracks) {
+        append(track);
+    }
+}
+
+void FeatureMatrix::reserve(size_t count) {
+    ids_.reserve(count);
+    bpm_.reserve(count);
+    key_.reserve(count);
+    duration_.reserve(count);
+    mean_energy_.reserve(count);
+    flags_.reserve(count);
+    mfcc_.reserve(count * kMfccStride);
+    chroma_.reserve(count * kChromaStride);
+    energy_.reserve(count * kEnergyStride);
+    mfcc_norm_.reserve(count);
+    chroma_norm_.reserve(count);
+    energy_stats_.reserve(count);
+    index_.reserve(count);
+}
+
+size_t FeatureMatrix::append(const TrackInfo& track) {
+    const size_t row = ids_.size();
+    uint8_t flags = 0;
+    
+    ids_.push_back(track.id);
+    bpm_.push_back(track.bpm);
+    key_.push_back(track.key);
+    duration_.push_back(track.duration);
+    
+    float mean = 0.5f;
+    if (!track.energy_curve.empty()) {
+        float sum = std::accumulate(track.energy_curve.begin(), track.energy_curve.end(), 0.0f);
+        mean = sum / track.energy_curve.size();
+    }
+    mean_energy_.push_back(mean);
+    
+    auto norm = [](const std::vector<float>& v) {
+        float sq = 0.0f;
+        for (float x : v) sq += x * x;
+        return std::sqrt(sq);
+    };
+    
+    mfcc_.resize(mfcc_.size() + kMfccStride, 0.0f);
+    float mfcc_norm = 0.0f;
+    if (track.mfcc.size() == kMfccDims) {
+        std::copy(track.mfcc.begin(), track.mfcc.end(), &mfcc_[row * kMfccStride]);
+        mfcc_norm = norm(track.mfcc);
+        flags |= kHasMfcc;
+    }
+    mfcc_norm_.push_back(mfcc_norm);
+    
+    chroma_.resize(chroma_.size() + kChromaStride, 0.0f);
+    float chroma_norm = 0.0f;
+    if (track.chroma.size() == kChromaDims) {
+        std::copy(track.chroma.begin(), track.chroma.end(), &chroma_[row * kChromaStride]);
+        chroma_norm = norm(track.chroma);
+        flags |= kHasChroma;
+    }
+    chroma_norm_.push_back(chroma_norm);
+    
+    energy_.resize(energy_.size() + kEnergyStride, 0.0f);
+    EnergyStats stats;
+    if (!track.energy_curve.empty()) {
+        float* e = &energy_[row * kEnergyStride];
+        resample_energy(track.energy_curve, e);
+        
+        // Segment statistics as SimilarityCalculator computes them per pair
+        const size_t seg_len = kEnergyPoints / kEnergySegments;
+        for (size_t s = 0; s < kEnergySegments; ++s) {
+            size_t start = s * seg_len;
+            size_t end = (s == kEnergySegments - 1) ? kEnergyPoints : (s + 1) * seg_len;
+            float sum = 0, sq = 0;
+            for (size_t i = start; i < end; ++i) {
+                sum += e[i];
+                sq += e[i] * e[i];
+            }
+            const size_t count = end - start;
+            float seg_mean = sum / count;
+            stats.segment_mean[s] = seg_mean;
+            stats.segment_std[s] = std::sqrt(std::max(0.0f, sq / count - seg_mean * seg_mean));
+        }
+        
+        // Centered once so the correlation needs one dot product per pair
+        float curve_mean = 0;
+        for (size_t i = 0; i < kEnergyPoints; ++i) {
+            curve_mean += e[i];
+        }
+        curve_mean /= kEnergyPoints;
+        float var = 0;
+        for (size_t i = 0; i < kEnergyPoints; ++i) {
+            e[i] -= curve_mean;
+            var += e[i] * e[i];
+        }
+        stats.norm = std::sqrt(var);
+        flags |= kHasEnergy;
+    }
+    energy_stats_.push_back(stats);
+    
+    flags_.push_back(flags);
+    index_[track.id] = row;
+    return row;
+}
+
+std::optional<size_t> FeatureMatrix::index_of(int64_t id) const {
+    auto it = index_.find(id);
+    if (it == index_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+void FeatureMatrix::resample_energy(const std::vector<float>& curve, float* out) {
+    const size_t len = kEnergyPoints;
+    if (curve.size() <= 1) {
+        std::fill(out, out + len, curve.empty() ? 0.0f : curve[0]);
+        return;
+    }
+    for (size_t i = 0; i < len; ++i) {
+        float src_idx = static_cast<float>(i) * (curve.size() - 1) / (len - 1);
+        size_t idx0 = static_cast<size_t>(src_idx);
+        size_t idx1 = std::min(idx0 + 1, curve.size() - 1);
+        float frac = src_idx - idx0;
+        out[i] = curve[idx0] * (1.0f - frac) + curve[idx1] * frac;
+    }
+}
+
+} // namespace automix
@@ -0,0 +1,125 @@
+/**
+ * AutoMix Engine - Columnar Track Feature Matrix
+ */
+
+#ifndef AUTOMIX_FEATURE_MATRIX_H
+#define AUTOMIX_FEATURE_MATRIX_H
+
+#include "automix/types.h"
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace automix {
+
+/**
+ * Structure-of-arrays snapshot of the features similarity and playlist
+ * generation need, one row per track addressed by a dense index.
+ *
+ * Vector features are stored in fixed-width rows of one contiguous array
+ * each, zero padded to a multiple of 8 floats for the SIMD kernels, with
+ * the per-track terms of the distance (norms, energy statistics)
+ * precomputed. Comparing tracks then touches no heap allocations and
+ * leaves only dot products per pair. Beats and paths are not kept:
+ * transition planning loads the few tracks it needs in full.
+ */
+class FeatureMatrix {
+public:
+    static constexpr size_t kMfccDims = 13;
+    static constexpr size_t kChromaDims = 12;
+    static constexpr size_t kEnergyPoints = 100;
+    static constexpr size_t kEnergySegments = 5;
+    
+    // Row widths in floats (padding is zero)
+    static constexpr size_t kMfccStride = 16;
+    static constexpr size_t kChromaStride = 16;
+    static constexpr size_t kEnergyStride = 104;
+    
+    /**
+     * Per-track terms of the energy distance.
+     */
+    struct EnergyStats {
+        float norm = 0.0f;                          // sqrt(sum((e - mean)^2)) of the resampled curve
+        float segment_mean[kEnergySegments] = {};
+        float segment_std[kEnergySegments] = {};
+    };
+    
+    FeatureMatrix() = default;
+    explicit FeatureMatrix(const std::vector<TrackInfo>& tracks);
+    
+    /**
+     * Add a track's features.
+     * Vectors of another width than the matrix stores count as missing.
+     * @return Index of the new row
+     */
+    size_t append(const TrackInfo& track);
+    
+    void reserve(size_t count);
+    size_t size() const { return ids_.size(); }
+    bool empty() const { return ids_.empty(); }
+    
+    /**
+     * Row of a track id, if present.
+     */
+    std::optional<size_t> index_of(int64_t id) const;
+    
+    // Whether some id has several rows (index_of() gives the last one)
+    bool has_duplicate_ids() const { return index_.size() != ids_.size(); }
+    
+    int64_t id(size_t i) const { return ids_[i]; }
+    float bpm(size_t i) const { return bpm_[i]; }
+    KeyCode key(size_t i) const { return key_[i]; }
+    float duration(size_t i) const { return duration_[i]; }
+    
+    // Mean of the raw energy curve (0.5 without one)
+    float mean_energy(size_t i) const { return mean_energy_[i]; }
+    
+    // Fixed-width rows; nullptr when the track has no such feature
+    const float* mfcc(size_t i) const { return has(i, kHasMfcc) ? &mfcc_[i * kMfccStride] : nullptr; }
+    const float* chroma(size_t i) const { return has(i, kHasChroma) ? &chroma_[i * kChromaStride] : nullptr; }
+    
+    // Energy curve resampled to kEnergyPoints, minus its mean
+    const float* energy(size_t i) const { return has(i, kHasEnergy) ? &energy_[i * kEnergyStride] : nullptr; }
+    
+    float mfcc_norm(size_t i) const { return mfcc_norm_[i]; }
+    float chroma_norm(size_t i) const { return chroma_norm_[i]; }
+    const EnergyStats& energy_stats(size_t i) const { return energy_stats_[i]; }
+    
+    // Whole columns for the batched kernels
+    const float* mfcc_rows() const { return mfcc_.data(); }
+    const float* chroma_rows() const { return chroma_.data(); }
+    const float* energy_rows() const { return energy_.data(); }
+    
+    /**
+     * Linearly resample an energy curve to kEnergyPoints values.
+     */
+    static void resample_energy(const std::vector<float>& curve, float* out);
+
+private:
+    enum : uint8_t {
+        kHasMfcc = 1 << 0,
+        kHasChroma = 1 << 1,
+        kHasEnergy = 1 << 2,
+    };
+    
+    bool has(size_t i, uint8_t flag) const { return (flags_[i] & flag) != 0; }
+    
+    std::vector<int64_t> ids_;
+    std::vector<float> bpm_;
+    std::vector<KeyCode> key_;
+    std::vector<float> duration_;
+    std::vector<float> mean_energy_;
+    std::vector<uint8_t> flags_;
+    std::vector<float> mfcc_;           // size() * kMfccStride
+    std::vector<float> chroma_;         // size() * kChromaStride
+    std::vector<float> energy_;         // size() * kEnergyStride
+    std::vector<float> mfcc_norm_;
+    std::vector<float> chroma_norm_;
+    std::vector<EnergyStats> energy_stats_;
+    std::unordered_map<int64_t, size_t> index_;
+};
+
+} // namespace automix
+
+#endif // AUTOMIX_FEATURE_MATRIX_H
@@ -5,9 +5,11 @@
 #include "playlist.h"
 #include "../core/utils.h"
 #include <algorithm>
-#include <unordered_set>
+#include <unordered_map>
 #include <numeric>
+#include <chrono>
 #include <cmath>
+#include <limits>
 
 namespace automix {
 
@@ -22,95 +24,282 @@ Playlist PlaylistGenerator::generate(
     const PlaylistRules& rules,
     const TransitionConfig& config
 ) {
-    Playlist playlist;
-    
-    // Configure similarity calculator with rules weights
-    similarity_.set_weights(rules.weights);
+    // The seed gets its own (last) row, so its id resolves to it
+    FeatureMatrix library;
+    library.reserve(candidates.size() + 1);
+    for (const auto& track : candidates) {
+        library.append(track);
+    }
+    size_t seed_row = library.append(seed);
     
-    // Initialize RNG with seed for reproducibility (if specified)
-    if (rules.random_seed != 0) {
-        rng_.seed(rules.random_seed);
+    std::unordered_map<int64_t, const TrackInfo*> by_id;
+    for (const auto& track : candidates) {
+        by_id.emplace(track.id, &track);
     }
+    by_id[seed.id] = &seed;
     
-    // Track which songs we've used
-    std::unordered_set<int64_t> used_ids;
+    return generate(library, seed_row, count, rules, config, [&by_id](int64_t id) -> std::optional<TrackInfo> {
+        auto it = by_id.find(id);
+        if (it == by_id.end()) return std::nullopt;
+        return *it->second;
+    });
+}
+
+Playlist PlaylistGenerator::generate(
+    const FeatureMatrix& library,
+    size_t seed,
+    int count,
+    const PlaylistRules& rules,
+    const TransitionConfig& config,
+    const TrackLoader& load_track
+) {
+    Playlist playlist;
+    const auto started = std::chrono::steady_clock::now();
     
-    // Recent tracks window for variety scoring
-    std::deque<TrackInfo> recent_tracks;
+    std::optional<TrackInfo> current_track = load_track(library.id(seed));
+    if (!current_track) {
+        return playlist;
+    }
+    
+    start(library, seed, rules, count);
     
     // Start with seed
     PlaylistEntry seed_entry;
-    seed_entry.track_id = seed.id;
+    seed_entry.track_id = library.id(seed);
     playlist.entries.push_back(seed_entry);
-    used_ids.insert(seed.id);
-    recent_tracks.push_back(seed);
-    
-    // Build available pool (excluding seed)
-    std::vector<TrackInfo> available;
-    available.reserve(candidates.size());
-    for (const auto& track : candidates) {
-        if (track.id != seed.id) {
-            available.push_back(track);
-        }
-    }
-    
-    // Generate playlist
-    TrackInfo current = seed;
     
-    while (static_cast<int>(playlist.entries.size()) < count && !available.empty()) {
-        float progress = static_cast<float>(playlist.entries.size()) / static_cast<float>(count);
-        
-        auto next_opt = select_next(current, available, rules, progress, recent_tracks, count);
-        
-        if (!next_opt) {
-            // No compatible track found, relax constraints and try again
-            PlaylistRules relaxed = rules;
-            relaxed.bpm_tolerance = 0;  // Allow any BPM
-            relaxed.max_key_distance = 12;  // Allow any key
-            relaxed.allow_key_change = true;
-            relaxed.min_energy_match = 0;
-            relaxed.bpm_step_limit = 0;
-            
-            next_opt = select_next(current, available, relaxed, progress, recent_tracks, count);
-            
-            if (!next_opt) {
-                break;  // Really no tracks left
-            }
+    // Append a track with the transition from the current one; false if it
+    // is gone from the library since the matrix was built
+    auto append = [&](size_t next) {
+        const int64_t next_id = library.id(next);
+        std::optional<TrackInfo> next_track = load_track(next_id);
+        if (!next_track) {
+            return false;
         }
         
-        const TrackInfo& next = *next_opt;
-        
         // Create transition plan
-        auto plan = transition_finder_.create_plan(current, next, config);
+        auto plan = transition_finder_.create_plan(*current_track, *next_track, config);
         
         // Update previous entry with transition
         playlist.entries.back().transition_to_next = plan;
         
         // Add new entry
         PlaylistEntry entry;
-        entry.track_id = next.id;
+        entry.track_id = next_id;
         playlist.entries.push_back(entry);
         
-        // Update state
-        used_ids.insert(next.id);
-        available.erase(
-            std::remove_if(available.begin(), available.end(),
-                [&used_ids](const TrackInfo& t) { return used_ids.count(t.id) > 0; }),
-            available.end()
-        );
-        
-        current = next;
+        current_track = std::move(next_track);
+        return true;
+    };
+    
+    if (rules.beam_width > 0) {
+        auto deadline = std::chrono::steady_clock::time_point::max();
+        if (rules.beam_time_limit > 0) {
+            deadline = started + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<float>(rules.beam_time_limit));
+        }
         
-        // Maintain recent tracks window (keep last 5)
-        recent_tracks.push_back(next);
-        if (recent_tracks.size() > 5) {
-            recent_tracks.pop_front();
+        // Tracks that fail to load and positions past the beam pool are
+        // filled by the greedy walk below, from the last track appended
+        for (size_t next : plan_sequence(library, seed, walk_.available, count, rules, deadline)) {
+            take(walk_.available, next);
+            if (append(next)) {
+                accept(next);
+            }
+        }
+    }
+    
+    // Generate playlist (or complete a planned one)
+    while (static_cast<int>(playlist.entries.size()) < count) {
+        auto next = next_track();
+        if (!next) {
+            break;  // Really no tracks left
+        }
+        if (append(*next)) {
+            accept(*next);
         }
     }
     
     return playlist;
 }
 
+void PlaylistGenerator::start(
+    const FeatureMatrix& library,
+    size_t seed,
+    const PlaylistRules& rules,
+    int arc_length,
+    size_t repeat_after
+) {
+    // Configure similarity calculator with rules weights
+    similarity_.set_weights(rules.weights);
+    
+    // Initialize RNG with seed for reproducibility (if specified)
+    if (rules.random_seed != 0) {
+        rng_.seed(rules.random_seed);
+    }
+    
+    walk_.library = &library;
+    walk_.rules = rules;
+    walk_.current = seed;
+    walk_.position = 1;
+    walk_.arc_length = std::max(1, arc_length);
+    walk_.repeat_after = repeat_after;
+    
+    // Recent tracks window for variety scoring
+    walk_.recent.assign(1, seed);
+    walk_.played.assign(1, seed);
+    for (auto& column : recent_distances_) {
+        column.row = SIZE_MAX;  // Library or weights may have changed
+    }
+    
+    // Build available pool (excluding seed); a duplicated id is offered
+    // once, with the row it resolves to
+    std::vector<size_t>& available = walk_.available;
+    available.clear();
+    available.reserve(library.size());
+    available_slot_.assign(library.size(), kNotAvailable);
+    const bool duplicates = library.has_duplicate_ids();
+    for (size_t i = 0; i < library.size(); ++i) {
+        if (library.id(i) == library.id(seed) || (duplicates && library.index_of(library.id(i)) != i)) {
+            continue;
+        }
+        available_slot_[i] = static_cast<uint32_t>(available.size());
+        available.push_back(i);
+    }
+    compatible_.reserve(available.size());
+    distances_.reserve(available.size());
+    scored_.reserve(available.size());
+}
+
+std::optional<size_t> PlaylistGenerator::next_track() {
+    if (!walk_.library || walk_.available.empty()) {
+        return std::nullopt;
+    }
+    
+    const FeatureMatrix& library = *walk_.library;
+    const PlaylistRules& rules = walk_.rules;
+    const size_t step = walk_.position % static_cast<size_t>(walk_.arc_length);
+    float progress = static_cast<float>(step) / static_cast<float>(walk_.arc_length);
+    
+    auto next = select_next(library, walk_.current, walk_.available, rules, progress, walk_.recent, walk_.arc_length);
+    
+    if (!next) {
+        // No compatible track found, relax constraints and try again
+        PlaylistRules relaxed = rules;
+        relaxed.bpm_tolerance = 0;  // Allow any BPM
+        relaxed.max_key_distance = 12;  // Allow any key
+        relaxed.allow_key_change = true;
+        relaxed.min_energy_match = 0;
+        relaxed.bpm_step_limit = 0;
+        
+        next = select_next(library, walk_.current, walk_.available, relaxed, progress, walk_.recent, walk_.arc_length);
+    }
+    
+    if (next) {
+        take(walk_.available, *next);
+    }
+    return next;
+}
+
+void PlaylistGenerator::accept(size_t row) {
+    walk_.current = row;
+    walk_.position++;
+    
+    // Maintain recent tracks window (keep last 5)
+    walk_.recent.push_back(row);
+    if (walk_.recent.size() > 5) {
+        walk_.recent.pop_front();
+    }
+    
+    // Offer the track played repeat_after tracks ago again
+    if (walk_.repeat_after > 0) {
+        walk_.played.push_back(row);
+        if (walk_.played.size() > walk_.repeat_after) {
+            const size_t back = walk_.played.front();
+            walk_.played.pop_front();
+            available_slot_[back] = static_cast<uint32_t>(walk_.available.size());
+            walk_.available.push_back(back);
+        }
+    }
+}
+
+void PlaylistGenerator::take(std::vector<size_t>& available, size_t row) {
+    // Swap with the last available track
+    const uint32_t slot = available_slot_[row];
+    const size_t last = available.back();
+    available[slot] = last;
+    available_slot_[last] = slot;
+    available.pop_back();
+    available_slot_[row] = kNotAvailable;
+}
+
+void PlaylistGenerator::set_candidate_index(const AnnIndex* index, size_t candidates) {
+    candidate_index_ = index;
+    index_candidates_ = std::max<size_t>(1, candidates);
+}
+
+void PlaylistGenerator::set_compatibility_index(const CompatibilityIndex* index) {
+    compatibility_index_ = index;
+}
+
+void PlaylistGenerator::set_threads(int threads) {
+    threads_ = std::max(0, threads);
+    pool_.reset();
+}
+
+ThreadPool& PlaylistGenerator::pool() {
+    if (!pool_) {
+        pool_ = std::make_unique<ThreadPool>(threads_);
+    }
+    return *pool_;
+}
+
+std::vector<size_t> PlaylistGenerator::plan_sequence(
+    const FeatureMatrix& library,
+    size_t seed,
+    const std::vector<size_t>& available,
+    int count,
+    const PlaylistRules& rules,
+    std::chrono::steady_clock::time_point deadline
+) {
+    // The seed and the available tracks nearest to it (ties by row)
+    std::vector<size_t> rows = available;
+    if (rows.size() > kBeamPool - 1) {
+        distances_.resize(rows.size());
+        similarity_.distances(library, seed, rows.data(), rows.size(), distances_.data());
+        std::vector<std::pair<float, size_t>> nearest(rows.size());
+        for (size_t k = 0; k < rows.size(); ++k) {
+            nearest[k] = {distances_[k], rows[k]};
+        }
+        std::nth_element(nearest.begin(), nearest.begin() + (kBeamPool - 1), nearest.end());
+        for (size_t k = 0; k < kBeamPool - 1; ++k) {
+            rows[k] = nearest[k].second;
+        }
+        rows.resize(kBeamPool - 1);
+    }
+    std::sort(rows.begin(), rows.end());
+    rows.insert(rows.begin(), seed);
+    
+    optimizer_.prepare(library, similarity_, std::move(rows), [&](size_t from, size_t to) {
+        return is_candidate(library, from, to, rules);
+    }, &pool());
+    
+    const size_t length = count > 1 ? static_cast<size_t>(count - 1) : 0;
+    std::vector<float> target_energy;
+    if (rules.energy_arc != EnergyArc::None) {
+        for (size_t position = 1; position <= length; ++position) {
+            float progress = static_cast<float>(position) / static_cast<float>(count);
+            target_energy.push_back(target_energy_for_progress(rules.energy_arc, progress));
+        }
+    }
+    
+    SequenceOptimizer::Options options;
+    options.width = rules.beam_width;
+    options.depth = rules.beam_depth;
+    options.deadline = deadline;
+    return optimizer_.optimize(length, target_energy, options, &pool());
+}
+
 Playlist PlaylistGenerator::create_with_transitions(
     const std::vector<TrackInfo>& tracks,
     const TransitionConfig& config
@@ -137,89 +326,199 @@ Playlist PlaylistGenerator::create_with_transitions(
 // Comprehensive candidate scoring
 // ============================================================================
 
-std::optional<TrackInfo> PlaylistGenerator::select_next(
-    const TrackInfo& current,
-    const std::vector<TrackInfo>& available,
+std::optional<size_t> PlaylistGenerator::select_next(
+    const FeatureMatrix& library,
+    size_t current,
+    const std::vector<size_t>& available,
     const PlaylistRules& rules,
     float progress,
-    const std::deque<TrackInfo>& recent_tracks,
+    const std::deque<size_t>& recent_tracks,
     int target_count
 ) {
     if (available.empty()) {
         return std::nullopt;
     }
     
+    compatible_.clear();
+    
+    // Tracks within the BPM and key rules, from the buckets
+    const bool listed = compatibility_index_ && CompatibilityIndex::narrows(rules);
+    if (listed) {
+        listed_.clear();
+        compatibility_index_->candidates(library, current, rules, listed_);
+    }
+    
+    // Nearest compatible tracks from the index, when it saves work: a graph
+    // search slows down as the filter rejects more, so with selective rules
+    // the listed tracks are scored directly
+    const bool selective = listed && listed_.size() * 2 < available.size();
+    if (candidate_index_ && available.size() > index_candidates_ && !selective) {
+        auto found = candidate_index_->search(library, current, index_candidates_,
+            static_cast<int>(index_candidates_), [&](int64_t id) {
+                auto row = library.index_of(id);
+                return row && is_available(*row) && is_candidate(library, current, *row, rules);
+            });
+        for (const auto& result : found) {
+            compatible_.push_back(*library.index_of(result.first));
+        }
+    }
+    
     // Filter compatible tracks
-    std::vector<TrackInfo> compatible;
-    for (const auto& track : available) {
-        if (similarity_.are_compatible(current, track, rules)) {
-            // Additional BPM step limit check
-            if (rules.bpm_step_limit > 0 && current.bpm > 0 && track.bpm > 0) {
-                float bpm_diff = utils::bpm_distance(current.bpm, track.bpm);
-                if (bpm_diff > rules.bpm_step_limit / 100.0f) {
-                    continue;
-                }
+    if (compatible_.empty() && listed) {
+        for (size_t track : listed_) {
+            if (is_available(track) && is_candidate(library, current, track, rules)) {
+                compatible_.push_back(track);
+            }
+        }
+    } else if (compatible_.empty()) {
+        for (size_t track : available) {
+            if (is_candidate(library, current, track, rules)) {
+                compatible_.push_back(track);
             }
-            compatible.push_back(track);
         }
     }
     
-    if (compatible.empty()) {
+    if (compatible_.empty()) {
         return std::nullopt;
     }
     
-    // Score all compatible tracks
-    std::vector<std::pair<TrackInfo, float>> scored;
-    scored.reserve(compatible.size());
+    // Higher score first; equal scores by row, so neither the order of the
+    // candidates nor the chunking changes the pick
+    auto better = [](const std::pair<size_t, float>& a, const std::pair<size_t, float>& b) {
+        return a.second > b.second || (a.second == b.second && a.first < b.first);
+    };
+    
+    // Score all compatible tracks in fixed chunks, with their distances from
+    // the current track computed in one batch per chunk. Each chunk moves its
+    // best kPickFrom to its front.
+    const size_t n = compatible_.size();
+    const size_t chunks = (n + kScoreChunk - 1) / kScoreChunk;
+    distances_.resize(n);
+    scored_.resize(n);
+    prepare_recent_distances(library, recent_tracks);
     
-    for (const auto& candidate : compatible) {
-        float score = score_candidate(current, candidate, rules, progress, recent_tracks, target_count);
-        scored.push_back({candidate, score});
+    auto score_chunk = [&](size_t chunk) {
+        const size_t begin = chunk * kScoreChunk;
+        const size_t end = std::min(n, begin + kScoreChunk);
+        similarity_.distances(library, current, compatible_.data() + begin, end - begin, distances_.data() + begin);
+        for (size_t k = begin; k < end; ++k) {
+            scored_[k] = {compatible_[k], score_candidate(library, current, compatible_[k], distances_[k], rules,
+                                                          progress, recent_tracks, target_count)};
+        }
+        const size_t head = std::min(end, begin + kPickFrom);
+        std::partial_sort(scored_.begin() + begin, scored_.begin() + head, scored_.begin() + end, better);
+    };
+    if (chunks > 1) {
+        pool().parallel_for(chunks, score_chunk);
+    } else {
+        score_chunk(0);
     }
     
-    // Sort by score (descending - higher is better)
-    std::sort(scored.begin(), scored.end(),
-        [](const auto& a, const auto& b) { return a.second > b.second; });
+    // Reduce the chunk winners in chunk order to the overall top candidates
+    top_.clear();
+    for (size_t begin = 0; begin < n; begin += kScoreChunk) {
+        const size_t head = std::min(n, begin + kPickFrom);
+        top_.insert(top_.end(), scored_.begin() + begin, scored_.begin() + head);
+    }
+    int pick_from = std::min(kPickFrom, static_cast<int>(top_.size()));
+    std::partial_sort(top_.begin(), top_.begin() + pick_from, top_.end(), better);
     
     // Pick from top candidates with weighted randomization
-    int pick_from = std::min(5, static_cast<int>(scored.size()));
     
     // Weight distribution: exponentially favor higher scores
-    std::vector<float> weights(pick_from);
+    float weights[kPickFrom];
     for (int i = 0; i < pick_from; ++i) {
         weights[i] = std::exp(-0.5f * i);  // Exponential decay
     }
     
-    std::discrete_distribution<int> dist(weights.begin(), weights.end());
+    std::discrete_distribution<int> dist(weights, weights + pick_from);
     int pick_idx = dist(rng_);
     
-    return scored[pick_idx].first;
+    return top_[pick_idx].first;
+}
+
+void PlaylistGenerator::prepare_recent_distances(const FeatureMatrix& library, const std::deque<size_t>& recent_tracks) {
+    // Keep the columns of tracks that are still recent
+    for (auto& column : recent_distances_) {
+        column.in_use = false;
+    }
+    recent_columns_.assign(recent_tracks.size(), nullptr);
+    for (size_t j = 0; j < recent_tracks.size(); ++j) {
+        for (auto& column : recent_distances_) {
+            if (!column.in_use && column.row == recent_tracks[j]) {
+                column.in_use = true;
+                recent_columns_[j] = column.by_row.data();
+                break;
+            }
+        }
+    }
+    
+    // Reuse the others for tracks that just became recent
+    for (size_t j = 0; j < recent_tracks.size(); ++j) {
+        if (recent_columns_[j]) continue;
+        
+        auto free_column = std::find_if(recent_distances_.begin(), recent_distances_.end(),
+            [](const RecentDistances& column) { return !column.in_use; });
+        if (free_column == recent_distances_.end()) {
+            free_column = recent_distances_.insert(recent_distances_.end(), RecentDistances{});
+        }
+        free_column->row = recent_tracks[j];
+        free_column->in_use = true;
+        free_column->by_row.assign(library.size(), std::numeric_limits<float>::quiet_NaN());
+        recent_columns_[j] = free_column->by_row.data();
+    }
+}
+
+bool PlaylistGenerator::is_candidate(
+    const FeatureMatrix& library,
+    size_t current,
+    size_t track,
+    const PlaylistRules& rules
+) const {
+    if (!similarity_.are_compatible(library, current, track, rules)) {
+        return false;
+    }
+    
+    // Additional BPM step limit check
+    const float current_bpm = library.bpm(current);
+    const float bpm = library.bpm(track);
+    if (rules.bpm_step_limit > 0 && current_bpm > 0 && bpm > 0) {
+        float bpm_diff = utils::bpm_distance(current_bpm, bpm);
+        if (bpm_diff > rules.bpm_step_limit / 100.0f) {
+            return false;
+        }
+    }
+    return true;
 }
 
 float PlaylistGenerator::score_candidate(
-    const TrackInfo& current,
-    const TrackInfo& candidate,
+    const FeatureMatrix& library,
+    size_t current,
+    size_t candidate,
+    float distance,
     const PlaylistRules& rules,
     float progress,
-    const std::deque<TrackInfo>& recent_tracks,
+    const std::deque<size_t>& recent_tracks,
     int target_count
 ) {
     // 1) Similarity score (0-1, higher = more similar)
-    float sim_score = similarity_.similarity(current, candidate);
+    float sim_score = 1.0f / (1.0f + distance);
     
     // 2) Energy arc score (0-1, higher = better match to target energy)
     float energy_arc_score = 1.0f;
     if (rules.energy_arc != EnergyArc::None) {
         float target_energy = target_energy_for_progress(rules.energy_arc, progress);
-        float track_energy = track_average_energy(candidate);
+        float track_energy = library.mean_energy(candidate);
         float energy_diff = std::abs(target_energy - track_energy);
         energy_arc_score = 1.0f - utils::clamp(energy_diff, 0.0f, 1.0f);
     }
     
     // 3) BPM progression score (0-1, higher = smoother BPM transition)
     float bpm_prog_score = 1.0f;
-    if (rules.prefer_bpm_progression && current.bpm > 0 && candidate.bpm > 0) {
-        float bpm_diff = utils::bpm_distance(current.bpm, candidate.bpm);
+    const float current_bpm = library.bpm(current);
+    const float candidate_bpm = library.bpm(candidate);
+    if (rules.prefer_bpm_progression && current_bpm > 0 && candidate_bpm > 0) {
+        float bpm_diff = utils::bpm_distance(current_bpm, candidate_bpm);
         // Prefer small BPM differences
         bpm_prog_score = 1.0f / (1.0f + bpm_diff * 20.0f);
     }
@@ -228,8 +527,13 @@ float PlaylistGenerator::score_candidate(
     float variety_score = 1.0f;
     if (!recent_tracks.empty()) {
         float total_distance = 0.0f;
-        for (const auto& recent : recent_tracks) {
-            total_distance += similarity_.distance(candidate, recent);
+        for (size_t j = 0; j < recent_tracks.size(); ++j) {
+            // Only this task touches the candidate's entry
+            float& cached = recent_columns_[j][candidate];
+            if (std::isnan(cached)) {
+                cached = similarity_.distance(library, candidate, recent_tracks[j]);
+            }
+            total_distance += cached;
         }
         float avg_distance = total_distance / recent_tracks.size();
         // Map average distance to variety score (higher distance = higher variety)
@@ -254,7 +558,7 @@ float PlaylistGenerator::score_candidate(
 // Energy arc helpers
 // ============================================================================
 
-float PlaylistGenerator::target_energy_for_progress(EnergyArc arc, float progress) {
+float PlaylistGenerator::target_energy_for_progress(EnergyArc arc, float progress) const {
     progress = utils::clamp(progress, 0.0f, 1.0f);
     
     switch (arc) {
@@ -287,11 +591,4 @@ float PlaylistGenerator::target_energy_for_progress(EnergyArc arc, float progres
     }
 }
 
-float PlaylistGenerator::track_average_energy(const TrackInfo& track) {
-    if (track.energy_curve.empty()) return 0.5f;
-    
-    float sum = std::accumulate(track.energy_curve.begin(), track.energy_curve.end(), 0.0f);
-    return sum / track.energy_curve.size();
-}
-
 } // namespace automix
@@ -7,10 +7,19 @@
 
 #include "automix/types.h"
 #include "similarity.h"
+#include "feature_matrix.h"
+#include "compatibility_index.h"
 #include "transition_points.h"
+#include "sequence_optimizer.h"
+#include "../core/thread_pool.h"
+#include <chrono>
+#include <cstdint>
+#include <memory>
 #include <vector>
 #include <random>
 #include <deque>
+#include <functional>
+#include <optional>
 
 namespace automix {
 
@@ -19,6 +28,9 @@ namespace automix {
  */
 class PlaylistGenerator {
 public:
+    // Full track (beats, energy curve) for transition planning
+    using TrackLoader = std::function<std::optional<TrackInfo>(int64_t track_id)>;
+    
     PlaylistGenerator();
     
     /**
@@ -39,6 +51,79 @@ public:
         const TransitionConfig& config
     );
     
+    /**
+     * Generate a playlist from row `seed` of a library feature matrix.
+     * Candidates are selected on the matrix; only the chosen tracks are
+     * loaded in full to plan their transitions.
+     * 
+     * With rules.beam_width > 0 the order is planned by beam search over
+     * the kBeamPool tracks nearest to the seed (SequenceOptimizer) rather
+     * than chosen step by step; the result is then deterministic and
+     * random_seed is not used. Planned tracks that fail to load, and
+     * positions past the pool, are chosen step by step.
+     * 
+     * @param library All candidate tracks (including the seed)
+     * @param seed Row of the starting track
+     * @param load_track Loads a chosen track; tracks it cannot load are skipped
+     */
+    Playlist generate(
+        const FeatureMatrix& library,
+        size_t seed,
+        int count,
+        const PlaylistRules& rules,
+        const TransitionConfig& config,
+        const TrackLoader& load_track
+    );
+    
+    /**
+     * Open-ended generation, one track at a time, for playlists made while
+     * they play (PlaylistSession). start() begins at row `seed` of a
+     * library that must outlive the walk; next_track() picks and takes the
+     * following track with the scoring of generate(), and accept() makes
+     * it the current one (a track that could not be loaded is just not
+     * accepted). Progress along rules.energy_arc restarts every
+     * `arc_length` tracks, and an accepted track is offered again once
+     * `repeat_after` more have been accepted (0 = never).
+     */
+    void start(const FeatureMatrix& library, size_t seed, const PlaylistRules& rules,
+               int arc_length, size_t repeat_after = 0);
+    
+    /** Next track of the walk (nullopt once no track is left). */
+    std::optional<size_t> next_track();
+    
+    void accept(size_t row);
+    
+    /**
+     * Pre-select candidates through an ANN index over the library: each step
+     * scores the `candidates` compatible tracks nearest to the current one
+     * instead of every remaining track (falling back to a full scan when the
+     * index finds none). The index must cover the matrix passed to
+     * generate() and outlive the calls; nullptr scores every track.
+     */
+    void set_candidate_index(const AnnIndex* index, size_t candidates = kDefaultIndexCandidates);
+    
+    static constexpr size_t kDefaultIndexCandidates = 256;
+    
+    // Tracks the beam search orders (pairwise distances are cached)
+    static constexpr size_t kBeamPool = 1024;
+    
+    /**
+     * List each step's compatible tracks from BPM/key buckets when the rules
+     * restrict BPM or key, instead of checking every remaining track. The
+     * ANN index is then only used if at least half the remaining tracks
+     * pass the buckets. Playlists are the same as without the buckets.
+     * The index must cover the matrix passed to generate() and outlive the
+     * calls; nullptr checks every track.
+     */
+    void set_compatibility_index(const CompatibilityIndex* index);
+    
+    /**
+     * Threads scoring candidates: 0 = one per core, 1 = only the calling
+     * thread. Candidates are scored in fixed chunks and reduced in chunk
+     * order, so playlists do not depend on it.
+     */
+    void set_threads(int threads);
+    
     /**
      * Create transition plans for an existing track list.
      * 
@@ -56,37 +141,109 @@ private:
     TransitionPointFinder transition_finder_;
     std::mt19937 rng_;
     
+    const AnnIndex* candidate_index_ = nullptr;
+    size_t index_candidates_ = kDefaultIndexCandidates;
+    const CompatibilityIndex* compatibility_index_ = nullptr;
+    
+    static constexpr size_t kScoreChunk = 1024;     // Candidates per scoring task
+    static constexpr int kPickFrom = 5;             // Top candidates drawn from
+    int threads_ = 0;
+    std::unique_ptr<ThreadPool> pool_;              // Created on first use
+    
+    // Distances from each row to a recent track (NaN until computed). The
+    // window slides by one track per step, so each candidate is compared
+    // with the newest recent track only, as long as it stays available.
+    struct RecentDistances {
+        size_t row = SIZE_MAX;
+        bool in_use = false;
+        std::vector<float> by_row;
+    };
+    std::vector<RecentDistances> recent_distances_;
+    std::vector<float*> recent_columns_;            // Per recent_tracks entry
+    
+    void prepare_recent_distances(const FeatureMatrix& library, const std::deque<size_t>& recent_tracks);
+    
+    SequenceOptimizer optimizer_;
+    
+    // State of the walk from start()
+    struct Walk {
+        const FeatureMatrix* library = nullptr;
+        PlaylistRules rules;
+        size_t current = 0;
+        std::vector<size_t> available;
+        std::deque<size_t> recent;          // Last 5 accepted, for variety scoring
+        std::deque<size_t> played;          // Accepted, until offered again
+        size_t position = 0;                // Tracks accepted, the seed included
+        int arc_length = 1;
+        size_t repeat_after = 0;
+    };
+    Walk walk_;
+    
+    // Rows of the tracks after the seed, in order, from a beam search
+    std::vector<size_t> plan_sequence(
+        const FeatureMatrix& library,
+        size_t seed,
+        const std::vector<size_t>& available,
+        int count,
+        const PlaylistRules& rules,
+        std::chrono::steady_clock::time_point deadline
+    );
+    
+    ThreadPool& pool();
+    
+    // Position of each row in the available list, kNotAvailable once
+    // taken, so a chosen track is swap-removed in O(1)
+    static constexpr uint32_t kNotAvailable = UINT32_MAX;
+    std::vector<uint32_t> available_slot_;
+    
+    bool is_available(size_t row) const { return available_slot_[row] != kNotAvailable; }
+    void take(std::vector<size_t>& available, size_t row);
+    
+    // Scratch space reused across select_next calls
+    std::vector<size_t> listed_;
+    std::vector<size_t> compatible_;
+    std::vector<float> distances_;
+    std::vector<std::pair<size_t, float>> scored_;
+    std::vector<std::pair<size_t, float>> top_;
+    
     /**
      * Select next track using comprehensive scoring.
-     * @param current Current track
-     * @param available Available tracks to choose from
+     * @param library Feature matrix the rows refer to
+     * @param current Row of the current track
+     * @param available Rows of the tracks to choose from
      * @param rules Playlist generation rules
      * @param progress Current playlist progress (0.0 - 1.0)
-     * @param recent_tracks Recently added tracks (for variety scoring)
+     * @param recent_tracks Rows of recently added tracks (for variety scoring)
      * @param target_count Total number of tracks to generate
+     * @return Row of the selected track
      */
-    std::optional<TrackInfo> select_next(
-        const TrackInfo& current,
-        const std::vector<TrackInfo>& available,
+    std::optional<size_t> select_next(
+        const FeatureMatrix& library,
+        size_t current,
+        const std::vector<size_t>& available,
         const PlaylistRules& rules,
         float progress,
-        const std::deque<TrackInfo>& recent_tracks,
+        const std::deque<size_t>& recent_tracks,
         int target_count
     );
     
-    // Calculate target energy for a given progress based on EnergyArc
-    float target_energy_for_progress(EnergyArc arc, float progress);
+    // Compatibility with the current track, including the BPM step limit
+    bool is_candidate(const FeatureMatrix& library, size_t current, size_t track, const PlaylistRules& rules) const;
     
-    // Calculate average energy of a track from its energy curve
-    float track_average_energy(const TrackInfo& track);
+    // Calculate target energy for a given progress based on EnergyArc
+    float target_energy_for_progress(EnergyArc arc, float progress) const;
     
-    // Score a candidate track (higher = better)
+    // Score a candidate track (higher = better); distance is its distance
+    // from current. Fills the candidate's recent_columns_ entries, so it is
+    // safe to call concurrently only for different candidates.
     float score_candidate(
-        const TrackInfo& current,
-        const TrackInfo& candidate,
+        const FeatureMatrix& library,
+        size_t current,
+        size_t candidate,
+        float distance,
         const PlaylistRules& rules,
         float progress,
-        const std::deque<TrackInfo>& recent_tracks,
+        const std::deque<size_t>& recent_tracks,
         int target_count
     );
 };
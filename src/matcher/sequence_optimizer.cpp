@@ -0,0 +1,185 @@
+/**
+ * AutoMix Engine - Beam-Search Sequence Optimizer Implementation
+ */
+
+#include "sequence_optimizer.h"
+#include "../core/utils.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace automix {
+
+namespace {
+
+void run_parallel(ThreadPool* pool, size_t count, const std::function<void(size_t)>& task) {
+    if (pool) {
+        pool->parallel_for(count, task);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        task(i);
+    }
+}
+
+} // namespace
+
+void SequenceOptimizer::prepare(
+    const FeatureMatrix& m,
+    const SimilarityCalculator& similarity,
+    std::vector<size_t> rows,
+    const Compatible& compatible,
+    ThreadPool* pool
+) {
+    rows_ = std::move(rows);
+    const size_t n = rows_.size();
+    distances_.resize(n * n);
+    compatible_.resize(n * n);
+    energy_.resize(n);
+    words_ = (n + 63) / 64;
+    
+    for (size_t i = 0; i < n; ++i) {
+        energy_[i] = m.mean_energy(rows_[i]);
+    }
+    
+    run_parallel(pool, n, [&](size_t i) {
+        similarity.distances(m, rows_[i], rows_.data(), n, &distances_[i * n]);
+        for (size_t j = 0; j < n; ++j) {
+            compatible_[i * n + j] = i != j && compatible(rows_[i], rows_[j]);
+        }
+    });
+}
+
+float SequenceOptimizer::step_score(uint32_t from, uint32_t to, float target) const {
+    const size_t pair = static_cast<size_t>(from) * rows_.size() + to;
+    float score = kSimilarityWeight / (1.0f + distances_[pair]);
+    if (!std::isnan(target)) {
+        const float energy_diff = std::abs(target - energy_[to]);
+        score += kEnergyArcWeight * (1.0f - utils::clamp(energy_diff, 0.0f, 1.0f));
+    }
+    if (!compatible_[pair]) {
+        score -= kRuleBreakPenalty;
+    }
+    return score;
+}
+
+std::vector<size_t> SequenceOptimizer::optimize(
+    size_t length,
+    const std::vector<float>& target_energy,
+    const Options& options,
+    ThreadPool* pool
+) {
+    std::vector<size_t> result;
+    if (rows_.size() < 2) {
+        return result;
+    }
+    length = std::min(length, rows_.size() - 1);
+    
+    // Commit the whole best sequence, or only its first track when looking
+    // ahead a limited depth
+    std::vector<uint32_t> sequence = {0};
+    while (sequence.size() <= length) {
+        const size_t remaining = length + 1 - sequence.size();
+        const size_t horizon = options.depth > 0 ? std::min<size_t>(options.depth, remaining) : remaining;
+        std::vector<uint32_t> best = search(sequence, horizon, target_energy, options, pool);
+        if (best.empty()) {
+            break;
+        }
+        if (options.depth > 0) {
+            sequence.push_back(best.front());
+        } else {
+            sequence.insert(sequence.end(), best.begin(), best.end());
+        }
+    }
+    
+    for (size_t i = 1; i < sequence.size(); ++i) {
+        result.push_back(rows_[sequence[i]]);
+    }
+    return result;
+}
+
+std::vector<uint32_t> SequenceOptimizer::search(
+    const std::vector<uint32_t>& prefix,
+    size_t steps,
+    const std::vector<float>& target_energy,
+    const Options& options,
+    ThreadPool* pool
+) {
+    const uint32_t n = static_cast<uint32_t>(rows_.size());
+    
+    // Higher score first; ties by beam, then by track, so the result does
+    // not depend on the thread count
+    auto better = [](const Extension& a, const Extension& b) {
+        if (a.score != b.score) return a.score > b.score;
+        if (a.beam != b.beam) return a.beam < b.beam;
+        return a.track < b.track;
+    };
+    
+    beams_.assign(1, Beam{0.0f, prefix.back(), kNoStep});
+    used_.assign(words_, 0);
+    for (uint32_t track : prefix) {
+        used_[track / 64] |= uint64_t(1) << (track % 64);
+    }
+    steps_.clear();
+    
+    std::vector<Beam> next_beams;
+    std::vector<uint64_t> next_used;
+    
+    for (size_t s = 0; s < steps; ++s) {
+        const bool in_time = std::chrono::steady_clock::now() < options.deadline;
+        const size_t width = in_time ? static_cast<size_t>(std::max(1, options.width)) : 1;
+        const size_t position = prefix.size() + s;
+        const float target = position - 1 < target_energy.size() ? target_energy[position - 1]
+                                                                 : std::numeric_limits<float>::quiet_NaN();
+        
+        // Best extensions of each beam
+        extensions_.resize(beams_.size());
+        run_parallel(pool, beams_.size(), [&](size_t b) {
+            const Beam& beam = beams_[b];
+            const uint64_t* used = &used_[b * words_];
+            std::vector<Extension>& out = extensions_[b];
+            out.clear();
+            for (uint32_t track = 0; track < n; ++track) {
+                if (used[track / 64] & (uint64_t(1) << (track % 64))) continue;
+                out.push_back({beam.score + step_score(beam.last, track, target), static_cast<uint32_t>(b), track});
+            }
+            const size_t keep = std::min(width, out.size());
+            std::partial_sort(out.begin(), out.begin() + keep, out.end(), better);
+            out.resize(keep);
+        });
+        
+        merged_.clear();
+        for (const auto& out : extensions_) {
+            merged_.insert(merged_.end(), out.begin(), out.end());
+        }
+        if (merged_.empty()) {
+            break;  // Pool exhausted
+        }
+        const size_t keep = std::min(width, merged_.size());
+        std::partial_sort(merged_.begin(), merged_.begin() + keep, merged_.end(), better);
+        
+        next_beams.clear();
+        next_used.resize(keep * words_);
+        for (size_t k = 0; k < keep; ++k) {
+            const Extension& ext = merged_[k];
+            steps_.push_back({ext.track, beams_[ext.beam].step});
+            next_beams.push_back({ext.score, ext.track, static_cast<uint32_t>(steps_.size() - 1)});
+            
+            uint64_t* used = &next_used[k * words_];
+            std::copy_n(&used_[ext.beam * words_], words_, used);
+            used[ext.track / 64] |= uint64_t(1) << (ext.track % 64);
+        }
+        beams_.swap(next_beams);
+        used_.swap(next_used);
+    }
+    
+    // Beams are kept best first
+    std::vector<uint32_t> best;
+    for (uint32_t step = beams_.front().step; step != kNoStep; step = steps_[step].parent) {
+        best.push_back(steps_[step].track);
+    }
+    std::reverse(best.begin(), best.end());
+    return best;
+}
+
+} // namespace automix
@@ -0,0 +1,122 @@
+/**
+ * AutoMix Engine - Beam-Search Sequence Optimizer
+ */
+
+#ifndef AUTOMIX_SEQUENCE_OPTIMIZER_H
+#define AUTOMIX_SEQUENCE_OPTIMIZER_H
+
+#include "feature_matrix.h"
+#include "similarity.h"
+#include "../core/thread_pool.h"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace automix {
+
+/**
+ * Orders a pool of tracks into a sequence by beam search: every step extends
+ * each of the `width` best partial sequences by every unused track and keeps
+ * the `width` best results. Sequences are scored as a whole, on the
+ * similarity of each transition and on how close each track's energy is to
+ * the target energy of its position.
+ *
+ * prepare() caches the pairwise distances and rule checks of the pool, so a
+ * search step costs a lookup per (sequence, track) pair. Transitions that
+ * break the rules are allowed at a penalty larger than any gain a single
+ * track can bring, so the search never dead-ends.
+ *
+ * Results only depend on the inputs (ties are broken by pool position),
+ * unless the time limit cuts the search short.
+ */
+class SequenceOptimizer {
+public:
+    struct Options {
+        int width = 16;                 // Partial sequences kept per step
+        int depth = 0;                  // Lookahead per committed track; 0 = plan the whole sequence at once
+        
+        // Past it the search keeps a single sequence, so the remaining
+        // positions are filled greedily
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    };
+    
+    // Whether the track of row `to` may follow the track of row `from`
+    using Compatible = std::function<bool(size_t from, size_t to)>;
+    
+    /**
+     * Cache distances and compatibility between every pair of `rows` of a
+     * matrix, rows[0] being the start of the sequence.
+     */
+    void prepare(
+        const FeatureMatrix& m,
+        const SimilarityCalculator& similarity,
+        std::vector<size_t> rows,
+        const Compatible& compatible,
+        ThreadPool* pool
+    );
+    
+    /** Tracks prepared, the start included. */
+    size_t size() const { return rows_.size(); }
+    
+    /**
+     * Best sequence of `length` prepared tracks after the start.
+     * @param target_energy Target energy of positions 1..length (empty = no arc)
+     * @return Matrix rows, start excluded
+     */
+    std::vector<size_t> optimize(
+        size_t length,
+        const std::vector<float>& target_energy,
+        const Options& options,
+        ThreadPool* pool
+    );
+
+private:
+    static constexpr float kSimilarityWeight = 0.35f;   // As in greedy scoring
+    static constexpr float kEnergyArcWeight = 0.25f;
+    static constexpr float kRuleBreakPenalty = 1.0f;
+    
+    struct Beam {
+        float score;
+        uint32_t last;                  // Pool position of the last track
+        uint32_t step;                  // Entry in steps_ (kNoStep = none yet)
+    };
+    
+    // Expansion of a beam by one track
+    struct Extension {
+        float score;
+        uint32_t beam;
+        uint32_t track;
+    };
+    
+    struct Step {
+        uint32_t track;
+        uint32_t parent;                // Previous step or kNoStep
+    };
+    
+    static constexpr uint32_t kNoStep = UINT32_MAX;
+    
+    std::vector<size_t> rows_;
+    std::vector<float> distances_;      // size()^2, from row-major
+    std::vector<uint8_t> compatible_;   // size()^2, from row-major
+    std::vector<float> energy_;         // Per pool position
+    size_t words_ = 0;                  // uint64_t words per used-track set
+    
+    // Search state
+    std::vector<Beam> beams_;
+    std::vector<uint64_t> used_;        // beams_.size() * words_
+    std::vector<Step> steps_;
+    std::vector<std::vector<Extension>> extensions_;    // Per beam
+    std::vector<Extension> merged_;
+    
+    float step_score(uint32_t from, uint32_t to, float target) const;
+    
+    // Run `steps` beam steps from positions `prefix` (start first) and
+    // return the best continuation, in order
+    std::vector<uint32_t> search(const std::vector<uint32_t>& prefix, size_t steps,
+                                 const std::vector<float>& target_energy, const Options& options, ThreadPool* pool);
+};
+
+} // namespace automix
+
+#endif // AUTOMIX_SEQUENCE_OPTIMIZER_H
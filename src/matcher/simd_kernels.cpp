@@ -0,0 +1,219 @@
+/**
+ * AutoMix Engine - SIMD Distance Kernels Implementation
+ *
+ * The AVX2 kernels are compiled with a target attribute and picked at run
+ * time, so the library still runs on x86-64 CPUs without AVX2. NEON is part
+ * of the AArch64 baseline.
+ */
+
+#include "simd_kernels.h"
+#include <atomic>
+#include <initializer_list>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define AUTOMIX_SIMD_AVX2 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define AUTOMIX_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace automix {
+namespace simd {
+
+namespace {
+
+using DotFn = float (*)(const float*, const float*, size_t);
+using BatchDotFn = void (*)(const float*, const float*, size_t, size_t, const size_t*, size_t, size_t, float*);
+
+/* ============================================================================
+ * Scalar
+ * ============================================================================ */
+
+float dot_scalar(const float* a, const float* b, size_t n) {
+    // Eight lanes like the vector kernels, so results differ only by
+    // the order of the final additions
+    float acc[8] = {};
+    for (size_t i = 0; i < n; i += 8) {
+        for (size_t j = 0; j < 8; ++j) {
+            acc[j] += a[i + j] * b[i + j];
+        }
+    }
+    return ((acc[0] + acc[4]) + (acc[1] + acc[5])) + ((acc[2] + acc[6]) + (acc[3] + acc[7]));
+}
+
+void batch_dot_scalar(const float* query, const float* rows, size_t stride, size_t n,
+                      const size_t* indices, size_t first, size_t count, float* out) {
+    for (size_t k = 0; k < count; ++k) {
+        const float* row = rows + (indices ? indices[k] : first + k) * stride;
+        out[k] = dot_scalar(query, row, n);
+    }
+}
+
+/* ============================================================================
+ * AVX2
+ * ============================================================================ */
+
+#ifdef AUTOMIX_SIMD_AVX2
+
+__attribute__((target("avx2,fma")))
+inline float hsum_avx(__m256 v) {
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+
+__attribute__((target("avx2,fma")))
+float dot_avx2(const float* a, const float* b, size_t n) {
+    __m256 acc = _mm256_setzero_ps();
+    for (size_t i = 0; i < n; i += 8) {
+        acc = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc);
+    }
+    return hsum_avx(acc);
+}
+
+__attribute__((target("avx2,fma")))
+void batch_dot_avx2(const float* query, const float* rows, size_t stride, size_t n,
+                    const size_t* indices, size_t first, size_t count, float* out) {
+    // Two rows at a time: independent FMA chains hide their latency
+    size_t k = 0;
+    for (; k + 2 <= count; k += 2) {
+        const float* r0 = rows + (indices ? indices[k] : first + k) * stride;
+        const float* r1 = rows + (indices ? indices[k + 1] : first + k + 1) * stride;
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        for (size_t i = 0; i < n; i += 8) {
+            __m256 q = _mm256_loadu_ps(query + i);
+            acc0 = _mm256_fmadd_ps(q, _mm256_loadu_ps(r0 + i), acc0);
+            acc1 = _mm256_fmadd_ps(q, _mm256_loadu_ps(r1 + i), acc1);
+        }
+        out[k] = hsum_avx(acc0);
+        out[k + 1] = hsum_avx(acc1);
+    }
+    if (k < count) {
+        out[k] = dot_avx2(query, rows + (indices ? indices[k] : first + k) * stride, n);
+    }
+}
+
+bool cpu_has_avx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+#endif // AUTOMIX_SIMD_AVX2
+
+/* ============================================================================
+ * NEON
+ * ============================================================================ */
+
+#ifdef AUTOMIX_SIMD_NEON
+
+float dot_neon(const float* a, const float* b, size_t n) {
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    for (size_t i = 0; i < n; i += 8) {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    return vaddvq_f32(vaddq_f32(acc0, acc1));
+}
+
+void batch_dot_neon(const float* query, const float* rows, size_t stride, size_t n,
+                    const size_t* indices, size_t first, size_t count, float* out) {
+    for (size_t k = 0; k < count; ++k) {
+        out[k] = dot_neon(query, rows + (indices ? indices[k] : first + k) * stride, n);
+    }
+}
+
+#endif // AUTOMIX_SIMD_NEON
+
+/* ============================================================================
+ * Dispatch
+ * ============================================================================ */
+
+struct Kernels {
+    Isa isa;
+    DotFn dot;
+    BatchDotFn batch_dot;
+};
+
+bool supported(Isa isa) {
+    switch (isa) {
+        case Isa::Scalar:
+            return true;
+        case Isa::AVX2:
+#ifdef AUTOMIX_SIMD_AVX2
+            return cpu_has_avx2();
+#else
+            return false;
+#endif
+        case Isa::NEON:
+#ifdef AUTOMIX_SIMD_NEON
+            return true;
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+const Kernels* kernels_for(Isa isa) {
+    static const Kernels scalar{Isa::Scalar, dot_scalar, batch_dot_scalar};
+#ifdef AUTOMIX_SIMD_AVX2
+    static const Kernels avx2{Isa::AVX2, dot_avx2, batch_dot_avx2};
+    if (isa == Isa::AVX2) return &avx2;
+#endif
+#ifdef AUTOMIX_SIMD_NEON
+    static const Kernels neon{Isa::NEON, dot_neon, batch_dot_neon};
+    if (isa == Isa::NEON) return &neon;
+#endif
+    return &scalar;
+}
+
+const Kernels* detect() {
+    for (Isa isa : {Isa::AVX2, Isa::NEON}) {
+        if (supported(isa)) return kernels_for(isa);
+    }
+    return kernels_for(Isa::Scalar);
+}
+
+std::atomic<const Kernels*>& current() {
+    static std::atomic<const Kernels*> kernels{detect()};
+    return kernels;
+}
+
+} // namespace
+
+Isa active_isa() {
+    return current().load(std::memory_order_relaxed)->isa;
+}
+
+const char* isa_name(Isa isa) {
+    switch (isa) {
+        case Isa::AVX2: return "avx2";
+        case Isa::NEON: return "neon";
+        case Isa::Scalar: break;
+    }
+    return "scalar";
+}
+
+bool use_isa(Isa isa) {
+    if (!supported(isa)) {
+        return false;
+    }
+    current().store(kernels_for(isa), std::memory_order_relaxed);
+    return true;
+}
+
+float dot(const float* a, const float* b, size_t n) {
+    return current().load(std::memory_order_relaxed)->dot(a, b, n);
+}
+
+void batch_dot(const float* query, const float* rows, size_t stride, size_t n,
+               const size_t* indices, size_t first, size_t count, float* out) {
+    current().load(std::memory_order_relaxed)->batch_dot(query, rows, stride, n, indices, first, count, out);
+}
+
+} // namespace simd
+} // namespace automix
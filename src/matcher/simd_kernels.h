@@ -0,0 +1,49 @@
+/**
+ * AutoMix Engine - SIMD Distance Kernels
+ */
+
+#ifndef AUTOMIX_SIMD_KERNELS_H
+#define AUTOMIX_SIMD_KERNELS_H
+
+#include <cstddef>
+
+namespace automix {
+namespace simd {
+
+enum class Isa {
+    Scalar,
+    AVX2,       // x86-64 with AVX2 + FMA, detected at run time
+    NEON        // AArch64
+};
+
+/**
+ * Instruction set the kernels currently use: the best one the CPU supports
+ * unless overridden by use_isa().
+ */
+Isa active_isa();
+const char* isa_name(Isa isa);
+
+/**
+ * Switch kernels to `isa` (for comparing paths in tests and benchmarks).
+ * @return false if this build or CPU cannot run it; nothing changes
+ */
+bool use_isa(Isa isa);
+
+/**
+ * Dot product of two rows of n floats; n is a multiple of 8.
+ */
+float dot(const float* a, const float* b, size_t n);
+
+/**
+ * Dot products of `query` with `count` rows of a row-major matrix whose
+ * rows are `stride` floats apart, using the first n floats of each row
+ * (n a multiple of 8). Row k is rows[indices[k]] or, without indices,
+ * rows[first + k]; its product goes to out[k].
+ */
+void batch_dot(const float* query, const float* rows, size_t stride, size_t n,
+               const size_t* indices, size_t first, size_t count, float* out);
+
+} // namespace simd
+} // namespace automix
+
+#endif // AUTOMIX_SIMD_KERNELS_H
@@ -3,12 +3,26 @@
  */
 
 #include "similarity.h"
+#include "simd_kernels.h"
 #include "../core/utils.h"
 #include <algorithm>
 #include <cmath>
 
 namespace automix {
 
+namespace {
+
+// Rows scored per batch_dot call; dot products for a block stay in cache
+constexpr size_t kDistanceBlock = 256;
+
+// utils::cosine_distance from a dot product and the two norms
+inline float cosine_from_dot(float dot, float norm_a, float norm_b) {
+    if (norm_a == 0.0f || norm_b == 0.0f) return 1.0f;
+    return 1.0f - utils::clamp(dot / (norm_a * norm_b), -1.0f, 1.0f);
+}
+
+} // namespace
+
 SimilarityCalculator::SimilarityCalculator(const SimilarityWeights& weights)
     : weights_(weights) {}
 
@@ -23,7 +37,7 @@ float SimilarityCalculator::distance(const TrackInfo& a, const TrackInfo& b) con
     }
     
     // Key distance
-    if (weights_.key > 0 && !a.key.empty() && !b.key.empty()) {
+    if (weights_.key > 0 && a.key != kUnknownKey && b.key != kUnknownKey) {
         d += weights_.key * key_distance(a.key, b.key);
         total_weight += weights_.key;
     }
@@ -99,12 +113,12 @@ bool SimilarityCalculator::are_compatible(const TrackInfo& a, const TrackInfo& b
     }
     
     // Check key compatibility
-    if (!rules.allow_key_change && !a.key.empty() && !b.key.empty()) {
+    if (!rules.allow_key_change && a.key != kUnknownKey && b.key != kUnknownKey) {
         int key_dist = utils::camelot_distance(a.key, b.key);
         if (key_dist > 0) {
             return false;
         }
-    } else if (rules.max_key_distance > 0 && !a.key.empty() && !b.key.empty()) {
+    } else if (rules.max_key_distance > 0 && a.key != kUnknownKey && b.key != kUnknownKey) {
         int key_dist = utils::camelot_distance(a.key, b.key);
         if (key_dist > rules.max_key_distance) {
             return false;
@@ -122,12 +136,266 @@ bool SimilarityCalculator::are_compatible(const TrackInfo& a, const TrackInfo& b
     return true;
 }
 
+float SimilarityCalculator::distance(const FeatureMatrix& m, size_t a, size_t b) const {
+    const float* mfcc_a = m.mfcc(a);
+    const float* mfcc_b = m.mfcc(b);
+    const float* chroma_a = m.chroma(a);
+    const float* chroma_b = m.chroma(b);
+    const float* energy_a = m.energy(a);
+    const float* energy_b = m.energy(b);
+    
+    float mfcc_dot = mfcc_a && mfcc_b ? simd::dot(mfcc_a, mfcc_b, FeatureMatrix::kMfccStride) : 0.0f;
+    float chroma_dot = chroma_a && chroma_b ? simd::dot(chroma_a, chroma_b, FeatureMatrix::kChromaStride) : 0.0f;
+    float energy_dot = energy_a && energy_b ? simd::dot(energy_a, energy_b, FeatureMatrix::kEnergyStride) : 0.0f;
+    return combine_distance(m, a, b, mfcc_dot, chroma_dot, energy_dot);
+}
+
+void SimilarityCalculator::distances(
+    const FeatureMatrix& m,
+    size_t query,
+    const size_t* candidates,
+    size_t count,
+    float* out
+) const {
+    batch_distances(m, query, candidates, 0, count, out);
+}
+
+void SimilarityCalculator::distances_in_range(
+    const FeatureMatrix& m,
+    size_t query,
+    size_t first,
+    size_t count,
+    float* out
+) const {
+    batch_distances(m, query, nullptr, first, count, out);
+}
+
+void SimilarityCalculator::batch_distances(
+    const FeatureMatrix& m,
+    size_t query,
+    const size_t* candidates,
+    size_t first,
+    size_t count,
+    float* out
+) const {
+    const bool use_mfcc = weights_.mfcc > 0 && m.mfcc(query);
+    const bool use_chroma = weights_.chroma > 0 && m.chroma(query);
+    const bool use_energy = weights_.energy > 0 && m.energy(query);
+    
+    float mfcc_dot[kDistanceBlock] = {};
+    float chroma_dot[kDistanceBlock] = {};
+    float energy_dot[kDistanceBlock] = {};
+    
+    for (size_t begin = 0; begin < count; begin += kDistanceBlock) {
+        const size_t n = std::min(kDistanceBlock, count - begin);
+        const size_t* indices = candidates ? candidates + begin : nullptr;
+        const size_t block_first = first + begin;
+        
+        // Missing rows are zero; combine_distance leaves them out by their flags
+        if (use_mfcc) {
+            simd::batch_dot(m.mfcc(query), m.mfcc_rows(), FeatureMatrix::kMfccStride, FeatureMatrix::kMfccStride,
+                            indices, block_first, n, mfcc_dot);
+        }
+        if (use_chroma) {
+            simd::batch_dot(m.chroma(query), m.chroma_rows(), FeatureMatrix::kChromaStride, FeatureMatrix::kChromaStride,
+                            indices, block_first, n, chroma_dot);
+        }
+        if (use_energy) {
+            simd::batch_dot(m.energy(query), m.energy_rows(), FeatureMatrix::kEnergyStride, FeatureMatrix::kEnergyStride,
+                            indices, block_first, n, energy_dot);
+        }
+        
+        for (size_t k = 0; k < n; ++k) {
+            size_t row = indices ? indices[k] : block_first + k;
+            out[begin + k] = combine_distance(m, query, row, mfcc_dot[k], chroma_dot[k], energy_dot[k]);
+        }
+    }
+}
+
+float SimilarityCalculator::combine_distance(
+    const FeatureMatrix& m, size_t a, size_t b,
+    float mfcc_dot, float chroma_dot, float energy_dot
+) const {
+    float d = 0.0f;
+    float total_weight = 0.0f;
+    
+    // BPM distance
+    if (weights_.bpm > 0 && m.bpm(a) > 0 && m.bpm(b) > 0) {
+        d += weights_.bpm * bpm_distance(m.bpm(a), m.bpm(b));
+        total_weight += weights_.bpm;
+    }
+    
+    // Key distance
+    if (weights_.key > 0 && m.key(a) != kUnknownKey && m.key(b) != kUnknownKey) {
+        d += weights_.key * key_distance(m.key(a), m.key(b));
+        total_weight += weights_.key;
+    }
+    
+    // MFCC distance
+    if (weights_.mfcc > 0 && m.mfcc(a) && m.mfcc(b)) {
+        d += weights_.mfcc * cosine_from_dot(mfcc_dot, m.mfcc_norm(a), m.mfcc_norm(b));
+        total_weight += weights_.mfcc;
+    }
+    
+    // Energy distance
+    if (weights_.energy > 0 && m.energy(a) && m.energy(b)) {
+        d += weights_.energy * energy_distance(m, a, b, energy_dot);
+        total_weight += weights_.energy;
+    }
+    
+    // Chroma distance
+    if (weights_.chroma > 0 && m.chroma(a) && m.chroma(b)) {
+        d += weights_.chroma * cosine_from_dot(chroma_dot, m.chroma_norm(a), m.chroma_norm(b));
+        total_weight += weights_.chroma;
+    }
+    
+    // Duration distance
+    if (weights_.duration > 0 && m.duration(a) > 0 && m.duration(b) > 0) {
+        d += weights_.duration * duration_distance(m.duration(a), m.duration(b));
+        total_weight += weights_.duration;
+    }
+    
+    // Normalize by total weight
+    return total_weight > 0 ? d / total_weight : 0.0f;
+}
+
+float SimilarityCalculator::energy_distance(const FeatureMatrix& m, size_t a, size_t b, float energy_dot) const {
+    const auto& sa = m.energy_stats(a);
+    const auto& sb = m.energy_stats(b);
+    
+    // Global correlation of the centered curves
+    float denominator = sa.norm * sb.norm;
+    float correlation = (denominator > 1e-10f) ? (energy_dot / denominator) : 0.0f;
+    float global_distance = (1.0f - correlation) / 2.0f;
+    
+    // Segmented comparison from the per-track segment statistics
+    float total_diff = 0.0f;
+    for (size_t s = 0; s < FeatureMatrix::kEnergySegments; ++s) {
+        float mean_diff = std::abs(sa.segment_mean[s] - sb.segment_mean[s]);
+        float std_diff = std::abs(sa.segment_std[s] - sb.segment_std[s]);
+        total_diff += 0.7f * mean_diff + 0.3f * std_diff;
+    }
+    float seg_distance = utils::clamp(total_diff / FeatureMatrix::kEnergySegments, 0.0f, 1.0f);
+    
+    return 0.6f * global_distance + 0.4f * seg_distance;
+}
+
+float SimilarityCalculator::similarity(const FeatureMatrix& m, size_t a, size_t b) const {
+    return 1.0f / (1.0f + distance(m, a, b));
+}
+
+bool SimilarityCalculator::are_compatible(const FeatureMatrix& m, size_t a, size_t b, const PlaylistRules& rules) const {
+    // Check BPM tolerance
+    if (rules.bpm_tolerance > 0 && m.bpm(a) > 0 && m.bpm(b) > 0) {
+        if (utils::bpm_distance(m.bpm(a), m.bpm(b)) > rules.bpm_tolerance) {
+            return false;
+        }
+    }
+    
+    // Check key compatibility
+    const bool keys_known = m.key(a) != kUnknownKey && m.key(b) != kUnknownKey;
+    if (!rules.allow_key_change && keys_known) {
+        if (utils::camelot_distance(m.key(a), m.key(b)) > 0) {
+            return false;
+        }
+    } else if (rules.max_key_distance > 0 && keys_known) {
+        if (utils::camelot_distance(m.key(a), m.key(b)) > rules.max_key_distance) {
+            return false;
+        }
+    }
+    
+    // Check energy match
+    const float* energy_a = m.energy(a);
+    const float* energy_b = m.energy(b);
+    if (rules.min_energy_match > 0 && energy_a && energy_b) {
+        float energy_dot = simd::dot(energy_a, energy_b, FeatureMatrix::kEnergyStride);
+        float energy_sim = 1.0f - energy_distance(m, a, b, energy_dot);
+        if (energy_sim < rules.min_energy_match) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+std::vector<std::pair<size_t, float>> SimilarityCalculator::find_similar(
+    const FeatureMatrix& m,
+    size_t target,
+    int count
+) const {
+    std::vector<std::pair<size_t, float>> results;
+    if (count <= 0) {
+        return results;
+    }
+    
+    // Keep the best `count` in a max-heap on (distance, row) while
+    // scoring the library block by block
+    auto worse = [](const std::pair<size_t, float>& a, const std::pair<size_t, float>& b) {
+        return a.second < b.second || (a.second == b.second && a.first < b.first);
+    };
+    results.reserve(static_cast<size_t>(count) + 1);
+    
+    float block[kDistanceBlock];
+    for (size_t begin = 0; begin < m.size(); begin += kDistanceBlock) {
+        const size_t n = std::min(kDistanceBlock, m.size() - begin);
+        distances_in_range(m, target, begin, n, block);
+        for (size_t k = 0; k < n; ++k) {
+            const size_t row = begin + k;
+            if (m.id(row) == m.id(target)) continue;  // Skip self
+            
+            std::pair<size_t, float> entry{row, block[k]};
+            if (results.size() < static_cast<size_t>(count)) {
+                results.push_back(entry);
+                std::push_heap(results.begin(), results.end(), worse);
+            } else if (worse(entry, results.front())) {
+                std::pop_heap(results.begin(), results.end(), worse);
+                results.back() = entry;
+                std::push_heap(results.begin(), results.end(), worse);
+            }
+        }
+    }
+    
+    // Sort by distance (ascending)
+    std::sort_heap(results.begin(), results.end(), worse);
+    return results;
+}
+
+std::vector<std::pair<size_t, float>> SimilarityCalculator::find_similar(
+    const FeatureMatrix& m,
+    size_t target,
+    int count,
+    const AnnIndex& index,
+    size_t candidates
+) const {
+    std::vector<size_t> rows;
+    rows.reserve(candidates);
+    for (const auto& [id, embedding_distance] : index.search(m, target, candidates, static_cast<int>(candidates))) {
+        auto row = m.index_of(id);
+        if (row && id != m.id(target)) rows.push_back(*row);
+    }
+    
+    std::vector<float> d(rows.size());
+    distances(m, target, rows.data(), rows.size(), d.data());
+    
+    std::vector<std::pair<size_t, float>> results;
+    results.reserve(rows.size());
+    for (size_t k = 0; k < rows.size(); ++k) {
+        results.push_back({rows[k], d[k]});
+    }
+    
+    const size_t n = std::min(results.size(), static_cast<size_t>(std::max(0, count)));
+    std::partial_sort(results.begin(), results.begin() + n, results.end(),
+        [](const auto& a, const auto& b) { return a.second < b.second || (a.second == b.second && a.first < b.first); });
+    results.resize(n);
+    return results;
+}
+
 float SimilarityCalculator::bpm_distance(float bpm1, float bpm2) const {
     // Use the utility function that handles double/half time
     return utils::bpm_distance(bpm1, bpm2);
 }
 
-float SimilarityCalculator::key_distance(const std::string& key1, const std::string& key2) const {
+float SimilarityCalculator::key_distance(KeyCode key1, KeyCode key2) const {
     // Camelot wheel distance normalized to 0-1
     int dist = utils::camelot_distance(key1, key2);
     return static_cast<float>(dist) / 6.0f;  // Max distance is 6
@@ -143,23 +411,15 @@ float SimilarityCalculator::energy_distance(const std::vector<float>& energy1, c
     }
     
     // Resample to same length
-    const size_t target_len = 100;
-    
-    auto resample = [](const std::vector<float>& curve, size_t len) {
-        if (curve.size() <= 1) return std::vector<float>(len, curve.empty() ? 0.0f : curve[0]);
-        std::vector<float> resampled(len);
-        for (size_t i = 0; i < len; ++i) {
-            float src_idx = static_cast<float>(i) * (curve.size() - 1) / (len - 1);
-            size_t idx0 = static_cast<size_t>(src_idx);
-            size_t idx1 = std::min(idx0 + 1, curve.size() - 1);
-            float frac = src_idx - idx0;
-            resampled[i] = curve[idx0] * (1.0f - frac) + curve[idx1] * frac;
-        }
-        return resampled;
-    };
-    
-    auto e1 = resample(energy1, target_len);
-    auto e2 = resample(energy2, target_len);
+    float e1[FeatureMatrix::kEnergyPoints];
+    float e2[FeatureMatrix::kEnergyPoints];
+    FeatureMatrix::resample_energy(energy1, e1);
+    FeatureMatrix::resample_energy(energy2, e2);
+    return resampled_energy_distance(e1, e2);
+}
+
+float SimilarityCalculator::resampled_energy_distance(const float* e1, const float* e2) const {
+    const size_t target_len = FeatureMatrix::kEnergyPoints;
     
     // 1) Global correlation (original approach)
     float mean1 = 0, mean2 = 0;
@@ -184,20 +444,19 @@ float SimilarityCalculator::energy_distance(const std::vector<float>& energy1, c
     float global_distance = (1.0f - correlation) / 2.0f;
     
     // 2) Segmented comparison (5 segments: intro/buildup/peak/breakdown/outro)
-    float seg_distance = segment_energy_distance(e1, e2, 5);
+    float seg_distance = segment_energy_distance(e1, e2, target_len, 5);
     
     // Blend: 60% global correlation + 40% segmented
     return 0.6f * global_distance + 0.4f * seg_distance;
 }
 
 float SimilarityCalculator::segment_energy_distance(
-    const std::vector<float>& e1, const std::vector<float>& e2, size_t segments
+    const float* e1, const float* e2, size_t len, size_t segments
 ) const {
-    if (e1.size() != e2.size() || e1.empty() || segments == 0) {
+    if (len == 0 || segments == 0) {
         return 0.0f;
     }
     
-    size_t len = e1.size();
     size_t seg_len = len / segments;
     if (seg_len == 0) seg_len = 1;
     
@@ -6,6 +6,8 @@
 #define AUTOMIX_SIMILARITY_H
 
 #include "automix/types.h"
+#include "feature_matrix.h"
+#include "ann_index.h"
 #include <vector>
 
 namespace automix {
@@ -45,6 +47,50 @@ public:
      */
     bool are_compatible(const TrackInfo& a, const TrackInfo& b, const PlaylistRules& rules) const;
     
+    /**
+     * Distance between rows a and b of a feature matrix; the TrackInfo
+     * overload's result for the tracks the rows were built from, within
+     * float rounding.
+     */
+    float distance(const FeatureMatrix& m, size_t a, size_t b) const;
+    
+    /**
+     * Distances from row `query` to many rows at once through the SIMD
+     * kernels: out[k] = distance(m, query, candidates[k]) for k < count.
+     */
+    void distances(const FeatureMatrix& m, size_t query, const size_t* candidates, size_t count, float* out) const;
+    
+    /**
+     * Distances from row `query` to rows [first, first + count).
+     */
+    void distances_in_range(const FeatureMatrix& m, size_t query, size_t first, size_t count, float* out) const;
+    float similarity(const FeatureMatrix& m, size_t a, size_t b) const;
+    bool are_compatible(const FeatureMatrix& m, size_t a, size_t b, const PlaylistRules& rules) const;
+    
+    /**
+     * Find the rows most similar to row `target`.
+     * @return Sorted vector of (row, distance) pairs
+     */
+    std::vector<std::pair<size_t, float>> find_similar(
+        const FeatureMatrix& m,
+        size_t target,
+        int count = 10
+    ) const;
+    
+    /**
+     * Rank the `candidates` tracks nearest to row `target` in an ANN index
+     * by the full distance, instead of scoring every row. Tracks far from
+     * the target in timbre and chroma are not considered.
+     * @return Sorted vector of (row, distance) pairs
+     */
+    std::vector<std::pair<size_t, float>> find_similar(
+        const FeatureMatrix& m,
+        size_t target,
+        int count,
+        const AnnIndex& index,
+        size_t candidates = 256
+    ) const;
+    
     void set_weights(const SimilarityWeights& weights) { weights_ = weights; }
     const SimilarityWeights& weights() const { return weights_; }
     
@@ -53,14 +99,24 @@ private:
     
     // Component distance functions
     float bpm_distance(float bpm1, float bpm2) const;
-    float key_distance(const std::string& key1, const std::string& key2) const;
+    float key_distance(KeyCode key1, KeyCode key2) const;
     float mfcc_distance(const std::vector<float>& mfcc1, const std::vector<float>& mfcc2) const;
     float energy_distance(const std::vector<float>& energy1, const std::vector<float>& energy2) const;
     float chroma_distance(const std::vector<float>& chroma1, const std::vector<float>& chroma2) const;
     float duration_distance(float dur1, float dur2) const;
     
+    // Energy distance between two curves resampled to FeatureMatrix::kEnergyPoints
+    float resampled_energy_distance(const float* e1, const float* e2) const;
+    
+    // Matrix rows: per-pair dot products combined with the precomputed row terms
+    void batch_distances(const FeatureMatrix& m, size_t query, const size_t* candidates,
+                         size_t first, size_t count, float* out) const;
+    float combine_distance(const FeatureMatrix& m, size_t a, size_t b,
+                           float mfcc_dot, float chroma_dot, float energy_dot) const;
+    float energy_distance(const FeatureMatrix& m, size_t a, size_t b, float energy_dot) const;
+    
     // Energy curve segmented comparison helper
-    float segment_energy_distance(const std::vector<float>& e1, const std::vector<float>& e2, size_t segments) const;
+    float segment_energy_distance(const float* e1, const float* e2, size_t len, size_t segments) const;
 };
 
 } // namespace automix
@@ -292,24 +292,11 @@ TransitionPlan TransitionPointFinder::create_plan(
     
     // Smart pitch shift: suggest when keys are close but not compatible
     plan.pitch_shift_semitones = 0;
-    if (!from_track.key.empty() && !to_track.key.empty()) {
+    if (from_track.key != kUnknownKey && to_track.key != kUnknownKey) {
         int key_dist = utils::camelot_distance(from_track.key, to_track.key);
         if (key_dist > 0 && key_dist <= 2) {
-            // Convert Camelot keys to semitones
-            // Each Camelot step (same mode) = 7 semitones (perfect 5th)
-            // Mode A->B (same number) = +3 semitones (relative major)
-            auto camelot_to_semitone = [](const std::string& key) -> int {
-                int num = utils::parse_camelot_number(key);
-                char mode = utils::parse_camelot_mode(key);
-                if (num == 0) return 0;
-                // Base: 5A = Cm = 0 semitones
-                int semi = ((num - 5) * 7 % 12 + 12) % 12;
-                if (mode == 'B' || mode == 'b') semi = (semi + 3) % 12;
-                return semi;
-            };
-            
-            int semi1 = camelot_to_semitone(from_track.key);
-            int semi2 = camelot_to_semitone(to_track.key);
+            int semi1 = utils::key_semitone(from_track.key);
+            int semi2 = utils::key_semitone(to_track.key);
             
             // Minimum semitone shift to align keys
             int diff = (semi1 - semi2 + 12) % 12;
@@ -4,10 +4,15 @@
 
 #include "engine.h"
 #include "../core/utils.h"
+#include "../core/content_hash.h"
+#include "../core/directory_walker.h"
+#include "../core/library_watcher.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <filesystem>
 #include <thread>
-#include <atomic>
-#include <mutex>
+#include <unordered_set>
 
 namespace automix {
 
@@ -29,6 +34,17 @@ Engine::Engine(const std::string& db_path)
         return this->load_track_audio(track_id);
     });
     
+    // Plan transitions for queue edits with the current configuration
+    scheduler_->set_transition_planner([this](int64_t from_id, int64_t to_id) -> std::optional<TransitionPlan> {
+        auto from = store_->get_track(from_id);
+        auto to = store_->get_track(to_id);
+        if (!from || !to) {
+            return std::nullopt;
+        }
+        return playlist_generator_->create_with_transitions({*from, *to}, transition_config_)
+            .entries.front().transition_to_next;
+    });
+    
     // Setup audio output render callback -> calls scheduler render
     audio_output_->set_render_callback([this](float* buffer, int frames) {
         return this->render(buffer, frames);
@@ -45,6 +61,16 @@ bool Engine::is_valid() const {
 
 int Engine::scan(const std::string& music_dir, bool recursive, ScanCallback callback,
                 bool metadata_only) {
+    ScanProgressCallback progress = nullptr;
+    if (callback) {
+        progress = [callback](const ScanProgress& p) {
+            callback(p.file, p.processed, p.total);
+        };
+    }
+    return scan(music_dir, recursive, std::move(progress), metadata_only ? ScanMode::MetadataOnly : ScanMode::Full);
+}
+
+int Engine::scan(const std::string& music_dir, bool recursive, ScanProgressCallback progress, ScanMode mode) {
     if (!is_valid()) {
         last_error_ = "Engine not initialized";
         return -1;
@@ -56,166 +82,547 @@ int Engine::scan(const std::string& music_dir, bool recursive, ScanCallback call
         return -1;
     }
     
-    // Find all audio files
-    auto files = utils::find_audio_files(dir_path, recursive);
+    last_scan_stats_ = ScanStats();
+    
+    // Find all audio files, skipping directories unchanged since the last walk
+    const std::string root = utils::path_to_absolute(dir_path);
+    const bool use_directory_cache = recursive && directory_cache_;
+    DirectorySnapshot previous_dirs;
+    if (use_directory_cache) {
+        previous_dirs = store_->get_directory_states(root);
+    }
+    WalkResult walk = DirectoryWalker().walk(root, recursive, use_directory_cache ? &previous_dirs : nullptr);
+    std::vector<WalkedFile> files = std::move(walk.files);
+    
+    // Filter out files that are already analyzed by diffing the walk against
+    // a snapshot of the library (one query instead of one per file). Entries
+    // left in the snapshot afterwards were not seen on disk.
+    TrackScanSnapshot known = store_->get_scan_snapshot();
+    
+    // Full scans also pick up low-confidence fast-scan results
+    const float min_confidence = mode == ScanMode::Full ? kRescanConfidence : 0.0f;
+    ContentIndex content = make_content_index(known, min_confidence);
+    
+    // Unchanged directories hold the same files as last time: the ones the
+    // library has there (files that failed last time force a relisting).
+    // Editing a file in place leaves its directory's mtime alone, so each
+    // known file is still stat'ed, just not listed
+    if (!walk.unchanged_dirs.empty()) {
+        std::unordered_set<std::string> unchanged(walk.unchanged_dirs.begin(), walk.unchanged_dirs.end());
+        for (const auto& entry : known) {
+            const std::string& path = entry.first;
+            if (unchanged.count(std::filesystem::path(path).parent_path().string())) {
+                int64_t mtime = utils::file_modified_time(path);
+                if (mtime != 0) {
+                    files.push_back({path, mtime});
+                }
+            }
+        }
+    }
     int total = static_cast<int>(files.size());
     
-    // Filter out files that are already analyzed (check serially — fast DB lookup)
-    struct ScanJob {
-        std::filesystem::path path;
-        int64_t file_mtime;
-    };
-    std::vector<ScanJob> jobs;
+    std::vector<ScanItem> items;
     int already_analyzed = 0;
     
     for (int i = 0; i < total; ++i) {
-        const auto& file = files[i];
-        std::string path_str = utils::path_to_absolute(file);
-        int64_t file_mtime = utils::file_modified_time(file);
+        std::string& path_str = files[i].path;
+        int64_t file_mtime = files[i].mtime;
+        
+        bool needed = true;
+        auto it = known.find(path_str);
+        if (it != known.end()) {
+            needed = Store::needs_analysis(it->second, file_mtime, min_confidence);
+            known.erase(it);
+        }
         
-        if (!store_->needs_analysis(path_str, file_mtime)) {
+        if (!needed) {
             already_analyzed++;
-            if (callback) {
-                callback(path_str, i + 1, total);
+            if (progress) {
+                progress({path_str, i + 1, total, last_scan_stats_});
             }
         } else {
-            jobs.push_back({file, file_mtime});
+            ScanItem item;
+            item.path = std::move(path_str);
+            item.file_mtime = file_mtime;
+            items.push_back(std::move(item));
         }
     }
     
-    if (jobs.empty()) {
-        store_->cleanup_missing_files();
-        return already_analyzed;
+    // Moved and duplicated files keep the analysis their content already has
+    int progress_count = already_analyzed;
+    already_analyzed += reuse_analysis(items, content, [&](const ScanItem& item, const std::string& from, bool renamed) {
+        if (renamed) {
+            known.erase(from);  // Not missing, moved
+        }
+        progress_count++;
+        if (progress) {
+            progress({item.path, progress_count, total, last_scan_stats_});
+        }
+    });
+    
+    int processed_count = 0;
+    bool save_directories = use_directory_cache;
+    if (!items.empty()) {
+        processed_count = analyze_items(std::move(items), mode, [&](const ScanItem& item, bool ok, const ScanStats& stats) {
+            if (!ok) {
+                // Relist this directory next time so the file is retried
+                auto dir = walk.directories.find(std::filesystem::path(item.path).parent_path().string());
+                if (dir != walk.directories.end()) {
+                    dir->second.mtime = 0;
+                }
+            }
+            progress_count++;
+            if (progress) {
+                progress({item.path, progress_count, total, stats});
+            }
+        });
+        if (last_scan_stats_.write.failed > 0) {
+            save_directories = false;  // Unknown which directories to relist
+        }
     }
     
-    // Multi-threaded scanning
-    unsigned int hw_threads = std::thread::hardware_concurrency();
-    unsigned int num_threads = std::max(1u, std::min(4u, hw_threads / 2));
-    num_threads = std::min(num_threads, static_cast<unsigned int>(jobs.size()));
+    if (save_directories) {
+        store_->save_directory_states(root, walk.directories);
+    }
+    store_->cleanup_missing_files(known);
+    return already_analyzed + processed_count;
+}
+
+int Engine::analyze_items(std::vector<ScanItem> items, ScanMode mode, const ScanPipeline::DoneCallback& on_done) {
+    int processed_count = 0;
+    auto counted = [&](const ScanItem& item, bool ok, const ScanStats& stats) {
+        if (ok) {
+            processed_count++;
+        }
+        if (on_done) {
+            on_done(item, ok, stats);
+        }
+    };
     
-    std::atomic<int> job_index{0};
-    std::atomic<int> processed_count{0};
-    std::atomic<int> progress_count{already_analyzed};
-    std::mutex callback_mutex;
+    // Rows are committed in batches behind the pipeline; wait for the last
+    // batch and count rows that failed to write
+    StoreWriter writer(*store_);
+    last_scan_stats_ = make_scan_pipeline(mode, items.size(), writer).run(std::move(items), counted);
     
-    if (metadata_only) {
-        // Metadata-only: only get duration, no decode/analyze
-        auto worker = [&]() {
-            Decoder local_decoder;
-            while (true) {
-                int idx = job_index.fetch_add(1);
-                if (idx >= static_cast<int>(jobs.size())) break;
-                
-                const auto& job = jobs[idx];
-                std::string path_str = utils::path_to_absolute(job.path);
+    auto flush_start = std::chrono::steady_clock::now();
+    writer.flush();
+    last_scan_stats_.elapsed_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - flush_start).count();
+    
+    StoreWriterStats written = writer.stats();
+    last_scan_stats_.write.completed = written.rows;
+    last_scan_stats_.write.failed = written.failed;
+    last_scan_stats_.write.busy_seconds = written.busy_seconds;
+    if (written.failed > 0) {
+        last_error_ = writer.last_error();
+    }
+    return processed_count - written.failed;
+}
+
+Engine::ContentIndex Engine::make_content_index(const TrackScanSnapshot& library, float min_confidence) {
+    ContentIndex index;
+    for (const auto& [path, state] : library) {
+        if (state.content_hash != 0 && state.analyzed_at > 0 && state.confidence >= min_confidence) {
+            index.emplace(state.content_hash, path);
+        }
+    }
+    return index;
+}
+
+int Engine::reuse_analysis(std::vector<ScanItem>& items, ContentIndex& index, const ReuseCallback& on_reused) {
+    if (items.empty()) {
+        return 0;
+    }
+    
+    // Fingerprints read the head and tail of each file; spread them over a
+    // few threads like the pipeline's readers
+    const size_t thread_count = std::min(items.size(), static_cast<size_t>(
+        std::max(4u, std::thread::hardware_concurrency())));
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&items, &next]() {
+            for (size_t i = next++; i < items.size(); i = next++) {
+                items[i].content_hash = file_fingerprint(items[i].path);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    int reused = 0;
+    std::vector<ScanItem> remaining;
+    for (auto& item : items) {
+        auto match = item.content_hash != 0 ? index.find(item.content_hash) : index.end();
+        if (match == index.end()) {
+            remaining.push_back(std::move(item));
+            continue;
+        }
+        
+        const std::string from = match->second;
+        bool renamed = false;
+        bool stored = false;
+        if (from == item.path) {
+            // Touched but not modified
+            stored = store_->touch_track(item.path, item.file_mtime);
+        } else if (!std::filesystem::exists(from) && store_->rename_track(from, item.path)) {
+            // Moved: the row (and its id in playlists) follows the file
+            renamed = true;
+            stored = store_->touch_track(item.path, item.file_mtime);
+            match->second = item.path;
+        } else {
+            // A copy of a file that is still there gets its own row
+            stored = store_->copy_track_analysis(from, item.path, item.file_mtime).ok();
+        }
+        
+        if (!stored) {
+            remaining.push_back(std::move(item));
+            continue;
+        }
+        reused++;
+        if (on_reused) {
+            on_reused(item, from, renamed);
+        }
+    }
+    
+    items = std::move(remaining);
+    return reused;
+}
+
+bool Engine::start_watch(const std::string& music_dir, bool recursive) {
+    if (!is_valid()) {
+        last_error_ = "Engine not initialized";
+        return false;
+    }
+    if (!std::filesystem::is_directory(music_dir)) {
+        last_error_ = "Directory does not exist: " + music_dir;
+        return false;
+    }
+    
+    std::string root = utils::path_to_absolute(music_dir);
+    while (root.size() > 1 && root.back() == '/') root.pop_back();
+    
+    auto watcher = std::make_unique<LibraryWatcher>();
+    if (!watcher->add_tree(root, recursive)) {
+        last_error_ = watcher->error();
+        if (watcher->watch_count() == 0) {
+            return false;
+        }
+        // Some subdirectories could not be watched (watch limit); keep the rest
+    }
+    
+    watcher_ = std::move(watcher);     // Releases the previous (stopped) watcher
+    watch_started_ = true;
+    watch_root_ = root;
+    watch_recursive_ = recursive;
+    return true;
+}
+
+int Engine::run_watch(WatchCallback callback, ScanMode mode) {
+    if (!watcher_ || !watch_started_) {
+        last_error_ = "Watch not started";
+        return -1;
+    }
+    
+    auto report = [&callback](WatchUpdate::Kind kind, const std::string& path, const std::string& old_path = "") {
+        if (callback) {
+            callback({kind, path, old_path});
+        }
+    };
+    
+    int applied = 0;
+    std::vector<WatchEvent> events;
+    while (watcher_->wait(events, -1)) {
+        // Let a burst (an album being copied) settle into one batch
+        auto batch_start = std::chrono::steady_clock::now();
+        size_t seen = events.size();
+        while (seen > 0 && std::chrono::steady_clock::now() - batch_start < std::chrono::milliseconds(kWatchMaxBatchMs) &&
+               watcher_->wait(events, kWatchSettleMs) && events.size() > seen) {
+            seen = events.size();
+        }
+        
+        // Renames and deletions apply in order; analysis runs once at the end
+        // for the files that still exist
+        std::vector<std::string> changed;
+        std::unordered_set<std::string> changed_set;
+        bool rescan = false;
+        
+        auto mark_changed = [&](const std::string& path) {
+            if (changed_set.insert(path).second) changed.push_back(path);
+        };
+        
+        for (const auto& event : events) {
+            switch (event.type) {
+                case WatchEvent::Type::Overflow:
+                    rescan = true;
+                    break;
                 
-                float duration = local_decoder.get_duration(path_str);
-                if (duration < 0) {
-                    int p = progress_count.fetch_add(1) + 1;
-                    if (callback) {
-                        std::lock_guard<std::mutex> lock(callback_mutex);
-                        callback(path_str, p, total);
+                case WatchEvent::Type::Changed:
+                    if (event.is_directory) {
+                        for (auto& file : DirectoryWalker().walk(event.path, watch_recursive_).files) {
+                            mark_changed(file.path);
+                        }
+                    } else if (utils::is_audio_file(event.path)) {
+                        mark_changed(event.path);
                     }
-                    continue;
-                }
+                    break;
                 
-                {
-                    std::lock_guard<std::mutex> lock(store_->write_mutex());
-                    auto upsert_result = store_->upsert_track_path_duration(path_str, duration, job.file_mtime);
-                    if (upsert_result.ok()) {
-                        processed_count.fetch_add(1);
+                case WatchEvent::Type::Removed:
+                    if (event.is_directory) {
+                        int removed = store_->delete_tracks_under(event.path);
+                        if (removed > 0) {
+                            applied += removed;
+                            report(WatchUpdate::Kind::Removed, event.path);
+                        }
+                    } else if (store_->delete_track_by_path(event.path)) {
+                        applied++;
+                        report(WatchUpdate::Kind::Removed, event.path);
                     }
-                }
+                    break;
                 
-                int p = progress_count.fetch_add(1) + 1;
-                if (callback) {
-                    std::lock_guard<std::mutex> lock(callback_mutex);
-                    callback(path_str, p, total);
-                }
+                case WatchEvent::Type::Moved:
+                    if (event.is_directory) {
+                        int moved = store_->rename_directory(event.old_path, event.path);
+                        if (moved > 0) {
+                            applied += moved;
+                            report(WatchUpdate::Kind::Renamed, event.path, event.old_path);
+                        }
+                        // Pending changes follow the directory
+                        const std::string old_prefix = event.old_path + "/";
+                        for (auto& path : changed) {
+                            if (path.compare(0, old_prefix.size(), old_prefix) == 0) {
+                                path = event.path + path.substr(event.old_path.size());
+                            }
+                        }
+                        changed_set = std::unordered_set<std::string>(changed.begin(), changed.end());
+                    } else if (utils::is_audio_file(event.path) && store_->rename_track(event.old_path, event.path)) {
+                        // Same file, new name: keep the analysis
+                        applied++;
+                        report(WatchUpdate::Kind::Renamed, event.path, event.old_path);
+                        if (changed_set.erase(event.old_path)) {
+                            changed.erase(std::find(changed.begin(), changed.end(), event.old_path));
+                            mark_changed(event.path);
+                        }
+                    } else {
+                        // Not in the library (or no longer audio): a new file and a removal
+                        if (store_->delete_track_by_path(event.old_path)) {
+                            report(WatchUpdate::Kind::Removed, event.old_path);
+                        }
+                        if (utils::is_audio_file(event.path)) mark_changed(event.path);
+                    }
+                    break;
             }
-        };
-        
-        std::vector<std::thread> threads;
-        threads.reserve(num_threads);
-        for (unsigned int i = 0; i < num_threads; ++i) {
-            threads.emplace_back(worker);
         }
-        for (auto& t : threads) {
-            t.join();
+        events.clear();
+        
+        if (rescan) {
+            // The kernel dropped events: fall back to a full incremental scan
+            int result = scan(watch_root_, watch_recursive_, ScanProgressCallback(), mode);
+            report(WatchUpdate::Kind::Rescanned, watch_root_);
+            if (result > 0) applied += result;
+            continue;
         }
-    } else {
-        // Full analysis: decode + analyze
-        auto worker = [&]() {
-            Decoder local_decoder;
-            Analyzer local_analyzer;
+        
+        const float min_confidence = mode == ScanMode::Full ? kRescanConfidence : 0.0f;
+        std::vector<ScanItem> items;
+        for (const auto& path : changed) {
+            if (!std::filesystem::is_regular_file(path)) continue;  // Gone again
             
-            while (true) {
-                int idx = job_index.fetch_add(1);
-                if (idx >= static_cast<int>(jobs.size())) break;
-                
-                const auto& job = jobs[idx];
-                std::string path_str = utils::path_to_absolute(job.path);
-                
-                auto decode_result = local_decoder.decode_for_analysis(path_str);
-                if (decode_result.failed()) {
-                    int p = progress_count.fetch_add(1) + 1;
-                    if (callback) {
-                        std::lock_guard<std::mutex> lock(callback_mutex);
-                        callback(path_str, p, total);
-                    }
-                    continue;
+            int64_t file_mtime = utils::file_modified_time(path);
+            if (!store_->needs_analysis(path, file_mtime, min_confidence)) continue;
+            
+            ScanItem item;
+            item.path = path;
+            item.file_mtime = file_mtime;
+            items.push_back(std::move(item));
+        }
+        
+        if (!items.empty()) {
+            ContentIndex content = make_content_index(store_->get_scan_snapshot(), min_confidence);
+            applied += reuse_analysis(items, content, [&](const ScanItem& item, const std::string& from, bool renamed) {
+                if (renamed) {
+                    report(WatchUpdate::Kind::Renamed, item.path, from);
+                } else {
+                    report(WatchUpdate::Kind::Analyzed, item.path);
                 }
-                
-                auto analyze_result = local_analyzer.analyze(decode_result.value());
-                if (analyze_result.failed()) {
-                    int p = progress_count.fetch_add(1) + 1;
-                    if (callback) {
-                        std::lock_guard<std::mutex> lock(callback_mutex);
-                        callback(path_str, p, total);
-                    }
-                    continue;
+            });
+        }
+        
+        if (!items.empty()) {
+            applied += analyze_items(std::move(items), mode, [&](const ScanItem& item, bool ok, const ScanStats&) {
+                report(ok ? WatchUpdate::Kind::Analyzed : WatchUpdate::Kind::Failed, item.path);
+            });
+        }
+    }
+    
+    // The watcher stays alive until the next start_watch() or the Engine's
+    // destruction, so a late stop_watch() never touches a freed object
+    watch_started_ = false;
+    return applied;
+}
+
+void Engine::stop_watch() {
+    if (watcher_) {
+        watcher_->stop();
+    }
+}
+
+void Engine::set_directory_cache(bool enabled) {
+    directory_cache_ = enabled;
+}
+
+ScanPipeline Engine::make_scan_pipeline(ScanMode mode, size_t jobs, StoreWriter& writer) {
+    const bool metadata_only = mode == ScanMode::MetadataOnly;
+    const bool fast = mode == ScanMode::Fast;
+    const bool streaming = analyzer_config_.streaming && !fast;
+    
+    // Whole files are read ahead for full analysis only: excerpts read a
+    // fraction of each file, duration probes only the header and streaming
+    // analysis reads the file as it decodes, so memory stays bounded
+    const bool read_ahead = mode == ScanMode::Full && !streaming;
+    
+    ScanConcurrency workers = ScanPipeline::auto_concurrency(
+        scan_concurrency_, std::thread::hardware_concurrency(), read_ahead, !metadata_only);
+    if (streaming) {
+        // Streaming analysis decodes inside the analyze stage
+        if (scan_concurrency_.analyzers <= 0) workers.analyzers += workers.decoders;
+        workers.decoders = 0;
+    }
+    auto cap = [jobs](int n) { return std::min(n, static_cast<int>(jobs)); };
+    
+    ScanPipeline::Stage read;
+    if (read_ahead) {
+        read.workers = cap(workers.readers);
+        read.factory = []() -> ScanPipeline::StageFn {
+            return [](ScanItem& item) {
+                auto result = Decoder::read_file(item.path);
+                if (result.failed()) {
+                    item.error = result.error();
+                    return false;
                 }
-                
-                TrackInfo track;
-                track.path = path_str;
-                track.bpm = analyze_result.value().bpm;
-                track.beats = analyze_result.value().beats;
-                track.key = analyze_result.value().key;
-                track.mfcc = analyze_result.value().mfcc;
-                track.chroma = analyze_result.value().chroma;
-                track.energy_curve = analyze_result.value().energy_curve;
-                track.duration = analyze_result.value().duration;
-                track.analyzed_at = utils::current_timestamp();
-                track.file_modified_at = job.file_mtime;
-                
-                {
-                    std::lock_guard<std::mutex> lock(store_->write_mutex());
-                    auto upsert_result = store_->upsert_track(track);
-                    if (upsert_result.ok()) {
-                        processed_count.fetch_add(1);
+                item.file = std::move(result.value());
+                return true;
+            };
+        };
+    }
+    
+    ScanPipeline::Stage decode;
+    decode.workers = cap(workers.decoders);
+    if (metadata_only) {
+        decode.factory = []() -> ScanPipeline::StageFn {
+            auto decoder = std::make_shared<Decoder>();
+            return [decoder](ScanItem& item) {
+                item.duration = decoder->get_duration(item.path);
+                if (item.duration < 0) {
+                    item.error = "Failed to read duration";
+                    return false;
+                }
+                return true;
+            };
+        };
+    } else if (fast) {
+        decode.factory = []() -> ScanPipeline::StageFn {
+            auto decoder = std::make_shared<Decoder>();
+            return [decoder](ScanItem& item) {
+                auto result = decoder->decode_excerpts(item.path);
+                if (result.failed()) {
+                    item.error = result.error();
+                    return false;
+                }
+                item.excerpts = std::move(result.value());
+                return true;
+            };
+        };
+    } else if (!streaming) {
+        decode.factory = []() -> ScanPipeline::StageFn {
+            auto decoder = std::make_shared<Decoder>();
+            return [decoder](ScanItem& item) {
+                auto result = decoder->decode_for_analysis(item.file);
+                item.file = EncodedFile();
+                if (result.failed()) {
+                    item.error = result.error();
+                    return false;
+                }
+                item.audio = std::move(result.value());
+                return true;
+            };
+        };
+    }
+    
+    ScanPipeline::Stage analyze;
+    if (!metadata_only) {
+        analyze.workers = cap(workers.analyzers);
+        AnalyzerConfig config = analyzer_config_;
+        analyze.factory = [config, fast, streaming]() -> ScanPipeline::StageFn {
+            auto decoder = std::make_shared<Decoder>();
+            auto analyzer = std::make_shared<Analyzer>(config);
+            return [decoder, analyzer, fast, streaming](ScanItem& item) {
+                Result<TrackFeatures> result = "No audio";
+                if (fast) {
+                    result = analyzer->analyze_excerpts(item.excerpts);
+                    item.excerpts = TrackExcerpts();
+                } else if (streaming) {
+                    // Decoded chunks go straight into the feature accumulators
+                    analyzer->begin_stream(Decoder::kAnalysisSampleRate);
+                    auto stream_result = decoder->stream_for_analysis(item.path, [&](const float* samples, size_t frames) {
+                        analyzer->push_stream(samples, frames);
+                        return true;
+                    });
+                    result = analyzer->finish_stream();
+                    if (stream_result.failed()) {
+                        result = ResultError{stream_result.error()};
                     }
+                } else {
+                    result = analyzer->analyze(item.audio);
+                    item.audio = AudioBuffer();
                 }
-                
-                int p = progress_count.fetch_add(1) + 1;
-                if (callback) {
-                    std::lock_guard<std::mutex> lock(callback_mutex);
-                    callback(path_str, p, total);
+                if (result.failed()) {
+                    item.error = result.error();
+                    return false;
                 }
-            }
+                item.features = std::move(result.value());
+                return true;
+            };
         };
-        
-        std::vector<std::thread> threads;
-        threads.reserve(num_threads);
-        for (unsigned int i = 0; i < num_threads; ++i) {
-            threads.emplace_back(worker);
-        }
-        for (auto& t : threads) {
-            t.join();
-        }
     }
     
-    store_->cleanup_missing_files();
-    return already_analyzed + processed_count.load();
+    // Hand rows to the batched writer; it reports write failures after commit
+    ScanPipeline::StageFn write = [&writer, metadata_only](ScanItem& item) {
+        if (metadata_only) {
+            writer.upsert_track_path_duration(item.path, item.duration, item.file_mtime, nullptr);
+            return true;
+        }
+        
+        const TrackFeatures& features = item.features;
+        TrackInfo track;
+        track.path = item.path;
+        track.bpm = features.bpm;
+        track.beats = features.beats;
+        track.key = features.key;
+        track.mfcc = features.mfcc;
+        track.chroma = features.chroma;
+        track.energy_curve = features.energy_curve;
+        track.duration = features.duration;
+        track.analyzed_at = utils::current_timestamp();
+        track.file_modified_at = item.file_mtime;
+        track.confidence = features.confidence.overall();
+        track.content_hash = item.content_hash;
+        
+        writer.upsert_track(std::move(track), nullptr);
+        return true;
+    };
+    
+    return ScanPipeline(std::move(read), std::move(decode), std::move(analyze), std::move(write),
+                        workers.queue_depth);
+}
+
+void Engine::set_scan_concurrency(const ScanConcurrency& concurrency) {
+    scan_concurrency_ = concurrency;
+}
+
+void Engine::set_analyzer_config(const AnalyzerConfig& config) {
+    analyzer_config_ = config;
+    analyzer_ = std::make_unique<Analyzer>(config);
 }
 
 int Engine::track_count() const {
@@ -239,23 +646,44 @@ Playlist Engine::generate_playlist(
     int count,
     const PlaylistRules& rules
 ) {
-    auto seed_opt = store_->get_track(seed_track_id);
-    if (!seed_opt) {
+    const FeatureMatrix& library = library_features();
+    auto seed = library.index_of(seed_track_id);
+    if (!seed) {
         last_error_ = "Seed track not found";
         return Playlist{};
     }
     
-    auto candidates = store_->get_all_tracks();
-    
+    playlist_generator_->set_candidate_index(
+        library.size() >= kSimilarityIndexMinTracks ? &similarity_index_ : nullptr);
+    playlist_generator_->set_compatibility_index(&compatibility_index_);
     return playlist_generator_->generate(
-        *seed_opt,
-        candidates,
+        library,
+        *seed,
         count,
         rules,
-        transition_config_
+        transition_config_,
+        [this](int64_t id) { return store_->get_track(id); }
     );
 }
 
+const FeatureMatrix& Engine::library_features() {
+    int64_t version = store_->data_version();
+    if (version != library_features_version_) {
+        FeatureMatrix features;
+        features.reserve(static_cast<size_t>(store_->get_track_count()));
+        store_->for_each_track_features([&features](const TrackInfo& track) {
+            features.append(track);
+        });
+        library_features_ = std::make_shared<const FeatureMatrix>(std::move(features));
+        library_features_version_ = version;
+        compatibility_index_.build(*library_features_);
+        if (library_features_->size() >= kSimilarityIndexMinTracks) {
+            similarity_index_.sync(*library_features_);
+        }
+    }
+    return *library_features_;
+}
+
 Playlist Engine::create_playlist(const std::vector<int64_t>& track_ids) {
     std::vector<TrackInfo> tracks;
     tracks.reserve(track_ids.size());
@@ -286,6 +714,68 @@ bool Engine::play(const Playlist& playlist) {
     return true;
 }
 
+bool Engine::play_session(
+    int64_t seed_track_id,
+    const PlaylistRules& rules,
+    const PlaylistSession::Options& options
+) {
+    auto seed = library_features().index_of(seed_track_id);
+    if (!seed) {
+        last_error_ = "Seed track not found";
+        return false;
+    }
+    
+    // Start audio first so we can decode tracks to the actual output sample rate.
+    if (!audio_output_->is_running()) {
+        start_audio();  // best-effort; playback can still run without platform output
+    }
+    
+    auto session = std::make_shared<PlaylistSession>(
+        library_features_,
+        *seed,
+        rules,
+        transition_config_,
+        [this](int64_t id) { return store_->get_track(id); },
+        options
+    );
+    if (!scheduler_->load_source(std::move(session))) {
+        last_error_ = "Failed to start playlist session";
+        return false;
+    }
+    
+    scheduler_->play();
+    
+    return true;
+}
+
+bool Engine::queue_insert(size_t position, int64_t track_id) {
+    if (!store_->get_track(track_id)) {
+        last_error_ = "Track not found";
+        return false;
+    }
+    return scheduler_->insert_entry(position, track_id);
+}
+
+bool Engine::queue_remove(size_t position) {
+    return scheduler_->remove_entry(position);
+}
+
+bool Engine::queue_move(size_t from, size_t to) {
+    return scheduler_->move_entry(from, to);
+}
+
+bool Engine::queue_replace(size_t position, int64_t track_id) {
+    if (!store_->get_track(track_id)) {
+        last_error_ = "Track not found";
+        return false;
+    }
+    return scheduler_->replace_entry(position, track_id);
+}
+
+std::vector<int64_t> Engine::queue() const {
+    return scheduler_->queue();
+}
+
 void Engine::pause() {
     scheduler_->pause();
 }
@@ -7,14 +7,19 @@
 
 #include "automix/types.h"
 #include "scheduler.h"
+#include "playlist_session.h"
+#include "scan_pipeline.h"
 #include "audio_output.h"
 #include "../core/store.h"
+#include "../core/store_writer.h"
+#include "../core/library_watcher.h"
 #include "../decoder/decoder.h"
 #include "../analyzer/analyzer.h"
 #include "../matcher/playlist.h"
 #include <memory>
 #include <string>
 #include <functional>
+#include <unordered_map>
 
 namespace automix {
 
@@ -23,6 +28,46 @@ namespace automix {
  */
 using ScanCallback = std::function<void(const std::string& file, int processed, int total)>;
 
+/**
+ * Scan progress with per-stage pipeline statistics.
+ */
+struct ScanProgress {
+    std::string file;
+    int processed = 0;
+    int total = 0;
+    ScanStats stats;                    // Pipeline stages so far (zero for already-analyzed files)
+};
+
+using ScanProgressCallback = std::function<void(const ScanProgress& progress)>;
+
+/**
+ * A library change applied in watch mode.
+ */
+struct WatchUpdate {
+    enum class Kind {
+        Analyzed,                       // New or modified file analyzed and stored
+        Failed,                         // New or modified file could not be analyzed
+        Renamed,                        // File or directory moved; analysis kept
+        Removed,                        // File or directory deleted from the library
+        Rescanned                       // Events were lost; the folder was rescanned
+    };
+    
+    Kind kind;
+    std::string path;
+    std::string old_path;               // Renamed only
+};
+
+using WatchCallback = std::function<void(const WatchUpdate& update)>;
+
+/**
+ * What a library scan computes for new or changed files.
+ */
+enum class ScanMode {
+    Full,           // Decode and analyze whole tracks
+    Fast,           // Analyze a few excerpts per track; low-confidence tracks are redone by a later Full scan
+    MetadataOnly    // Path, duration and mtime only
+};
+
 /**
  * Main AutoMix Engine class.
  * Coordinates all components: scanning, analysis, playlist generation, and playback.
@@ -60,6 +105,85 @@ public:
      */
     int scan(const std::string& music_dir, bool recursive = true, ScanCallback callback = nullptr, bool metadata_only = false);
     
+    /**
+     * Scan a directory for music files with the given scan mode.
+     * Full scans also re-analyze tracks whose fast-scan confidence is below
+     * kRescanConfidence.
+     * 
+     * Files go through a staged pipeline (read, decode, analyze, then a
+     * single store writer) with bounded queues between stages; see
+     * set_scan_concurrency(). progress is called on the writer thread.
+     * @return Number of tracks processed
+     */
+    int scan(const std::string& music_dir, bool recursive, ScanProgressCallback progress, ScanMode mode);
+    
+    // Fast-scan results below this confidence are redone by the next full scan
+    static constexpr float kRescanConfidence = 0.6f;
+    
+    /**
+     * Set analyzer configuration used by subsequent scans
+     * (e.g. RhythmMethod::Degara for faster bulk scans).
+     */
+    void set_analyzer_config(const AnalyzerConfig& config);
+    
+    /**
+     * Get analyzer configuration.
+     */
+    const AnalyzerConfig& analyzer_config() const { return analyzer_config_; }
+    
+    /**
+     * Set per-stage worker counts for subsequent scans (0 = auto).
+     */
+    void set_scan_concurrency(const ScanConcurrency& concurrency);
+    
+    const ScanConcurrency& scan_concurrency() const { return scan_concurrency_; }
+    
+    /**
+     * Skip listing directories whose mtime is unchanged since the last
+     * recursive scan of the same directory (default on). Their files are
+     * taken from the library and only stat'ed, so files edited in place
+     * are still picked up.
+     */
+    void set_directory_cache(bool enabled);
+    
+    bool directory_cache() const { return directory_cache_; }
+    
+    /* ========================================================================
+     * Watch Mode
+     * ======================================================================== */
+    
+    /**
+     * Start watching a music directory for changes (Linux/inotify).
+     * Changes are queued from this point on; run a scan afterwards to catch
+     * up with changes made while not watching, then call run_watch().
+     * @return false if watching is unsupported or the directory is invalid
+     */
+    bool start_watch(const std::string& music_dir, bool recursive = true);
+    
+    /**
+     * Apply queued and future changes until stop_watch(): new and modified
+     * files go through the scan pipeline, deletions remove tracks, and
+     * renames update the stored path without re-analysis. Blocks.
+     * @return Number of library changes applied, or -1 if not started
+     */
+    int run_watch(WatchCallback callback = nullptr, ScanMode mode = ScanMode::Full);
+    
+    /**
+     * Make run_watch() return. Safe from other threads and signal handlers,
+     * also while or after run_watch() returns; only not concurrently with
+     * start_watch().
+     */
+    void stop_watch();
+    
+    // Watch mode batches a burst of events: wait until quiet this long, at most kWatchMaxBatchMs
+    static constexpr int kWatchSettleMs = 500;
+    static constexpr int kWatchMaxBatchMs = 5000;
+    
+    /**
+     * Pipeline statistics of the last scan.
+     */
+    const ScanStats& last_scan_stats() const { return last_scan_stats_; }
+    
     /**
      * Get total track count in library.
      */
@@ -108,6 +232,18 @@ public:
      */
     bool play(const Playlist& playlist);
     
+    /**
+     * Start an endless mix from a seed track. Tracks and transitions are
+     * generated during playback by a PlaylistSession, a few tracks ahead,
+     * so playback starts after one generation step and memory stays
+     * constant however long it runs.
+     */
+    bool play_session(
+        int64_t seed_track_id,
+        const PlaylistRules& rules = PlaylistRules(),
+        const PlaylistSession::Options& options = PlaylistSession::Options()
+    );
+    
     /**
      * Pause playback.
      */
@@ -142,6 +278,22 @@ public:
      */
     bool seek(float position);
     
+    /**
+     * Edit the upcoming tracks while playing (see Scheduler): positions
+     * count from the current track (0) and the next track is position 1.
+     * Only the transitions next to an edit are re-planned.
+     * @return false if a position is out of range or the track is unknown
+     */
+    bool queue_insert(size_t position, int64_t track_id);
+    bool queue_remove(size_t position);
+    bool queue_move(size_t from, size_t to);
+    bool queue_replace(size_t position, int64_t track_id);
+    
+    /**
+     * Track IDs from the current track on (index = position).
+     */
+    std::vector<int64_t> queue() const;
+    
     /**
      * Get current playback state.
      */
@@ -230,6 +382,33 @@ private:
     // Track loader callback for scheduler
     Result<AudioBuffer> load_track_audio(int64_t track_id);
     
+    // Build the read/decode/analyze/write stages for a scan of `jobs` files
+    ScanPipeline make_scan_pipeline(ScanMode mode, size_t jobs, StoreWriter& writer);
+    
+    // Run items through the pipeline and commit them; returns files stored
+    int analyze_items(std::vector<ScanItem> items, ScanMode mode, const ScanPipeline::DoneCallback& on_done);
+    
+    // Analyzed content by fingerprint: hash -> path of a track usable as is
+    using ContentIndex = std::unordered_map<uint64_t, std::string>;
+    static ContentIndex make_content_index(const TrackScanSnapshot& library, float min_confidence);
+    
+    // Called for an item whose analysis was taken from the track at `from`
+    // (renamed: that row now belongs to the item's path)
+    using ReuseCallback = std::function<void(const ScanItem& item, const std::string& from, bool renamed)>;
+    
+    // Fingerprint items and store moved, renamed, touched or duplicated files
+    // from the analysis the library already has. Reused items are removed
+    // from `items`; returns their number
+    int reuse_analysis(std::vector<ScanItem>& items, ContentIndex& index, const ReuseCallback& on_reused);
+    
+    // Feature matrix of the whole library, rebuilt when the store changed
+    // along with the BPM/key buckets (and the similarity index on large
+    // libraries)
+    const FeatureMatrix& library_features();
+    
+    // Libraries smaller than this are scanned in full for each playlist step
+    static constexpr size_t kSimilarityIndexMinTracks = 5000;
+    
     std::unique_ptr<Store> store_;
     std::unique_ptr<Decoder> decoder_;
     std::unique_ptr<Analyzer> analyzer_;
@@ -239,6 +418,20 @@ private:
     std::unique_ptr<AudioOutput> audio_output_;
     
     TransitionConfig transition_config_;
+    AnalyzerConfig analyzer_config_;
+    ScanConcurrency scan_concurrency_;
+    ScanStats last_scan_stats_;
+    bool directory_cache_ = true;
+    
+    std::unique_ptr<LibraryWatcher> watcher_;      // Kept after run_watch() returns
+    bool watch_started_ = false;                    // start_watch() not yet followed by run_watch()
+    std::string watch_root_;
+    bool watch_recursive_ = true;
+    
+    std::shared_ptr<const FeatureMatrix> library_features_ = std::make_shared<const FeatureMatrix>();  // Shared with playlist sessions
+    int64_t library_features_version_ = -1;
+    AnnIndex similarity_index_;
+    CompatibilityIndex compatibility_index_;
     std::string last_error_;
 };
 
@@ -0,0 +1,139 @@
+/**
+ * AutoMix Engine - Streaming Playlist Session Implementation
+ */
+
+#include "playlist_session.h"
+#include <algorithm>
+
+namespace automix {
+
+PlaylistSession::PlaylistSession(
+    std::shared_ptr<const FeatureMatrix> library,
+    size_t seed,
+    const PlaylistRules& rules,
+    const TransitionConfig& config,
+    PlaylistGenerator::TrackLoader load_track,
+    const Options& options
+)
+    : library_(std::move(library))
+    , seed_(seed)
+    , rules_(rules)
+    , config_(config)
+    , load_track_(std::move(load_track))
+    , options_(options) {
+    options_.lookahead = std::max<size_t>(1, options_.lookahead);
+    if (options_.repeat_after == 0) {
+        options_.repeat_after = std::max<size_t>(1, library_->size() / 2);
+    }
+    
+    // Runs beside playback: one thread is plenty for a track per transition
+    generator_.set_threads(1);
+    
+    worker_ = std::thread([this]() { run(); });
+}
+
+PlaylistSession::~PlaylistSession() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    worker_.join();
+}
+
+std::optional<PlaylistEntry> PlaylistSession::next_entry(bool wait) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (wait) {
+        ready_changed_.wait(lock, [this]() { return !ready_.empty() || ended_; });
+    }
+    if (ready_.empty()) {
+        return std::nullopt;
+    }
+    
+    PlaylistEntry entry = std::move(ready_.front());
+    ready_.pop_front();
+    taken_++;
+    lock.unlock();
+    
+    wake_.notify_one();
+    return entry;
+}
+
+bool PlaylistSession::ended() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ended_ && ready_.empty();
+}
+
+size_t PlaylistSession::taken() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return taken_;
+}
+
+void PlaylistSession::run() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this]() { return stop_ || ready_.size() < options_.lookahead; });
+            if (stop_) {
+                return;
+            }
+        }
+        
+        bool ended = false;
+        std::optional<PlaylistEntry> entry = step(ended);
+        
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (entry) {
+                ready_.push_back(std::move(*entry));
+            }
+            ended_ = ended;
+        }
+        ready_changed_.notify_all();
+        if (ended) {
+            return;
+        }
+    }
+}
+
+std::optional<PlaylistEntry> PlaylistSession::step(bool& ended) {
+    const FeatureMatrix& library = *library_;
+    
+    // First step: start the walk at the seed
+    if (!pending_) {
+        pending_track_ = load_track_(library.id(seed_));
+        if (!pending_track_) {
+            ended = true;
+            return std::nullopt;
+        }
+        compatibility_index_.build(library);
+        generator_.set_compatibility_index(&compatibility_index_);
+        generator_.start(library, seed_, rules_, options_.arc_length, options_.repeat_after);
+        
+        pending_ = PlaylistEntry{};
+        pending_->track_id = library.id(seed_);
+        return std::nullopt;
+    }
+    
+    auto next = generator_.next_track();
+    if (!next) {
+        ended = true;  // The pending entry is the last one
+        return std::move(pending_);
+    }
+    
+    std::optional<TrackInfo> next_track = load_track_(library.id(*next));
+    if (!next_track) {
+        return std::nullopt;  // Gone from the library since the snapshot
+    }
+    generator_.accept(*next);
+    
+    PlaylistEntry completed = std::move(*pending_);
+    completed.transition_to_next = transition_finder_.create_plan(*pending_track_, *next_track, config_);
+    
+    pending_ = PlaylistEntry{};
+    pending_->track_id = library.id(*next);
+    pending_track_ = std::move(next_track);
+    return completed;
+}
+
+} // namespace automix
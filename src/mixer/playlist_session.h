@@ -0,0 +1,104 @@
+/**
+ * AutoMix Engine - Streaming Playlist Session
+ */
+
+#ifndef AUTOMIX_PLAYLIST_SESSION_H
+#define AUTOMIX_PLAYLIST_SESSION_H
+
+#include "automix/types.h"
+#include "scheduler.h"
+#include "../matcher/playlist.h"
+#include "../matcher/compatibility_index.h"
+#include "../matcher/transition_points.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace automix {
+
+/**
+ * An open-ended playlist generated while it plays. A background thread
+ * walks the library from a seed track (PlaylistGenerator::start) and keeps
+ * `lookahead` entries ready, each with the transition to the entry after
+ * it planned. Taking an entry wakes the thread to generate the next one,
+ * so generation keeps one track-length ahead of the upcoming transition.
+ *
+ * The first entry is ready after one step, whatever the length of the mix,
+ * and memory stays constant: played tracks are offered again once
+ * `repeat_after` others have played, so the session only ends when the
+ * library runs out.
+ */
+class PlaylistSession : public PlaylistSource {
+public:
+    struct Options {
+        size_t lookahead = 3;           // K: entries kept ready
+        int arc_length = 32;            // Tracks per rules.energy_arc cycle
+        size_t repeat_after = 0;        // Tracks before one plays again; 0 = half the library (at least 1)
+    };
+    
+    /**
+     * Start generating from row `seed` of a snapshot of the library.
+     * load_track is called on the session thread.
+     */
+    PlaylistSession(
+        std::shared_ptr<const FeatureMatrix> library,
+        size_t seed,
+        const PlaylistRules& rules,
+        const TransitionConfig& config,
+        PlaylistGenerator::TrackLoader load_track,
+        const Options& options
+    );
+    
+    /**
+     * Stops the session thread.
+     */
+    ~PlaylistSession() override;
+    
+    // Non-copyable
+    PlaylistSession(const PlaylistSession&) = delete;
+    PlaylistSession& operator=(const PlaylistSession&) = delete;
+    
+    std::optional<PlaylistEntry> next_entry(bool wait) override;
+    bool ended() const override;
+    
+    /**
+     * Entries handed out so far.
+     */
+    size_t taken() const;
+
+private:
+    std::shared_ptr<const FeatureMatrix> library_;
+    size_t seed_;
+    PlaylistRules rules_;
+    TransitionConfig config_;
+    PlaylistGenerator::TrackLoader load_track_;
+    Options options_;
+    
+    // Session thread only
+    PlaylistGenerator generator_;
+    CompatibilityIndex compatibility_index_;
+    TransitionPointFinder transition_finder_;
+    std::optional<PlaylistEntry> pending_;      // Latest track, its transition not yet planned
+    std::optional<TrackInfo> pending_track_;
+    
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;              // Session thread: room in ready_ or stop
+    std::condition_variable ready_changed_;     // Consumers: entry ready or ended
+    std::deque<PlaylistEntry> ready_;
+    size_t taken_ = 0;
+    bool ended_ = false;
+    bool stop_ = false;
+    std::thread worker_;
+    
+    void run();
+    
+    // Generate the next track; returns the entry it completes, if any.
+    // `ended` is set once no track is left (the last entry is returned)
+    std::optional<PlaylistEntry> step(bool& ended);
+};
+
+} // namespace automix
+
+#endif // AUTOMIX_PLAYLIST_SESSION_H
@@ -0,0 +1,166 @@
+/**
+ * AutoMix Engine - Staged Library Scan Pipeline Implementation
+ */
+
+#include "scan_pipeline.h"
+#include "../core/bounded_queue.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+namespace automix {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct StageCounters {
+    int workers = 0;
+    std::atomic<int> completed{0};
+    std::atomic<int> failed{0};
+    std::atomic<int64_t> busy_ns{0};
+    
+    void record(Clock::time_point begin, bool ok) {
+        busy_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count());
+        (ok ? completed : failed).fetch_add(1);
+    }
+    
+    ScanStageStats snapshot() const {
+        ScanStageStats stats;
+        stats.workers = workers;
+        stats.completed = completed.load();
+        stats.failed = failed.load();
+        stats.busy_seconds = static_cast<double>(busy_ns.load()) * 1e-9;
+        return stats;
+    }
+};
+
+} // namespace
+
+ScanPipeline::ScanPipeline(Stage read, Stage decode, Stage analyze, StageFn write, int queue_depth)
+    : stages_{std::move(read), std::move(decode), std::move(analyze)}
+    , write_(std::move(write))
+    , queue_depth_(std::max(1, queue_depth)) {}
+
+ScanStats ScanPipeline::run(std::vector<ScanItem> items, const DoneCallback& on_done) {
+    using Queue = BoundedQueue<ScanItem>;
+    const auto start = Clock::now();
+    
+    // read, decode, analyze, write
+    StageCounters counters[4];
+    auto snapshot = [&]() {
+        ScanStats stats;
+        stats.read = counters[0].snapshot();
+        stats.decode = counters[1].snapshot();
+        stats.analyze = counters[2].snapshot();
+        stats.write = counters[3].snapshot();
+        stats.elapsed_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        return stats;
+    };
+    
+    // Stages in use, each with its own input queue
+    std::vector<int> active;
+    std::vector<std::unique_ptr<Queue>> inputs;
+    for (int s = 0; s < 3; ++s) {
+        if (stages_[s].factory && stages_[s].workers > 0) {
+            active.push_back(s);
+            counters[s].workers = stages_[s].workers;
+            inputs.push_back(std::make_unique<Queue>(static_cast<size_t>(queue_depth_) * stages_[s].workers));
+        }
+    }
+    counters[3].workers = 1;
+    
+    Queue to_writer(static_cast<size_t>(queue_depth_) * 4);
+    Queue* first = inputs.empty() ? &to_writer : inputs.front().get();
+    
+    // Single writer: store writes and progress callbacks stay on one thread
+    std::thread writer([&]() {
+        ScanItem item;
+        while (to_writer.pop(item)) {
+            bool ok = item.error.empty();
+            if (ok) {
+                auto begin = Clock::now();
+                ok = write_(item);
+                counters[3].record(begin, ok);
+            }
+            if (on_done) {
+                on_done(item, ok, snapshot());
+            }
+            item = ScanItem();  // Release file contents / audio before waiting again
+        }
+    });
+    
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<std::atomic<int>>> running;
+    for (size_t k = 0; k < active.size(); ++k) {
+        const int s = active[k];
+        Queue* in = inputs[k].get();
+        Queue* out = k + 1 < active.size() ? inputs[k + 1].get() : &to_writer;
+        running.push_back(std::make_unique<std::atomic<int>>(stages_[s].workers));
+        std::atomic<int>* remaining = running.back().get();
+        
+        for (int w = 0; w < stages_[s].workers; ++w) {
+            workers.emplace_back([this, &counters, &to_writer, s, in, out, remaining]() {
+                StageFn process = stages_[s].factory();
+                ScanItem item;
+                while (in->pop(item)) {
+                    auto begin = Clock::now();
+                    bool ok = process(item);
+                    counters[s].record(begin, ok);
+                    // Failed items go straight to the writer to be reported
+                    (ok ? out : &to_writer)->push(std::move(item));
+                }
+                // The last worker of a stage ends the next stage's input
+                if (remaining->fetch_sub(1) == 1 && out != &to_writer) {
+                    out->close();
+                }
+            });
+        }
+    }
+    
+    for (auto& item : items) {
+        first->push(std::move(item));
+    }
+    if (first != &to_writer) {
+        first->close();
+    }
+    
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    to_writer.close();
+    writer.join();
+    
+    return snapshot();
+}
+
+ScanConcurrency ScanPipeline::auto_concurrency(ScanConcurrency requested, unsigned int hw_threads,
+                                               bool read_ahead, bool analyze) {
+    const int hw = static_cast<int>(hw_threads > 0 ? hw_threads : 4);
+    ScanConcurrency result = requested;
+    
+    // Readers mostly wait on storage; several requests in flight hide
+    // network latency without costing CPU
+    result.readers = read_ahead ? (requested.readers > 0 ? requested.readers : 4) : 0;
+    
+    if (result.decoders <= 0) {
+        // Decoding is cheaper than analysis; without analysis (duration
+        // probes) the decode stage is I/O bound as well
+        result.decoders = analyze ? std::max(1, hw / 3) : std::max(4, hw);
+    }
+    
+    if (!analyze) {
+        result.analyzers = 0;
+    } else if (result.analyzers <= 0) {
+        result.analyzers = std::max(1, hw - result.decoders);
+    }
+    
+    if (result.queue_depth <= 0) {
+        result.queue_depth = 2;
+    }
+    return result;
+}
+
+} // namespace automix
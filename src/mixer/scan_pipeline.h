@@ -0,0 +1,127 @@
+/**
+ * AutoMix Engine - Staged Library Scan Pipeline
+ */
+
+#ifndef AUTOMIX_SCAN_PIPELINE_H
+#define AUTOMIX_SCAN_PIPELINE_H
+
+#include "automix/types.h"
+#include "../decoder/decoder.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace automix {
+
+/**
+ * One file travelling through the scan pipeline. Each stage fills in its
+ * output and later stages consume (and may release) it.
+ */
+struct ScanItem {
+    std::string path;
+    int64_t file_mtime = 0;
+    uint64_t content_hash = 0;          // file_fingerprint(), 0 = not computed
+    
+    EncodedFile file;                   // Read stage
+    AudioBuffer audio;                  // Decode stage (whole-track analysis)
+    TrackExcerpts excerpts;             // Decode stage (fast scan)
+    float duration = 0.0f;              // Decode stage (metadata-only scan)
+    TrackFeatures features;             // Analyze stage
+    
+    std::string error;                  // Set by the stage that failed
+};
+
+/**
+ * Counters for one pipeline stage.
+ */
+struct ScanStageStats {
+    int workers = 0;                    // 0 = stage not used by this scan
+    int completed = 0;
+    int failed = 0;
+    double busy_seconds = 0.0;          // Summed over workers
+    
+    /**
+     * Files per second finished by this stage over the scan so far.
+     */
+    double throughput(double elapsed_seconds) const {
+        return elapsed_seconds > 0.0 ? (completed + failed) / elapsed_seconds : 0.0;
+    }
+    
+    /**
+     * Share of worker time spent working rather than waiting (0 to 1).
+     * A saturated stage near 1 is the bottleneck.
+     */
+    double utilization(double elapsed_seconds) const {
+        return elapsed_seconds > 0.0 && workers > 0 ? busy_seconds / (elapsed_seconds * workers) : 0.0;
+    }
+};
+
+struct ScanStats {
+    ScanStageStats read;
+    ScanStageStats decode;
+    ScanStageStats analyze;
+    ScanStageStats write;
+    double elapsed_seconds = 0.0;
+};
+
+/**
+ * Per-stage worker counts for a scan. 0 picks a value from the hardware
+ * concurrency and the scan mode (see ScanPipeline::auto_concurrency).
+ */
+struct ScanConcurrency {
+    int readers = 0;                    // File I/O (many in flight helps network storage)
+    int decoders = 0;
+    int analyzers = 0;
+    int queue_depth = 0;                // Items buffered between stages, per downstream worker
+};
+
+/**
+ * Runs scan items through read -> decode -> analyze stages, each with its
+ * own worker threads, joined by bounded queues, and a single writer thread.
+ *
+ * Queues bound the memory held in flight (file contents, decoded audio).
+ * An item whose stage fails skips straight to the writer so it is still
+ * reported. The writer and on_done run on one thread, so store writes and
+ * progress callbacks are serialized.
+ */
+class ScanPipeline {
+public:
+    // Process one item; return false (with item.error set) if it failed
+    using StageFn = std::function<bool(ScanItem&)>;
+    
+    // Called once per worker thread so workers can own a Decoder/Analyzer
+    using StageFactory = std::function<StageFn()>;
+    
+    using DoneCallback = std::function<void(const ScanItem& item, bool ok, const ScanStats& stats)>;
+    
+    struct Stage {
+        StageFactory factory;           // Null: stage not used, items pass through
+        int workers = 1;
+    };
+    
+    ScanPipeline(Stage read, Stage decode, Stage analyze, StageFn write, int queue_depth = 2);
+    
+    /**
+     * Process all items; blocks until every item has reached the writer.
+     * on_done is called for every item after it was written (ok) or failed.
+     * @return Final statistics
+     */
+    ScanStats run(std::vector<ScanItem> items, const DoneCallback& on_done);
+    
+    /**
+     * Fill zero fields of `requested` for the given hardware thread count.
+     * Readers only count when file contents are read ahead; analyzers only
+     * when there is an analysis stage.
+     */
+    static ScanConcurrency auto_concurrency(ScanConcurrency requested, unsigned int hw_threads,
+                                            bool read_ahead, bool analyze);
+
+private:
+    Stage stages_[3];
+    StageFn write_;
+    int queue_depth_;
+};
+
+} // namespace automix
+
+#endif // AUTOMIX_SCAN_PIPELINE_H
@@ -35,6 +35,10 @@ void Scheduler::set_status_callback(StatusCallback callback) {
     status_callback_ = std::move(callback);
 }
 
+void Scheduler::set_transition_planner(TransitionPlanner planner) {
+    transition_planner_ = std::move(planner);
+}
+
 void Scheduler::set_sample_rate(int sample_rate) {
     sample_rate_ = sample_rate > 0 ? sample_rate : 44100;
 }
@@ -44,6 +48,28 @@ bool Scheduler::load_playlist(const Playlist& playlist) {
     
     playlist_ = playlist;
     current_index_ = 0;
+    source_.reset();
+    return load_first_tracks();
+}
+
+bool Scheduler::load_source(std::shared_ptr<PlaylistSource> source) {
+    stop();
+    
+    playlist_ = Playlist{};
+    current_index_ = 0;
+    source_ = std::move(source);
+    
+    if (source_) {
+        if (auto first = source_->next_entry(true)) {
+            playlist_.entries.push_back(std::move(*first));
+            pull_next(true);
+        }
+    }
+    return load_first_tracks();
+}
+
+bool Scheduler::load_first_tracks() {
+    publish_current();
     
     if (playlist_.empty()) {
         return false;
@@ -118,11 +144,13 @@ bool Scheduler::skip() {
     if (transitioning_) {
         return false;
     }
-    if (current_index_ + 1 >= playlist_.size()) {
+    if (!pull_next(false) && (!source_ || source_->ended())) {
         stop();
         return true;
     }
     
+    // A source's next entry may still be generating: poll() starts the
+    // transition once it is ready
     skip_requested_ = true;
     return true;
 }
@@ -165,6 +193,118 @@ void Scheduler::set_transition_config(const TransitionConfig& config) {
     transition_config_ = config;
 }
 
+// =============================================================================
+// Queue editing — CONTROL THREAD
+// =============================================================================
+
+bool Scheduler::insert_entry(size_t position, int64_t track_id) {
+    if (playlist_.empty() || position < first_editable() || current_index_ + position > playlist_.size()) {
+        return false;
+    }
+    
+    const int64_t next_id = next_track_id();
+    const size_t index = current_index_ + position;
+    playlist_.entries.insert(playlist_.entries.begin() + index, PlaylistEntry{track_id, std::nullopt});
+    replan(index - 1);
+    replan(index);
+    queue_changed(next_id);
+    return true;
+}
+
+bool Scheduler::remove_entry(size_t position) {
+    if (position < first_editable() || current_index_ + position >= playlist_.size()) {
+        return false;
+    }
+    
+    const int64_t next_id = next_track_id();
+    const size_t index = current_index_ + position;
+    playlist_.entries.erase(playlist_.entries.begin() + index);
+    replan(index - 1);
+    queue_changed(next_id);
+    return true;
+}
+
+bool Scheduler::move_entry(size_t from, size_t to) {
+    if (from < first_editable() || to < first_editable() ||
+        current_index_ + from >= playlist_.size() || current_index_ + to >= playlist_.size()) {
+        return false;
+    }
+    if (from == to) {
+        return true;
+    }
+    
+    const int64_t next_id = next_track_id();
+    const size_t old_index = current_index_ + from;
+    const size_t new_index = current_index_ + to;
+    PlaylistEntry entry = std::move(playlist_.entries[old_index]);
+    playlist_.entries.erase(playlist_.entries.begin() + old_index);
+    playlist_.entries.insert(playlist_.entries.begin() + new_index, std::move(entry));
+    
+    // The old neighbours now follow each other; the entry sits between new ones
+    replan(old_index < new_index ? old_index - 1 : old_index);
+    replan(new_index - 1);
+    replan(new_index);
+    queue_changed(next_id);
+    return true;
+}
+
+bool Scheduler::replace_entry(size_t position, int64_t track_id) {
+    if (position < first_editable() || current_index_ + position >= playlist_.size()) {
+        return false;
+    }
+    
+    const int64_t next_id = next_track_id();
+    const size_t index = current_index_ + position;
+    playlist_.entries[index].track_id = track_id;
+    replan(index - 1);
+    replan(index);
+    queue_changed(next_id);
+    return true;
+}
+
+std::vector<int64_t> Scheduler::queue() const {
+    std::vector<int64_t> ids;
+    for (size_t i = current_index_; i < playlist_.size(); ++i) {
+        ids.push_back(playlist_.entries[i].track_id);
+    }
+    return ids;
+}
+
+void Scheduler::replan(size_t index) {
+    if (index >= playlist_.size()) {
+        return;
+    }
+    
+    PlaylistEntry& entry = playlist_.entries[index];
+    if (index + 1 >= playlist_.size()) {
+        entry.transition_to_next.reset();  // Planned when an entry follows
+        return;
+    }
+    
+    const int64_t to = playlist_.entries[index + 1].track_id;
+    const auto& plan = entry.transition_to_next;
+    if (plan && plan->from_track_id == entry.track_id && plan->to_track_id == to) {
+        return;
+    }
+    entry.transition_to_next = transition_planner_ ? transition_planner_(entry.track_id, to) : std::nullopt;
+}
+
+void Scheduler::queue_changed(int64_t previous_next_id) {
+    publish_current();
+    
+    const int64_t next_id = next_track_id();
+    if (next_id == previous_next_id) {
+        return;
+    }
+    
+    // Not playing outside a transition, and edits leave the next track alone during one
+    next_deck_->unload();
+    if (next_id != 0) {
+        load_track_to_deck(*next_deck_, next_id);
+    }
+    notify_status();
+}
+
 // =============================================================================
 // render() — AUDIO THREAD (real-time safe)
 // =============================================================================
@@ -228,16 +368,15 @@ void Scheduler::rt_update(int frames) {
     float duration = active_deck_->duration();
     
     // Check if we should signal a transition (only when transitions are enabled)
-    if (transition_config_.enable_transitions && !transitioning_ && current_index_ < playlist_.size()) {
-        const auto& entry = playlist_.entries[current_index_];
-        
+    if (transition_config_.enable_transitions && !transitioning_ && rt_has_next_.load()) {
         float transition_point = duration - transition_config_.max_transition_seconds;
         
-        if (entry.transition_to_next) {
-            transition_point = entry.transition_to_next->out_point.time_seconds;
+        const float out_point = rt_out_point_.load();
+        if (out_point >= 0.0f) {
+            transition_point = out_point;
         }
         
-        if (current_pos >= transition_point && current_index_ + 1 < playlist_.size()) {
+        if (current_pos >= transition_point) {
             if (!transition_trigger_pending_) {
                 transition_trigger_pending_ = true;
             }
@@ -265,8 +404,20 @@ void Scheduler::poll() {
         return;
     }
     
-    // Handle skip request
-    if (skip_requested_.exchange(false)) {
+    // Entries of a generated playlist that were not ready when the current
+    // track started
+    if (source_ && current_index_ + 1 >= playlist_.size() && pull_next(false)
+        && !transitioning_ && !next_deck_->is_loaded()) {
+        load_track_to_deck(*next_deck_, playlist_.entries[current_index_ + 1].track_id);
+    }
+    
+    // Handle skip request (kept pending until a source's next entry is ready)
+    if (skip_requested_ && current_index_ + 1 >= playlist_.size() && source_ && source_->ended()) {
+        stop();  // The source ended while the skip waited
+        return;
+    }
+    if (skip_requested_ && (current_index_ + 1 < playlist_.size() || !source_)) {
+        skip_requested_ = false;
         start_transition();
     }
     
@@ -300,6 +451,7 @@ void Scheduler::poll() {
             active_deck_->pause();
             active_deck_->unload();
             current_index_--;
+            publish_current();
             if (load_track_to_deck(*active_deck_, playlist_.entries[current_index_].track_id)) {
                 active_deck_->play();
                 if (current_index_ + 1 < playlist_.size()) {
@@ -336,6 +488,8 @@ void Scheduler::poll() {
         next_deck_->unload();
         
         current_index_++;
+        pull_next(false);
+        publish_current();
         state_ = PlaybackState::Playing;
         
         // Smoothly recover incoming deck stretch back to normal speed.
@@ -355,9 +509,14 @@ void Scheduler::poll() {
     
     // Handle playback finished (no transition was active)
     if (playback_finished_.exchange(false)) {
-        if (current_index_ + 1 < playlist_.size()) {
+        if (pull_next(true)) {
             // Move to next track
+            if (!next_deck_->is_loaded()) {
+                load_track_to_deck(*next_deck_, playlist_.entries[current_index_ + 1].track_id);
+            }
             current_index_++;
+            pull_next(false);
+            publish_current();
             std::swap(active_deck_, next_deck_);
             active_deck_->play();
             
@@ -394,6 +553,42 @@ bool Scheduler::load_track_to_deck(Deck& deck, int64_t track_id) {
     return deck.load(result.value(), track_id);
 }
 
+bool Scheduler::pull_next(bool wait) {
+    if (current_index_ + 1 < playlist_.size()) {
+        return true;
+    }
+    if (!source_) {
+        return false;
+    }
+    
+    auto entry = source_->next_entry(wait);
+    if (!entry) {
+        return false;
+    }
+    playlist_.entries.push_back(std::move(*entry));
+    if (playlist_.size() > 1) {
+        replan(playlist_.size() - 2);  // The queue was edited since the source planned it
+    }
+    
+    // Drop entries played long ago
+    if (current_index_ > kSourceHistory) {
+        const size_t dropped = current_index_ - kSourceHistory;
+        playlist_.entries.erase(playlist_.entries.begin(), playlist_.entries.begin() + dropped);
+        current_index_ -= dropped;
+    }
+    publish_current();
+    return true;
+}
+
+void Scheduler::publish_current() {
+    float out_point = -1.0f;
+    if (current_index_ < playlist_.size() && playlist_.entries[current_index_].transition_to_next) {
+        out_point = playlist_.entries[current_index_].transition_to_next->out_point.time_seconds;
+    }
+    rt_out_point_ = out_point;
+    rt_has_next_ = current_index_ + 1 < playlist_.size();
+}
+
 void Scheduler::start_transition() {
     if (current_index_ + 1 >= playlist_.size()) {
         return;
@@ -434,6 +629,8 @@ void Scheduler::start_transition() {
         next_deck_->unload();
         
         current_index_++;
+        pull_next(false);
+        publish_current();
         transitioning_ = false;
         state_ = PlaybackState::Playing;
         
@@ -11,6 +11,7 @@
 #include <functional>
 #include <memory>
 #include <atomic>
+#include <optional>
 #include <vector>
 
 namespace automix {
@@ -23,6 +24,12 @@ class Decoder;
  */
 using TrackLoadCallback = std::function<Result<AudioBuffer>(int64_t track_id)>;
 
+/**
+ * Plans the transition between two tracks, for entries changed by queue
+ * edits (nullopt = use the default transition).
+ */
+using TransitionPlanner = std::function<std::optional<TransitionPlan>(int64_t from_track_id, int64_t to_track_id)>;
+
 /**
  * Status callback for playback events.
  */
@@ -33,6 +40,30 @@ using StatusCallback = std::function<void(
     int64_t next_track_id
 )>;
 
+/**
+ * Supplies playlist entries while they play, for playlists generated as
+ * playback advances (see PlaylistSession). Called from the control thread.
+ */
+class PlaylistSource {
+public:
+    virtual ~PlaylistSource() = default;
+    
+    /**
+     * Take the next entry, with its transition to the entry after it
+     * planned (none for the last one).
+     * @param wait Block until an entry is ready, instead of returning
+     *        nullopt when none is ready yet
+     * @return nullopt at the end of the playlist
+     */
+    virtual std::optional<PlaylistEntry> next_entry(bool wait) = 0;
+    
+    /**
+     * Whether the playlist has ended: next_entry() will not return another
+     * entry (as opposed to none being ready yet).
+     */
+    virtual bool ended() const = 0;
+};
+
 /**
  * Scheduler manages playlist playback and automatic transitions.
  *
@@ -62,11 +93,27 @@ public:
      */
     void set_status_callback(StatusCallback callback);
     
+    /**
+     * Set the planner used for transitions changed by queue edits.
+     */
+    void set_transition_planner(TransitionPlanner planner);
+    
     /**
      * Load a playlist for playback.
      */
     bool load_playlist(const Playlist& playlist);
     
+    /**
+     * Play entries pulled from a source as playback advances instead of a
+     * fixed playlist. The next entry is taken when the current track
+     * starts; only kSourceHistory played entries are kept (for previous()),
+     * so memory stays constant however long the mix runs.
+     * Blocks until the first two entries are ready.
+     */
+    bool load_source(std::shared_ptr<PlaylistSource> source);
+    
+    static constexpr size_t kSourceHistory = 16;
+    
     /**
      * Start playback.
      */
@@ -88,7 +135,9 @@ public:
     void stop();
     
     /**
-     * Skip to next track.
+     * Skip to next track, or stop on the last one. Never waits for a
+     * source: if its next entry is not ready yet, poll() starts the
+     * transition once it is (or stops if the source ends instead).
      * @return false if a transition is already in progress.
      */
     bool skip();
@@ -106,6 +155,32 @@ public:
      */
     bool seek(float position);
     
+    /* Queue editing (control thread) ------------------------------------
+     *
+     * Positions count from the current track: 0 = playing, 1 = next.
+     * Upcoming entries (position 1 on, 2 on while the next track is being
+     * mixed in) can be changed while audio keeps playing: only the
+     * transitions on either side of an edit are re-planned, and the next
+     * deck is only re-loaded if the next track changed. With a
+     * PlaylistSource, edits apply to the entries already taken from it.
+     * Each returns false if a position is out of range.
+     */
+    
+    /** Insert a track at `position` (up to queue().size() to append). */
+    bool insert_entry(size_t position, int64_t track_id);
+    
+    bool remove_entry(size_t position);
+    
+    /** Move the entry at `from` so that it ends up at `to`. */
+    bool move_entry(size_t from, size_t to);
+    
+    bool replace_entry(size_t position, int64_t track_id);
+    
+    /**
+     * Track IDs from the current track on (index = position).
+     */
+    std::vector<int64_t> queue() const;
+    
     /**
      * Get current playback state.
      */
@@ -156,9 +231,27 @@ private:
     
     // --- Control-thread helpers (called only from poll / control methods) ---
     bool load_track_to_deck(Deck& deck, int64_t track_id);
+    bool load_first_tracks();
     void start_transition();
     void notify_status();
     
+    // Make sure an entry follows the current one, taking it from the source
+    // if there is one; false if there is none (yet)
+    bool pull_next(bool wait);
+    
+    // Update what the audio thread knows of the current entry
+    void publish_current();
+    
+    // First position queue edits may change
+    size_t first_editable() const { return transitioning_ ? 2 : 1; }
+    
+    // Re-plan the transition after entry `index` unless it still leads to
+    // the following entry
+    void replan(size_t index);
+    
+    // After a queue edit: re-load the next deck if the next track changed
+    void queue_changed(int64_t previous_next_id);
+    
     // Decks
     std::unique_ptr<Deck> deck_a_;
     std::unique_ptr<Deck> deck_b_;
@@ -168,9 +261,14 @@ private:
     // Crossfader
     Crossfader crossfader_;
     
-    // Playlist
+    // Playlist (control thread only; the audio thread reads the rt_ copies)
     Playlist playlist_;
     size_t current_index_{0};
+    std::shared_ptr<PlaylistSource> source_;
+    
+    // Current entry for the audio thread, from publish_current()
+    std::atomic<float> rt_out_point_{-1.0f};       // Planned transition start; < 0 = none
+    std::atomic<bool> rt_has_next_{false};
     
     // State (atomic — shared between threads)
     std::atomic<PlaybackState> state_{PlaybackState::Stopped};
@@ -198,6 +296,7 @@ private:
     // Callbacks
     TrackLoadCallback track_loader_;
     StatusCallback status_callback_;
+    TransitionPlanner transition_planner_;
     
     // Transition trigger position (set by audio thread for poll to use)
     std::atomic<bool> transition_trigger_pending_{false};
@@ -76,6 +76,30 @@ void test_sample_rate() {
     std::cout << "PASSED\n";
 }
 
+void test_queue_editing() {
+    std::cout << "Test: Queue editing... ";
+    
+    AutoMixEngine* engine = automix_create(":memory:");
+    assert(engine != nullptr);
+    
+    // Nothing loaded: empty queue, nothing to edit
+    int64_t unset = 0;
+    int64_t* ids = &unset;
+    int count = -1;
+    assert(automix_get_queue(engine, &ids, &count) == AUTOMIX_OK);
+    assert(count == 0 && ids == nullptr);
+    automix_free_track_ids(ids);
+    
+    assert(automix_queue_remove(engine, 1) == AUTOMIX_ERROR_INVALID_ARGUMENT);
+    assert(automix_queue_move(engine, 1, 2) == AUTOMIX_ERROR_INVALID_ARGUMENT);
+    assert(automix_queue_insert(engine, -1, 1) == AUTOMIX_ERROR_INVALID_ARGUMENT);
+    assert(automix_queue_replace(nullptr, 1, 1) == AUTOMIX_ERROR_INVALID_ARGUMENT);
+    
+    automix_destroy(engine);
+    
+    std::cout << "PASSED\n";
+}
+
 int main() {
     std::cout << "AutoMix Engine - Basic Tests\n";
     std::cout << "============================\n\n";
@@ -84,6 +108,7 @@ int main() {
     test_playback_state();
     test_transition_config();
     test_sample_rate();
+    test_queue_editing();
     
     std::cout << "\nAll tests passed!\n";
     return 0;
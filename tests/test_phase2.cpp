@@ -5,17 +5,28 @@
 
 #include "automix/types.h"
 #include "../src/core/store.h"
+#include "../src/core/store_writer.h"
 #include "../src/core/utils.h"
+#include "../src/core/directory_walker.h"
+#include "../src/core/content_hash.h"
 #include "../src/decoder/decoder.h"
 #include "../src/analyzer/analyzer.h"
 #include "../src/analyzer/bpm_detector.h"
 #include "../src/analyzer/key_detector.h"
 #include "../src/analyzer/energy_analyzer.h"
+#include "../src/analyzer/fft.h"
+#include "../src/analyzer/analysis_context.h"
 
 #include <iostream>
 #include <cassert>
 #include <cmath>
 #include <filesystem>
+#include <fstream>
+#include <complex>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <chrono>
 
 using namespace automix;
 
@@ -63,7 +74,7 @@ TEST(store_insert_and_get) {
     TrackInfo track;
     track.path = "/test/audio.mp3";
     track.bpm = 128.0f;
-    track.key = "8A";
+    track.key = utils::key_from_camelot("8A");
     track.duration = 180.0f;
     track.beats = {0.0f, 0.5f, 1.0f, 1.5f};
     track.mfcc = {1.0f, 2.0f, 3.0f};
@@ -213,6 +224,218 @@ TEST(store_needs_analysis) {
     assert(store.needs_analysis(stub.path, 1000));   // same mtime still needs analysis
     assert(store.needs_analysis(stub.path, 999));    // even older mtime
     assert(store.needs_analysis(stub.path, 1001));   // newer mtime
+    
+    // Low-confidence excerpt analysis is only redone when the caller asks
+    TrackInfo rough;
+    rough.path = "/test/rough.mp3";
+    rough.file_modified_at = 1000;
+    rough.analyzed_at = 9999;
+    rough.confidence = 0.34f;
+    store.upsert_track(rough);
+    assert_near(store.get_track_by_path(rough.path)->confidence, 0.34f, 1e-6f, "stored confidence");
+    assert(!store.needs_analysis(rough.path, 1000));
+    assert(store.needs_analysis(rough.path, 1000, 0.6f));
+    assert(!store.needs_analysis(track.path, 1000, 0.6f));  // Full analysis has confidence 1
+}
+
+TEST(store_scan_snapshot) {
+    Store store(":memory:");
+    
+    TrackInfo track;
+    track.path = "/test/audio.mp3";
+    track.file_modified_at = 1000;
+    track.analyzed_at = 9999;
+    track.beats.assign(1000, 0.5f);
+    int64_t id = store.upsert_track(track).value();
+    store.upsert_track_path_duration("/test/stub.mp3", 60.0f, 1000);
+    
+    auto snapshot = store.get_scan_snapshot();
+    assert(snapshot.size() == 2);
+    const auto& state = snapshot.at(track.path);
+    assert(state.id == id);
+    assert(state.file_modified_at == 1000 && state.analyzed_at == 9999);
+    assert_near(state.confidence, 1.0f, 1e-6f, "snapshot confidence");
+    
+    // Same decisions as the per-path lookup
+    for (const auto& [path, row] : snapshot) {
+        for (int64_t mtime : {999, 1000, 1001}) {
+            assert(Store::needs_analysis(row, mtime) == store.needs_analysis(path, mtime));
+        }
+    }
+    
+    // Only candidates whose files are gone are removed
+    auto real = std::filesystem::temp_directory_path() / "automix_snapshot_test.mp3";
+    std::ofstream(real) << "x";
+    TrackInfo present;
+    present.path = real.string();
+    store.upsert_track(present);
+    
+    snapshot = store.get_scan_snapshot();
+    snapshot.erase("/test/stub.mp3");
+    assert(store.cleanup_missing_files(snapshot) == 1);
+    assert(!store.get_track_by_path(track.path).has_value());
+    assert(store.get_track_by_path(present.path).has_value());
+    assert(store.get_track_by_path("/test/stub.mp3").has_value());
+    std::filesystem::remove(real);
+}
+
+TEST(content_hash_fingerprint) {
+    // Reference XXH64 values
+    assert(xxhash64("", 0) == 0xef46db3751d8e999ULL);
+    assert(xxhash64("abc", 3) == 0x44bc2cf5ad770999ULL);
+    const std::string long_input = "Nobody inspects the spammish repetition";
+    assert(xxhash64(long_input.data(), long_input.size()) == 0xfbcea83c8a378bf1ULL);
+    
+    auto dir = std::filesystem::temp_directory_path() / "automix_fingerprint_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    
+    std::string data(3 * 1024 * 1024, '\0');
+    std::mt19937 rng(7);
+    for (auto& c : data) c = static_cast<char>(rng());
+    auto write = [&](const char* name, const std::string& contents) {
+        std::ofstream(dir / name, std::ios::binary) << contents;
+        return (dir / name).string();
+    };
+    
+    std::string original = write("a.flac", data);
+    std::string copy = write("b.flac", data);
+    uint64_t hash = file_fingerprint(original);
+    assert(hash != 0);
+    assert(file_fingerprint(copy) == hash);
+    
+    // Head, tail and length changes are seen
+    std::string edited = data;
+    edited[10] ^= 1;
+    assert(file_fingerprint(write("head.flac", edited)) != hash);
+    edited = data;
+    edited[data.size() - 10] ^= 1;
+    assert(file_fingerprint(write("tail.flac", edited)) != hash);
+    assert(file_fingerprint(write("longer.flac", data + "x")) != hash);
+    
+    // Small files are hashed whole
+    assert(file_fingerprint(write("small.mp3", "abc")) != file_fingerprint(write("small2.mp3", "abd")));
+    assert(file_fingerprint((dir / "missing.mp3").string()) == 0);
+    
+    std::filesystem::remove_all(dir);
+}
+
+TEST(store_copy_track_analysis) {
+    Store store(":memory:");
+    
+    TrackInfo track;
+    track.path = "/music/a.flac";
+    track.bpm = 124.0f;
+    track.key = utils::key_from_camelot("8A");
+    track.beats = {0.5f, 1.0f};
+    track.analyzed_at = 500;
+    track.file_modified_at = 100;
+    track.confidence = 0.9f;
+    track.content_hash = 0x8000000000000001ULL;  // Top bit set: stored as a negative int64
+    int64_t id = store.upsert_track(track).value();
+    
+    // A new row for a copy, with its own mtime
+    auto copy_id = store.copy_track_analysis(track.path, "/music/copy/a.flac", 200);
+    assert(copy_id.ok() && copy_id.value() != id);
+    auto copy = store.get_track_by_path("/music/copy/a.flac");
+    assert(copy.has_value());
+    assert(copy->bpm == track.bpm && copy->key == track.key && copy->beats == track.beats);
+    assert(copy->analyzed_at == 500 && copy->file_modified_at == 200);
+    assert(copy->content_hash == track.content_hash);
+    assert(store.get_scan_snapshot().at(copy->path).content_hash == track.content_hash);
+    
+    // An existing row keeps its id and takes the analysis
+    int64_t stale_id = store.upsert_track_path_duration("/music/stale.flac", 10.0f, 1).value();
+    assert(store.copy_track_analysis(track.path, "/music/stale.flac", 300).value() == stale_id);
+    assert(store.get_track_by_path("/music/stale.flac")->bpm == track.bpm);
+    
+    assert(!store.copy_track_analysis("/music/missing.flac", "/music/x.flac", 1).ok());
+    
+    assert(store.touch_track(track.path, 400));
+    assert(store.get_track_by_path(track.path)->file_modified_at == 400);
+    assert(!store.needs_analysis(track.path, 400));
+    assert(!store.touch_track("/music/missing.flac", 400));
+}
+
+TEST(walker_lists_tree_in_parallel) {
+    namespace fs = std::filesystem;
+    auto root = fs::temp_directory_path() / "automix_walker_test";
+    fs::remove_all(root);
+    
+    // 6 artists x 5 albums x 4 tracks, plus non-audio files
+    for (int a = 0; a < 6; ++a) {
+        for (int b = 0; b < 5; ++b) {
+            auto album = root / ("artist" + std::to_string(a)) / ("album" + std::to_string(b));
+            fs::create_directories(album);
+            for (int t = 0; t < 4; ++t) {
+                std::ofstream(album / ("track" + std::to_string(t) + ".flac")) << "x";
+            }
+            std::ofstream(album / "cover.jpg") << "x";
+        }
+    }
+    std::ofstream(root / "loose.mp3") << "x";
+    
+    auto expected = utils::find_audio_files(root, true);
+    std::vector<std::string> expected_paths;
+    for (const auto& file : expected) {
+        expected_paths.push_back(utils::path_to_absolute(file));
+    }
+    std::sort(expected_paths.begin(), expected_paths.end());
+    
+    auto walk = DirectoryWalker(8).walk(root.string(), true);
+    assert(walk.files.size() == expected_paths.size());
+    for (size_t i = 0; i < walk.files.size(); ++i) {
+        assert(walk.files[i].path == expected_paths[i]);
+        assert(walk.files[i].mtime == utils::file_modified_time(walk.files[i].path));
+    }
+    assert(walk.directories.size() == 1 + 6 + 30);
+    assert(walk.listed_dirs == 37 && walk.unchanged_dirs.empty());
+    assert(walk.directories.at(utils::path_to_absolute(root)).parent.empty());
+    
+    // Non-recursive: the root only
+    auto flat = DirectoryWalker(4).walk(root.string(), false);
+    assert(flat.files.size() == 1 && flat.directories.size() == 1);
+    
+    fs::remove_all(root);
+}
+
+TEST(walker_skips_unchanged_dirs) {
+    namespace fs = std::filesystem;
+    auto root = fs::temp_directory_path() / "automix_walker_cache_test";
+    fs::remove_all(root);
+    fs::create_directories(root / "a" / "deep");
+    fs::create_directories(root / "b");
+    std::ofstream(root / "a" / "deep" / "1.mp3") << "x";
+    std::ofstream(root / "b" / "2.mp3") << "x";
+    
+    Store store(":memory:");
+    const std::string root_path = utils::path_to_absolute(root);
+    DirectoryWalker walker;
+    auto first = walker.walk(root_path, true);
+    assert(first.files.size() == 2);
+    assert(store.save_directory_states(root_path, first.directories));
+    
+    // A new file in b/: only b/ is listed again, but a/deep is still reached
+    std::ofstream(root / "b" / "3.mp3") << "x";
+    auto previous = store.get_directory_states(root_path);
+    assert(previous.size() == 4);
+    auto second = walker.walk(root_path, true, &previous);
+    assert(second.listed_dirs == 1);
+    assert(second.unchanged_dirs.size() == 3);
+    assert(second.files.size() == 2);  // b/2.mp3 and b/3.mp3
+    assert(second.directories.size() == 4);
+    
+    // Saving replaces the states below root; other roots are kept
+    DirectorySnapshot other;
+    other["/elsewhere"] = DirectoryState();
+    store.save_directory_states("/elsewhere", other);
+    fs::remove_all(root / "a");
+    auto third = walker.walk(root_path, true, &previous);
+    assert(store.save_directory_states(root_path, third.directories));
+    assert(store.get_directory_states(root_path).size() == 2);
+    assert(store.get_directory_states("/elsewhere").size() == 1);
+    
+    fs::remove_all(root);
 }
 
 TEST(store_upsert_path_duration) {
@@ -229,7 +452,7 @@ TEST(store_upsert_path_duration) {
     // analyzed_at must remain 0 so that needs_analysis returns true for full scan
     assert(track->analyzed_at == 0);
     assert(track->bpm == 0.0f);
-    assert(track->key.empty());
+    assert(track->key == kUnknownKey);
 
     // needs_analysis should return true (analyzed_at==0)
     assert(store.needs_analysis("/test/meta.mp3", 2000));
@@ -238,7 +461,7 @@ TEST(store_upsert_path_duration) {
     TrackInfo full;
     full.path = "/test/meta.mp3";
     full.bpm = 128.0f;
-    full.key = "8A";
+    full.key = utils::key_from_camelot("8A");
     full.duration = 180.5f;
     full.analyzed_at = 50000;
     full.file_modified_at = 2000;
@@ -255,7 +478,7 @@ TEST(store_upsert_path_duration) {
     assert(after.has_value());
     assert(after->analyzed_at == 50000);               // preserved
     assert(std::abs(after->bpm - 128.0f) < 0.01f);    // preserved
-    assert(after->key == "8A");                        // preserved
+    assert(after->key == full.key);                    // preserved
     assert(after->duration > 180.9f);                  // updated to new value
 }
 
@@ -263,6 +486,215 @@ TEST(store_upsert_path_duration) {
  * Track Metadata Tests
  * ============================================================================ */
 
+TEST(store_upsert_returns_id) {
+    Store store(":memory:");
+    
+    TrackInfo a;
+    a.path = "/test/a.mp3";
+    TrackInfo b;
+    b.path = "/test/b.mp3";
+    
+    int64_t id_a = store.upsert_track(a).value();
+    int64_t id_b = store.upsert_track(b).value();
+    assert(id_a != id_b);
+    
+    // Updates report the existing row, not the last inserted one
+    a.bpm = 128.0f;
+    assert(store.upsert_track(a).value() == id_a);
+    assert(store.upsert_track_path_duration(a.path, 200.0f, 5).value() == id_a);
+    assert(store.upsert_track_path_duration("/test/c.mp3", 100.0f, 5).value() > id_b);
+}
+
+TEST(store_writer_batches) {
+    Store store(":memory:");
+    
+    StoreWriterConfig config;
+    config.batch_size = 16;
+    config.max_delay_ms = 1000;
+    
+    std::vector<std::future<Result<int64_t>>> ids;
+    std::vector<int64_t> callback_ids(10, 0);
+    {
+        StoreWriter writer(store, config);
+        for (int i = 0; i < 40; ++i) {
+            TrackInfo track;
+            track.path = "/test/" + std::to_string(i) + ".mp3";
+            track.bpm = 100.0f + i;
+            ids.push_back(writer.upsert_track(track));
+        }
+        for (int i = 0; i < 10; ++i) {
+            writer.upsert_track_path_duration("/test/stub" + std::to_string(i) + ".mp3", 60.0f, 1,
+                [&callback_ids, i](const Result<int64_t>& id) { callback_ids[i] = id.value(); });
+        }
+        
+        // flush() does not wait out the batching delay
+        auto start = std::chrono::steady_clock::now();
+        writer.flush();
+        assert(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(500));
+        
+        auto stats = writer.stats();
+        assert(stats.rows == 50 && stats.failed == 0);
+        assert(stats.transactions <= 5);  // Batches, not one commit per row
+        
+        // Rewriting a path keeps its id
+        TrackInfo again;
+        again.path = "/test/3.mp3";
+        again.bpm = 90.0f;
+        auto id = writer.upsert_track(again);
+        assert(id.get().value() == ids[3].get().value());
+    }
+    
+    assert(store.get_track_count() == 50);
+    for (int i = 0; i < 40; ++i) {
+        if (i == 3) continue;
+        int64_t id = ids[i].get().value();
+        assert(store.get_track(id)->path == "/test/" + std::to_string(i) + ".mp3");
+    }
+    assert_near(store.get_track_by_path("/test/3.mp3")->bpm, 90.0f, 0.01f, "Rewrite not committed");
+    for (int i = 0; i < 10; ++i) {
+        assert(store.get_track(callback_ids[i])->analyzed_at == 0);
+    }
+}
+
+TEST(store_writer_benchmark) {
+    // One autocommit per row against batched transactions, on a WAL file
+    const int rows = 2000;
+    auto dir = std::filesystem::temp_directory_path();
+    auto ms = [](auto a, auto b) { return std::chrono::duration<double, std::milli>(b - a).count(); };
+    
+    auto make_track = [](int i) {
+        TrackInfo track;
+        track.path = "/bench/" + std::to_string(i) + ".mp3";
+        track.bpm = 120.0f;
+        track.mfcc.assign(13, 0.5f);
+        track.chroma.assign(12, 0.25f);
+        track.beats.assign(400, 1.0f);
+        return track;
+    };
+    
+    auto single_path = (dir / "automix_writer_single.db").string();
+    auto batched_path = (dir / "automix_writer_batched.db").string();
+    for (const auto& path : {single_path, batched_path}) {
+        std::filesystem::remove(path);
+        std::filesystem::remove(path + "-wal");
+        std::filesystem::remove(path + "-shm");
+    }
+    
+    auto t0 = std::chrono::steady_clock::now();
+    {
+        Store store(single_path);
+        for (int i = 0; i < rows; ++i) {
+            assert(store.upsert_track(make_track(i)).ok());
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    {
+        Store store(batched_path);
+        StoreWriter writer(store);
+        for (int i = 0; i < rows; ++i) {
+            writer.upsert_track(make_track(i), nullptr);
+        }
+        writer.flush();
+        assert(writer.stats().rows == rows);
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    
+    std::cout << "[" << rows << " rows: autocommit " << ms(t0, t1) << " ms, batched " << ms(t1, t2) << " ms] ";
+    
+    Store check(batched_path);
+    assert(check.get_track_count() == rows);
+    
+    for (const auto& path : {single_path, batched_path}) {
+        std::filesystem::remove(path);
+        std::filesystem::remove(path + "-wal");
+        std::filesystem::remove(path + "-shm");
+    }
+}
+
+TEST(store_statement_cache_benchmark) {
+    // Lookups through Store's cached statements against compiling the same
+    // query for every call (the previous behaviour), on one database
+    auto path = (std::filesystem::temp_directory_path() / "automix_stmt_cache.db").string();
+    std::filesystem::remove(path);
+    
+    const int tracks = 200;
+    const int lookups = 20000;
+    Store store(path);
+    for (int i = 0; i < tracks; ++i) {
+        TrackInfo track;
+        track.path = "/bench/" + std::to_string(i) + ".mp3";
+        track.analyzed_at = 1;
+        track.file_modified_at = 1;
+        assert(store.upsert_track(track).ok());
+    }
+    
+    sqlite3* db = nullptr;
+    assert(sqlite3_open(path.c_str(), &db) == SQLITE_OK);
+    
+    auto t0 = std::chrono::steady_clock::now();
+    int found_uncached = 0;
+    for (int i = 0; i < lookups; ++i) {
+        std::string track_path = "/bench/" + std::to_string(i % tracks) + ".mp3";
+        sqlite3_stmt* stmt;
+        sqlite3_prepare_v2(db, "SELECT analyzed_at, confidence, file_modified_at FROM tracks WHERE path = ?",
+                           -1, &stmt, nullptr);
+        sqlite3_bind_text(stmt, 1, track_path.c_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(stmt) == SQLITE_ROW) found_uncached++;
+        sqlite3_finalize(stmt);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    int found_cached = 0;
+    for (int i = 0; i < lookups; ++i) {
+        std::string track_path = "/bench/" + std::to_string(i % tracks) + ".mp3";
+        if (!store.needs_analysis(track_path, 1)) found_cached++;
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    sqlite3_close(db);
+    
+    auto per_second = [](auto a, auto b) {
+        return lookups / std::chrono::duration<double>(b - a).count();
+    };
+    std::cout << "[" << static_cast<int>(per_second(t0, t1)) << " lookups/s prepared per call, "
+              << static_cast<int>(per_second(t1, t2)) << " lookups/s cached] ";
+    
+    assert(found_uncached == lookups);
+    assert(found_cached == lookups);
+    
+    // Cached statements are reset after use, so later calls see new writes
+    assert(store.get_track_by_path("/bench/0.mp3").has_value());
+    assert(store.delete_track_by_path("/bench/0.mp3"));
+    assert(store.needs_analysis("/bench/0.mp3", 1));
+    assert(store.get_track_count() == tracks - 1);
+    
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + "-wal");
+    std::filesystem::remove(path + "-shm");
+}
+
+TEST(store_statement_reentrant_use) {
+    Store store(":memory:");
+    for (int i = 0; i < 3; ++i) {
+        TrackInfo track;
+        track.path = "/reentrant/" + std::to_string(i) + ".mp3";
+        assert(store.upsert_track(track).ok());
+    }
+    
+    // The statement an outer for_each_* holds is refused, not waited on;
+    // other statements stay usable from the callback
+    int outer = 0;
+    int inner = 0;
+    store.for_each_track_features([&](const TrackInfo&) {
+        outer++;
+        store.for_each_track_features([&](const TrackInfo&) { inner++; });
+        assert(store.get_track_count() == 3);
+    });
+    assert(outer == 3);
+    assert(inner == 0);
+    
+    // Released once the outer visit is done
+    store.for_each_track_features([&](const TrackInfo&) { inner++; });
+    assert(inner == 3);
+}
 TEST(store_metadata_upsert_and_get) {
     Store store(":memory:");
     assert(store.is_open());
@@ -452,27 +884,66 @@ TEST(utils_bpm_distance) {
     assert_near(utils::bpm_distance(60.0f, 120.0f), 0.0f, 0.01f, "half time");
 }
 
+TEST(utils_key_codes) {
+    assert(utils::key_from_camelot("1A") == 0);
+    assert(utils::key_from_camelot("8A") == 14);
+    assert(utils::key_from_camelot("12B") == 23);
+    assert(utils::key_from_camelot("") == kUnknownKey);
+    assert(utils::key_from_camelot("13A") == kUnknownKey);
+    assert(utils::key_from_camelot("C#") == kUnknownKey);
+    assert(utils::key_to_camelot(kUnknownKey).empty());
+    for (int code = 0; code < 24; ++code) {
+        KeyCode key = static_cast<KeyCode>(code);
+        assert(utils::key_from_camelot(utils::key_to_camelot(key)) == key);
+    }
+    
+    // Semitones above C: 5A = C minor, 5B = Eb major, 8A = A minor, 6A = G minor
+    static_assert(utils::key_semitone(8) == 0, "5A is C minor");
+    assert(utils::key_semitone(utils::key_from_camelot("5B")) == 3);
+    assert(utils::key_semitone(utils::key_from_camelot("8A")) == 9);
+    assert(utils::key_semitone(utils::key_from_camelot("6A")) == 7);
+    assert(utils::key_semitone(kUnknownKey) == 0);
+}
+
 TEST(utils_camelot_distance) {
+    auto key = utils::key_from_camelot;
+    
     // Same key
-    assert(utils::camelot_distance("8A", "8A") == 0);
+    assert(utils::camelot_distance(key("8A"), key("8A")) == 0);
     
     // Adjacent keys
-    assert(utils::camelot_distance("8A", "7A") == 1);
-    assert(utils::camelot_distance("8A", "9A") == 1);
+    assert(utils::camelot_distance(key("8A"), key("7A")) == 1);
+    assert(utils::camelot_distance(key("8A"), key("9A")) == 1);
+    assert(utils::camelot_distance(key("12A"), key("1A")) == 1);
     
     // Relative major/minor (same number)
-    assert(utils::camelot_distance("8A", "8B") == 0);
+    assert(utils::camelot_distance(key("8A"), key("8B")) == 0);
+    
+    // Mode change to another number costs one more step
+    assert(utils::camelot_distance(key("8A"), key("9B")) == 2);
     
     // Opposite keys
-    assert(utils::camelot_distance("1A", "7A") == 6);
+    static_assert(utils::camelot_distance(0, 12) == 6, "1A and 7A are opposite");
+    
+    // Unknown keys never count as a clash
+    assert(utils::camelot_distance(key("8A"), kUnknownKey) == 0);
+    
+    for (int a = 0; a < 24; ++a) {
+        for (int b = 0; b < 24; ++b) {
+            int d = utils::camelot_distance(static_cast<KeyCode>(a), static_cast<KeyCode>(b));
+            assert(d >= 0 && d <= 7);
+            assert(d == utils::camelot_distance(static_cast<KeyCode>(b), static_cast<KeyCode>(a)));
+        }
+    }
 }
 
 TEST(utils_keys_compatible) {
-    assert(utils::keys_compatible("8A", "8A"));  // Same key
-    assert(utils::keys_compatible("8A", "8B"));  // Relative major
-    assert(utils::keys_compatible("8A", "7A"));  // Adjacent
-    assert(utils::keys_compatible("8A", "9A"));  // Adjacent
-    assert(!utils::keys_compatible("8A", "2A")); // Far apart
+    auto key = utils::key_from_camelot;
+    assert(utils::keys_compatible(key("8A"), key("8A")));  // Same key
+    assert(utils::keys_compatible(key("8A"), key("8B")));  // Relative major
+    assert(utils::keys_compatible(key("8A"), key("7A")));  // Adjacent
+    assert(utils::keys_compatible(key("8A"), key("9A")));  // Adjacent
+    assert(!utils::keys_compatible(key("8A"), key("2A"))); // Far apart
 }
 
 TEST(utils_audio_file_detection) {
@@ -576,6 +1047,25 @@ TEST(analyzer_beat_detection) {
     assert(beats.size() <= 15);
 }
 
+TEST(analyzer_rhythm_single_pass) {
+    BPMDetector detector;
+    auto audio = generate_click_track(120.0f, 10.0f);
+    
+    auto result = detector.analyze(audio);
+    assert(result.ok());
+    
+    const auto& rhythm = result.value();
+    assert(!rhythm.onset_envelope.empty());
+    assert_near(rhythm.onset_rate, audio.sample_rate / 512.0f, 0.01f, "onset rate");
+    
+    // Same results as the individual detectors
+    auto bpm = detector.detect(audio);
+    auto beats = detector.detect_beats(audio);
+    assert(bpm.ok() && beats.ok());
+    assert(rhythm.bpm == bpm.value());
+    assert(rhythm.beats == beats.value());
+}
+
 TEST(analyzer_energy_curve) {
     EnergyAnalyzer analyzer;
     
@@ -631,10 +1121,9 @@ TEST(analyzer_key_detection) {
     assert(result.ok());
     
     // Should return a valid Camelot key
-    std::string key = result.value();
-    assert(!key.empty());
-    assert(key.length() >= 2);
-    assert(key.back() == 'A' || key.back() == 'B');
+    KeyCode key = result.value();
+    assert(key >= 0 && key < 24);
+    assert(!utils::key_to_camelot(key).empty());
 }
 
 TEST(analyzer_chroma) {
@@ -657,6 +1146,186 @@ TEST(analyzer_chroma) {
     assert_near(sum, 1.0f, 0.01f, "chroma normalization");
 }
 
+TEST(analyzer_fft_matches_dft) {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    
+    for (size_t n : {2u, 8u, 64u, 1024u}) {
+        std::vector<float> input(n);
+        for (auto& v : input) v = dist(rng);
+        
+        RealFFT fft(n);
+        std::vector<std::complex<float>> output(fft.bins());
+        fft.forward(input.data(), output.data());
+        
+        // Reference DFT in double precision
+        for (size_t k = 0; k < fft.bins(); ++k) {
+            double re = 0.0, im = 0.0;
+            for (size_t t = 0; t < n; ++t) {
+                double angle = -2.0 * M_PI * k * t / n;
+                re += input[t] * std::cos(angle);
+                im += input[t] * std::sin(angle);
+            }
+            assert_near(output[k].real(), static_cast<float>(re), 1e-3f * n, "FFT real part");
+            assert_near(output[k].imag(), static_cast<float>(im), 1e-3f * n, "FFT imag part");
+        }
+    }
+}
+
+TEST(analyzer_fft_inverse_and_autocorrelation) {
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    
+    // Round trip
+    for (size_t n : {2u, 16u, 4096u}) {
+        std::vector<float> input(n), output(n);
+        for (auto& v : input) v = dist(rng) - 0.5f;
+        
+        RealFFT fft(n);
+        std::vector<std::complex<float>> spectrum(fft.bins());
+        fft.forward(input.data(), spectrum.data());
+        fft.inverse(spectrum.data(), output.data());
+        for (size_t i = 0; i < n; ++i) {
+            assert_near(output[i], input[i], 1e-4f, "FFT round trip");
+        }
+    }
+    
+    // Linear autocorrelation against the direct sum (odd length, no wrap-around)
+    std::vector<float> signal(1001);
+    for (auto& v : signal) v = dist(rng);
+    auto r = autocorrelation(signal.data(), signal.size(), 300);
+    assert(r.size() == 301);
+    for (size_t lag = 0; lag <= 300; lag += 7) {
+        double direct = 0.0;
+        for (size_t i = 0; i + lag < signal.size(); ++i) {
+            direct += signal[i] * signal[i + lag];
+        }
+        assert_near(r[lag], static_cast<float>(direct), 1e-3f * r[0], "autocorrelation");
+    }
+}
+
+TEST(analyzer_tempo_curve_benchmark_2h) {
+    // Onset envelope of a 2-hour mix at 44.1 kHz / 512 hop (~86 frames/s):
+    // a 128 BPM pulse with noise
+    const int onset_sr = 44100 / 512;
+    const size_t frames = static_cast<size_t>(2 * 3600) * onset_sr;
+    const float period = 60.0f * onset_sr / 128.0f;
+    
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> noise(0.0f, 0.2f);
+    std::vector<float> envelope(frames);
+    for (size_t i = 0; i < frames; ++i) {
+        float phase = std::fmod(static_cast<float>(i), period);
+        envelope[i] = (phase < 1.0f ? 1.0f : 0.0f) + noise(rng);
+    }
+    
+    const size_t max_lag = onset_sr;
+    
+    auto t0 = std::chrono::steady_clock::now();
+    auto fast = autocorrelation(envelope.data(), envelope.size(), max_lag);
+    auto t1 = std::chrono::steady_clock::now();
+    
+    // Previous approach: direct sum for each lag
+    std::vector<float> direct(max_lag + 1, 0.0f);
+    for (size_t lag = 0; lag <= max_lag; ++lag) {
+        float corr = 0.0f;
+        for (size_t i = 0; i < envelope.size() - lag; ++i) {
+            corr += envelope[i] * envelope[i + lag];
+        }
+        direct[lag] = corr;
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    
+    auto ms = [](auto a, auto b) { return std::chrono::duration<double, std::milli>(b - a).count(); };
+    std::cout << "[" << frames << " frames, " << (max_lag + 1) << " lags: fft "
+              << ms(t0, t1) << " ms, direct " << ms(t1, t2) << " ms] ";
+    
+    // Mean correlation per lag agrees
+    for (size_t lag = 0; lag <= max_lag; ++lag) {
+        float n = static_cast<float>(frames - lag);
+        assert_near(fast[lag] / n, direct[lag] / n, 1e-3f * fast[0] / frames, "tempo curve");
+    }
+    
+    // Strongest lag below two beat periods is the beat period
+    size_t best = 20;
+    for (size_t lag = 20; lag < static_cast<size_t>(period * 1.5f); ++lag) {
+        if (fast[lag] > fast[best]) best = lag;
+    }
+    assert(std::abs(static_cast<float>(best) - period) < 1.0f);
+}
+
+TEST(analyzer_chroma_full_track) {
+    KeyDetector detector;
+    
+    // 100 s of mono 22050 Hz audio: silence, then A4 only in the last 4 seconds.
+    // Chroma must cover the whole track, not just the first frames.
+    AudioBuffer audio;
+    audio.sample_rate = 22050;
+    audio.channels = 1;
+    audio.samples.resize(100 * 22050, 0.0f);
+    for (size_t i = 96 * 22050; i < audio.samples.size(); ++i) {
+        audio.samples[i] = 0.5f * std::sin(2.0f * M_PI * 440.0f * i / 22050.0f);
+    }
+    
+    auto result = detector.compute_chroma(audio);
+    assert(result.ok());
+    
+    auto chroma = result.value();
+    assert(chroma.size() == 12);
+    
+    // Pitch class 9 = A (C = 0)
+    int best = static_cast<int>(std::max_element(chroma.begin(), chroma.end()) - chroma.begin());
+    assert(best == 9);
+    assert_near(std::accumulate(chroma.begin(), chroma.end(), 0.0f), 1.0f, 0.01f, "chroma normalization");
+}
+
+TEST(analyzer_context_spectrum_frames) {
+    // Stereo C major chord (C4, E4, G4)
+    AudioBuffer audio;
+    audio.sample_rate = 22050;
+    audio.channels = 2;
+    const size_t frames = 5 * 22050;
+    audio.samples.resize(frames * 2);
+    for (size_t i = 0; i < frames; ++i) {
+        float t = static_cast<float>(i) / 22050.0f;
+        float v = 0.3f * (std::sin(2.0f * M_PI * 261.63f * t) +
+                          std::sin(2.0f * M_PI * 329.63f * t) +
+                          std::sin(2.0f * M_PI * 392.00f * t));
+        audio.samples[i * 2] = v;
+        audio.samples[i * 2 + 1] = v;
+    }
+    
+    AnalysisContext context(audio);
+    assert(context.mono().size() == frames);
+    assert(context.sample_rate() == 22050);
+    
+    assert(context.channels() == 2);
+    
+    // Frames are computed on demand; revisiting one gives the same spectrum
+    SpectrumFrames spec = context.spectrum(KeyDetector::kFrameSize, KeyDetector::kHopSize);
+    assert(spec.bins() == KeyDetector::kFrameSize / 2 + 1);
+    assert(spec.frames() == (frames - KeyDetector::kFrameSize) / KeyDetector::kHopSize + 1);
+    std::vector<float> first(spec.frame(0), spec.frame(0) + spec.bins());
+    spec.frame(spec.frames() - 1);
+    const float* again = spec.frame(0);
+    for (size_t k = 0; k < spec.bins(); ++k) {
+        assert(again[k] == first[k]);
+    }
+    
+    // Chroma from the shared context matches the standalone path
+    KeyDetector detector;
+    auto from_context = detector.compute_chroma(context);
+    auto standalone = detector.compute_chroma(audio);
+    assert(from_context.ok() && standalone.ok());
+    for (int i = 0; i < 12; ++i) {
+        assert_near(from_context.value()[i], standalone.value()[i], 1e-5f, "chroma");
+    }
+    
+    auto key = detector.detect_from_chroma(from_context.value());
+    assert(key.ok());
+    assert(key.value() == detector.detect(audio).value());
+}
+
 TEST(analyzer_full_analysis) {
     Analyzer analyzer;
     
@@ -671,11 +1340,186 @@ TEST(analyzer_full_analysis) {
     // Verify all features are populated
     assert(features.bpm > 0);
     assert(!features.beats.empty());
-    assert(!features.key.empty());
+    assert(features.key != kUnknownKey);
     assert(features.energy_curve.size() > 0);
     assert_near(features.duration, 5.0f, 0.1f, "duration");
 }
 
+TEST(analyzer_streaming_matches_buffer) {
+    // Mono click track with a chord underneath (same shape as decode_for_analysis output)
+    auto audio = generate_click_track(124.0f, 20.0f, 22050);
+    audio.samples = audio.to_mono();
+    audio.channels = 1;
+    for (size_t i = 0; i < audio.samples.size(); ++i) {
+        float t = static_cast<float>(i) / 22050.0f;
+        audio.samples[i] += 0.1f * (std::sin(2.0f * M_PI * 220.0f * t) + std::sin(2.0f * M_PI * 277.18f * t));
+    }
+    
+    Analyzer analyzer;
+    auto whole = analyzer.analyze(audio);
+    assert(whole.ok());
+    
+    for (size_t chunk : {1000u, 4097u, 16384u}) {
+        analyzer.begin_stream(audio.sample_rate);
+        for (size_t start = 0; start < audio.samples.size(); start += chunk) {
+            size_t n = std::min(chunk, audio.samples.size() - start);
+            analyzer.push_stream(&audio.samples[start], n);
+        }
+        auto streamed = analyzer.finish_stream();
+        assert(streamed.ok());
+        
+        const auto& a = whole.value();
+        const auto& b = streamed.value();
+        assert(a.bpm == b.bpm);
+        assert(a.beats == b.beats);
+        assert(a.key == b.key);
+        assert(a.chroma == b.chroma);
+        assert(a.mfcc == b.mfcc);
+        assert(a.energy_curve == b.energy_curve);
+        assert_near(a.duration, b.duration, 1e-4f, "duration");
+    }
+    
+    // finish without begin, and an empty stream, are errors
+    assert(analyzer.finish_stream().failed());
+    analyzer.begin_stream(22050);
+    assert(analyzer.finish_stream().failed());
+}
+
+TEST(analyzer_excerpt_analysis) {
+    // Two-minute mono track at the analysis rate; excerpts cut the way
+    // Decoder::decode_excerpts lays them out (start, middle, end)
+    const int sr = 22050;
+    const float duration = 120.0f, length = 20.0f;
+    auto make_track = [&](float bpm) {
+        auto audio = generate_click_track(bpm, duration, sr);
+        audio.samples = audio.to_mono();
+        audio.channels = 1;
+        for (size_t i = 0; i < audio.samples.size(); ++i) {
+            float t = static_cast<float>(i) / sr;
+            audio.samples[i] += 0.1f * (std::sin(2.0f * M_PI * 220.0f * t) + std::sin(2.0f * M_PI * 277.18f * t));
+        }
+        return audio;
+    };
+    auto cut = [&](const AudioBuffer& audio, float start) {
+        AudioExcerpt excerpt;
+        excerpt.start = start;
+        excerpt.audio.sample_rate = sr;
+        excerpt.audio.channels = 1;
+        auto first = audio.samples.begin() + static_cast<size_t>(start * sr);
+        excerpt.audio.samples.assign(first, first + static_cast<size_t>(length * sr));
+        return excerpt;
+    };
+    
+    auto audio = make_track(124.0f);
+    TrackExcerpts track;
+    track.duration = duration;
+    for (float start : {0.0f, 50.0f, 100.0f}) {
+        track.excerpts.push_back(cut(audio, start));
+    }
+    
+    Analyzer analyzer;
+    auto t0 = std::chrono::steady_clock::now();
+    auto full = analyzer.analyze(audio);
+    auto t1 = std::chrono::steady_clock::now();
+    auto fast = analyzer.analyze_excerpts(track);
+    auto t2 = std::chrono::steady_clock::now();
+    assert(full.ok() && fast.ok());
+    std::cout << "(full " << std::chrono::duration<double, std::milli>(t1 - t0).count()
+              << " ms, excerpts " << std::chrono::duration<double, std::milli>(t2 - t1).count() << " ms) ";
+    
+    const auto& f = fast.value();
+    assert_near(f.bpm, full.value().bpm, 1.0f, "excerpt bpm");
+    assert(f.key == full.value().key);
+    assert_near(f.confidence.bpm, 1.0f, 1e-6f, "bpm confidence");
+    assert_near(f.confidence.key, 1.0f, 1e-6f, "key confidence");
+    assert(f.confidence.beats > 0.4f && f.confidence.beats < 0.6f);  // 60 of 120 s detected
+    assert_near(f.duration, duration, 1e-3f, "duration");
+    assert(f.mfcc.size() == full.value().mfcc.size());
+    assert(f.energy_curve.size() == full.value().energy_curve.size());
+    
+    // One sorted grid over the whole track at the beat period
+    const float period = 60.0f / 124.0f;
+    assert(std::is_sorted(f.beats.begin(), f.beats.end()));
+    assert(f.beats.front() < period && f.beats.back() > duration - 2 * period);
+    for (size_t i = 1; i < f.beats.size(); ++i) {
+        assert_near(f.beats[i] - f.beats[i - 1], period, 0.05f, "beat spacing");
+    }
+    
+    // A middle section at another tempo is outvoted but lowers confidence
+    auto other = make_track(90.0f);
+    track.excerpts[1] = cut(other, 50.0f);
+    auto mixed = analyzer.analyze_excerpts(track);
+    assert(mixed.ok());
+    assert_near(mixed.value().bpm, f.bpm, 1.0f, "median bpm");
+    assert_near(mixed.value().confidence.bpm, 2.0f / 3.0f, 1e-4f, "mixed bpm confidence");
+    assert(mixed.value().confidence.overall() <= mixed.value().confidence.bpm);
+    
+    // A single excerpt covering the whole track is a plain full analysis
+    TrackExcerpts whole;
+    whole.duration = duration;
+    whole.excerpts.push_back({0.0f, audio});
+    auto single = analyzer.analyze_excerpts(whole);
+    assert(single.ok());
+    assert(single.value().beats == full.value().beats);
+    assert_near(single.value().confidence.overall(), 1.0f, 1e-6f, "whole-track confidence");
+    
+    assert(analyzer.analyze_excerpts(TrackExcerpts{}).failed());
+}
+
+TEST(analyzer_rhythm_config) {
+    AnalyzerConfig config;
+    assert(config.rhythm_method == RhythmMethod::MultiFeature);
+    
+    config.rhythm_method = RhythmMethod::Degara;
+    Analyzer analyzer(config);
+    assert(analyzer.config().rhythm_method == RhythmMethod::Degara);
+    
+    // BPM and beats come from the same rhythm pass
+    auto audio = generate_click_track(128.0f, 8.0f);
+    auto features = analyzer.analyze(audio);
+    assert(features.ok());
+    assert(features.value().bpm == analyzer.detect_bpm(audio).value());
+    assert(features.value().beats == analyzer.detect_beats(audio).value());
+}
+
+TEST(analyzer_reuse_benchmark) {
+    // Scan workers keep one Analyzer for many tracks; compare against
+    // constructing a fresh Analyzer (and its algorithm pool) per track.
+    const int tracks = 6;
+    std::vector<AudioBuffer> audio;
+    for (int i = 0; i < tracks; ++i) {
+        audio.push_back(generate_click_track(110.0f + 5.0f * i, 20.0f));
+    }
+    
+    auto ms = [](auto a, auto b) { return std::chrono::duration<double, std::milli>(b - a).count(); };
+    
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<TrackFeatures> fresh;
+    for (const auto& track : audio) {
+        Analyzer analyzer;
+        fresh.push_back(analyzer.analyze(track).value());
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    
+    Analyzer pooled;
+    std::vector<TrackFeatures> reused;
+    for (const auto& track : audio) {
+        reused.push_back(pooled.analyze(track).value());
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    
+    std::cout << "[" << tracks << " tracks: fresh " << ms(t0, t1) / tracks << " ms/track, reused "
+              << ms(t1, t2) / tracks << " ms/track] ";
+    
+    // Reusing the Analyzer must not leak state between tracks
+    for (int i = 0; i < tracks; ++i) {
+        assert(fresh[i].bpm == reused[i].bpm);
+        assert(fresh[i].beats == reused[i].beats);
+        assert(fresh[i].key == reused[i].key);
+        assert(fresh[i].mfcc == reused[i].mfcc);
+    }
+}
+
 /* ============================================================================
  * Main
  * ============================================================================ */
@@ -692,7 +1536,17 @@ int main() {
     RUN_TEST(store_get_all_tracks);
     RUN_TEST(store_search_tracks);
     RUN_TEST(store_needs_analysis);
+    RUN_TEST(store_scan_snapshot);
+    RUN_TEST(content_hash_fingerprint);
+    RUN_TEST(store_copy_track_analysis);
+    RUN_TEST(walker_lists_tree_in_parallel);
+    RUN_TEST(walker_skips_unchanged_dirs);
     RUN_TEST(store_upsert_path_duration);
+    RUN_TEST(store_upsert_returns_id);
+    RUN_TEST(store_writer_batches);
+    RUN_TEST(store_writer_benchmark);
+    RUN_TEST(store_statement_cache_benchmark);
+    RUN_TEST(store_statement_reentrant_use);
     
     std::cout << "\n--- Store Metadata Module ---\n";
     RUN_TEST(store_metadata_upsert_and_get);
@@ -706,6 +1560,7 @@ int main() {
     RUN_TEST(utils_math);
     RUN_TEST(utils_cosine_distance);
     RUN_TEST(utils_bpm_distance);
+    RUN_TEST(utils_key_codes);
     RUN_TEST(utils_camelot_distance);
     RUN_TEST(utils_keys_compatible);
     RUN_TEST(utils_audio_file_detection);
@@ -716,10 +1571,20 @@ int main() {
     std::cout << "\n--- Analyzer Module ---\n";
     RUN_TEST(analyzer_bpm_detection);
     RUN_TEST(analyzer_beat_detection);
+    RUN_TEST(analyzer_rhythm_single_pass);
     RUN_TEST(analyzer_energy_curve);
     RUN_TEST(analyzer_key_detection);
     RUN_TEST(analyzer_chroma);
+    RUN_TEST(analyzer_fft_matches_dft);
+    RUN_TEST(analyzer_fft_inverse_and_autocorrelation);
+    RUN_TEST(analyzer_tempo_curve_benchmark_2h);
+    RUN_TEST(analyzer_chroma_full_track);
+    RUN_TEST(analyzer_context_spectrum_frames);
     RUN_TEST(analyzer_full_analysis);
+    RUN_TEST(analyzer_streaming_matches_buffer);
+    RUN_TEST(analyzer_excerpt_analysis);
+    RUN_TEST(analyzer_rhythm_config);
+    RUN_TEST(analyzer_reuse_benchmark);
     
     std::cout << "\n======================================\n";
     if (failed_tests == 0) {
@@ -6,13 +6,19 @@
 #include "automix/types.h"
 #include "../src/core/utils.h"
 #include "../src/matcher/similarity.h"
+#include "../src/matcher/feature_matrix.h"
+#include "../src/matcher/simd_kernels.h"
+#include "../src/matcher/ann_index.h"
+#include "../src/matcher/compatibility_index.h"
 #include "../src/matcher/playlist.h"
 #include "../src/matcher/transition_points.h"
 
 #include <iostream>
 #include <cassert>
+#include <chrono>
 #include <cmath>
 #include <numeric>
+#include <random>
 #include <unordered_set>
 
 using namespace automix;
@@ -60,7 +66,7 @@ TrackInfo make_track(int64_t id, float bpm, const std::string& key,
     track.id = id;
     track.path = "/test/track_" + std::to_string(id) + ".mp3";
     track.bpm = bpm;
-    track.key = key;
+    track.key = utils::key_from_camelot(key);
     track.duration = duration;
     
     // Generate beats at the given BPM
@@ -277,6 +283,298 @@ TEST(similarity_energy_segmented) {
     assert_true(d_diff > d_same, "Inverted energy curve should have larger distance");
 }
 
+/* ============================================================================
+ * FeatureMatrix Tests
+ * ============================================================================ */
+
+// Varied tracks: unknown keys, missing features, energy curves of any length
+std::vector<TrackInfo> make_library(size_t count, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    
+    std::vector<TrackInfo> tracks;
+    tracks.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        TrackInfo track;
+        track.id = static_cast<int64_t>(i) + 1;
+        track.bpm = i % 17 == 0 ? 0.0f : 80.0f + 100.0f * unit(rng);
+        track.key = i % 13 == 0 ? kUnknownKey : utils::key_from_camelot(std::to_string(1 + rng() % 12) + (rng() % 2 ? "A" : "B"));
+        track.duration = 120.0f + 300.0f * unit(rng);
+        if (i % 11 != 0) {
+            track.mfcc.resize(13);
+            for (auto& v : track.mfcc) v = unit(rng) - 0.5f;
+        }
+        if (i % 7 != 0) {
+            track.chroma.resize(12);
+            for (auto& v : track.chroma) v = unit(rng);
+        }
+        if (i % 5 != 0) {
+            track.energy_curve.resize(1 + rng() % 300);
+            for (auto& v : track.energy_curve) v = unit(rng);
+        }
+        tracks.push_back(std::move(track));
+    }
+    return tracks;
+}
+
+TEST(feature_matrix_key_codes) {
+    auto tracks = make_library(200, 5);
+    FeatureMatrix matrix(tracks);
+    size_t unknown = 0;
+    for (size_t i = 0; i < tracks.size(); ++i) {
+        assert_true(matrix.key(i) == tracks[i].key, "Matrix keeps the key code");
+        if (matrix.key(i) == kUnknownKey) unknown++;
+    }
+    assert_true(unknown > 0 && unknown < tracks.size(), "Library mixes known and unknown keys");
+}
+
+TEST(feature_matrix_matches_track_distance) {
+    auto tracks = make_library(200, 3);
+    FeatureMatrix matrix(tracks);
+    assert_true(matrix.size() == tracks.size(), "One row per track");
+    assert_true(matrix.index_of(tracks[42].id) == size_t(42), "Rows follow input order");
+    assert_true(!matrix.index_of(9999).has_value(), "Unknown id has no row");
+    
+    SimilarityCalculator calc(SimilarityWeights::for_electronic());
+    PlaylistRules rules;
+    rules.bpm_tolerance = 0.08f;
+    rules.max_key_distance = 2;
+    rules.min_energy_match = 0.6f;
+    
+    for (size_t a = 0; a < tracks.size(); a += 3) {
+        for (size_t b = 0; b < tracks.size(); b += 7) {
+            assert_near(calc.distance(matrix, a, b), calc.distance(tracks[a], tracks[b]), 1e-5f,
+                "Matrix distance should match TrackInfo distance");
+            assert_true(calc.are_compatible(matrix, a, b, rules) == calc.are_compatible(tracks[a], tracks[b], rules),
+                "Matrix compatibility should match TrackInfo compatibility");
+        }
+    }
+    
+    auto by_row = calc.find_similar(matrix, 10, 5);
+    auto by_track = calc.find_similar(tracks[10], tracks, 5);
+    assert_true(by_row.size() == by_track.size(), "Same number of similar tracks");
+    for (size_t i = 0; i < by_row.size(); ++i) {
+        assert_near(by_row[i].second, by_track[i].second, 1e-5f, "Same distances");
+    }
+}
+
+TEST(similarity_batched_kernels_match_scalar) {
+    auto tracks = make_library(1000, 5);
+    FeatureMatrix matrix(tracks);
+    SimilarityCalculator calc;
+    
+    const simd::Isa best = simd::active_isa();
+    std::vector<size_t> rows;
+    for (size_t i = 0; i < matrix.size(); i += 3) rows.push_back(i);
+    
+    std::vector<float> batched(rows.size());
+    std::vector<float> scalar(rows.size());
+    for (size_t query : {size_t(1), size_t(5), size_t(500)}) {
+        calc.distances(matrix, query, rows.data(), rows.size(), batched.data());
+        assert_true(simd::use_isa(simd::Isa::Scalar), "Scalar kernels are always available");
+        calc.distances(matrix, query, rows.data(), rows.size(), scalar.data());
+        simd::use_isa(best);
+        
+        for (size_t k = 0; k < rows.size(); ++k) {
+            assert_near(batched[k], scalar[k], 1e-5f, "Vector and scalar kernels should agree");
+            assert_near(batched[k], calc.distance(tracks[query], tracks[rows[k]]), 1e-5f,
+                "Batched distance should match the TrackInfo distance");
+        }
+    }
+    
+    // Contiguous ranges, including a partial last block
+    std::vector<float> range(matrix.size());
+    calc.distances_in_range(matrix, 7, 0, matrix.size(), range.data());
+    for (size_t i = 0; i < matrix.size(); i += 37) {
+        assert_near(range[i], calc.distance(matrix, 7, i), 1e-5f, "Range and pair distances should agree");
+    }
+}
+
+TEST(similarity_find_similar_benchmark) {
+    auto tracks = make_library(200000, 13);
+    FeatureMatrix matrix(tracks);
+    tracks.clear();
+    SimilarityCalculator calc;
+    
+    auto t0 = std::chrono::steady_clock::now();
+    auto similar = calc.find_similar(matrix, 0, 10);
+    auto t1 = std::chrono::steady_clock::now();
+    
+    assert_true(similar.size() == 10, "Should return 10 tracks");
+    for (size_t i = 1; i < similar.size(); ++i) {
+        assert_true(similar[i - 1].second <= similar[i].second, "Results should be sorted");
+    }
+    
+    // Same top result as a plain scan over pair distances
+    size_t best = 1;
+    for (size_t i = 1; i < matrix.size(); ++i) {
+        if (calc.distance(matrix, 0, i) < calc.distance(matrix, 0, best)) best = i;
+    }
+    assert_near(similar[0].second, calc.distance(matrix, 0, best), 1e-6f, "Nearest track should match a full scan");
+    
+    std::cout << "(" << simd::isa_name(simd::active_isa()) << ", 200k tracks "
+              << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms) ";
+}
+
+/* ============================================================================
+ * AnnIndex Tests
+ * ============================================================================ */
+
+TEST(ann_index_recall) {
+    auto tracks = make_library(20000, 17);
+    FeatureMatrix matrix(tracks);
+    tracks.clear();
+    
+    auto t0 = std::chrono::steady_clock::now();
+    AnnIndex index;
+    index.sync(matrix);
+    auto t1 = std::chrono::steady_clock::now();
+    assert_true(index.size() == matrix.size(), "Every track should be indexed");
+    
+    const size_t k = 10;
+    const size_t queries = 200;
+    std::cout << "(build " << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms";
+    for (int ef : {16, 64, 256}) {
+        size_t hits = 0;
+        double us = 0.0;
+        for (size_t q = 0; q < queries; ++q) {
+            const size_t row = (q * 97) % matrix.size();
+            float query[AnnIndex::kDims];
+            AnnIndex::embed(matrix, row, query);
+            
+            auto s0 = std::chrono::steady_clock::now();
+            auto found = index.search(matrix, row, k, ef);
+            auto s1 = std::chrono::steady_clock::now();
+            us += std::chrono::duration<double, std::micro>(s1 - s0).count();
+            
+            auto exact = index.search_exact(query, k);
+            std::unordered_set<int64_t> expected;
+            for (const auto& result : exact) expected.insert(result.first);
+            for (const auto& result : found) hits += expected.count(result.first);
+        }
+        const float recall = static_cast<float>(hits) / static_cast<float>(queries * k);
+        std::cout << ", ef " << ef << " recall " << recall << " " << us / queries << " us";
+        if (ef == 256) {
+            assert_true(recall > 0.95f, "Recall should be high with a wide search");
+        }
+    }
+    std::cout << ") ";
+}
+
+TEST(ann_index_incremental_updates) {
+    auto tracks = make_library(2000, 19);
+    FeatureMatrix first(std::vector<TrackInfo>(tracks.begin(), tracks.begin() + 1500));
+    
+    AnnIndex index;
+    assert_true(index.sync(first) == 1500, "First sync adds every track");
+    assert_true(index.sync(first) == 0, "Unchanged library adds nothing");
+    
+    // Drop 100 tracks, change one, add 500
+    std::vector<TrackInfo> next(tracks.begin() + 100, tracks.end());
+    next[0].mfcc.assign(13, 0.25f);
+    FeatureMatrix second(next);
+    assert_true(index.sync(second) == 501, "New and changed tracks are added");
+    assert_true(index.size() == second.size(), "Index should match the library");
+    assert_true(!index.contains(tracks[50].id), "Removed track should be gone");
+    assert_true(index.contains(tracks[1800].id), "New track should be indexed");
+    
+    for (size_t row = 0; row < second.size(); row += 37) {
+        auto found = index.search(second, row, 5);
+        assert_true(!found.empty(), "Search should find tracks");
+        for (const auto& result : found) {
+            assert_true(second.index_of(result.first).has_value(), "Removed tracks are never returned");
+        }
+    }
+    
+    // The changed track is found at its new position
+    float query[AnnIndex::kDims];
+    AnnIndex::embed(second, 0, query);
+    auto found = index.search(query, 1, 64);
+    assert_true(!found.empty() && found[0].first == next[0].id, "Changed track should be re-indexed");
+}
+
+TEST(ann_index_filtered_search) {
+    auto tracks = make_library(3000, 23);
+    FeatureMatrix matrix(tracks);
+    AnnIndex index;
+    index.sync(matrix);
+    
+    auto even = [](int64_t id) { return id % 2 == 0; };
+    auto found = index.search(matrix, 10, 20, 100, even);
+    assert_true(found.size() == 20, "Filter should still fill the results");
+    for (size_t i = 0; i < found.size(); ++i) {
+        assert_true(even(found[i].first), "Only accepted tracks are returned");
+        if (i > 0) assert_true(found[i - 1].second <= found[i].second, "Results should be sorted");
+    }
+    
+    auto none = index.search(matrix, 10, 20, 100, [](int64_t) { return false; });
+    assert_true(none.empty(), "Rejecting everything returns nothing");
+}
+
+TEST(similarity_find_similar_with_index) {
+    auto tracks = make_library(5000, 29);
+    FeatureMatrix matrix(tracks);
+    AnnIndex index;
+    index.sync(matrix);
+    SimilarityCalculator calc;
+    
+    auto similar = calc.find_similar(matrix, 3, 10, index, 200);
+    assert_true(similar.size() == 10, "Should return 10 tracks");
+    for (size_t i = 0; i < similar.size(); ++i) {
+        assert_true(similar[i].first != 3, "Target is not its own match");
+        assert_near(similar[i].second, calc.distance(matrix, 3, similar[i].first), 1e-6f, "Full distance decides the order");
+        if (i > 0) assert_true(similar[i - 1].second <= similar[i].second, "Results should be sorted");
+    }
+}
+
+/* ============================================================================
+ * CompatibilityIndex Tests
+ * ============================================================================ */
+
+TEST(compatibility_index_lists_compatible_tracks) {
+    auto tracks = make_library(5000, 31);
+    FeatureMatrix matrix(tracks);
+    CompatibilityIndex index(matrix);
+    SimilarityCalculator calc;
+    assert_true(index.size() == matrix.size(), "Every track should be indexed");
+    
+    std::vector<PlaylistRules> all_rules(6);
+    all_rules[0].bpm_tolerance = 0.04f;
+    all_rules[1].bpm_step_limit = 3.0f;
+    all_rules[2].allow_key_change = false;
+    all_rules[3].max_key_distance = 1;
+    all_rules[4].bpm_tolerance = 0.6f;
+    all_rules[4].max_key_distance = 2;
+    all_rules[5].bpm_tolerance = 0.08f;
+    all_rules[5].bpm_step_limit = 5.0f;
+    all_rules[5].allow_key_change = false;
+    
+    for (const auto& rules : all_rules) {
+        assert_true(CompatibilityIndex::narrows(rules), "Rules restrict BPM or key");
+        for (size_t current = 0; current < matrix.size(); current += 131) {
+            std::vector<size_t> listed;
+            index.candidates(matrix, current, rules, listed);
+            std::unordered_set<size_t> seen(listed.begin(), listed.end());
+            assert_true(seen.size() == listed.size(), "No track is listed twice");
+            
+            for (size_t row = 0; row < matrix.size(); ++row) {
+                bool ok = calc.are_compatible(matrix, current, row, rules);
+                if (ok && rules.bpm_step_limit > 0 && matrix.bpm(current) > 0 && matrix.bpm(row) > 0) {
+                    ok = utils::bpm_distance(matrix.bpm(current), matrix.bpm(row)) <= rules.bpm_step_limit / 100.0f;
+                }
+                if (ok) assert_true(seen.count(row) > 0, "Every compatible track is listed");
+            }
+            if (matrix.bpm(current) > 0 && matrix.key(current) != kUnknownKey) {
+                assert_true(listed.size() < matrix.size() / 2, "Buckets narrow the candidates");
+            }
+        }
+    }
+    
+    PlaylistRules loose;
+    loose.max_key_distance = 12;
+    assert_true(!CompatibilityIndex::narrows(loose), "Limits past the wheel do not narrow");
+}
+
 /* ============================================================================
  * PlaylistGenerator Tests
  * ============================================================================ */
@@ -325,6 +623,33 @@ TEST(playlist_no_duplicates) {
     }
 }
 
+TEST(playlist_exhausts_library_once) {
+    PlaylistGenerator gen;
+    
+    TrackInfo seed = make_track(1, 128.0f, "8A");
+    
+    // Duplicated ids, including the seed's, are offered once
+    std::vector<TrackInfo> candidates;
+    for (int i = 1; i <= 40; ++i) {
+        candidates.push_back(make_track(i, 120.0f + i * 0.5f, i % 2 ? "8A" : "9A"));
+    }
+    candidates.push_back(make_track(7, 130.0f, "8A"));
+    candidates.push_back(make_track(1, 128.0f, "8A"));
+    
+    PlaylistRules rules;
+    rules.random_seed = 11;
+    TransitionConfig config;
+    
+    auto playlist = gen.generate(seed, candidates, 100, rules, config);
+    
+    assert_true(playlist.size() == 40, "Every track should be used once");
+    std::unordered_set<int64_t> ids;
+    for (const auto& entry : playlist.entries) {
+        assert_true(ids.insert(entry.track_id).second, "Should have no duplicate tracks");
+    }
+    assert_true(!playlist.entries.back().transition_to_next.has_value(), "Last entry has no transition");
+}
+
 TEST(playlist_transitions_generated) {
     PlaylistGenerator gen;
     
@@ -478,6 +803,305 @@ TEST(playlist_reproducible_seed) {
     }
 }
 
+TEST(playlist_generate_from_matrix) {
+    std::vector<TrackInfo> tracks;
+    for (int i = 1; i <= 40; ++i) {
+        tracks.push_back(make_track(i, 118.0f + i * 0.5f, i % 3 ? "8A" : "9A", 240.0f, 0.2f + 0.015f * i));
+    }
+    
+    PlaylistRules rules;
+    rules.energy_arc = EnergyArc::Peak;
+    rules.max_key_distance = 1;
+    rules.random_seed = 7;
+    TransitionConfig config;
+    
+    std::vector<TrackInfo> candidates(tracks.begin() + 1, tracks.end());
+    auto from_tracks = PlaylistGenerator().generate(tracks[0], candidates, 12, rules, config);
+    
+    FeatureMatrix library(tracks);
+    int loads = 0;
+    auto loader = [&](int64_t id) -> std::optional<TrackInfo> {
+        loads++;
+        return tracks[*library.index_of(id)];
+    };
+    auto from_matrix = PlaylistGenerator().generate(library, 0, 12, rules, config, loader);
+    
+    assert_true(from_matrix.size() == 12, "Playlist should have 12 tracks");
+    assert_true(loads == 12, "Only the chosen tracks are loaded");
+    for (size_t i = 0; i < from_matrix.size(); ++i) {
+        assert_true(from_matrix.entries[i].track_id == from_tracks.entries[i].track_id,
+            "Matrix and TrackInfo generation should agree");
+    }
+    
+    // Tracks that can no longer be loaded are left out
+    auto without_odd = PlaylistGenerator().generate(library, 0, 12, rules, config, [&](int64_t id) -> std::optional<TrackInfo> {
+        if (id % 2) return id == 1 ? std::optional<TrackInfo>(tracks[0]) : std::nullopt;
+        return tracks[*library.index_of(id)];
+    });
+    assert_true(without_odd.size() == 12, "Enough loadable tracks remain");
+    for (size_t i = 1; i < without_odd.size(); ++i) {
+        assert_true(without_odd.entries[i].track_id % 2 == 0, "Unloadable tracks are skipped");
+    }
+}
+
+TEST(playlist_large_library_benchmark) {
+    auto tracks = make_library(20000, 11);
+    
+    auto t0 = std::chrono::steady_clock::now();
+    FeatureMatrix library(tracks);
+    auto t1 = std::chrono::steady_clock::now();
+    
+    PlaylistRules rules;
+    rules.random_seed = 99;
+    TransitionConfig config;
+    auto playlist = PlaylistGenerator().generate(library, 1, 20, rules, config, [&](int64_t id) {
+        return std::optional<TrackInfo>(tracks[*library.index_of(id)]);
+    });
+    auto t2 = std::chrono::steady_clock::now();
+    
+    assert_true(playlist.size() == 20, "Playlist should have 20 tracks");
+    auto ms = [](auto a, auto b) { return std::chrono::duration<double, std::milli>(b - a).count(); };
+    std::cout << "(matrix " << ms(t0, t1) << " ms, 20 tracks from 20k " << ms(t1, t2) << " ms) ";
+}
+
+TEST(playlist_generate_with_index) {
+    auto tracks = make_library(20000, 11);
+    FeatureMatrix library(tracks);
+    AnnIndex index;
+    index.sync(library);
+    
+    PlaylistRules rules;
+    rules.random_seed = 99;
+    TransitionConfig config;
+    PlaylistGenerator gen;
+    gen.set_candidate_index(&index, 128);
+    
+    auto t0 = std::chrono::steady_clock::now();
+    auto playlist = gen.generate(library, 1, 20, rules, config, [&](int64_t id) {
+        return std::optional<TrackInfo>(tracks[*library.index_of(id)]);
+    });
+    auto t1 = std::chrono::steady_clock::now();
+    
+    assert_true(playlist.size() == 20, "Playlist should have 20 tracks");
+    std::unordered_set<int64_t> seen;
+    for (const auto& entry : playlist.entries) {
+        assert_true(seen.insert(entry.track_id).second, "No duplicates");
+    }
+    for (size_t i = 1; i < playlist.entries.size(); ++i) {
+        size_t a = *library.index_of(playlist.entries[i - 1].track_id);
+        size_t b = *library.index_of(playlist.entries[i].track_id);
+        assert_true(SimilarityCalculator().are_compatible(library, a, b, rules),
+            "Consecutive tracks should be compatible");
+    }
+    std::cout << "(20 tracks from 20k " << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms) ";
+}
+
+TEST(playlist_buckets_match_full_scan) {
+    auto tracks = make_library(3000, 37);
+    FeatureMatrix library(tracks);
+    CompatibilityIndex index(library);
+    auto loader = [&](int64_t id) { return std::optional<TrackInfo>(tracks[*library.index_of(id)]); };
+    
+    PlaylistRules rules;
+    rules.random_seed = 5;
+    rules.bpm_tolerance = 0.06f;
+    rules.max_key_distance = 2;
+    rules.bpm_step_limit = 4.0f;
+    rules.energy_arc = EnergyArc::Peak;
+    TransitionConfig config;
+    
+    PlaylistGenerator scan;
+    auto expected = scan.generate(library, 3, 30, rules, config, loader);
+    
+    PlaylistGenerator bucketed;
+    bucketed.set_compatibility_index(&index);
+    auto playlist = bucketed.generate(library, 3, 30, rules, config, loader);
+    
+    assert_true(playlist.size() == expected.size(), "Same length");
+    for (size_t i = 0; i < playlist.size(); ++i) {
+        assert_true(playlist.entries[i].track_id == expected.entries[i].track_id, "Same tracks in the same order");
+    }
+}
+
+TEST(playlist_threads_match_serial) {
+    // Several scoring chunks per step, no rules: every track is scored
+    auto tracks = make_library(5000, 43);
+    FeatureMatrix library(tracks);
+    auto loader = [&](int64_t id) { return std::optional<TrackInfo>(tracks[*library.index_of(id)]); };
+    
+    PlaylistRules rules;
+    rules.random_seed = 17;
+    rules.energy_arc = EnergyArc::Wave;
+    TransitionConfig config;
+    
+    PlaylistGenerator serial;
+    serial.set_threads(1);
+    auto expected = serial.generate(library, 0, 25, rules, config, loader);
+    
+    PlaylistGenerator parallel;
+    parallel.set_threads(4);
+    auto playlist = parallel.generate(library, 0, 25, rules, config, loader);
+    
+    assert_true(expected.size() == 25, "Full playlist");
+    assert_true(playlist.size() == expected.size(), "Same length");
+    for (size_t i = 0; i < playlist.size(); ++i) {
+        assert_true(playlist.entries[i].track_id == expected.entries[i].track_id, "Same tracks in the same order");
+    }
+}
+
+TEST(playlist_bucket_benchmark) {
+    // Fully analyzed: tracks without BPM or key pass every rule and are
+    // always scored
+    auto tracks = make_library(200000, 41);
+    for (size_t i = 0; i < tracks.size(); ++i) {
+        if (tracks[i].bpm <= 0) tracks[i].bpm = 90.0f + static_cast<float>(i % 80);
+        if (tracks[i].key == kUnknownKey) tracks[i].key = static_cast<KeyCode>(i % 24);
+    }
+    FeatureMatrix library(tracks);
+    
+    auto t0 = std::chrono::steady_clock::now();
+    CompatibilityIndex index(library);
+    auto t1 = std::chrono::steady_clock::now();
+    
+    PlaylistRules rules;
+    rules.random_seed = 8;
+    rules.bpm_tolerance = 0.03f;
+    rules.allow_key_change = false;
+    TransitionConfig config;
+    PlaylistGenerator gen;
+    gen.set_compatibility_index(&index);
+    auto playlist = gen.generate(library, 1, 50, rules, config, [&](int64_t id) {
+        return std::optional<TrackInfo>(tracks[*library.index_of(id)]);
+    });
+    auto t2 = std::chrono::steady_clock::now();
+    
+    assert_true(playlist.size() == 50, "Playlist should have 50 tracks");
+    auto ms = [](auto a, auto b) { return std::chrono::duration<double, std::milli>(b - a).count(); };
+    std::cout << "(buckets " << ms(t0, t1) << " ms, 50 tracks from 200k " << ms(t1, t2) << " ms) ";
+}
+
+TEST(playlist_beam_search_follows_arc) {
+    // Small library, tight rules, flat energy curves spread over the range
+    auto tracks = make_library(400, 47);
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> unit(0.05f, 0.95f);
+    for (auto& track : tracks) {
+        track.energy_curve.assign(64, unit(rng));
+    }
+    FeatureMatrix library(tracks);
+    auto loader = [&](int64_t id) { return std::optional<TrackInfo>(tracks[*library.index_of(id)]); };
+    
+    PlaylistRules rules;
+    rules.random_seed = 9;
+    rules.bpm_tolerance = 0.03f;
+    rules.max_key_distance = 1;
+    rules.energy_arc = EnergyArc::Peak;
+    rules.beam_time_limit = 0;
+    TransitionConfig config;
+    
+    // Mean distance from the arc the greedy generator aims at
+    auto arc_error = [&](const Playlist& playlist) {
+        const float peak = 0.6f * 30;
+        float error = 0.0f;
+        for (size_t i = 1; i < playlist.size(); ++i) {
+            float target = i < peak ? 0.3f + 0.7f * (i / peak) : 1.0f - 0.6f * ((i - peak) / (30 - peak));
+            error += std::abs(library.mean_energy(*library.index_of(playlist.entries[i].track_id)) - target);
+        }
+        return error / (playlist.size() - 1);
+    };
+    
+    PlaylistGenerator greedy;
+    auto stepwise = greedy.generate(library, 0, 30, rules, config, loader);
+    
+    rules.beam_width = 16;
+    PlaylistGenerator serial;
+    serial.set_threads(1);
+    auto planned = serial.generate(library, 0, 30, rules, config, loader);
+    
+    assert_true(planned.size() == 30, "Beam search should fill the playlist");
+    std::unordered_set<int64_t> ids;
+    for (const auto& entry : planned.entries) {
+        assert_true(ids.insert(entry.track_id).second, "Should have no duplicate tracks");
+    }
+    for (size_t i = 0; i + 1 < planned.size(); ++i) {
+        assert_true(planned.entries[i].transition_to_next.has_value(), "Transitions should be planned");
+    }
+    assert_true(arc_error(planned) < arc_error(stepwise), "Should follow the arc closer than greedy selection");
+    
+    PlaylistGenerator parallel;
+    parallel.set_threads(4);
+    auto again = parallel.generate(library, 0, 30, rules, config, loader);
+    assert_true(again.size() == planned.size(), "Same length");
+    for (size_t i = 0; i < again.size(); ++i) {
+        assert_true(again.entries[i].track_id == planned.entries[i].track_id, "Same tracks with any thread count");
+    }
+    
+    // Limited lookahead still fills the playlist
+    rules.beam_depth = 4;
+    auto lookahead = serial.generate(library, 0, 30, rules, config, loader);
+    assert_true(lookahead.size() == 30, "Lookahead should fill the playlist");
+    rules.beam_depth = 0;
+    
+    // Planned tracks that fail to load are replaced, and transitions start
+    // from the track actually before them
+    std::unordered_set<int64_t> missing = {planned.entries[5].track_id, planned.entries[12].track_id};
+    auto flaky = serial.generate(library, 0, 30, rules, config, [&](int64_t id) {
+        return missing.count(id) ? std::nullopt : loader(id);
+    });
+    assert_true(flaky.size() == 30, "Failed loads should be filled in");
+    for (size_t i = 0; i + 1 < flaky.size(); ++i) {
+        assert_true(!missing.count(flaky.entries[i].track_id), "Unloadable tracks should be left out");
+        const auto& plan = flaky.entries[i].transition_to_next;
+        assert_true(plan && plan->from_track_id == flaky.entries[i].track_id &&
+                    plan->to_track_id == flaky.entries[i + 1].track_id, "Transitions should follow the order");
+    }
+}
+
+TEST(playlist_beam_search_past_pool) {
+    // More tracks than the beam search orders
+    auto tracks = make_library(3000, 59);
+    FeatureMatrix library(tracks);
+    
+    PlaylistRules rules;
+    rules.beam_width = 2;
+    rules.beam_time_limit = 0;
+    TransitionConfig config;
+    PlaylistGenerator gen;
+    const int count = static_cast<int>(PlaylistGenerator::kBeamPool) + 100;
+    auto playlist = gen.generate(library, 0, count, rules, config, [&](int64_t id) {
+        return std::optional<TrackInfo>(tracks[*library.index_of(id)]);
+    });
+    
+    assert_true(static_cast<int>(playlist.size()) == count, "Playlist should continue past the beam pool");
+    std::unordered_set<int64_t> ids;
+    for (const auto& entry : playlist.entries) {
+        assert_true(ids.insert(entry.track_id).second, "Should have no duplicate tracks");
+    }
+}
+
+TEST(playlist_beam_search_benchmark) {
+    auto tracks = make_library(50000, 53);
+    FeatureMatrix library(tracks);
+    
+    PlaylistRules rules;
+    rules.bpm_tolerance = 0.08f;
+    rules.max_key_distance = 2;
+    rules.energy_arc = EnergyArc::Ascending;
+    rules.beam_width = 64;
+    rules.beam_time_limit = 0;
+    TransitionConfig config;
+    PlaylistGenerator gen;
+    
+    auto t0 = std::chrono::steady_clock::now();
+    auto playlist = gen.generate(library, 0, 60, rules, config, [&](int64_t id) {
+        return std::optional<TrackInfo>(tracks[*library.index_of(id)]);
+    });
+    auto t1 = std::chrono::steady_clock::now();
+    
+    assert_true(playlist.size() == 60, "Playlist should have 60 tracks");
+    std::cout << "(60 tracks, width 64: " << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms) ";
+}
+
 /* ============================================================================
  * TransitionPointFinder Tests
  * ============================================================================ */
@@ -710,15 +1334,40 @@ int main() {
     RUN_TEST(similarity_are_compatible);
     RUN_TEST(similarity_energy_segmented);
     
+    std::cout << "\n--- FeatureMatrix ---\n";
+    RUN_TEST(feature_matrix_key_codes);
+    RUN_TEST(feature_matrix_matches_track_distance);
+    RUN_TEST(similarity_batched_kernels_match_scalar);
+    RUN_TEST(similarity_find_similar_benchmark);
+    
+    std::cout << "\n--- AnnIndex ---\n";
+    RUN_TEST(ann_index_recall);
+    RUN_TEST(ann_index_incremental_updates);
+    RUN_TEST(ann_index_filtered_search);
+    RUN_TEST(similarity_find_similar_with_index);
+    
+    std::cout << "\n--- CompatibilityIndex ---\n";
+    RUN_TEST(compatibility_index_lists_compatible_tracks);
+    
     std::cout << "\n--- PlaylistGenerator ---\n";
     RUN_TEST(playlist_generate_length);
     RUN_TEST(playlist_no_duplicates);
+    RUN_TEST(playlist_exhausts_library_once);
     RUN_TEST(playlist_transitions_generated);
     RUN_TEST(playlist_energy_arc_ascending);
     RUN_TEST(playlist_bpm_progression);
     RUN_TEST(playlist_create_with_transitions);
     RUN_TEST(playlist_relaxed_fallback);
     RUN_TEST(playlist_reproducible_seed);
+    RUN_TEST(playlist_generate_from_matrix);
+    RUN_TEST(playlist_large_library_benchmark);
+    RUN_TEST(playlist_generate_with_index);
+    RUN_TEST(playlist_buckets_match_full_scan);
+    RUN_TEST(playlist_threads_match_serial);
+    RUN_TEST(playlist_bucket_benchmark);
+    RUN_TEST(playlist_beam_search_follows_arc);
+    RUN_TEST(playlist_beam_search_past_pool);
+    RUN_TEST(playlist_beam_search_benchmark);
     
     std::cout << "\n--- TransitionPointFinder ---\n";
     RUN_TEST(transition_out_point_in_window);
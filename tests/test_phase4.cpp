@@ -12,13 +12,24 @@
 #include "mixer/deck.h"
 #include "mixer/crossfader.h"
 #include "mixer/scheduler.h"
+#include "mixer/playlist_session.h"
 #include "mixer/engine.h"
+#include "mixer/scan_pipeline.h"
+#include "core/utils.h"
+#include "core/content_hash.h"
 #include <iostream>
 #include <cassert>
 #include <cmath>
 #include <cstring>
 #include <vector>
 #include <numeric>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <thread>
 
 using namespace automix;
 
@@ -675,6 +686,345 @@ void test_scheduler_previous() {
     std::cout << "PASSED\n";
 }
 
+// Endless source cycling through the test tracks, counting what it hands out
+class CyclingSource : public PlaylistSource {
+public:
+    std::optional<PlaylistEntry> next_entry(bool /*wait*/) override {
+        int64_t id = static_cast<int64_t>(taken % g_test_tracks.size()) + 1;
+        int64_t next_id = static_cast<int64_t>((taken + 1) % g_test_tracks.size()) + 1;
+        taken++;
+        
+        TransitionPlan plan;
+        plan.from_track_id = id;
+        plan.to_track_id = next_id;
+        plan.out_point.time_seconds = 0.6f;
+        plan.in_point.time_seconds = 0.0f;
+        plan.crossfade_duration = 0.1f;
+        plan.bpm_stretch_ratio = 1.0f;
+        return PlaylistEntry{id, plan};
+    }
+    
+    bool ended() const override { return false; }
+    
+    size_t taken = 0;
+};
+
+void test_scheduler_playlist_source() {
+    std::cout << "Test: Scheduler pulls from a playlist source... ";
+    
+    g_test_tracks.clear();
+    g_test_tracks.push_back(make_sine(440.0f, 1.0f));
+    g_test_tracks.push_back(make_sine(880.0f, 1.0f));
+    g_test_tracks.push_back(make_sine(660.0f, 1.0f));
+    
+    Scheduler sched;
+    sched.set_track_loader(test_track_loader);
+    TransitionConfig config;
+    config.max_transition_seconds = 0.5f;
+    sched.set_transition_config(config);
+    
+    auto source = std::make_shared<CyclingSource>();
+    assert(sched.load_source(source));
+    assert(source->taken == 2);  // Current and next only
+    sched.play();
+    assert(sched.current_track_id() == 1);
+    assert(sched.next_track_id() == 2);
+    
+    // Play through more tracks than the scheduler keeps
+    std::vector<float> buf(512 * 2, 0.0f);
+    int64_t last_id = sched.current_track_id();
+    size_t changes = 0;
+    for (int i = 0; i < 4000 && changes < Scheduler::kSourceHistory + 4; i++) {
+        sched.render(buf.data(), 512, kSampleRate);
+        sched.poll();
+        if (sched.current_track_id() != last_id && sched.state() == PlaybackState::Playing) {
+            assert(sched.current_track_id() == last_id % 3 + 1);
+            last_id = sched.current_track_id();
+            changes++;
+            assert(source->taken == changes + 2);  // One entry ahead
+        }
+    }
+    assert(changes == Scheduler::kSourceHistory + 4);
+    assert(sched.state() != PlaybackState::Stopped);
+    
+    // Going back still works after old entries were dropped
+    int64_t before = sched.current_track_id();
+    assert(sched.previous());
+    sched.poll();
+    assert(sched.current_track_id() == (before + 1) % 3 + 1);
+    
+    sched.stop();
+    std::cout << "PASSED\n";
+}
+
+// Source whose entries after the first two are only ready once opened,
+// or never once finished
+class GatedSource : public PlaylistSource {
+public:
+    std::optional<PlaylistEntry> next_entry(bool wait) override {
+        if (wait) {
+            waits++;
+        }
+        if (source.taken >= 2 && (!open || finished)) {
+            return std::nullopt;
+        }
+        return source.next_entry(wait);
+    }
+    
+    bool ended() const override { return source.taken >= 2 && finished; }
+    
+    CyclingSource source;
+    bool open = false;
+    bool finished = false;
+    int waits = 0;
+};
+
+void test_scheduler_skip_does_not_wait() {
+    std::cout << "Test: Scheduler skip does not wait for a source... ";
+    
+    g_test_tracks.clear();
+    g_test_tracks.push_back(make_sine(440.0f, 2.0f));
+    g_test_tracks.push_back(make_sine(880.0f, 2.0f));
+    g_test_tracks.push_back(make_sine(660.0f, 2.0f));
+    
+    Scheduler sched;
+    sched.set_track_loader(test_track_loader);
+    TransitionConfig config;
+    config.max_transition_seconds = 0.5f;
+    sched.set_transition_config(config);
+    
+    auto source = std::make_shared<GatedSource>();
+    assert(sched.load_source(source));
+    const int waits = source->waits;
+    sched.play();
+    
+    // Skip to track 2; track 3 is not generated yet
+    std::vector<float> buf(512 * 2, 0.0f);
+    assert(sched.skip());
+    for (int i = 0; i < 200 && sched.current_track_id() != 2; i++) {
+        sched.render(buf.data(), 512, kSampleRate);
+        sched.poll();
+    }
+    assert(sched.current_track_id() == 2);
+    assert(sched.next_track_id() == 0);
+    
+    // The skip is accepted without blocking and waits in poll()
+    assert(sched.skip());
+    assert(source->waits == waits);
+    sched.poll();
+    assert(sched.current_track_id() == 2);
+    assert(sched.state() == PlaybackState::Playing);
+    
+    source->open = true;
+    sched.poll();
+    assert(sched.next_track_id() == 3);
+    assert(sched.state() == PlaybackState::Transitioning);
+    assert(source->waits == waits);
+    sched.stop();
+    
+    // Skipping the last track of an ended source stops, at once or once
+    // a pending skip finds out
+    auto play_second = [&](std::shared_ptr<GatedSource> gated) {
+        assert(sched.load_source(gated));
+        sched.play();
+        assert(sched.skip());
+        for (int i = 0; i < 200 && sched.current_track_id() != 2; i++) {
+            sched.render(buf.data(), 512, kSampleRate);
+            sched.poll();
+        }
+        assert(sched.current_track_id() == 2);
+    };
+    
+    auto ended = std::make_shared<GatedSource>();
+    ended->finished = true;
+    play_second(ended);
+    assert(sched.skip());
+    assert(sched.state() == PlaybackState::Stopped);
+    
+    auto ending = std::make_shared<GatedSource>();
+    play_second(ending);
+    assert(sched.skip());
+    sched.poll();
+    assert(sched.state() == PlaybackState::Playing);
+    ending->finished = true;
+    sched.poll();
+    assert(sched.state() == PlaybackState::Stopped);
+    
+    std::cout << "PASSED\n";
+}
+
+void test_playlist_session_streams() {
+    std::cout << "Test: PlaylistSession generates ahead of playback... ";
+    
+    std::vector<TrackInfo> tracks;
+    for (int i = 1; i <= 12; ++i) {
+        TrackInfo track;
+        track.id = i;
+        track.bpm = 120.0f + i;
+        track.key = static_cast<KeyCode>(i % 24);
+        track.duration = 180.0f;
+        for (float t = 0; t < track.duration; t += 60.0f / track.bpm) {
+            track.beats.push_back(t);
+        }
+        track.mfcc.assign(13, 0.1f * i);
+        track.chroma.assign(12, 0.1f);
+        track.chroma[i % 12] = 1.0f;
+        track.energy_curve.assign(100, 0.3f + 0.05f * i);
+        tracks.push_back(track);
+    }
+    auto library = std::make_shared<const FeatureMatrix>(tracks);
+    
+    std::atomic<int> loads{0};
+    auto loader = [&](int64_t id) -> std::optional<TrackInfo> {
+        loads++;
+        return tracks[static_cast<size_t>(id - 1)];
+    };
+    
+    PlaylistRules rules;
+    rules.random_seed = 5;
+    rules.energy_arc = EnergyArc::Wave;
+    PlaylistSession::Options options;
+    options.lookahead = 2;
+    options.arc_length = 8;
+    options.repeat_after = 4;
+    
+    PlaylistSession session(library, 0, rules, TransitionConfig(), loader, options);
+    
+    // Far more entries than the library has tracks
+    std::vector<PlaylistEntry> entries;
+    for (int i = 0; i < 40; ++i) {
+        auto entry = session.next_entry(true);
+        assert(entry.has_value());
+        entries.push_back(*entry);
+    }
+    assert(entries.front().track_id == 1);
+    assert(session.taken() == 40);
+    for (size_t i = 0; i + 1 < entries.size(); ++i) {
+        assert(entries[i].transition_to_next.has_value());
+        assert(entries[i].transition_to_next->from_track_id == entries[i].track_id);
+        assert(entries[i].transition_to_next->to_track_id == entries[i + 1].track_id);
+        for (size_t j = i + 1; j < entries.size() && j <= i + 4; ++j) {
+            assert(entries[i].track_id != entries[j].track_id);
+        }
+    }
+    
+    // Generation stops lookahead entries past the last one taken
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    assert(loads.load() <= 40 + 1 + static_cast<int>(options.lookahead));
+    assert(!session.ended());
+    
+    // A seed that cannot be loaded ends the session without entries
+    PlaylistSession empty(library, 0, rules, TransitionConfig(), [](int64_t) -> std::optional<TrackInfo> {
+        return std::nullopt;
+    }, options);
+    assert(!empty.next_entry(true).has_value());
+    assert(empty.ended());
+    
+    std::cout << "PASSED\n";
+}
+
+void test_scheduler_queue_edits() {
+    std::cout << "Test: Scheduler queue edits during playback... ";
+    
+    g_test_tracks.clear();
+    g_test_tracks.push_back(make_sine(440.0f, 2.0f));
+    g_test_tracks.push_back(make_sine(880.0f, 2.0f));
+    g_test_tracks.push_back(make_sine(660.0f, 2.0f));
+    g_test_tracks.push_back(make_sine(550.0f, 2.0f));
+    
+    int loads = 0;
+    std::vector<std::pair<int64_t, int64_t>> planned;
+    
+    Scheduler sched;
+    sched.set_track_loader([&](int64_t id) {
+        loads++;
+        return test_track_loader(id);
+    });
+    sched.set_transition_planner([&](int64_t from, int64_t to) -> std::optional<TransitionPlan> {
+        planned.push_back({from, to});
+        TransitionPlan plan;
+        plan.from_track_id = from;
+        plan.to_track_id = to;
+        plan.out_point.time_seconds = 1.0f;
+        plan.crossfade_duration = 0.2f;
+        plan.bpm_stretch_ratio = 1.0f;
+        return plan;
+    });
+    TransitionConfig config;
+    config.max_transition_seconds = 0.5f;
+    sched.set_transition_config(config);
+    
+    Playlist playlist;
+    playlist.entries.push_back({1, std::nullopt});
+    playlist.entries.push_back({2, std::nullopt});
+    playlist.entries.push_back({3, std::nullopt});
+    assert(sched.load_playlist(playlist));
+    sched.play();
+    
+    std::vector<float> buf(512 * 2, 0.0f);
+    for (int i = 0; i < 20; i++) {
+        sched.render(buf.data(), 512, kSampleRate);
+        sched.poll();
+    }
+    const float position = sched.position();
+    assert(loads == 2);
+    
+    // The playing track and out-of-range positions cannot be edited
+    assert(!sched.remove_entry(0));
+    assert(!sched.replace_entry(0, 4));
+    assert(!sched.insert_entry(5, 4));
+    assert(!sched.move_entry(1, 3));
+    
+    // Later entry: only its transitions are planned, the next deck is kept
+    assert(sched.replace_entry(2, 4));
+    assert((sched.queue() == std::vector<int64_t>{1, 2, 4}));
+    assert(planned.size() == 1 && planned[0].first == 2 && planned[0].second == 4);
+    assert(loads == 2);
+    
+    // New next track: the next deck is re-loaded
+    planned.clear();
+    assert(sched.insert_entry(1, 3));
+    assert((sched.queue() == std::vector<int64_t>{1, 3, 2, 4}));
+    assert(planned.size() == 2);
+    assert(sched.next_track_id() == 3);
+    assert(loads == 3);
+    
+    planned.clear();
+    assert(sched.move_entry(3, 1));
+    assert((sched.queue() == std::vector<int64_t>{1, 4, 3, 2}));
+    assert(planned.size() == 2);  // 1 -> 4 and 4 -> 3; 3 -> 2 is kept
+    assert(loads == 4);
+    
+    planned.clear();
+    assert(sched.remove_entry(1));
+    assert((sched.queue() == std::vector<int64_t>{1, 3, 2}));
+    assert(planned.size() == 1 && planned[0].first == 1 && planned[0].second == 3);
+    assert(loads == 5);
+    
+    // Playback went on throughout
+    assert(sched.state() == PlaybackState::Playing);
+    assert(sched.current_track_id() == 1);
+    assert(sched.position() >= position);
+    
+    // The edited queue plays; the next track is locked while it is mixed in
+    bool locked = false;
+    for (int i = 0; i < 1000 && sched.current_track_id() == 1; i++) {
+        sched.render(buf.data(), 512, kSampleRate);
+        sched.poll();
+        if (sched.state() == PlaybackState::Transitioning && !locked) {
+            assert(!sched.remove_entry(1));
+            assert(sched.replace_entry(2, 4));
+            locked = true;
+        }
+    }
+    assert(locked);
+    assert(sched.current_track_id() == 3);
+    assert((sched.queue() == std::vector<int64_t>{3, 4}));
+    
+    sched.stop();
+    std::cout << "PASSED\n";
+}
+
 void test_scheduler_render_prealloc() {
     std::cout << "Test: Scheduler pre-allocated buffers... ";
     
@@ -732,6 +1082,408 @@ void test_engine_render_to_buffer() {
     std::cout << "PASSED\n";
 }
 
+// =============================================================================
+// 5. Scan Pipeline
+// =============================================================================
+
+void test_scan_pipeline_stages() {
+    std::cout << "Test: Scan pipeline stages... ";
+    
+    const int count = 60;
+    std::vector<ScanItem> items(count);
+    for (int i = 0; i < count; ++i) {
+        items[i].path = "/music/" + std::to_string(i) + ".mp3";
+        items[i].file_mtime = i;
+    }
+    
+    // Track how many workers run each stage at once
+    struct Gauge {
+        std::atomic<int> now{0};
+        std::atomic<int> peak{0};
+        void enter() {
+            int n = now.fetch_add(1) + 1;
+            int p = peak.load();
+            while (n > p && !peak.compare_exchange_weak(p, n)) {}
+        }
+        void leave() { now.fetch_sub(1); }
+    };
+    Gauge reading, decoding, analyzing;
+    
+    auto stage = [](Gauge& gauge, int workers, std::function<bool(ScanItem&)> body) {
+        ScanPipeline::Stage s;
+        s.workers = workers;
+        s.factory = [&gauge, body]() -> ScanPipeline::StageFn {
+            return [&gauge, body](ScanItem& item) {
+                gauge.enter();
+                bool ok = body(item);
+                gauge.leave();
+                return ok;
+            };
+        };
+        return s;
+    };
+    
+    // Reads wait on "storage"; every 7th file fails to decode
+    auto read = stage(reading, 4, [](ScanItem& item) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        item.file.data.assign(16, 0);
+        return true;
+    });
+    auto decode = stage(decoding, 2, [](ScanItem& item) {
+        if (item.file_mtime % 7 == 0) {
+            item.error = "corrupt";
+            return false;
+        }
+        item.audio.samples.assign(item.file.data.size(), 0.5f);
+        return true;
+    });
+    auto analyze = stage(analyzing, 3, [](ScanItem& item) {
+        item.features.bpm = static_cast<float>(item.audio.samples.size());
+        return true;
+    });
+    
+    std::set<std::thread::id> writer_threads;
+    int written = 0;
+    ScanPipeline::StageFn write = [&](ScanItem& item) {
+        writer_threads.insert(std::this_thread::get_id());
+        assert(item.features.bpm == 16.0f);
+        written++;
+        return true;
+    };
+    
+    ScanPipeline pipeline(read, decode, analyze, write, 2);
+    std::set<std::string> reported;
+    int failed = 0;
+    int callbacks = 0;
+    auto stats = pipeline.run(std::move(items), [&](const ScanItem& item, bool ok, const ScanStats& progress) {
+        writer_threads.insert(std::this_thread::get_id());
+        reported.insert(item.path);
+        callbacks++;
+        if (!ok) {
+            assert(item.error == "corrupt");
+            failed++;
+        }
+        assert(progress.write.completed + failed == callbacks);
+    });
+    
+    const int corrupt = (count + 6) / 7;
+    assert(static_cast<int>(reported.size()) == count);
+    assert(failed == corrupt);
+    assert(written == count - corrupt);
+    assert(writer_threads.size() == 1);
+    
+    assert(stats.read.workers == 4 && stats.read.completed == count);
+    assert(stats.decode.completed == count - corrupt && stats.decode.failed == corrupt);
+    assert(stats.analyze.completed == count - corrupt);
+    assert(stats.write.workers == 1 && stats.write.completed == count - corrupt);
+    assert(reading.peak <= 4 && decoding.peak <= 2 && analyzing.peak <= 3);
+    assert(reading.peak > 1);  // Reads overlap
+    assert(stats.read.throughput(stats.elapsed_seconds) > 0.0);
+    
+    // Skipped stages pass items through
+    ScanPipeline direct(ScanPipeline::Stage(), ScanPipeline::Stage(), ScanPipeline::Stage(),
+                        [](ScanItem&) { return true; });
+    std::vector<ScanItem> few(3);
+    int done = 0;
+    auto direct_stats = direct.run(std::move(few), [&](const ScanItem&, bool ok, const ScanStats&) {
+        assert(ok);
+        done++;
+    });
+    assert(done == 3 && direct_stats.read.workers == 0 && direct_stats.write.completed == 3);
+    
+    std::cout << "PASSED\n";
+}
+
+void test_scan_pipeline_auto_concurrency() {
+    std::cout << "Test: Scan pipeline auto concurrency... ";
+    
+    auto full = ScanPipeline::auto_concurrency(ScanConcurrency(), 32, true, true);
+    assert(full.readers > 0 && full.decoders > 0 && full.analyzers > 0 && full.queue_depth > 0);
+    assert(full.decoders + full.analyzers == 32);  // No fixed cap of 4 threads
+    
+    auto fast = ScanPipeline::auto_concurrency(ScanConcurrency(), 8, false, true);
+    assert(fast.readers == 0 && fast.decoders > 0 && fast.analyzers > 0);
+    
+    auto metadata = ScanPipeline::auto_concurrency(ScanConcurrency(), 2, false, false);
+    assert(metadata.analyzers == 0 && metadata.decoders >= 4);
+    
+    ScanConcurrency requested;
+    requested.readers = 16;
+    requested.analyzers = 3;
+    auto manual = ScanPipeline::auto_concurrency(requested, 0, true, true);
+    assert(manual.readers == 16 && manual.analyzers == 3 && manual.decoders >= 1);
+    
+    std::cout << "PASSED\n";
+}
+
+void test_engine_scan_reports_stages() {
+    std::cout << "Test: Engine scan reports stage stats... ";
+    
+    // Files that exist but do not decode: every one is read, fails in the
+    // decode stage and is still reported
+    auto dir = std::filesystem::temp_directory_path() / "automix_scan_pipeline_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const int count = 5;
+    for (int i = 0; i < count; ++i) {
+        std::ofstream(dir / ("bad" + std::to_string(i) + ".mp3")) << "not audio";
+    }
+    
+    Engine engine(":memory:");
+    ScanConcurrency concurrency;
+    concurrency.readers = 2;
+    concurrency.decoders = 2;
+    concurrency.analyzers = 1;
+    engine.set_scan_concurrency(concurrency);
+    
+    int callbacks = 0;
+    ScanStats last;
+    int result = engine.scan(dir.string(), true, [&](const ScanProgress& progress) {
+        callbacks++;
+        assert(progress.total == count);
+        last = progress.stats;
+    }, ScanMode::Full);
+    
+    assert(result == 0);
+    assert(callbacks == count);
+    const ScanStats& stats = engine.last_scan_stats();
+    assert(stats.read.workers == 2 && stats.read.completed == count);
+    assert(stats.decode.failed == count);
+    assert(stats.analyze.completed == 0 && stats.write.completed == 0);
+    assert(last.decode.failed == count);
+    
+    std::filesystem::remove_all(dir);
+    std::cout << "PASSED\n";
+}
+
+void test_engine_streaming_scan_skips_read_ahead() {
+    std::cout << "Test: Engine streaming scan skips read-ahead... ";
+    
+    auto dir = std::filesystem::temp_directory_path() / "automix_streaming_scan_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const int count = 3;
+    for (int i = 0; i < count; ++i) {
+        std::ofstream(dir / ("bad" + std::to_string(i) + ".mp3")) << "not audio";
+    }
+    
+    Engine engine(":memory:");
+    AnalyzerConfig config;
+    config.streaming = true;
+    engine.set_analyzer_config(config);
+    
+    // The analyze stage opens each path itself: no read stage fills
+    // item.file, so no encoded file is held in memory
+    assert(engine.scan(dir.string(), true, ScanProgressCallback(), ScanMode::Full) == 0);
+    const ScanStats& stats = engine.last_scan_stats();
+    assert(stats.read.workers == 0 && stats.read.completed == 0);
+    assert(stats.decode.workers == 0);
+    assert(stats.analyze.failed == count);
+    
+    std::filesystem::remove_all(dir);
+    std::cout << "PASSED\n";
+}
+
+void test_engine_rescan_skips_unchanged() {
+    std::cout << "Test: Engine rescan skips unchanged files... ";
+    
+    auto dir = std::filesystem::temp_directory_path() / "automix_rescan_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    
+    Engine engine(":memory:");
+    const int count = 50;
+    for (int i = 0; i < count; ++i) {
+        auto file = dir / ("track" + std::to_string(i) + ".mp3");
+        std::ofstream(file) << "not audio";
+        
+        // As left behind by an earlier scan
+        TrackInfo track;
+        track.path = utils::path_to_absolute(file);
+        track.analyzed_at = utils::current_timestamp();
+        track.file_modified_at = utils::file_modified_time(file);
+        engine.store().upsert_track(track);
+    }
+    
+    // A track whose file was deleted since
+    TrackInfo gone;
+    gone.path = (dir / "deleted.mp3").string();
+    gone.analyzed_at = 1;
+    engine.store().upsert_track(gone);
+    
+    int callbacks = 0;
+    int result = engine.scan(dir.string(), true, [&](const ScanProgress& progress) {
+        callbacks++;
+        assert(progress.stats.read.completed == 0);
+    }, ScanMode::Full);
+    
+    assert(result == count);
+    assert(callbacks == count);
+    assert(engine.last_scan_stats().read.completed == 0);  // Nothing reached the pipeline
+    assert(engine.track_count() == count);                // The deleted file was removed
+    
+    // Editing a file in place leaves its directory's mtime alone: the
+    // directory cache skips the listing, but the known files are still
+    // stat'ed and the edit is found
+    auto edited = dir / "track7.mp3";
+    std::filesystem::last_write_time(edited, std::filesystem::last_write_time(edited) + std::chrono::hours(1));
+    assert(engine.scan(dir.string(), true, ScanProgressCallback(), ScanMode::Full) == count - 1);
+    assert(engine.last_scan_stats().read.completed == 1);
+    
+    engine.set_directory_cache(false);
+    assert(engine.scan(dir.string(), true, ScanProgressCallback(), ScanMode::Full) == count - 1);
+    assert(engine.last_scan_stats().read.completed == 1);
+    
+    std::filesystem::remove_all(dir);
+    std::cout << "PASSED\n";
+}
+
+void test_engine_relinks_moved_files() {
+    std::cout << "Test: Engine relinks moved and copied files... ";
+    
+    auto dir = std::filesystem::temp_directory_path() / "automix_relink_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir / "old");
+    
+    // An analyzed library of three files
+    Engine engine(":memory:");
+    std::vector<int64_t> ids;
+    for (int i = 0; i < 3; ++i) {
+        auto file = dir / "old" / ("track" + std::to_string(i) + ".mp3");
+        std::ofstream(file) << "contents of track " << i;
+        
+        TrackInfo track;
+        track.path = utils::path_to_absolute(file);
+        track.bpm = 120.0f + i;
+        track.analyzed_at = utils::current_timestamp();
+        track.file_modified_at = utils::file_modified_time(file);
+        track.content_hash = file_fingerprint(track.path);
+        ids.push_back(engine.store().upsert_track(track).value());
+    }
+    
+    // Reorganized: a directory renamed, one file also copied
+    std::filesystem::rename(dir / "old", dir / "new");
+    std::filesystem::create_directories(dir / "copies");
+    std::filesystem::copy_file(dir / "new" / "track1.mp3", dir / "copies" / "track1.mp3");
+    
+    int callbacks = 0;
+    int result = engine.scan(dir.string(), true, [&](const ScanProgress&) { callbacks++; }, ScanMode::Full);
+    assert(result == 4);
+    assert(callbacks == 4);
+    assert(engine.last_scan_stats().read.completed == 0);  // Nothing was decoded
+    assert(engine.track_count() == 4);
+    
+    // Moved files keep their rows (playlists and history still point at
+    // them); of the two copies of track1 either may take the original row
+    auto copy = engine.store().get_track_by_path(utils::path_to_absolute(dir / "copies" / "track1.mp3"));
+    assert(copy.has_value() && copy->bpm == 121.0f);
+    for (int i = 0; i < 3; ++i) {
+        auto moved = engine.store().get_track_by_path(utils::path_to_absolute(dir / "new" / ("track" + std::to_string(i) + ".mp3")));
+        assert(moved.has_value());
+        assert(moved->bpm == 120.0f + i);
+        if (i == 1) {
+            assert((moved->id == ids[i]) != (copy->id == ids[i]));
+        } else {
+            assert(moved->id == ids[i]);
+        }
+    }
+    
+    // Nothing left to do on the next scan
+    assert(engine.scan(dir.string(), true, ScanProgressCallback(), ScanMode::Full) == 4);
+    assert(engine.last_scan_stats().read.completed == 0);
+    
+    std::filesystem::remove_all(dir);
+    std::cout << "PASSED\n";
+}
+
+void test_engine_watch_mode() {
+    std::cout << "Test: Engine watch mode... ";
+    
+    if (!LibraryWatcher::is_supported()) {
+        std::cout << "SKIPPED (no inotify)\n";
+        return;
+    }
+    
+    namespace fs = std::filesystem;
+    auto dir = fs::temp_directory_path() / "automix_watch_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir / "album");
+    const std::string root = utils::path_to_absolute(dir);
+    
+    // An analyzed track already in the library
+    Engine engine(":memory:");
+    auto seed = dir / "album" / "seed.mp3";
+    std::ofstream(seed) << "not audio";
+    TrackInfo track;
+    track.path = root + "/album/seed.mp3";
+    track.bpm = 124.0f;
+    track.analyzed_at = utils::current_timestamp();
+    track.file_modified_at = utils::file_modified_time(seed);
+    int64_t id = engine.store().upsert_track(track).value();
+    
+    assert(engine.start_watch(dir.string(), true));
+    
+    std::mutex mutex;
+    std::vector<WatchUpdate> updates;
+    std::thread runner([&]() {
+        engine.run_watch([&](const WatchUpdate& update) {
+            std::lock_guard<std::mutex> lock(mutex);
+            updates.push_back(update);
+        }, ScanMode::Full);
+    });
+    
+    // Copy of the updates once there are `count` of them (empty on timeout)
+    auto wait_for = [&](size_t count) {
+        for (int i = 0; i < 200; ++i) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (updates.size() >= count) return updates;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(25));
+        }
+        return std::vector<WatchUpdate>();
+    };
+    
+    // Rename: path changes in place, analysis kept
+    fs::rename(seed, dir / "album" / "renamed.mp3");
+    auto seen1 = wait_for(1);
+    assert(seen1.size() == 1);
+    assert(seen1[0].kind == WatchUpdate::Kind::Renamed);
+    auto renamed = engine.store().get_track_by_path(root + "/album/renamed.mp3");
+    assert(renamed.has_value() && renamed->id == id && renamed->bpm == 124.0f);
+    
+    // Directory move carries its tracks
+    fs::rename(dir / "album", dir / "moved");
+    auto seen2 = wait_for(2);
+    assert(seen2.size() == 2);
+    assert(seen2[1].kind == WatchUpdate::Kind::Renamed);
+    assert(engine.store().get_track(id)->path == root + "/moved/renamed.mp3");
+    
+    // New file in a new directory goes through the pipeline (undecodable here)
+    fs::create_directories(dir / "new");
+    std::ofstream(dir / "new" / "fresh.mp3") << "not audio";
+    auto seen3 = wait_for(3);
+    assert(seen3.size() == 3);
+    assert(seen3[2].kind == WatchUpdate::Kind::Failed);
+    assert(seen3[2].path == root + "/new/fresh.mp3");
+    
+    // Deletion removes the track
+    fs::remove(dir / "moved" / "renamed.mp3");
+    auto seen4 = wait_for(4);
+    assert(seen4.size() == 4);
+    assert(seen4[3].kind == WatchUpdate::Kind::Removed);
+    assert(!engine.get_track(id).has_value());
+    
+    engine.stop_watch();
+    runner.join();
+    
+    // A late stop (second Ctrl-C) still finds the watcher alive
+    engine.stop_watch();
+    assert(engine.run_watch() == -1);
+    fs::remove_all(dir);
+    std::cout << "PASSED\n";
+}
+
 // =============================================================================
 // Main
 // =============================================================================
@@ -761,10 +1513,23 @@ int main() {
     test_scheduler_hard_cut();
     test_scheduler_previous();
     test_scheduler_render_prealloc();
+    test_scheduler_playlist_source();
+    test_scheduler_skip_does_not_wait();
+    test_scheduler_queue_edits();
+    test_playlist_session_streams();
     
     // Engine integration
     test_engine_render_to_buffer();
     
+    // Scan pipeline
+    test_scan_pipeline_stages();
+    test_scan_pipeline_auto_concurrency();
+    test_engine_scan_reports_stages();
+    test_engine_streaming_scan_skips_read_ahead();
+    test_engine_rescan_skips_unchanged();
+    test_engine_relinks_moved_files();
+    test_engine_watch_mode();
+    
     std::cout << "\nAll Phase 4 tests passed!\n";
     return 0;
 }